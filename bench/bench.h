@@ -0,0 +1,73 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/bench.h Small helpers shared by the benchmark programs.
+ *
+ * The benchmarks are built by `make bench' and print plain text tables.
+ * Most take optional numeric command line arguments to change the
+ * problem size, see the top of each program.
+ */
+
+#ifndef CPP11_BENCH_H
+#define CPP11_BENCH_H 1
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Measures wall clock time since construction or the last reset().
+class Stopwatch {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start_;
+  public:
+    Stopwatch() : start_(Clock::now()) { }
+    void reset() { start_ = Clock::now(); }
+    double seconds() const {
+        return std::chrono::duration<double>(Clock::now()-start_).count();
+    }
+};
+
+// Keeps the compiler from optimizing away a computed value.
+template<typename T>
+inline void do_not_optimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Returns numeric command line argument \a n, or \a fallback.
+inline unsigned long long bench_arg(int argc, char **argv, int n,
+    unsigned long long fallback)
+{
+    return argc > n ? std::strtoull(argv[n], nullptr, 0) : fallback;
+}
+
+// Thread counts 1, 2, 4, ... up to (and including) the number of cores.
+inline std::vector<unsigned> bench_thread_counts()
+{
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned n=1; n<cores; n*=2) {
+        counts.push_back(n);
+    }
+    counts.push_back(cores);
+    return counts;
+}
+
+// Returns the \a p quantile (0..1) of \a values, which gets sorted.
+template<typename T>
+inline T bench_quantile(std::vector<T> &values, double p)
+{
+    if (values.empty()) {
+        return T();
+    }
+    std::sort(values.begin(), values.end());
+    size_t i = static_cast<size_t>(p * (values.size()-1) + 0.5);
+    return values[i];
+}
+
+#endif // CPP11_BENCH_H
+
+/* vim: set ts=4 sw=4 tw=76: */
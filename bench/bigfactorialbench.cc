@@ -0,0 +1,99 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/bigfactorialbench.cc Seconds to compute n! exactly, by
+ *       multiplying 1 * 2 * ... * n one by one, by a product tree of
+ *       1..n and by prime factors with and without threads, and to
+ *       convert it to decimal.
+ *
+ * Usage: bigfactorialbench [max_n [threads]]
+ * Runs n = 10^4, 10^5, ... up to max_n (default 10^6, 10^7 takes
+ * minutes). The one by one product, which is O(n^2), only runs up to
+ * 10^5. The pool has threads (default all cores) threads.
+ */
+
+#include "bench.h"
+
+#include "cpp11/biguint.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Seconds of \a f; \a f returns something to keep.
+template<typename F>
+double seconds(F f)
+{
+    Stopwatch watch;
+    do_not_optimize(f());
+    return watch.seconds();
+}
+
+void cell(double seconds)
+{
+    std::cout << std::setw(10) << std::fixed << std::setprecision(3)
+              << seconds;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned max_n = bench_arg(argc, argv, 1, 1000000);
+    ThreadPool pool(bench_arg(argc, argv, 2,
+        std::thread::hardware_concurrency()));
+
+    std::cout << "seconds for n!; " << pool.size() << " threads"
+              << std::endl
+              << std::setw(10) << "n" << std::setw(10) << "digits"
+              << std::setw(10) << "1by1" << std::setw(10) << "tree"
+              << std::setw(10) << "primes" << std::setw(10) << "parallel"
+              << std::setw(10) << "dec" << std::setw(10) << "dec par"
+              << std::endl;
+    for (unsigned n=10000; n<=max_n; n*=10) {
+        std::cout << std::setw(10) << n << std::flush;
+        BigUInt factorial;
+        const double parallel = seconds([&] {
+            factorial = big_factorial(n, pool);
+            return factorial.limbs().size();
+        });
+        std::string digits;
+        const double decimal = seconds([&] {
+            return factorial.to_string().size();
+        });
+        const double decimal_parallel = seconds([&] {
+            digits = factorial.to_string(pool);
+            return digits.size();
+        });
+        std::cout << std::setw(10) << digits.size() << std::flush;
+
+        if (n <= 100000) {
+            cell(seconds([&] {
+                BigUInt product = 1;
+                for (unsigned i=2; i<=n; ++i) {
+                    product *= i;
+                }
+                return product.limbs().size();
+            }));
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        cell(seconds([&] {
+            return range_product(1, n).limbs().size();
+        }));
+        cell(seconds([&] {
+            return big_factorial(n).limbs().size();
+        }));
+        cell(parallel);
+        cell(decimal);
+        cell(decimal_parallel);
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,128 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/colorparserbench.cc GB/s of parsing a text of colors with
+ *       std::stringstream per token and with the SWAR parser of
+ *       colorparser.h, sequentially, piece by piece and on a ThreadPool.
+ *
+ * Usage: colorparserbench [colors [rounds]]
+ * The text has colors (default 4M) tokens, decimal, 0x and # in turn,
+ * and is parsed rounds (default 5) times by each parser.
+ */
+
+#include "bench.h"
+
+#include "cpp11/colorparser.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string make_text(size_t colors)
+{
+    std::mt19937 random { 1 };
+    std::string text;
+    char buffer[16];
+    for (size_t i=0; i<colors; ++i) {
+        const uint32_t value = random();
+        const char *format = i % 3 == 0 ? "%u\n" : i % 3 == 1
+            ? "0x%08x\n" : "#%08x\n";
+        std::snprintf(buffer, sizeof(buffer), format, value);
+        text += buffer;
+    }
+    return text;
+}
+
+// The way without a parser: a stringstream for each token.
+ParsedColors parse_stringstream(const std::string &text)
+{
+    ParsedColors parsed;
+    std::istringstream lines { text };
+    std::string token;
+    while (lines >> token) {
+        std::stringstream in;
+        uint32_t value = 0;
+        if (token[0] == '#') {
+            in << token.substr(1);
+            in >> std::hex >> value;
+        } else if (token.size() > 1 && token[1] == 'x') {
+            in << token.substr(2);
+            in >> std::hex >> value;
+        } else {
+            in << token;
+            in >> value;
+        }
+        parsed.colors.push_back(Color::from_argb(value));
+    }
+    return parsed;
+}
+
+// GB/s of \a parse over \a rounds rounds, checking the color count.
+template<typename F>
+double rate(const std::string &text, size_t colors, unsigned rounds,
+    F parse)
+{
+    Stopwatch watch;
+    for (unsigned r=0; r<rounds; ++r) {
+        const ParsedColors parsed = parse();
+        if (parsed.colors.size() != colors || !parsed.errors.empty()) {
+            std::cerr << "wrong result" << std::endl;
+        }
+        do_not_optimize(parsed.colors.back());
+    }
+    return text.size() * double(rounds) / watch.seconds() / 1e9;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t colors = bench_arg(argc, argv, 1, 4 << 20);
+    const unsigned rounds = bench_arg(argc, argv, 2, 5);
+    const std::string text = make_text(colors);
+
+    std::cout << colors << " colors, " << text.size() / 1e6 << " MB"
+              << std::endl << std::fixed << std::setprecision(3);
+    const double slow = rate(text, colors, 1, [&] {
+        return parse_stringstream(text);
+    });
+    std::cout << std::setw(20) << "stringstream" << std::setw(8) << slow
+              << " GB/s" << std::endl;
+    const double swar = rate(text, colors, rounds, [&] {
+        return parse_colors(text.data(), text.size());
+    });
+    std::cout << std::setw(20) << "swar" << std::setw(8) << swar
+              << " GB/s " << std::setw(6) << std::setprecision(0)
+              << swar / slow << "x" << std::setprecision(3) << std::endl;
+    const double stream = rate(text, colors, rounds, [&] {
+        ColorStreamParser parser;
+        ParsedColors parsed;
+        for (size_t at=0; at<text.size(); at+=65536) {
+            parser.parse(text.data() + at,
+                std::min<size_t>(65536, text.size() - at), parsed);
+        }
+        parser.finish(parsed);
+        return parsed;
+    });
+    std::cout << std::setw(20) << "swar, 64 KiB pieces" << std::setw(8)
+              << stream << " GB/s" << std::endl;
+    for (unsigned threads: bench_thread_counts()) {
+        ThreadPool pool { threads };
+        const double parallel = rate(text, colors, rounds, [&] {
+            return parse_colors(text.data(), text.size(), pool);
+        });
+        std::cout << std::setw(20) << "swar, " + std::to_string(threads)
+                + " threads" << std::setw(8) << parallel << " GB/s"
+                  << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,128 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/colorspacebench.cc Million colors per second of the table
+ *       driven conversions of colorspace.h against the direct math.
+ *
+ * Usage: colorspacebench [colors [rounds]]
+ * Each conversion runs rounds (default 20) times over colors (default
+ * 1M) random colors; "direct" computes the same with std::pow() and
+ * floating point weights.
+ */
+
+#include "bench.h"
+
+#include "cpp11/colorspace.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Million colors per second of \a convert over \a rounds rounds.
+template<typename F>
+double rate(size_t n, unsigned rounds, F convert)
+{
+    Stopwatch watch;
+    for (unsigned r=0; r<rounds; ++r) {
+        convert();
+    }
+    return n * rounds / watch.seconds() / 1e6;
+}
+
+void print(const char *name, double table, double direct)
+{
+    std::cout << std::setw(10) << name << std::fixed
+              << std::setprecision(0) << std::setw(10) << table
+              << std::setw(10) << direct << std::setprecision(1)
+              << std::setw(9) << table / direct << "x" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t n = bench_arg(argc, argv, 1, 1 << 20);
+    const unsigned rounds = bench_arg(argc, argv, 2, 20);
+
+    std::mt19937 random { 1 };
+    std::vector<Color> colors(n), back(n);
+    for (Color &c: colors) {
+        c = Color::from_argb(random());
+    }
+    std::vector<LinearColor> light(n);
+    std::vector<uint8_t> grays(n);
+    std::vector<YCbCr> ycc(n);
+
+    std::cout << n << " colors, Mcolor/s" << std::endl
+              << std::setw(10) << "" << std::setw(10) << "table"
+              << std::setw(10) << "direct" << std::setw(10) << "speedup"
+              << std::endl;
+    print("decode", rate(n, rounds, [&] {
+            to_linear(colors.data(), light.data(), n);
+        }), rate(n, rounds, [&] {
+            for (size_t i=0; i<n; ++i) {
+                const Color c = colors[i];
+                light[i] = LinearColor { c.a() / 255.0f,
+                    srgb_to_linear_exact(c.r()),
+                    srgb_to_linear_exact(c.g()),
+                    srgb_to_linear_exact(c.b()) };
+            }
+        }));
+    print("encode", rate(n, rounds, [&] {
+            from_linear(light.data(), back.data(), n);
+        }), rate(n, rounds, [&] {
+            for (size_t i=0; i<n; ++i) {
+                const LinearColor &l = light[i];
+                back[i] = Color(uint8_t(l.a * 255 + 0.5f),
+                    linear_to_srgb_exact(l.r), linear_to_srgb_exact(l.g),
+                    linear_to_srgb_exact(l.b));
+            }
+        }));
+    do_not_optimize(back[n / 2]);
+    print("gray", rate(n, rounds, [&] {
+            to_gray(colors.data(), grays.data(), n);
+        }), rate(n, rounds, [&] {
+            for (size_t i=0; i<n; ++i) {
+                const Color c = colors[i];
+                grays[i] = uint8_t(std::lround(0.299 * c.r()
+                    + 0.587 * c.g() + 0.114 * c.b()));
+            }
+        }));
+    print("luminance", rate(n, rounds, [&] {
+            to_luminance(colors.data(), grays.data(), n);
+        }), rate(n, rounds, [&] {
+            for (size_t i=0; i<n; ++i) {
+                const Color c = colors[i];
+                grays[i] = linear_to_srgb_exact(
+                    0.2126f * srgb_to_linear_exact(c.r())
+                    + 0.7152f * srgb_to_linear_exact(c.g())
+                    + 0.0722f * srgb_to_linear_exact(c.b()));
+            }
+        }));
+    do_not_optimize(grays[n / 2]);
+    print("ycbcr", rate(n, rounds, [&] {
+            to_ycbcr(colors.data(), ycc.data(), n);
+        }), rate(n, rounds, [&] {
+            for (size_t i=0; i<n; ++i) {
+                const double r = colors[i].r(), g = colors[i].g(),
+                    b = colors[i].b();
+                ycc[i] = YCbCr {
+                    uint8_t(std::lround(0.299 * r + 0.587 * g
+                        + 0.114 * b)),
+                    uint8_t(std::lround(128 - 0.168735892 * r
+                        - 0.331264108 * g + 0.5 * b)),
+                    uint8_t(std::lround(128 + 0.5 * r
+                        - 0.418687589 * g - 0.081312411 * b)) };
+            }
+        }));
+    do_not_optimize(ycc[n / 2].cr);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
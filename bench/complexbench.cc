@@ -0,0 +1,145 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/complexbench.cc Loops over std::complex<long double> (as
+ *       the _i literals give) against the kernels of ComplexArray and
+ *       FftPlan, for float and double and each kernel set.
+ *
+ * Usage: complexbench [size [rounds]]
+ * Arrays and transforms have size (default 4096, a power of two)
+ * numbers, each measurement runs rounds (default 1000) times. The naive
+ * FFT is the textbook recursive radix-2 one.
+ */
+
+#include "bench.h"
+
+#include "cpp11/fft.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::complex<long double> Complex;
+
+void naive_fft(std::vector<Complex> &x)
+{
+    const size_t n = x.size();
+    if (n < 2) {
+        return;
+    }
+    std::vector<Complex> even(n / 2), odd(n / 2);
+    for (size_t i=0; i<n/2; ++i) {
+        even[i] = x[2 * i];
+        odd[i] = x[2 * i + 1];
+    }
+    naive_fft(even);
+    naive_fft(odd);
+    const long double pi = 3.141592653589793238462643383279502884L;
+    for (size_t k=0; k<n/2; ++k) {
+        const Complex t = std::exp(-2 * pi * k / n * 1.0_i) * odd[k];
+        x[k] = even[k] + t;
+        x[k + n / 2] = even[k] - t;
+    }
+}
+
+// Nanoseconds per number (or per transform) of \a f.
+template<typename F>
+double ns(size_t per_round, unsigned rounds, F f)
+{
+    Stopwatch watch;
+    for (unsigned r=0; r<rounds; ++r) {
+        f();
+    }
+    return watch.seconds() * 1e9 / rounds / per_round;
+}
+
+void row(const std::string &name, double madd, double abs, double fft)
+{
+    std::cout << std::setw(16) << name << std::fixed
+              << std::setprecision(2) << std::setw(10) << madd
+              << std::setw(10) << abs << std::setprecision(1)
+              << std::setw(12) << fft << std::endl;
+}
+
+template<typename T>
+void measure(const char *type, size_t n, unsigned rounds)
+{
+    std::mt19937 random { 1 };
+    std::uniform_real_distribution<T> value { -1, 1 };
+    for (const ComplexKernels<T> *k: available_complex_kernels<T>()) {
+        ComplexArray<T> a(n, *k), b(n, *k), sum(n, *k);
+        for (size_t i=0; i<n; ++i) {
+            a.set(i, std::complex<T>(value(random), value(random)));
+            b.set(i, std::complex<T>(value(random), value(random)));
+        }
+        const double madd = ns(n, rounds, [&] {
+            sum.multiply_add(a, b);
+        });
+        std::vector<T> magnitude;
+        const double abs = ns(n, rounds, [&] {
+            magnitude = a.magnitude();
+        });
+        do_not_optimize(magnitude[n / 2]);
+        const FftPlan<T> plan { n, *k };
+        // Back and forth, so that the values stay the same.
+        const double fft = ns(2, rounds, [&] {
+            plan.forward(a);
+            plan.inverse(a);
+        }) / 1000;
+        row(std::string(type) + " " + k->name, madd, abs, fft);
+        do_not_optimize(sum[n / 2]);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t n = bench_arg(argc, argv, 1, 4096);
+    const unsigned rounds = bench_arg(argc, argv, 2, 1000);
+
+    std::cout << n << " complex numbers; ns per number for multiply-add"
+              << " and |z|, us per FFT" << std::endl
+              << std::setw(16) << "" << std::setw(10) << "madd"
+              << std::setw(10) << "|z|" << std::setw(12) << "fft"
+              << std::endl;
+    std::mt19937 random { 1 };
+    std::uniform_real_distribution<long double> value { -1, 1 };
+    std::vector<Complex> a(n), b(n), sum(n);
+    for (size_t i=0; i<n; ++i) {
+        a[i] = Complex(value(random), value(random));
+        b[i] = Complex(value(random), value(random));
+    }
+    const double madd = ns(n, rounds, [&] {
+        for (size_t i=0; i<n; ++i) {
+            sum[i] += a[i] * b[i];
+        }
+    });
+    std::vector<long double> magnitude(n);
+    const double abs = ns(n, rounds, [&] {
+        for (size_t i=0; i<n; ++i) {
+            magnitude[i] = std::abs(a[i]);
+        }
+    });
+    do_not_optimize(magnitude[n / 2]);
+    // The naive FFT is slow, fewer rounds do.
+    const unsigned fft_rounds = rounds / 10 + 1;
+    const double fft = ns(1, fft_rounds, [&] {
+        std::vector<Complex> x = a;
+        naive_fft(x);
+        do_not_optimize(x[n / 2]);
+    }) / 1000;
+    row("long double", madd, abs, fft);
+    do_not_optimize(sum[n / 2]);
+
+    measure<float>("float", n, rounds);
+    measure<double>("double", n, rounds);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
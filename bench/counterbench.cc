@@ -0,0 +1,74 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/counterbench.cc Increment throughput of a shared
+ *       std::atomic against a ShardedCounter.
+ *
+ * Usage: counterbench [increments_per_thread]
+ * Printed are million increments per second (all threads together) for
+ * 1, 2, 4, ... threads up to twice the number of cores.
+ */
+
+#include "bench.h"
+
+#include "cpp11/counter.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+template<typename F>
+double run(unsigned threads, unsigned long increments, F increment)
+{
+    std::vector<std::thread> workers;
+    Stopwatch watch;
+    for (unsigned t=0; t<threads; ++t) {
+        workers.emplace_back([&] {
+            for (unsigned long n=0; n<increments; ++n) {
+                increment();
+            }
+        });
+    }
+    for (auto &w: workers) {
+        w.join();
+    }
+    return threads * increments / watch.seconds() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long increments = bench_arg(argc, argv, 1, 10000000);
+
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "atomic"
+              << std::setw(12) << "sharded" << "  (M increments/s)"
+              << std::endl;
+    std::vector<unsigned> counts = bench_thread_counts();
+    counts.push_back(2 * counts.back());
+    for (unsigned threads: counts) {
+        std::atomic<uint64_t> shared { 0 };
+        ShardedCounter sharded;
+        const double a = run(threads, increments, [&shared] {
+            shared.fetch_add(1, std::memory_order_relaxed);
+        });
+        const double b = run(threads, increments, [&sharded] {
+            ++sharded;
+        });
+        if (shared.load() != sharded.value()) {
+            std::cerr << "count mismatch" << std::endl;
+            return 1;
+        }
+        std::cout << std::setw(8) << threads << std::fixed
+                  << std::setprecision(1) << std::setw(12) << a
+                  << std::setw(12) << b << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
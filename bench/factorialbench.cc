@@ -0,0 +1,92 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/factorialbench.cc Nanoseconds per binomial probability
+ *       C(n, k) p^k (1-p)^(n-k), with the coefficient recomputed, from
+ *       lgamma() and from the tables of factorial.h.
+ *
+ * Usage: factorialbench [rounds]
+ * Each way computes all probabilities for n = 60 (where binomial64()
+ * applies) and n = 1000, rounds (default 2000) times.
+ */
+
+#include "bench.h"
+
+#include "cpp11/factorial.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+// As in code without tables: a product of k fractions.
+double choose(unsigned n, unsigned k)
+{
+    double c = 1;
+    for (unsigned i=1; i<=k; ++i) {
+        c = c * (n - k + i) / i;
+    }
+    return c;
+}
+
+// Nanoseconds per probability of \a pmf(k) for k = 0..n.
+template<typename F>
+double ns(unsigned n, unsigned rounds, F pmf)
+{
+    double sum = 0;
+    Stopwatch watch;
+    for (unsigned r=0; r<rounds; ++r) {
+        for (unsigned k=0; k<=n; ++k) {
+            sum += pmf(k);
+        }
+    }
+    const double elapsed = watch.seconds();
+    // All probabilities sum to one per round.
+    if (std::fabs(sum / rounds - 1) > 1e-9) {
+        std::cerr << "wrong sum " << sum / rounds << std::endl;
+    }
+    return elapsed * 1e9 / rounds / (n + 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned rounds = bench_arg(argc, argv, 1, 2000);
+    const double p = 0.3, log_p = std::log(p), log_q = std::log(1 - p);
+
+    std::cout << "ns per binomial probability" << std::endl
+              << std::setw(6) << "n" << std::setw(12) << "recompute"
+              << std::setw(10) << "lgamma" << std::setw(12) << "log table"
+              << std::setw(12) << "binomial64" << std::endl;
+    for (unsigned n: { 60u, 1000u }) {
+        const double recompute = ns(n, rounds, [&](unsigned k) {
+            return choose(n, k) * std::pow(p, k) * std::pow(1 - p, n - k);
+        });
+        const double lgamma = ns(n, rounds, [&](unsigned k) {
+            return std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0)
+                - std::lgamma(n - k + 1.0) + k * log_p + (n - k) * log_q);
+        });
+        const double table = ns(n, rounds, [&](unsigned k) {
+            return std::exp(log_binomial(n, k) + k * log_p
+                + (n - k) * log_q);
+        });
+        std::cout << std::setw(6) << n << std::fixed
+                  << std::setprecision(1) << std::setw(12) << recompute
+                  << std::setw(10) << lgamma << std::setw(12) << table;
+        if (n <= max_binomial64) {
+            const double exact = ns(n, rounds, [&](unsigned k) {
+                return binomial64(n, k) * std::pow(p, k)
+                    * std::pow(1 - p, n - k);
+            });
+            std::cout << std::setw(12) << exact;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
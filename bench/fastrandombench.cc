@@ -0,0 +1,115 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/fastrandombench.cc Millions of values per second of the
+ *       standard engines, Xoshiro256StarStar and Pcg64 through <random>
+ *       distributions, and of the fills of BatchRandom per kernel set.
+ *
+ * Usage: fastrandombench [count]
+ * Each way makes count (default 10^7) dice rolls, uniform doubles in
+ * [0, 1) and normal doubles, into an array of 4096 values at a time.
+ */
+
+#include "bench.h"
+
+#include "cpp11/fastrandom.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t block = 4096;
+
+void row(const std::string &name, double dice, double real,
+    double normal)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << dice << std::setw(10) << real << std::setw(10) << normal
+              << std::endl;
+}
+
+// Millions of values per second of \a fill, which fills a block.
+template<typename F>
+double rate(size_t count, F fill)
+{
+    const size_t rounds = (count + block - 1) / block;
+    Stopwatch watch;
+    for (size_t r=0; r<rounds; ++r) {
+        fill();
+    }
+    return rounds * block / watch.seconds() / 1e6;
+}
+
+template<typename Engine>
+void measure(const char *name, size_t count)
+{
+    Engine engine;
+    std::vector<int> dice(block);
+    std::vector<double> values(block);
+    std::uniform_int_distribution<> roll_a_dice { 1, 6 };
+    std::uniform_real_distribution<> uniform;
+    std::normal_distribution<> normal;
+    const double d = rate(count, [&] {
+        for (int &v: dice) {
+            v = roll_a_dice(engine);
+        }
+        do_not_optimize(dice.data());
+    });
+    const double u = rate(count, [&] {
+        for (double &v: values) {
+            v = uniform(engine);
+        }
+        do_not_optimize(values.data());
+    });
+    const double n = rate(count, [&] {
+        for (double &v: values) {
+            v = normal(engine);
+        }
+        do_not_optimize(values.data());
+    });
+    row(name, d, u, n);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t count = bench_arg(argc, argv, 1, 10000000);
+
+    std::cout << std::setw(24) << std::left << "M values/s" << std::right
+              << std::setw(10) << "dice" << std::setw(10) << "uniform"
+              << std::setw(10) << "normal" << std::endl;
+    measure<std::default_random_engine>("default_random_engine", count);
+    measure<std::mt19937_64>("mt19937_64", count);
+    measure<Xoshiro256StarStar>("Xoshiro256StarStar", count);
+    measure<Pcg64>("Pcg64", count);
+
+    for (const RandomKernels *k: available_random_kernels()) {
+        BatchRandom random(0, *k);
+        std::vector<int32_t> dice(block);
+        std::vector<double> values(block);
+        const double d = rate(count, [&] {
+            random.fill_uniform(dice.data(), block, 1, 6);
+            do_not_optimize(dice.data());
+        });
+        const double u = rate(count, [&] {
+            random.fill_uniform(values.data(), block);
+            do_not_optimize(values.data());
+        });
+        const double n = rate(count, [&] {
+            random.fill_normal(values.data(), block);
+            do_not_optimize(values.data());
+        });
+        row(std::string("BatchRandom ") + k->name, d, u, n);
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,83 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/futurebench.cc A deep chain of dependent steps with
+ *       std::async against Future::then() on a ThreadPool.
+ *
+ * Usage: futurebench [depth [async_depth]]
+ * Each step adds one to the result of the previous step. With then(),
+ * a chain of depth steps (default 100000) is set up and then started;
+ * std::async needs a thread blocked in get() per pending step, so its
+ * chain is shorter (async_depth, default 1000). Printed is the time
+ * per step, and the time of a fan-out of depth tasks joined by
+ * when_all().
+ */
+
+#include "bench.h"
+
+#include "cpp11/future.h"
+
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    const unsigned long depth = bench_arg(argc, argv, 1, 100000);
+    const unsigned long async_depth = bench_arg(argc, argv, 2, 1000);
+
+    // std::async: every step is a thread waiting for its predecessor.
+    Stopwatch watch;
+    std::future<unsigned long> last = std::async(std::launch::async,
+        [] { return 0ul; });
+    for (unsigned long n=0; n<async_depth; ++n) {
+        last = std::async(std::launch::async,
+            [](std::future<unsigned long> previous) {
+                return previous.get() + 1;
+            }, std::move(last));
+    }
+    const bool async_ok = last.get() == async_depth;
+    const double async_step = watch.seconds() / async_depth;
+
+    PoolExecutor &executor = PoolExecutor::shared();
+    watch.reset();
+    Promise<unsigned long> start;
+    Future<unsigned long> chain = start.get_future();
+    for (unsigned long n=0; n<depth; ++n) {
+        chain = chain.then(executor,
+            [](unsigned long x) { return x + 1; });
+    }
+    const double build = watch.seconds();
+    watch.reset();
+    start.set_value(0);
+    const bool then_ok = chain.get() == depth;
+    const double run = watch.seconds();
+
+    watch.reset();
+    std::vector<Future<unsigned long>> tasks;
+    tasks.reserve(depth);
+    for (unsigned long n=0; n<depth; ++n) {
+        tasks.push_back(spawn(executor, [n] { return n; }));
+    }
+    const std::vector<unsigned long> all = when_all(std::move(tasks)).get();
+    const double fan_out = watch.seconds();
+
+    if (!async_ok || !then_ok || all.size() != depth) {
+        std::cerr << "wrong result" << std::endl;
+        return 1;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << "std::async chain of " << async_depth << ": "
+              << async_step * 1e6 << " us per step" << std::endl
+              << "then() chain of " << depth << ": "
+              << build * 1e6 / depth << " us to attach, "
+              << run * 1e6 / depth << " us to run per step" << std::endl
+              << "when_all of " << depth << " tasks: "
+              << fan_out * 1e6 / depth << " us per task" << std::endl;
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
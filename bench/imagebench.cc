@@ -0,0 +1,96 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/imagebench.cc Megapixels per second of the pixel kernels
+ *       of Image, for each kernel set the CPU supports.
+ *
+ * Usage: imagebench [width [height [frames]]]
+ * Each kernel processes frames (default 100) of width x height (default
+ * 1920x1080) pixels. Splitting into and merging from a PlanarImage is
+ * measured once, it has no SIMD kernels.
+ */
+
+#include "bench.h"
+
+#include "cpp11/image.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Megapixels per second of \a kernel over \a frames frames.
+template<typename F>
+double rate(size_t pixels, unsigned frames, F kernel)
+{
+    Stopwatch watch;
+    for (unsigned f=0; f<frames; ++f) {
+        kernel();
+    }
+    return pixels * frames / watch.seconds() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t width = bench_arg(argc, argv, 1, 1920);
+    const size_t height = bench_arg(argc, argv, 2, 1080);
+    const unsigned frames = bench_arg(argc, argv, 3, 100);
+    const size_t n = width * height;
+
+    std::mt19937 random { 1 };
+    std::vector<uint32_t> src(n), dst(n);
+    for (size_t i=0; i<n; ++i) {
+        src[i] = random();
+        dst[i] = random();
+    }
+    available_pixel_kernels().front()->premultiply(src.data(),
+        src.data(), n);
+
+    std::cout << width << "x" << height << " pixels, Mpixel/s" << std::endl
+              << std::setw(8) << "kernels" << std::setw(10) << "fill"
+              << std::setw(10) << "blend" << std::setw(10) << "premul"
+              << std::setw(10) << "to rgba" << std::setw(10) << "to bgra"
+              << std::endl;
+    for (const PixelKernels *k: available_pixel_kernels()) {
+        std::cout << std::setw(8) << k->name << std::fixed
+                  << std::setprecision(0)
+                  << std::setw(10) << rate(n, frames, [&] {
+                         k->fill(dst.data(), n, 0xff102030);
+                     })
+                  << std::setw(10) << rate(n, frames, [&] {
+                         k->blend(dst.data(), src.data(), n);
+                     })
+                  << std::setw(10) << rate(n, frames, [&] {
+                         k->premultiply(dst.data(), src.data(), n);
+                     })
+                  << std::setw(10) << rate(n, frames, [&] {
+                         k->argb_to_rgba(dst.data(), src.data(), n);
+                     })
+                  << std::setw(10) << rate(n, frames, [&] {
+                         k->swap_bytes(dst.data(), src.data(), n);
+                     })
+                  << std::endl;
+        do_not_optimize(dst[n / 2]);
+    }
+
+    Image image { width, height };
+    image.convert_from(PixelFormat::argb, src.data());
+    PlanarImage planar { width, height };
+    const double split = rate(n, frames, [&] {
+        planar = PlanarImage(image);
+    });
+    const double merge = rate(n, frames, [&] {
+        planar.merge_into(image);
+    });
+    std::cout << "planar split " << split << ", merge " << merge
+              << " Mpixel/s" << std::endl;
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
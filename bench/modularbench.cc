@@ -0,0 +1,142 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/modularbench.cc C(n, k) mod p by recomputing factorials as
+ *       factorial_func does, from tables with %, and by
+ *       ModularCombinatorics one by one, in batches and in parallel.
+ *
+ * Usage: modularbench [N [queries]]
+ * Tables go up to N (default 10^7); queries (default 10^8) random C(n,
+ * k) with n <= N are answered by each way but the recomputing one,
+ * which gets 100. p is 10^9 + 7.
+ */
+
+#include "bench.h"
+
+#include "cpp11/modular.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+
+const uint64_t p = 1000000007;
+
+uint64_t mul_mod(uint64_t a, uint64_t b)
+{
+    return static_cast<uint64_t>(uint128_t{a} * b % p);
+}
+
+uint64_t power_mod(uint64_t base, uint64_t exponent)
+{
+    uint64_t result = 1;
+    for (; exponent; exponent >>= 1, base = mul_mod(base, base)) {
+        if (exponent & 1) {
+            result = mul_mod(result, base);
+        }
+    }
+    return result;
+}
+
+uint64_t factorial_mod(uint32_t n)
+{
+    uint64_t result = 1;
+    for (uint32_t i=2; i<=n; ++i) {
+        result = mul_mod(result, i);
+    }
+    return result;
+}
+
+void row(const char *name, double seconds, size_t count)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(12)
+              << seconds * 1e9 / count << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const uint32_t max_n = bench_arg(argc, argv, 1, 10000000);
+    const uint64_t count = bench_arg(argc, argv, 2, 100000000);
+    ThreadPool pool;
+
+    Stopwatch watch;
+    const ModularCombinatorics serial(max_n, p);
+    const double serial_build = watch.seconds();
+    watch.reset();
+    const ModularCombinatorics mod(max_n, p, pool);
+    const double parallel_build = watch.seconds();
+    std::cout << "tables up to " << max_n << ": " << std::setprecision(3)
+              << serial_build << " s, on " << pool.size() << " threads "
+              << parallel_build << " s" << std::endl;
+
+    // A block of queries, answered again and again.
+    std::mt19937 random { 1 };
+    std::vector<BinomialQuery> queries(std::min<uint64_t>(count,
+        1 << 20));
+    for (BinomialQuery &q: queries) {
+        q.n = std::uniform_int_distribution<uint32_t>(0, max_n)(random);
+        q.k = std::uniform_int_distribution<uint32_t>(0, q.n)(random);
+    }
+    const size_t rounds = (count + queries.size() - 1) / queries.size();
+    const size_t total = rounds * queries.size();
+
+    std::cout << "ns per C(n, k) mod p" << std::endl;
+    uint64_t sum = 0;
+    watch.reset();
+    for (size_t i=0; i<100; ++i) {
+        const BinomialQuery &q = queries[i];
+        sum += mul_mod(factorial_mod(q.n), power_mod(mul_mod(
+            factorial_mod(q.k), factorial_mod(q.n - q.k)), p - 2));
+    }
+    row("recompute", watch.seconds(), 100);
+
+    // Plain tables, with a division per product.
+    std::vector<uint64_t> factorials(max_n + 1), inverses(max_n + 1);
+    for (uint32_t n=0; n<=max_n; ++n) {
+        factorials[n] = mod.factorial(n);
+        inverses[n] = mod.inverse_factorial(n);
+    }
+    watch.reset();
+    for (size_t r=0; r<rounds; ++r) {
+        for (const BinomialQuery &q: queries) {
+            sum += mul_mod(mul_mod(factorials[q.n], inverses[q.k]),
+                inverses[q.n - q.k]);
+        }
+    }
+    row("tables with %", watch.seconds(), total);
+
+    watch.reset();
+    for (size_t r=0; r<rounds; ++r) {
+        for (const BinomialQuery &q: queries) {
+            sum += mod.binomial(q.n, q.k);
+        }
+    }
+    row("Montgomery", watch.seconds(), total);
+
+    std::vector<uint64_t> results(queries.size());
+    watch.reset();
+    for (size_t r=0; r<rounds; ++r) {
+        mod.binomials(queries.data(), queries.size(), results.data());
+        sum += results[r % results.size()];
+    }
+    row("batch, prefetched", watch.seconds(), total);
+
+    watch.reset();
+    for (size_t r=0; r<rounds; ++r) {
+        results = mod.binomials(queries, pool);
+        sum += results[r % results.size()];
+    }
+    row("batch on the pool", watch.seconds(), total);
+    do_not_optimize(sum);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
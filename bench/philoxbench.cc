@@ -0,0 +1,122 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/philoxbench.cc Millions of values per second of Philox4x32
+ *       one by one and in fills, and of parallel_for_random on pools of
+ *       1, 2, 4, ... threads, with a checksum that must not change with
+ *       the number of threads.
+ *
+ * Usage: philoxbench [items [values]]
+ * items (default 10^5) work items each draw values (default 1000) 32
+ * bit values, or uniform doubles in [0, 1).
+ */
+
+#include "bench.h"
+
+#include "cpp11/philox.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void row(const std::string &name, double raw, double real,
+    uint64_t checksum)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << raw << std::setw(10);
+    if (real > 0) {
+        std::cout << real;
+    } else {
+        std::cout << "-";
+    }
+    std::cout << "  " << std::hex
+              << std::setw(16) << std::setfill('0') << checksum
+              << std::setfill(' ') << std::dec << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t items = bench_arg(argc, argv, 1, 100000);
+    const size_t values = bench_arg(argc, argv, 2, 1000);
+    const double total = 1e-6 * items * values;
+
+    std::cout << std::setw(24) << std::left << "M values/s" << std::right
+              << std::setw(10) << "raw" << std::setw(10) << "uniform"
+              << "  checksum" << std::endl;
+
+    // One engine, one stream.
+    {
+        Philox4x32 engine { 42 };
+        std::uniform_real_distribution<> uniform;
+        uint64_t sum = 0;
+        Stopwatch watch;
+        for (size_t i=0; i<items*values; ++i) {
+            sum += engine();
+        }
+        const double raw = total / watch.seconds();
+        double real = 0;
+        watch.reset();
+        for (size_t i=0; i<items*values; ++i) {
+            real += uniform(engine);
+        }
+        row("one by one", raw, total / watch.seconds(), sum);
+        do_not_optimize(real);
+
+        std::vector<uint32_t> block(values);
+        sum = 0;
+        watch.reset();
+        for (size_t i=0; i<items; ++i) {
+            engine.fill(block.data(), values);
+            sum += block[i % values];
+        }
+        row("fill", total / watch.seconds(), 0, sum);
+    }
+
+    // A substream per item; the sums are reduced in index order.
+    for (unsigned threads: bench_thread_counts()) {
+        ThreadPool pool { threads };
+        std::vector<uint64_t> sums(items);
+        std::vector<double> reals(items);
+        Stopwatch watch;
+        parallel_for_random(pool, 42, size_t{0}, items,
+            [&](size_t i, Philox4x32 &engine) {
+                std::vector<uint32_t> block(values);
+                engine.fill(block.data(), values);
+                uint64_t sum = 0;
+                for (uint32_t v: block) {
+                    sum += v;
+                }
+                sums[i] = sum;
+            });
+        const double raw = total / watch.seconds();
+        watch.reset();
+        parallel_for_random(pool, 42, size_t{0}, items,
+            [&](size_t i, Philox4x32 &engine) {
+                std::uniform_real_distribution<> uniform;
+                double sum = 0;
+                for (size_t v=0; v<values; ++v) {
+                    sum += uniform(engine);
+                }
+                reals[i] = sum;
+            });
+        const double real = total / watch.seconds();
+        uint64_t checksum = 0;
+        for (size_t i=0; i<items; ++i) {
+            checksum = checksum * 31 + sums[i];
+            checksum ^= static_cast<uint64_t>(reals[i] * 1e6);
+        }
+        row(std::to_string(threads) + " threads", raw, real, checksum);
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,99 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/pipelinebench.cc End-to-end throughput of a
+ *       produce -> parse -> transform -> sink Pipeline.
+ *
+ * Usage: pipelinebench [messages [capacity]]
+ * The source formats "key,value" lines, parse splits them, transform
+ * hashes the key a few rounds and the sink sums up. Printed are the
+ * messages per second for several parse/transform worker counts and
+ * queue capacities, and the per-stage report of the last run.
+ */
+
+#include "bench.h"
+
+#include "cpp11/pipeline.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct Record {
+    std::string key;
+    uint64_t value;
+};
+
+// Returns messages per second; prints the stage report if \a verbose.
+double run(unsigned long messages, size_t capacity, unsigned workers,
+    bool verbose)
+{
+    Pipeline pipeline(capacity);
+    std::atomic<unsigned long> next { 0 };
+    uint64_t sum = 0;
+
+    pipeline.source<std::string>("produce",
+        [&](Pipeline::Emitter<std::string> &emit) {
+            const unsigned long n = next++;
+            if (n >= messages) {
+                return false;
+            }
+            emit("key" + std::to_string(n % 1000) + ","
+                + std::to_string(n));
+            return true;
+        })
+        .map<Record>("parse", [](const std::string &line) {
+            const size_t comma = line.find(',');
+            return Record { line.substr(0, comma),
+                std::stoull(line.substr(comma + 1)) };
+        }, workers)
+        .map<uint64_t>("transform", [](const Record &r) {
+            uint64_t h = 14695981039346656037ull;     // FNV-1a
+            for (unsigned round=0; round<8; ++round) {
+                for (char c: r.key) {
+                    h = (h ^ static_cast<unsigned char>(c))
+                        * 1099511628211ull;
+                }
+            }
+            return h ^ r.value;
+        }, workers)
+        .sink("sink", [&sum](const uint64_t &h) { sum += h; });
+
+    Stopwatch watch;
+    pipeline.run();
+    pipeline.wait();
+    const double seconds = watch.seconds();
+    do_not_optimize(sum);
+    if (verbose) {
+        std::cout << std::endl << pipeline.report_text();
+    }
+    return messages / seconds;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long messages = bench_arg(argc, argv, 1, 200000);
+    const size_t capacity = bench_arg(argc, argv, 2, 1024);
+
+    std::cout << messages << " messages" << std::endl;
+    std::cout << std::setw(10) << "workers" << std::setw(10) << "capacity"
+              << std::setw(14) << "messages/s" << std::endl;
+    const std::vector<unsigned> counts = bench_thread_counts();
+    for (unsigned workers: counts) {
+        for (size_t cap: { size_t{16}, capacity }) {
+            std::cout << std::setw(10) << workers << std::setw(10) << cap
+                      << std::setw(14) << std::fixed << std::setprecision(0)
+                      << run(messages, cap, workers, false) << std::endl;
+        }
+    }
+    run(messages, capacity, counts.back(), true);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
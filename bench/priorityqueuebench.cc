@@ -0,0 +1,141 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/priorityqueuebench.cc Latency of urgent messages behind
+ *       saturating bulk traffic: FIFO Queue, PriorityQueue and
+ *       DeadlineQueue.
+ *
+ * Usage: priorityqueuebench [urgent_messages [bulk_producers [backlog]]]
+ * Bulk producers keep about `backlog' messages queued, one consumer
+ * spends about a microsecond per message, and an urgent message is sent
+ * every 200us. Printed are latency quantiles of the urgent messages.
+ */
+
+#include "bench.h"
+
+#include "cpp11/consumer.h"
+#include "cpp11/priorityqueue.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Message {
+    Clock::time_point sent;
+    enum Kind { bulk, urgent, stop } kind;
+};
+
+// Adapters giving the three queues the same "urgent or not" interface.
+struct FifoAdapter {
+    Queue<Message> queue;
+    void add(const Message &m) { queue.add(m); }
+    Message get() { return queue.get(); }
+    size_t size() { return queue.size(); }
+};
+
+struct LaneAdapter {
+    PriorityQueue<Message, 2> queue;
+    void add(const Message &m) {
+        queue.add(m, m.kind == Message::bulk ? 1 : 0);
+    }
+    Message get() { return queue.get(); }
+    size_t size() { return queue.size(); }
+};
+
+struct DeadlineAdapter {
+    DeadlineQueue<Message> queue;
+    void add(const Message &m) {
+        const auto budget = m.kind == Message::bulk
+            ? std::chrono::milliseconds{100} : std::chrono::milliseconds{1};
+        queue.add(m, m.sent + budget);
+    }
+    Message get() { return queue.get(); }
+    size_t size() { return queue.size(); }
+};
+
+template<typename Adapter>
+void run(const char *name, unsigned urgent, unsigned producers,
+    size_t backlog)
+{
+    Adapter queue;
+    std::atomic<bool> done { false };
+    std::vector<double> latencies;
+    latencies.reserve(urgent);
+
+    std::thread consumer { [&] {
+        for (;;) {
+            Message m = queue.get();
+            if (m.kind == Message::stop) {
+                break;
+            }
+            if (m.kind == Message::urgent) {
+                latencies.push_back(std::chrono::duration<double,
+                    std::micro>(Clock::now() - m.sent).count());
+            }
+            // Simulated processing.
+            const auto until = Clock::now() + std::chrono::microseconds{1};
+            while (Clock::now() < until) { }
+        }
+    } };
+    std::vector<std::thread> bulk;
+    for (unsigned n=0; n<producers; ++n) {
+        bulk.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                if (queue.size() < backlog) {
+                    queue.add(Message { Clock::now(), Message::bulk });
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // Let the backlog build up before sending urgent messages.
+    while (queue.size() < backlog/2) {
+        std::this_thread::yield();
+    }
+    for (unsigned n=0; n<urgent; ++n) {
+        queue.add(Message { Clock::now(), Message::urgent });
+        std::this_thread::sleep_for(std::chrono::microseconds{200});
+    }
+    done.store(true);
+    for (auto &t: bulk) {
+        t.join();
+    }
+    queue.add(Message { Clock::now(), Message::stop });
+    consumer.join();
+
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(1)
+              << std::setw(12) << bench_quantile(latencies, 0.5)
+              << std::setw(12) << bench_quantile(latencies, 0.99)
+              << std::setw(12) << bench_quantile(latencies, 0.999)
+              << std::setw(12) << bench_quantile(latencies, 1.0)
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned urgent = bench_arg(argc, argv, 1, 2000);
+    const unsigned producers = bench_arg(argc, argv, 2, 2);
+    const size_t backlog = bench_arg(argc, argv, 3, 2000);
+
+    std::cout << urgent << " urgent messages, " << producers
+              << " bulk producers, backlog " << backlog << std::endl;
+    std::cout << std::setw(10) << "queue" << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us" << std::setw(12) << "p999 us"
+              << std::setw(12) << "max us" << std::endl;
+    run<FifoAdapter>("fifo", urgent, producers, backlog);
+    run<LaneAdapter>("lanes", urgent, producers, backlog);
+    run<DeadlineAdapter>("deadline", urgent, producers, backlog);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,72 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/profiledmutexbench.cc Cost of ProfiledMutex against a plain
+ *       std::mutex, uncontended and contended.
+ *
+ * Usage: profiledmutexbench [iterations]
+ * Each thread increments a shared counter under the lock; printed are
+ * nanoseconds per lock/unlock pair for 1, 2, 4, ... threads up to twice
+ * the number of cores, then the lock report.
+ */
+
+#include "bench.h"
+
+#include "cpp11/profiledmutex.h"
+
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+template<typename Mutex>
+double run(Mutex &mutex, unsigned threads, unsigned long iterations)
+{
+    unsigned long counter = 0;
+    std::vector<std::thread> workers;
+    Stopwatch watch;
+    for (unsigned t=0; t<threads; ++t) {
+        workers.emplace_back([&] {
+            for (unsigned long n=0; n<iterations; ++n) {
+                std::lock_guard<Mutex> lock { mutex };
+                ++counter;
+            }
+        });
+    }
+    for (auto &w: workers) {
+        w.join();
+    }
+    do_not_optimize(counter);
+    return watch.seconds() * 1e9 / (iterations * threads);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long iterations = bench_arg(argc, argv, 1, 1000000);
+
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "std::mutex"
+              << std::setw(14) << "Profiled" << "  (ns per lock)"
+              << std::endl;
+    std::vector<unsigned> counts = bench_thread_counts();
+    counts.push_back(2 * counts.back());
+    for (unsigned threads: counts) {
+        std::mutex plain;
+        ProfiledMutex profiled { "bench." + std::to_string(threads) };
+        const double a = run(plain, threads, iterations);
+        const double b = run(profiled, threads, iterations);
+        std::cout << std::setw(8) << threads << std::fixed
+                  << std::setprecision(1) << std::setw(14) << a
+                  << std::setw(14) << b << std::endl;
+    }
+    std::cout << std::endl << LockProfile::report_text();
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
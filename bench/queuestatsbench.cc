@@ -0,0 +1,106 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/queuestatsbench.cc Cost of the Queue instrumentation:
+ *       compiled out, compiled in but disabled, and enabled.
+ *
+ * Usage: queuestatsbench [messages]
+ * Measures add()+get() of one thread (no contention, so the
+ * instrumentation is not hidden behind lock waits) and the throughput of
+ * one producer and one consumer thread.
+ */
+
+#include "bench.h"
+
+#include "cpp11/consumer.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+void enable(QueueStats &stats) { stats.enable(); }
+void enable(NoQueueStats &) { }
+
+// Best of three runs with a fresh queue each, ns per message.
+template<typename Stats>
+double single_thread(bool enabled, unsigned long messages)
+{
+    double best = 1e99;
+    for (int run=0; run<3; ++run) {
+        Queue<unsigned long, Stats> queue;
+        if (enabled) {
+            enable(queue.stats());
+        }
+        Stopwatch watch;
+        for (unsigned long n=0; n<messages; ++n) {
+            queue.add(n);
+            do_not_optimize(queue.get());
+        }
+        best = std::min(best, watch.seconds() * 1e9 / messages);
+    }
+    return best;
+}
+
+template<typename Stats>
+double producer_consumer(bool enabled, unsigned long messages)
+{
+    double best = 1e99;
+    for (int run=0; run<3; ++run) {
+        Queue<unsigned long, Stats> queue;
+        if (enabled) {
+            enable(queue.stats());
+        }
+        Stopwatch watch;
+        std::thread producer { [&] {
+            for (unsigned long n=1; n<=messages; ++n) {
+                queue.add(n);
+            }
+        } };
+        unsigned long last = 0;
+        while (last != messages) {
+            last = queue.get();
+        }
+        producer.join();
+        best = std::min(best, watch.seconds() * 1e9 / messages);
+    }
+    return best;
+}
+
+void print(const char *name, double single, double pair)
+{
+    std::cout << std::setw(22) << name << std::fixed << std::setprecision(1)
+              << std::setw(18) << single << std::setw(18) << pair
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long messages = bench_arg(argc, argv, 1, 2000000);
+    // All single threaded runs first: the two thread runs leave the heap
+    // in a state that slows down whatever runs next.
+    double single[3] = {
+        single_thread<NoQueueStats>(false, messages),
+        single_thread<QueueStats>(false, messages),
+        single_thread<QueueStats>(true, messages),
+    };
+    double pair[3] = {
+        producer_consumer<NoQueueStats>(false, messages),
+        producer_consumer<QueueStats>(false, messages),
+        producer_consumer<QueueStats>(true, messages),
+    };
+    std::cout << messages << " messages" << std::endl;
+    std::cout << std::setw(22) << "stats"
+              << std::setw(18) << "1 thread ns/msg"
+              << std::setw(18) << "2 threads ns/msg" << std::endl;
+    print("compiled out", single[0], pair[0]);
+    print("compiled in, disabled", single[1], pair[1]);
+    print("enabled", single[2], pair[2]);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,132 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/rwlockbench.cc Read throughput of std::mutex,
+ *       DistributedRWLock and SeqLock against the number of readers.
+ *
+ * Usage: rwlockbench [milliseconds_per_run [write_interval_us]]
+ * Readers copy a small configuration struct as fast as they can while
+ * one writer replaces it every write_interval_us microseconds. Printed
+ * are million reads per second (all readers together).
+ */
+
+#include "bench.h"
+
+#include "cpp11/rwlock.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Config {
+    uint64_t version;
+    uint64_t limit;
+    uint64_t timeout;
+    uint64_t flags;
+};
+
+struct MutexConfig {
+    std::mutex mutex;
+    Config config;
+
+    Config read() {
+        std::lock_guard<std::mutex> lock { mutex };
+        return config;
+    }
+    void write(const Config &c) {
+        std::lock_guard<std::mutex> lock { mutex };
+        config = c;
+    }
+};
+
+struct RWLockConfig {
+    DistributedRWLock lock;
+    Config config;
+
+    Config read() {
+        ReadLock<DistributedRWLock> read { lock };
+        return config;
+    }
+    void write(const Config &c) {
+        std::lock_guard<DistributedRWLock> write { lock };
+        config = c;
+    }
+};
+
+struct SeqLockConfig {
+    SeqLock<Config> config;
+
+    Config read() { return config.load(); }
+    void write(const Config &c) { config.store(c); }
+};
+
+template<typename Shared>
+double run(unsigned readers, double seconds, unsigned interval_us)
+{
+    Shared shared;
+    std::atomic<bool> stop { false };
+    std::vector<unsigned long> reads(readers);
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<readers; ++t) {
+        threads.emplace_back([&, t] {
+            unsigned long n = 0;
+            uint64_t sum = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                sum += shared.read().limit;
+                ++n;
+            }
+            do_not_optimize(sum);
+            reads[t] = n;
+        });
+    }
+    Stopwatch watch;
+    uint64_t version = 0;
+    while (watch.seconds() < seconds) {
+        ++version;
+        shared.write(Config { version, version, version, version });
+        std::this_thread::sleep_for(std::chrono::microseconds{interval_us});
+    }
+    stop = true;
+    for (auto &t: threads) {
+        t.join();
+    }
+    const double elapsed = watch.seconds();
+    unsigned long total = 0;
+    for (unsigned long n: reads) {
+        total += n;
+    }
+    return total / elapsed / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const double seconds = bench_arg(argc, argv, 1, 500) / 1000.0;
+    const unsigned interval_us = bench_arg(argc, argv, 2, 1000);
+
+    std::cout << "Mreads/s, a write every " << interval_us << "us"
+              << std::endl;
+    std::cout << std::setw(8) << "readers" << std::setw(12) << "mutex"
+              << std::setw(12) << "rwlock" << std::setw(12) << "seqlock"
+              << std::endl;
+    for (unsigned readers: bench_thread_counts()) {
+        std::cout << std::setw(8) << readers << std::fixed
+                  << std::setprecision(2) << std::setw(12)
+                  << run<MutexConfig>(readers, seconds, interval_us)
+                  << std::setw(12)
+                  << run<RWLockConfig>(readers, seconds, interval_us)
+                  << std::setw(12)
+                  << run<SeqLockConfig>(readers, seconds, interval_us)
+                  << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,154 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/shmqueuebench.cc Throughput between two processes: ShmRing
+ *       against a Unix domain socket pair.
+ *
+ * Usage: shmqueuebench [messages [ring_bytes]]
+ * A forked child sends `messages' records of each size, the parent
+ * receives and checks them. Printed are messages and megabytes per
+ * second.
+ */
+
+#include "bench.h"
+
+#include "cpp11/shmqueue.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+void print(const char *name, size_t size, unsigned long messages,
+    double seconds)
+{
+    std::cout << std::setw(8) << name << std::setw(8) << size
+              << std::setw(14) << std::fixed << std::setprecision(0)
+              << messages / seconds << std::setw(10) << std::setprecision(1)
+              << messages * size / seconds / 1e6 << std::endl;
+}
+
+void join(pid_t child)
+{
+    int status;
+    if (::waitpid(child, &status, 0) != child || !WIFEXITED(status)
+        || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("sender failed");
+    }
+}
+
+void shm(unsigned long messages, size_t size, size_t capacity)
+{
+    const std::string name = "/cpp11-bench-" + std::to_string(::getpid());
+    ShmRing::unlink(name);
+    ShmRing ring(name, capacity);
+    Stopwatch watch;
+    const pid_t child = ::fork();
+    if (child == 0) {
+        ShmRing sender(name);
+        std::vector<char> message(size, 'm');
+        for (unsigned long n=0; n<messages; ++n) {
+            std::memcpy(message.data(), &n, sizeof(n));
+            sender.write(message.data(), size);
+        }
+        sender.close();
+        ::_exit(0);
+    }
+    unsigned long received = 0;
+    const char *data;
+    size_t length;
+    while (ring.peek(data, length)) {
+        unsigned long n;
+        std::memcpy(&n, data, sizeof(n));
+        if (n != received++ || length != size) {
+            throw std::runtime_error("shm: wrong message");
+        }
+        ring.consume();
+    }
+    const double seconds = watch.seconds();
+    join(child);
+    ShmRing::unlink(name);
+    print("shm", size, messages, seconds);
+}
+
+// Reads or writes exactly size bytes.
+template<typename Io>
+void transfer(Io io, int fd, char *buffer, size_t size)
+{
+    while (size) {
+        const ssize_t done = io(fd, buffer, size);
+        if (done <= 0) {
+            throw std::runtime_error("socket: transfer failed");
+        }
+        buffer += done;
+        size -= done;
+    }
+}
+
+void socket(unsigned long messages, size_t size)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        throw std::runtime_error("socketpair failed");
+    }
+    Stopwatch watch;
+    const pid_t child = ::fork();
+    if (child == 0) {
+        ::close(fds[0]);
+        std::vector<char> message(size, 'm');
+        for (unsigned long n=0; n<messages; ++n) {
+            std::memcpy(message.data(), &n, sizeof(n));
+            transfer([](int fd, char *p, size_t s) {
+                    return ::write(fd, p, s);
+                }, fds[1], message.data(), size);
+        }
+        ::_exit(0);
+    }
+    ::close(fds[1]);
+    std::vector<char> message(size);
+    for (unsigned long received=0; received<messages; ++received) {
+        transfer([](int fd, char *p, size_t s) {
+                return ::read(fd, p, s);
+            }, fds[0], message.data(), size);
+        unsigned long n;
+        std::memcpy(&n, message.data(), sizeof(n));
+        if (n != received) {
+            throw std::runtime_error("socket: wrong message");
+        }
+    }
+    const double seconds = watch.seconds();
+    ::close(fds[0]);
+    join(child);
+    print("socket", size, messages, seconds);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long messages = bench_arg(argc, argv, 1, 1000000);
+    const size_t capacity = bench_arg(argc, argv, 2, 1 << 20);
+
+    std::cout << messages << " messages, ring " << capacity << " bytes"
+              << std::endl;
+    std::cout << std::setw(8) << "channel" << std::setw(8) << "bytes"
+              << std::setw(14) << "messages/s" << std::setw(10) << "MB/s"
+              << std::endl;
+    for (size_t size: { 16, 64, 1024 }) {
+        shm(messages, size, capacity);
+        socket(messages, size);
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
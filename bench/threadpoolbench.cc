@@ -0,0 +1,112 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/threadpoolbench.cc Task spawn overhead: a std::thread per
+ *       task against ThreadPool::submit() and parallel_for().
+ *
+ * Usage: threadpoolbench [tasks [loop_size]]
+ * Printed are microseconds per (empty) task when each one is waited for
+ * before the next is started (latency), and when all are started first
+ * (throughput), and the time of a parallel_for over loop_size elements
+ * against a plain loop.
+ */
+
+#include "bench.h"
+
+#include "cpp11/threadpool.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+void print(const char *name, unsigned long tasks, double seconds)
+{
+    std::cout << std::setw(28) << name << std::fixed << std::setprecision(3)
+              << std::setw(12) << seconds * 1e6 / tasks << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long tasks = bench_arg(argc, argv, 1, 20000);
+    const size_t loop_size = bench_arg(argc, argv, 2, 10000000);
+    std::atomic<unsigned long> counter { 0 };
+    auto task = [&counter] {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    ThreadPool pool;
+    std::cout << tasks << " tasks, " << pool.size() << " pool threads"
+              << std::endl;
+    std::cout << std::setw(28) << "" << std::setw(12) << "us/task"
+              << std::endl;
+
+    Stopwatch watch;
+    for (unsigned long n=0; n<tasks; ++n) {
+        std::thread t { task };
+        t.join();
+    }
+    print("std::thread, one by one", tasks, watch.seconds());
+
+    watch.reset();
+    for (unsigned long n=0; n<tasks; ++n) {
+        std::future<void> f = pool.submit(task);
+        f.get();
+    }
+    print("submit, one by one", tasks, watch.seconds());
+
+    watch.reset();
+    {
+        std::vector<std::thread> threads;
+        for (unsigned long n=0; n<tasks; ++n) {
+            threads.emplace_back(task);
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+    }
+    print("std::thread, all at once", tasks, watch.seconds());
+
+    watch.reset();
+    {
+        std::vector<std::future<void>> futures;
+        for (unsigned long n=0; n<tasks; ++n) {
+            futures.push_back(pool.submit(task));
+        }
+        for (auto &f: futures) {
+            pool.wait(f);
+        }
+    }
+    print("submit, all at once", tasks, watch.seconds());
+
+    watch.reset();
+    pool.parallel_for(0ul, tasks, [&](unsigned long) { task(); }, 1);
+    print("parallel_for, grain 1", tasks, watch.seconds());
+
+    // A loop with a little work per element.
+    std::vector<double> v(loop_size);
+    watch.reset();
+    for (size_t i=0; i<loop_size; ++i) {
+        v[i] = std::sqrt(static_cast<double>(i));
+    }
+    do_not_optimize(v.back());
+    const double serial = watch.seconds();
+    watch.reset();
+    pool.parallel_for(size_t{0}, loop_size,
+        [&v](size_t i) { v[i] = std::sqrt(static_cast<double>(i)); });
+    do_not_optimize(v.back());
+    const double parallel = watch.seconds();
+    std::cout << std::endl << loop_size << " sqrt: serial "
+              << std::setprecision(1) << serial * 1e3
+              << " ms, parallel_for " << parallel * 1e3 << " ms"
+              << std::endl;
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,105 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/timerwheelbench.cc Schedule, cancel and fire costs of
+ *       TimerWheel with many outstanding timers, and the lateness of
+ *       TimerService.
+ *
+ * Usage: timerwheelbench [timers [span_ticks]]
+ * Schedules timers (default 1M) with random expiries within span_ticks
+ * (default 60000, a minute of 1ms ticks), cancels every other one, then
+ * advances through the span firing the rest. Then TimerService fires
+ * 100000 timers within 200ms; printed is how late they ran.
+ */
+
+#include "bench.h"
+
+#include "cpp11/timerwheel.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    const size_t timers = bench_arg(argc, argv, 1, 1000000);
+    const uint64_t span = bench_arg(argc, argv, 2, 60000);
+
+    std::mt19937_64 random { 1 };
+    std::vector<uint64_t> expiries(timers);
+    for (auto &e: expiries) {
+        e = 1 + random() % span;
+    }
+    TimerWheel wheel;
+    std::vector<TimerWheel::TimerId> ids(timers);
+    uint64_t fired = 0;
+
+    Stopwatch watch;
+    for (size_t n=0; n<timers; ++n) {
+        ids[n] = wheel.schedule(expiries[n], [&fired] { ++fired; });
+    }
+    const double schedule = watch.seconds();
+    watch.reset();
+    for (size_t n=0; n<timers; n+=2) {
+        wheel.cancel(ids[n]);
+    }
+    const double cancel = watch.seconds();
+    const size_t outstanding = wheel.size();
+    watch.reset();
+    wheel.advance(span, [](TimerWheel::Callback &callback) {
+        callback();
+    });
+    const double fire = watch.seconds();
+    if (fired != outstanding) {
+        std::cerr << "fired " << fired << " of " << outstanding
+                  << std::endl;
+        return 1;
+    }
+    std::cout << timers << " timers over " << span << " ticks"
+              << std::endl << std::fixed << std::setprecision(1)
+              << "schedule " << schedule * 1e9 / timers << " ns, "
+              << "cancel " << cancel * 1e9 / (timers / 2) << " ns, "
+              << "fire " << fire * 1e9 / outstanding << " ns per timer"
+              << std::endl;
+
+    // Real time: how late does the service run callbacks?
+    using Clock = TimerService::Clock;
+    const size_t count = 100000;
+    std::vector<double> lateness;
+    lateness.reserve(count);
+    std::mutex mutex;
+    std::atomic<size_t> done { 0 };
+    {
+        TimerService service;
+        const Clock::time_point start = Clock::now();
+        for (size_t n=0; n<count; ++n) {
+            const Clock::time_point when = start
+                + std::chrono::microseconds(random() % 200000);
+            service.schedule_at(when, [&, when] {
+                const double late = std::chrono::duration<double>(
+                    Clock::now() - when).count();
+                {
+                    std::lock_guard<std::mutex> lock { mutex };
+                    lateness.push_back(late * 1e6);
+                }
+                ++done;
+            });
+        }
+        while (done < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    }
+    std::cout << count << " service timers in 200ms, lateness: p50 "
+              << bench_quantile(lateness, 0.5) << " us, p99 "
+              << bench_quantile(lateness, 0.99) << " us, max "
+              << bench_quantile(lateness, 1.0) << " us" << std::endl;
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
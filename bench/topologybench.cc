@@ -0,0 +1,188 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/topologybench.cc Latency and throughput between two
+ *       threads left to the scheduler against threads pinned close to
+ *       each other and far apart.
+ *
+ * Usage: topologybench [round_trips [messages]]
+ * A ping-pong of round_trips (default 1M) through two cache lines gives
+ * the latency of handing a line to the other thread; a single-producer,
+ * single-consumer ring then carries messages (default 10M) one way. The
+ * lines and the ring are in a NodeBuffer on the node of the consumer.
+ * With a single CPU, the "pinned" threads share it and only show the
+ * cost of taking turns.
+ */
+
+#include "bench.h"
+
+#include "cpp11/cacheline.h"
+#include "cpp11/topology.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Counter = std::atomic<uint64_t>;
+
+// Waits until \a value reaches \a expected, yielding now and then so
+// that threads sharing a CPU still get along.
+void await(const Counter &value, uint64_t expected)
+{
+    unsigned spins = 0;
+    while (value.load(std::memory_order_acquire) < expected) {
+        if (++spins % 64 == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// A ring of uint64_t in a NodeBuffer: head, tail and the slots each in
+// their own cache lines.
+class SpscRing {
+  public:
+    static constexpr size_t capacity = 1024;
+
+    explicit SpscRing(int node)
+        : memory_(3 * cache_line_size + capacity * sizeof(uint64_t),
+            node),
+          head_(new (memory_.as<char>()) Counter { 0 }),
+          tail_(new (memory_.as<char>() + cache_line_size) Counter { 0 }),
+          slots_(reinterpret_cast<uint64_t *>(memory_.as<char>()
+              + 2 * cache_line_size))
+    { }
+
+    void push(uint64_t value) {
+        const uint64_t tail = tail_->load(std::memory_order_relaxed);
+        if (tail >= capacity) {
+            await(*head_, tail + 1 - capacity);
+        }
+        slots_[tail % capacity] = value;
+        tail_->store(tail + 1, std::memory_order_release);
+    }
+    uint64_t pop() {
+        const uint64_t head = head_->load(std::memory_order_relaxed);
+        await(*tail_, head + 1);
+        const uint64_t value = slots_[head % capacity];
+        head_->store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+  private:
+    NodeBuffer memory_;
+    Counter *head_;
+    Counter *tail_;
+    uint64_t *slots_;
+};
+
+// Starts \a f pinned to \a cpu, or unpinned for -1.
+template<typename F>
+std::thread start(int cpu, F f)
+{
+    if (cpu < 0) {
+        return std::thread(f);
+    }
+    return pinned_thread({ static_cast<unsigned>(cpu) }, f);
+}
+
+// Nanoseconds per round trip.
+double ping_pong(int a, int b, int node, uint64_t round_trips)
+{
+    NodeBuffer memory { 2 * cache_line_size, node };
+    Counter *ping = new (memory.as<char>()) Counter { 0 };
+    Counter *pong = new (memory.as<char>() + cache_line_size) Counter { 0 };
+    std::thread echo = start(b, [=] {
+        for (uint64_t n=1; n<=round_trips; ++n) {
+            await(*ping, n);
+            pong->store(n, std::memory_order_release);
+        }
+    });
+    double seconds = 0;
+    std::thread serve = start(a, [&] {
+        Stopwatch watch;
+        for (uint64_t n=1; n<=round_trips; ++n) {
+            ping->store(n, std::memory_order_release);
+            await(*pong, n);
+        }
+        seconds = watch.seconds();
+    });
+    serve.join();
+    echo.join();
+    return seconds * 1e9 / round_trips;
+}
+
+// Million messages per second.
+double stream(int producer, int consumer, int node, uint64_t messages)
+{
+    SpscRing ring { node };
+    uint64_t sum = 0;
+    Stopwatch watch;
+    std::thread take = start(consumer, [&] {
+        for (uint64_t n=0; n<messages; ++n) {
+            sum += ring.pop();
+        }
+    });
+    std::thread give = start(producer, [&] {
+        for (uint64_t n=0; n<messages; ++n) {
+            ring.push(n);
+        }
+    });
+    give.join();
+    take.join();
+    do_not_optimize(sum);
+    return messages / watch.seconds() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const uint64_t round_trips = bench_arg(argc, argv, 1, 1000000);
+    const uint64_t messages = bench_arg(argc, argv, 2, 10000000);
+
+    const CpuTopology &topology = CpuTopology::system();
+    const std::pair<unsigned, unsigned> close = topology.close_pair();
+    const unsigned far = topology.nearest(close.first).back();
+    std::cout << topology.cpus().size() << " CPUs, "
+              << topology.nodes().size() << " nodes" << std::endl;
+
+    struct Placement {
+        std::string name;
+        int a, b;
+    };
+    std::vector<Placement> placements {
+        { "unpinned", -1, -1 },
+        { "close " + std::to_string(close.first) + "+"
+            + std::to_string(close.second),
+          int(close.first), int(close.second) },
+    };
+    if (far != close.second) {
+        placements.push_back({ "far " + std::to_string(close.first) + "+"
+            + std::to_string(far), int(close.first), int(far) });
+    }
+
+    std::cout << std::setw(16) << "placement" << std::setw(14)
+              << "round trip" << std::setw(14) << "stream"
+              << "  (ns, M messages/s)" << std::endl;
+    for (const Placement &p: placements) {
+        const int node = p.b < 0 ? -1
+            : int(topology.cpu(unsigned(p.b)).node);
+        const double latency = ping_pong(p.a, p.b, node, round_trips);
+        const double rate = stream(p.a, p.b, node, messages);
+        std::cout << std::setw(16) << p.name << std::fixed
+                  << std::setprecision(1) << std::setw(14) << latency
+                  << std::setw(14) << rate << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,73 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/waitstrategybench.cc Enqueue-to-dequeue latency of the
+ *       condition variable wait against spin-then-park at several rates.
+ *
+ * Usage: waitstrategybench [messages_per_rate]
+ * A producer sends messages paced at 1k, 10k, 100k and 1M messages per
+ * second, the consumer records the latency with the Queue statistics.
+ */
+
+#include "bench.h"
+
+#include "cpp11/consumer.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Wait>
+void run(const char *name, unsigned rate, unsigned messages)
+{
+    Queue<unsigned, QueueStats, Wait> queue;
+    queue.stats().enable();
+    std::thread consumer { [&] {
+        while (queue.get() != 0) { }
+    } };
+    const auto interval = std::chrono::nanoseconds{1000000000 / rate};
+    auto next = Clock::now();
+    for (unsigned n=1; n<=messages; ++n) {
+        next += interval;
+        // Busy pacing; sleeping would be too coarse at high rates.
+        while (Clock::now() < next) {
+            cpu_relax();
+        }
+        queue.add(n);
+    }
+    queue.add(0);
+    consumer.join();
+    const Histogram h = queue.stats().snapshot().latency;
+    std::cout << std::setw(10) << rate << std::setw(16) << name
+              << std::setw(10) << h.quantile(0.5)
+              << std::setw(10) << h.quantile(0.99)
+              << std::setw(10) << h.quantile(0.999)
+              << std::setw(12) << h.max() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned messages = bench_arg(argc, argv, 1, 20000);
+    std::cout << messages << " messages per rate, latency in ns"
+              << std::endl;
+    std::cout << std::setw(10) << "msg/s" << std::setw(16) << "wait"
+              << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p999" << std::setw(12) << "max"
+              << std::endl;
+    for (unsigned rate: { 1000u, 10000u, 100000u, 1000000u }) {
+        // Fewer messages at low rates to bound the run time.
+        const unsigned n = std::min(messages, rate);
+        run<CondVarWait>("condvar", rate, n);
+        run<SpinThenParkWait>("spin-then-park", rate, n);
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
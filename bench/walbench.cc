@@ -0,0 +1,121 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/walbench.cc Durable append throughput of WriteAheadLog
+ *       for several group commit windows.
+ *
+ * Usage: walbench [seconds_per_run [producers [record_bytes]]]
+ * The log is written below $TMPDIR (default /tmp), which should be a
+ * real disk for meaningful numbers (tmpfs makes fdatasync free). Each
+ * producer appends synchronously, waiting until its record is durable.
+ */
+
+#include "bench.h"
+
+#include "cpp11/wal.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+
+void remove_directory(const std::string &path)
+{
+    if (DIR *dir = ::opendir(path.c_str())) {
+        while (const dirent *entry = ::readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                ::unlink((path + "/" + entry->d_name).c_str());
+            }
+        }
+        ::closedir(dir);
+    }
+    ::rmdir(path.c_str());
+}
+
+void run(const std::string &base, const char *name,
+    std::chrono::microseconds window, bool sync, double seconds,
+    unsigned producers, size_t size)
+{
+    const std::string directory = base + "/cpp11-walbench-"
+        + std::to_string(::getpid());
+    remove_directory(directory);
+    WalOptions options;
+    options.max_delay = window;
+    options.sync = sync;
+    std::vector<double> latencies;
+    {
+        WriteAheadLog log(directory, options);
+        std::atomic<bool> stop { false };
+        std::vector<std::vector<double>> per_thread(producers);
+        std::vector<std::thread> threads;
+        const std::string record(size, 'r');
+        Stopwatch watch;
+        for (unsigned t=0; t<producers; ++t) {
+            threads.emplace_back([&, t] {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    Stopwatch append;
+                    log.append(record);
+                    per_thread[t].push_back(append.seconds() * 1e6);
+                }
+            });
+        }
+        while (watch.seconds() < seconds) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        stop = true;
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        const double elapsed = watch.seconds();
+        for (auto &v: per_thread) {
+            latencies.insert(latencies.end(), v.begin(), v.end());
+        }
+        const WalStats stats = log.stats();
+        std::cout << std::setw(10) << name << std::fixed
+                  << std::setprecision(0)
+                  << std::setw(12) << stats.records / elapsed
+                  << std::setw(10) << stats.batch_records.count() / elapsed
+                  << std::setprecision(1)
+                  << std::setw(10) << stats.batch_records.mean()
+                  << std::setw(10) << bench_quantile(latencies, 0.5)
+                  << std::setw(10) << bench_quantile(latencies, 0.99)
+                  << std::endl;
+    }
+    remove_directory(directory);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const double seconds = bench_arg(argc, argv, 1, 2);
+    const unsigned producers = bench_arg(argc, argv, 2, 16);
+    const size_t size = bench_arg(argc, argv, 3, 128);
+    const char *tmp = std::getenv("TMPDIR");
+    const std::string base = tmp ? tmp : "/tmp";
+
+    std::cout << producers << " producers, " << size << " byte records, "
+              << base << std::endl;
+    std::cout << std::setw(10) << "window" << std::setw(12) << "records/s"
+              << std::setw(10) << "syncs/s" << std::setw(10) << "per sync"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+              << std::endl;
+    using std::chrono::microseconds;
+    run(base, "0us", microseconds{0}, true, seconds, producers, size);
+    run(base, "100us", microseconds{100}, true, seconds, producers, size);
+    run(base, "1ms", microseconds{1000}, true, seconds, producers, size);
+    run(base, "5ms", microseconds{5000}, true, seconds, producers, size);
+    run(base, "no sync", microseconds{0}, false, seconds, producers, size);
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,123 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file bench/workstealingbench.cc Fine-grained tasks on a work-stealing
+ *       pool compared to consumers sharing one mutex Queue.
+ *
+ * Usage: workstealingbench [depth [work]]
+ * Runs a binary task tree with 2^depth leaves, each leaf spinning for
+ * `work' iterations, with 1, 2, 4, ... workers.
+ */
+
+#include "bench.h"
+
+#include "cpp11/consumer.h"
+#include "cpp11/workstealing.h"
+
+#include <atomic>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+unsigned leaf_work;
+
+void leaf()
+{
+    unsigned x = 1;
+    for (unsigned n=0; n<leaf_work; ++n) {
+        x = x*1664525u + 1013904223u;
+    }
+    do_not_optimize(x);
+}
+
+// The same tree spawned into a set of threads sharing one Queue.
+double run_shared_queue(unsigned threads, unsigned depth)
+{
+    using Task = std::function<void()>;
+    Queue<Task> queue;
+    std::atomic<long> outstanding { 1 };
+    std::function<void(unsigned)> node = [&] (unsigned d) {
+        if (d == 0) {
+            leaf();
+        } else {
+            outstanding.fetch_add(2);
+            queue.add([&node, d] { node(d-1); });
+            queue.add([&node, d] { node(d-1); });
+        }
+        if (outstanding.fetch_sub(1) == 1) {
+            // Last task done: wake everybody with an empty task.
+            for (unsigned n=0; n<threads; ++n) {
+                queue.add(Task());
+            }
+        }
+    };
+    Stopwatch watch;
+    std::vector<std::thread> consumers;
+    for (unsigned n=0; n<threads; ++n) {
+        consumers.emplace_back([&queue] {
+            while (Task task = queue.get()) {
+                task();
+            }
+        });
+    }
+    queue.add([&node, depth] { node(depth); });
+    for (auto &t: consumers) {
+        t.join();
+    }
+    return watch.seconds();
+}
+
+double run_work_stealing(unsigned threads, unsigned depth)
+{
+    WorkStealingPool pool { threads };
+    std::function<void(unsigned)> node = [&] (unsigned d) {
+        if (d == 0) {
+            leaf();
+            return;
+        }
+        pool.submit([&node, d] { node(d-1); });
+        pool.submit([&node, d] { node(d-1); });
+    };
+    Stopwatch watch;
+    pool.submit([&node, depth] { node(depth); });
+    pool.shutdown();
+    return watch.seconds();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned depth = bench_arg(argc, argv, 1, 18);
+    leaf_work = bench_arg(argc, argv, 2, 200);
+    const double tasks = 2.0 * (1u << depth) - 1;
+
+    std::cout << "task tree: " << static_cast<long>(tasks) << " tasks, "
+              << leaf_work << " iterations per leaf" << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(16) << "queue Mtask/s"
+              << std::setw(10) << "speedup"
+              << std::setw(16) << "steal Mtask/s"
+              << std::setw(10) << "speedup" << std::endl;
+    double queue_base = 0, steal_base = 0;
+    for (unsigned threads: bench_thread_counts()) {
+        double q = tasks / run_shared_queue(threads, depth) / 1e6;
+        double s = tasks / run_work_stealing(threads, depth) / 1e6;
+        if (threads == 1) {
+            queue_base = q;
+            steal_base = s;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << threads
+                  << std::setw(16) << q << std::setw(10) << q/queue_base
+                  << std::setw(16) << s << std::setw(10) << s/steal_base
+                  << std::endl;
+    }
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,646 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/biguint.cc Limb arithmetic, Karatsuba multiplication,
+ *       decimal conversion and factorials of BigUInt.
+ */
+
+#include "cpp11/biguint.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+typedef BigUInt::Limb Limb;
+typedef unsigned __int128 uint128_t;
+
+/// Limbs of the shorter factor from which on the three Karatsuba
+/// products, and conversions of halves, run in parallel.
+const size_t parallel_threshold = 1024;
+/// Numbers of at most this many limbs are converted limb by limb.
+const size_t convert_threshold = 24;
+/// Factors of a product tree multiplied one by one.
+const size_t product_leaf = 16;
+/// Factors from which on the halves of a product tree run in parallel.
+const size_t parallel_factors = 4096;
+
+const Limb ten19 = 10000000000000000000ull;
+const size_t digits_per_limb = 19;
+
+// Runs \a first on \a pool, if any, and \a second in the calling thread;
+// returns when both returned and rethrows the first exception.
+void fork_join(ThreadPool *pool, const std::function<void()> &first,
+    const std::function<void()> &second)
+{
+    if (!pool) {
+        first();
+        second();
+        return;
+    }
+    std::future<void> future = pool->submit(first);
+    std::exception_ptr error;
+    try {
+        second();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // first refers to our locals, so it is waited for in any case.
+    try {
+        pool->wait(future);
+    } catch (...) {
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// r = a + b for \a n limbs each; returns the carry.
+Limb add_n(Limb *r, const Limb *a, const Limb *b, size_t n)
+{
+    Limb carry = 0;
+    for (size_t i=0; i<n; ++i) {
+        const uint128_t sum = uint128_t{a[i]} + b[i] + carry;
+        r[i] = static_cast<Limb>(sum);
+        carry = static_cast<Limb>(sum >> 64);
+    }
+    return carry;
+}
+
+// r += a, where r has \a rn >= \a an limbs; returns the carry out.
+Limb add_in(Limb *r, size_t rn, const Limb *a, size_t an)
+{
+    Limb carry = add_n(r, r, a, an);
+    for (size_t i=an; carry && i<rn; ++i) {
+        carry = ++r[i] == 0;
+    }
+    return carry;
+}
+
+// r -= a, where r has \a rn >= \a an limbs; returns the borrow out.
+Limb sub_in(Limb *r, size_t rn, const Limb *a, size_t an)
+{
+    Limb borrow = 0;
+    for (size_t i=0; i<an; ++i) {
+        const uint128_t diff = uint128_t{r[i]} - a[i] - borrow;
+        r[i] = static_cast<Limb>(diff);
+        // A borrow wraps around and sets all high bits.
+        borrow = static_cast<Limb>(diff >> 64) & 1;
+    }
+    for (size_t i=an; borrow && i<rn; ++i) {
+        borrow = r[i]-- == 0;
+    }
+    return borrow;
+}
+
+// r = a * m for \a n limbs; returns the carry limb.
+Limb mul_1(Limb *r, const Limb *a, size_t n, Limb m)
+{
+    Limb carry = 0;
+    for (size_t i=0; i<n; ++i) {
+        const uint128_t product = uint128_t{a[i]} * m + carry;
+        r[i] = static_cast<Limb>(product);
+        carry = static_cast<Limb>(product >> 64);
+    }
+    return carry;
+}
+
+// r += a * m for \a n limbs; returns the carry limb.
+Limb addmul_1(Limb *r, const Limb *a, size_t n, Limb m)
+{
+    Limb carry = 0;
+    for (size_t i=0; i<n; ++i) {
+        const uint128_t product = uint128_t{a[i]} * m + r[i] + carry;
+        r[i] = static_cast<Limb>(product);
+        carry = static_cast<Limb>(product >> 64);
+    }
+    return carry;
+}
+
+void mul_basecase(Limb *r, const Limb *a, size_t an, const Limb *b,
+    size_t bn)
+{
+    r[an] = mul_1(r, a, an, b[0]);
+    for (size_t j=1; j<bn; ++j) {
+        r[an + j] = addmul_1(r + j, a, an, b[j]);
+    }
+}
+
+void mul(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn,
+    ThreadPool *pool);
+
+// For an >= bn > an / 2: with B = 2^(64 h) and a = a1 B + a0, b = b1 B
+// + b0, a b = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0.
+void karatsuba(Limb *r, const Limb *a, size_t an, const Limb *b,
+    size_t bn, ThreadPool *pool)
+{
+    const size_t h = (an + 1) / 2;
+    const size_t rn = an + bn;
+    ThreadPool *const fork = bn >= parallel_threshold ? pool : nullptr;
+    if (bn <= h) {
+        // Only for odd an and bn = h: b has no high half.
+        std::vector<Limb> high(an - h + bn);
+        if (fork) {
+            fork_join(fork,
+                [&] { mul(r, a, h, b, bn, pool); },
+                [&] { mul(high.data(), a + h, an - h, b, bn, pool); });
+        } else {
+            mul(r, a, h, b, bn, nullptr);
+            mul(high.data(), a + h, an - h, b, bn, nullptr);
+        }
+        std::fill(r + h + bn, r + rn, Limb{0});
+        add_in(r + h, rn - h, high.data(), high.size());
+        return;
+    }
+
+    const size_t a1n = an - h, b1n = bn - h;
+    std::vector<Limb> sa(a, a + h), sb(b, b + h);
+    sa.push_back(add_in(sa.data(), h, a + h, a1n));
+    sb.push_back(add_in(sb.data(), h, b + h, b1n));
+    const size_t san = h + (sa[h] != 0), sbn = h + (sb[h] != 0);
+    std::vector<Limb> middle(2 * h + 2);
+
+    if (fork) {
+        fork_join(fork,
+            [&] { mul(r, a, h, b, h, pool); },
+            [&] {
+                fork_join(fork,
+                    [&] { mul(r + 2 * h, a + h, a1n, b + h, b1n, pool); },
+                    [&] { mul(middle.data(), sa.data(), san, sb.data(),
+                        sbn, pool); });
+            });
+    } else {
+        // Without std::function, which costs at these sizes.
+        mul(r, a, h, b, h, nullptr);
+        mul(r + 2 * h, a + h, a1n, b + h, b1n, nullptr);
+        mul(middle.data(), sa.data(), san, sb.data(), sbn, nullptr);
+    }
+    sub_in(middle.data(), middle.size(), r, 2 * h);
+    sub_in(middle.data(), middle.size(), r + 2 * h, a1n + b1n);
+    // The middle product is below 2^(64 (rn - h)), higher limbs are 0.
+    add_in(r + h, rn - h, middle.data(),
+        std::min(middle.size(), rn - h));
+}
+
+// r = a b, where r has an + bn limbs and does not overlap a or b.
+void mul(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn,
+    ThreadPool *pool)
+{
+    if (an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    if (bn == 0) {
+        std::fill(r, r + an, Limb{0});
+    } else if (bn < BigUInt::karatsuba_threshold) {
+        mul_basecase(r, a, an, b, bn);
+    } else if (an >= 2 * bn) {
+        // Slices of a of b's size, each a balanced product.
+        std::fill(r, r + an + bn, Limb{0});
+        std::vector<Limb> slice(2 * bn);
+        for (size_t at=0; at<an; at+=bn) {
+            const size_t n = std::min(bn, an - at);
+            mul(slice.data(), a + at, n, b, bn, pool);
+            add_in(r + at, an + bn - at, slice.data(), n + bn);
+        }
+    } else {
+        karatsuba(r, a, an, b, bn, pool);
+    }
+}
+
+// About 2^(2 m) / p for p of m bits, never more and a few units less
+// at most. Newton's iteration x' = 2 x - p x^2 / 2^(2 m) doubles the
+// correct bits of x and never overshoots, so it starts from the
+// reciprocal of the top half of p.
+BigUInt reciprocal(const BigUInt &p, ThreadPool *pool)
+{
+    const size_t m = p.bits();
+    if (m <= 62) {
+        return static_cast<Limb>((uint128_t{1} << (2 * m)) / p.limbs()[0]);
+    }
+    // Two guard bits more than half keep the error below a unit or two.
+    const size_t h = (m + 1) / 2 + 2;
+    const BigUInt y = reciprocal(p >> (m - h), pool);
+    // With x = y 2^(m - h): p x^2 / 2^(2 m) = p y^2 / 2^(2 h), rounded
+    // up here so that x' stays below 2^(2 m) / p.
+    BigUInt x = y << (m - h + 1);
+    x -= (BigUInt::multiply(p, BigUInt::multiply(y, y, pool), pool)
+        >> (2 * h)) + 1;
+    return x;
+}
+
+/// Level k of a decimal conversion: 10^(19 2^k) and, where needed, its
+/// reciprocal.
+struct Power {
+    BigUInt value;
+    BigUInt reciprocal;
+    size_t bits;
+};
+
+// q, r = a / p, a % p, for a < p^2.
+void divide(const BigUInt &a, const Power &p, BigUInt &q, BigUInt &r,
+    ThreadPool *pool)
+{
+    // Only the top m + 1 bits of a matter for the quotient, so that the
+    // product is balanced. Rounds down, by a few units at most.
+    q = BigUInt::multiply(a >> (p.bits - 1), p.reciprocal, pool)
+        >> (p.bits + 1);
+    r = a - BigUInt::multiply(q, p.value, pool);
+    while (r >= p.value) {
+        r -= p.value;
+        q += 1;
+    }
+}
+
+// Writes a < 10^(38 2^k) as exactly 38 2^k digits to \a out.
+void write_digits(const BigUInt &a, const std::vector<Power> &powers,
+    size_t k, char *out, ThreadPool *pool)
+{
+    const size_t width = 2 * digits_per_limb << k;
+    if (a.limbs().size() <= convert_threshold) {
+        BigUInt rest = a;
+        char *p = out + width;
+        while (!rest.is_zero()) {
+            Limb group = rest.divide(ten19);
+            for (size_t i=0; i<digits_per_limb; ++i) {
+                *--p = static_cast<char>('0' + group % 10);
+                group /= 10;
+            }
+        }
+        std::fill(out, p, '0');
+        return;
+    }
+    BigUInt q, r;
+    divide(a, powers[k], q, r, pool);
+    fork_join(a.limbs().size() >= parallel_threshold ? pool : nullptr,
+        [&] { write_digits(q, powers, k - 1, out, pool); },
+        [&] { write_digits(r, powers, k - 1, out + width / 2, pool); });
+}
+
+std::string to_decimal(const BigUInt &a, ThreadPool *pool)
+{
+    // Squares 10^(19 2^k) until the last one's square exceeds a.
+    std::vector<Power> powers;
+    BigUInt power = ten19;
+    for (;;) {
+        BigUInt square = BigUInt::multiply(power, power, pool);
+        const bool last = a < square;
+        // Levels below convert_threshold limbs are never divided.
+        BigUInt inverse = square.limbs().size() > convert_threshold
+            ? reciprocal(power, pool) : BigUInt();
+        const size_t bits = power.bits();
+        powers.push_back(Power { std::move(power), std::move(inverse),
+            bits });
+        if (last) {
+            break;
+        }
+        power = std::move(square);
+    }
+    const size_t k = powers.size() - 1;
+    std::string digits(2 * digits_per_limb << k, '0');
+    write_digits(a, powers, k, &digits[0], pool);
+    const size_t first = digits.find_first_not_of('0');
+    return first == std::string::npos ? "0" : digits.substr(first);
+}
+
+// The number of the groups of 19 digits in [begin, begin + count),
+// least significant first; powers[j] is 10^(19 2^j).
+BigUInt combine(const std::vector<Limb> &groups, size_t begin,
+    size_t count, const std::vector<BigUInt> &powers, ThreadPool *pool)
+{
+    if (count <= convert_threshold) {
+        BigUInt value;
+        for (size_t i=begin+count; i-->begin; ) {
+            value *= ten19;
+            value += groups[i];
+        }
+        return value;
+    }
+    // The low part is the largest power of two of groups below count.
+    size_t j = 0;
+    while ((size_t{2} << j) < count) {
+        ++j;
+    }
+    const size_t low_count = size_t{1} << j;
+    BigUInt low, high;
+    fork_join(count >= parallel_threshold ? pool : nullptr,
+        [&] { low = combine(groups, begin, low_count, powers, pool); },
+        [&] { high = combine(groups, begin + low_count,
+            count - low_count, powers, pool); });
+    return BigUInt::multiply(high, powers[j], pool) + low;
+}
+
+BigUInt from_decimal(const std::string &decimal, ThreadPool *pool)
+{
+    if (decimal.empty()
+        || decimal.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("BigUInt: not a decimal number: "
+            + decimal.substr(0, 32));
+    }
+    // Groups of 19 digits from the end, the first may be shorter.
+    const size_t count = (decimal.size() + digits_per_limb - 1)
+        / digits_per_limb;
+    std::vector<Limb> groups(count);
+    for (size_t i=0; i<count; ++i) {
+        const size_t end = decimal.size() - i * digits_per_limb;
+        const size_t begin = end > digits_per_limb
+            ? end - digits_per_limb : 0;
+        Limb group = 0;
+        for (size_t c=begin; c<end; ++c) {
+            group = group * 10 + static_cast<Limb>(decimal[c] - '0');
+        }
+        groups[i] = group;
+    }
+    std::vector<BigUInt> powers { ten19 };
+    while ((size_t{1} << powers.size()) < count) {
+        powers.push_back(BigUInt::multiply(powers.back(), powers.back(),
+            pool));
+    }
+    return combine(groups, 0, count, powers, pool);
+}
+
+// Multiplies small factors into limbs, as many as fit each.
+std::vector<Limb> pack(const std::vector<Limb> &factors)
+{
+    std::vector<Limb> packed;
+    Limb limb = 1;
+    for (Limb f: factors) {
+        if ((uint128_t{limb} * f) >> 64) {
+            packed.push_back(limb);
+            limb = f;
+        } else {
+            limb *= f;
+        }
+    }
+    packed.push_back(limb);
+    return packed;
+}
+
+// The product of factors[begin, end) as a balanced tree, so that both
+// factors of each multiplication are of about the same size.
+BigUInt product(const std::vector<Limb> &factors, size_t begin,
+    size_t end, ThreadPool *pool)
+{
+    if (end - begin <= product_leaf) {
+        BigUInt result = 1;
+        for (size_t i=begin; i<end; ++i) {
+            result *= factors[i];
+        }
+        return result;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    BigUInt left, right;
+    fork_join(end - begin >= parallel_factors ? pool : nullptr,
+        [&] { left = product(factors, begin, middle, pool); },
+        [&] { right = product(factors, middle, end, pool); });
+    return BigUInt::multiply(left, right, pool);
+}
+
+BigUInt factorial(unsigned n, ThreadPool *pool)
+{
+    // Odd primes up to n by the sieve of Eratosthenes, and how often
+    // each divides n! (Legendre's formula).
+    std::vector<bool> composite(size_t{n} + 1);
+    std::vector<Limb> primes;
+    std::vector<unsigned> exponents;
+    unsigned max_exponent = 0;
+    for (uint64_t p=3; p<=n; p+=2) {
+        if (composite[p]) {
+            continue;
+        }
+        for (uint64_t multiple=p*p; multiple<=n; multiple+=2*p) {
+            composite[multiple] = true;
+        }
+        unsigned exponent = 0;
+        for (uint64_t q=n/p; q>0; q/=p) {
+            exponent += static_cast<unsigned>(q);
+        }
+        primes.push_back(p);
+        exponents.push_back(exponent);
+        max_exponent = std::max(max_exponent, exponent);
+    }
+
+    // parts[b]: the product of the primes with bit b in their exponent.
+    size_t bits = 0;
+    while (max_exponent >> bits) {
+        ++bits;
+    }
+    std::vector<BigUInt> parts(bits);
+    auto part = [&](size_t bit) {
+        std::vector<Limb> factors;
+        for (size_t i=0; i<primes.size(); ++i) {
+            if (exponents[i] >> bit & 1) {
+                factors.push_back(primes[i]);
+            }
+        }
+        const std::vector<Limb> packed = pack(factors);
+        parts[bit] = product(packed, 0, packed.size(), pool);
+    };
+    if (pool) {
+        pool->parallel_for(size_t{0}, bits, part, 1);
+    } else {
+        for (size_t bit=0; bit<bits; ++bit) {
+            part(bit);
+        }
+    }
+
+    BigUInt result = 1;
+    for (size_t bit=bits; bit-->0; ) {
+        result = BigUInt::multiply(result, result, pool);
+        result = BigUInt::multiply(result, parts[bit], pool);
+    }
+    // 2 divides n! n - popcount(n) times.
+    return result <<= n - static_cast<unsigned>(__builtin_popcount(n));
+}
+
+} // namespace
+
+BigUInt BigUInt::from_limbs(std::vector<Limb> limbs)
+{
+    BigUInt result;
+    result.limbs_ = std::move(limbs);
+    result.trim();
+    return result;
+}
+
+BigUInt BigUInt::from_string(const std::string &decimal)
+{
+    return from_decimal(decimal, nullptr);
+}
+
+BigUInt BigUInt::from_string(const std::string &decimal, ThreadPool &pool)
+{
+    return from_decimal(decimal, &pool);
+}
+
+std::string BigUInt::to_string() const
+{
+    return to_decimal(*this, nullptr);
+}
+
+std::string BigUInt::to_string(ThreadPool &pool) const
+{
+    return to_decimal(*this, &pool);
+}
+
+size_t BigUInt::bits() const
+{
+    return limbs_.empty() ? 0 : 64 * limbs_.size()
+        - static_cast<size_t>(__builtin_clzll(limbs_.back()));
+}
+
+BigUInt &BigUInt::operator+=(const BigUInt &other)
+{
+    if (limbs_.size() < other.limbs_.size()) {
+        limbs_.resize(other.limbs_.size());
+    }
+    if (add_in(limbs_.data(), limbs_.size(), other.limbs_.data(),
+            other.limbs_.size())) {
+        limbs_.push_back(1);
+    }
+    return *this;
+}
+
+BigUInt &BigUInt::operator-=(const BigUInt &other)
+{
+    if (*this < other) {
+        throw std::underflow_error("BigUInt: negative difference");
+    }
+    sub_in(limbs_.data(), limbs_.size(), other.limbs_.data(),
+        other.limbs_.size());
+    trim();
+    return *this;
+}
+
+BigUInt &BigUInt::operator*=(const BigUInt &other)
+{
+    return *this = multiply(*this, other, nullptr);
+}
+
+BigUInt &BigUInt::operator*=(Limb factor)
+{
+    if (factor == 0) {
+        limbs_.clear();
+    } else if (const Limb carry = mul_1(limbs_.data(), limbs_.data(),
+            limbs_.size(), factor)) {
+        limbs_.push_back(carry);
+    }
+    return *this;
+}
+
+BigUInt &BigUInt::operator<<=(size_t shift)
+{
+    if (limbs_.empty()) {
+        return *this;
+    }
+    const size_t limbs = shift / 64;
+    const unsigned bits = static_cast<unsigned>(shift % 64);
+    std::vector<Limb> result(limbs_.size() + limbs + 1);
+    for (size_t i=0; i<limbs_.size(); ++i) {
+        result[i + limbs] |= limbs_[i] << bits;
+        if (bits) {
+            result[i + limbs + 1] = limbs_[i] >> (64 - bits);
+        }
+    }
+    limbs_ = std::move(result);
+    trim();
+    return *this;
+}
+
+BigUInt &BigUInt::operator>>=(size_t shift)
+{
+    const size_t limbs = shift / 64;
+    const unsigned bits = static_cast<unsigned>(shift % 64);
+    if (limbs >= limbs_.size()) {
+        limbs_.clear();
+        return *this;
+    }
+    const size_t n = limbs_.size() - limbs;
+    for (size_t i=0; i<n; ++i) {
+        limbs_[i] = limbs_[i + limbs] >> bits;
+        if (bits && i + 1 < n) {
+            limbs_[i] |= limbs_[i + limbs + 1] << (64 - bits);
+        }
+    }
+    limbs_.resize(n);
+    trim();
+    return *this;
+}
+
+BigUInt::Limb BigUInt::divide(Limb divisor)
+{
+    if (divisor == 0) {
+        throw std::domain_error("BigUInt: division by zero");
+    }
+    Limb remainder = 0;
+    for (size_t i=limbs_.size(); i-->0; ) {
+        const uint128_t value = uint128_t{remainder} << 64 | limbs_[i];
+        limbs_[i] = static_cast<Limb>(value / divisor);
+        remainder = static_cast<Limb>(value % divisor);
+    }
+    trim();
+    return remainder;
+}
+
+BigUInt BigUInt::multiply(const BigUInt &a, const BigUInt &b,
+    ThreadPool *pool)
+{
+    if (a.is_zero() || b.is_zero()) {
+        return BigUInt();
+    }
+    BigUInt result;
+    result.limbs_.resize(a.limbs_.size() + b.limbs_.size());
+    mul(result.limbs_.data(), a.limbs_.data(), a.limbs_.size(),
+        b.limbs_.data(), b.limbs_.size(), pool);
+    result.trim();
+    return result;
+}
+
+int BigUInt::compare(const BigUInt &a, const BigUInt &b)
+{
+    if (a.limbs_.size() != b.limbs_.size()) {
+        return a.limbs_.size() < b.limbs_.size() ? -1 : 1;
+    }
+    for (size_t i=a.limbs_.size(); i-->0; ) {
+        if (a.limbs_[i] != b.limbs_[i]) {
+            return a.limbs_[i] < b.limbs_[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+void BigUInt::trim()
+{
+    while (!limbs_.empty() && limbs_.back() == 0) {
+        limbs_.pop_back();
+    }
+}
+
+BigUInt big_factorial(unsigned n)
+{
+    return factorial(n, nullptr);
+}
+
+BigUInt big_factorial(unsigned n, ThreadPool &pool)
+{
+    return factorial(n, &pool);
+}
+
+BigUInt range_product(unsigned first, unsigned last)
+{
+    std::vector<Limb> factors;
+    for (uint64_t i=first; i<=last; ++i) {
+        factors.push_back(i);
+    }
+    const std::vector<Limb> packed = pack(factors);
+    return product(packed, 0, packed.size(), nullptr);
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
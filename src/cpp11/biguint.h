@@ -0,0 +1,144 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/biguint.h Unsigned integers of any size, with Karatsuba
+ *       multiplication, divide-and-conquer decimal conversion and exact
+ *       factorials.
+ *
+ * A BigUInt is a std::vector of 64 bit limbs, least significant first.
+ * Small products are computed digit by digit ("schoolbook", O(n^2));
+ * from karatsuba_threshold limbs on, Karatsuba's three half size products
+ * replace the four of the schoolbook method, O(n^1.58). Given a
+ * ThreadPool, the three products of the large levels run in parallel.
+ *
+ * Decimal conversion splits the number at 10^(19 2^k), the largest such
+ * power below its square root, and converts both halves (in parallel)
+ * the same way. The divisions are multiplications by reciprocals found
+ * by Newton's iteration, so the conversion costs a few multiplications
+ * instead of the O(n^2) of dividing by 10^19 again and again.
+ *
+ * big_factorial(n) multiplies the prime factors of n!: each odd prime p
+ * appears e = n/p + n/p^2 + ... times, so n! is 2^e2 times the product
+ * over the bits b of the exponents of (primes with bit b set)^(2^b),
+ * which is evaluated by squaring and multiplying from the top bit down
+ * (Horner's scheme). The products of primes are balanced binary trees,
+ * so that both factors of a multiplication are of similar size, and
+ * their independent subtrees run in parallel. This needs far fewer and
+ * better balanced multiplications than 1 * 2 * ... * n.
+ *
+ * \code
+ * BigUInt a = BigUInt::from_string("123456789012345678901234567890");
+ * std::cout << (a * a + 1).to_string() << std::endl;
+ * \endcode
+ */
+
+#ifndef CPP11_BIGUINT_H
+#define CPP11_BIGUINT_H 1
+
+#include "cpp11/threadpool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class BigUInt {
+  public:
+    typedef uint64_t Limb;
+
+    /// Limbs from which on products use Karatsuba's method.
+    static const size_t karatsuba_threshold = 32;
+
+    BigUInt() { }
+    BigUInt(Limb value) {
+        if (value) {
+            limbs_.push_back(value);
+        }
+    }
+    /// From limbs, least significant first.
+    static BigUInt from_limbs(std::vector<Limb> limbs);
+    /// From decimal digits; throws std::invalid_argument for anything
+    /// else, including an empty string.
+    static BigUInt from_string(const std::string &decimal);
+    static BigUInt from_string(const std::string &decimal,
+        ThreadPool &pool);
+
+    /// The decimal digits, without leading zeros ("0" for zero).
+    std::string to_string() const;
+    std::string to_string(ThreadPool &pool) const;
+
+    /// Limbs, least significant first, without leading zeros.
+    const std::vector<Limb> &limbs() const { return limbs_; }
+    bool is_zero() const { return limbs_.empty(); }
+    /// Number of significant bits, 0 for zero.
+    size_t bits() const;
+
+    BigUInt &operator+=(const BigUInt &other);
+    /// Throws std::underflow_error if \a other is larger.
+    BigUInt &operator-=(const BigUInt &other);
+    BigUInt &operator*=(const BigUInt &other);
+    BigUInt &operator*=(Limb factor);
+    BigUInt &operator<<=(size_t shift);
+    BigUInt &operator>>=(size_t shift);
+    /// Divides by \a divisor (not 0) and returns the remainder.
+    Limb divide(Limb divisor);
+
+    /// The product, with the large Karatsuba levels on \a pool.
+    static BigUInt multiply(const BigUInt &a, const BigUInt &b,
+        ThreadPool *pool);
+
+    friend bool operator==(const BigUInt &a, const BigUInt &b) {
+        return a.limbs_ == b.limbs_;
+    }
+    friend bool operator<(const BigUInt &a, const BigUInt &b) {
+        return compare(a, b) < 0;
+    }
+
+  private:
+    static int compare(const BigUInt &a, const BigUInt &b);
+    void trim();
+
+    std::vector<Limb> limbs_;
+};
+
+inline bool operator!=(const BigUInt &a, const BigUInt &b) {
+    return !(a == b);
+}
+inline bool operator>(const BigUInt &a, const BigUInt &b) {
+    return b < a;
+}
+inline bool operator<=(const BigUInt &a, const BigUInt &b) {
+    return !(b < a);
+}
+inline bool operator>=(const BigUInt &a, const BigUInt &b) {
+    return !(a < b);
+}
+
+inline BigUInt operator+(BigUInt a, const BigUInt &b) { return a += b; }
+inline BigUInt operator-(BigUInt a, const BigUInt &b) { return a -= b; }
+inline BigUInt operator*(const BigUInt &a, const BigUInt &b) {
+    return BigUInt::multiply(a, b, nullptr);
+}
+inline BigUInt operator*(BigUInt a, BigUInt::Limb b) { return a *= b; }
+inline BigUInt operator<<(BigUInt a, size_t shift) { return a <<= shift; }
+inline BigUInt operator>>(BigUInt a, size_t shift) { return a >>= shift; }
+
+inline std::ostream &operator<<(std::ostream &out, const BigUInt &value) {
+    return out << value.to_string();
+}
+
+/// n! exactly, in the calling thread.
+BigUInt big_factorial(unsigned n);
+/// n! exactly, with the products of primes and the large
+/// multiplications on \a pool.
+BigUInt big_factorial(unsigned n, ThreadPool &pool);
+/// first (first + 1) ... last, 1 if last < first, as a balanced tree of
+/// products ("binary splitting").
+BigUInt range_product(unsigned first, unsigned last);
+
+#endif // CPP11_BIGUINT_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,43 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/cacheline.h Helpers against false sharing.
+ *
+ * Two variables written by different threads should not share a cache
+ * line, otherwise each write invalidates the line in the other core
+ * ("ping-pong") even if the threads never touch the same variable.
+ */
+
+#ifndef CPP11_CACHELINE_H
+#define CPP11_CACHELINE_H 1
+
+#include <cstddef> // for size_t
+
+// Size of a cache line on all platforms we care about (x86, most ARM).
+constexpr size_t cache_line_size = 64;
+
+// Wraps a value so that no other variable shares a cache line with it:
+// there is a whole line of padding on either side. The value itself is
+// not aligned and may span two lines. Padding instead of alignas(),
+// because operator new of C++ 2011 does not honor over-alignment, and
+// some of these live in heap arrays.
+template<typename T>
+struct CacheAligned {
+  private:
+    char before_[cache_line_size];
+
+  public:
+    T value;
+
+    CacheAligned() : value() { }
+    explicit CacheAligned(const T &v) : value(v) { }
+
+  private:
+    char after_[cache_line_size];
+};
+
+#endif // CPP11_CACHELINE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,361 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/colorparser.cc Parsing color tokens by SWAR, sequentially,
+ *       in chunks on a ThreadPool and piece by piece.
+ */
+
+#include "cpp11/colorparser.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The first character of a word is its least significant byte.
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "colorparser.cc expects a little endian CPU"
+#endif
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+
+const uint64_t ones = 0x0101010101010101ull;
+const uint64_t highs = 0x8080808080808080ull;
+
+/// Longest token looked at; longer ones are no color.
+const size_t max_token = 16;
+
+// Each byte of the result is 0x80 where that of \a x is less than \a n
+// (at most 0x80), else 0. Exact, unlike the usual haszero() tricks: no
+// carry crosses a byte as the high bits are added separately.
+inline uint64_t bytes_less(uint64_t x, unsigned n)
+{
+    return ~(((x & ~highs) + ones * (0x80 - n)) | x) & highs;
+}
+
+inline uint64_t bytes_between(uint64_t x, unsigned lo, unsigned hi)
+{
+    return ~bytes_less(x, lo) & bytes_less(x, hi + 1);
+}
+
+// Space, control characters and ','.
+inline uint64_t separators(uint64_t x)
+{
+    return bytes_less(x, 0x21) | bytes_less(x ^ ones * ',', 1);
+}
+
+inline bool is_separator(char c)
+{
+    return static_cast<unsigned char>(c) <= 0x20 || c == ',';
+}
+
+// Index of the first byte marked in \a mask (not 0).
+inline size_t first(uint64_t mask)
+{
+    return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+}
+
+// The eight bytes at \a p; past \a end they read as spaces.
+inline uint64_t load(const char *p, const char *end)
+{
+    uint64_t word;
+    if (end - p >= 8) {
+        std::memcpy(&word, p, 8);
+    } else {
+        word = ones * ' ';
+        if (p < end) {
+            std::memcpy(&word, p, static_cast<size_t>(end - p));
+        }
+    }
+    return word;
+}
+
+// The \a n (1 to 8) bytes from byte \a at of \a bytes as a word of
+// eight digits, by padding with '0' in front.
+inline uint64_t digits(uint128_t bytes, unsigned at, unsigned n)
+{
+    const uint64_t word = static_cast<uint64_t>(bytes >> (8 * at))
+        << (8 * (8 - n));
+    return word | (ones * '0') >> (8 * n - 1) >> 1;
+}
+
+bool parse_hex8(uint64_t word, uint32_t &value)
+{
+    const uint64_t digit = bytes_between(word, '0', '9');
+    // Setting bit 5 makes 'A'-'F' lower case and keeps digits.
+    const uint64_t letter = bytes_between(word | ones * 0x20, 'a', 'f');
+    if ((digit | letter) != highs) {
+        return false;
+    }
+    // '0' & 0x0f is 0, 'a' & 0x0f is 1 and needs 9 more.
+    const uint64_t nibbles = (word & ones * 0x0f) + (letter >> 7) * 9;
+    // Pairs of nibbles into bytes, bytes into 16 bits, into 32 bits.
+    uint64_t t = (nibbles << 4 | nibbles >> 8) & 0x00ff00ff00ff00ffull;
+    t = (t << 8 | t >> 16) & 0x0000ffff0000ffffull;
+    value = static_cast<uint32_t>(t << 16 | t >> 32);
+    return true;
+}
+
+bool parse_decimal8(uint64_t word, uint32_t &value)
+{
+    if (bytes_between(word, '0', '9') != highs) {
+        return false;
+    }
+    // Each multiplication combines neighbours: to pairs of digits, then
+    // to the two halves of four pairs each.
+    uint64_t t = word - ones * '0';
+    t = t * 10 + (t >> 8);
+    t = ((t & 0x000000ff000000ffull) * (100 + (1000000ull << 32))
+        + ((t >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))
+        >> 32;
+    value = static_cast<uint32_t>(t);
+    return true;
+}
+
+const char *const not_a_color = "not a color";
+const char *const too_long = "too long for a color";
+const char *const out_of_range = "more than 0xffffffff";
+
+// Converts the token of \a length bytes starting with \a bytes.
+const char *convert(uint128_t bytes, size_t length, uint32_t &value)
+{
+    const unsigned first_char = static_cast<unsigned>(bytes & 0xff);
+    const unsigned second = static_cast<unsigned>(bytes >> 8 & 0xff);
+    if (first_char == '#') {
+        if (!(length == 7 || length == 9)
+            || !parse_hex8(digits(bytes, 1, length - 1), value)) {
+            return not_a_color;
+        }
+        // #RRGGBB is opaque.
+        value |= length == 7 ? 0xff000000u : 0;
+        return nullptr;
+    }
+    if (first_char == '0' && (second | 0x20) == 'x') {
+        return length >= 3 && length <= 10
+            && parse_hex8(digits(bytes, 2, length - 2), value)
+            ? nullptr : not_a_color;
+    }
+    if (length <= 8) {
+        return parse_decimal8(digits(bytes, 0, length), value)
+            ? nullptr : not_a_color;
+    }
+    if (length > 10) {
+        return not_a_color;
+    }
+    uint32_t high, low;
+    if (!parse_decimal8(digits(bytes, 0, length - 8), high)
+        || !parse_decimal8(digits(bytes, length - 8, 8), low)) {
+        return not_a_color;
+    }
+    const uint64_t all = uint64_t{high} * 100000000 + low;
+    value = static_cast<uint32_t>(all);
+    return all > 0xffffffffull ? out_of_range : nullptr;
+}
+
+// Parses [begin, end), which starts with \a base in the whole text.
+void parse_range(const char *begin, const char *end, size_t base,
+    ParsedColors &out)
+{
+    const char *p = begin;
+    while (p < end) {
+        const uint64_t word = load(p, end);
+        const uint64_t skip = separators(word);
+        if (skip == highs) {
+            p += 8;
+            continue;
+        }
+        p += first(~skip & highs);
+
+        // The token, if not too long, ends in the next 16 bytes.
+        const uint64_t low = load(p, end), high = load(p + 8, end);
+        uint64_t mask = separators(low);
+        size_t length = mask ? first(mask)
+            : (mask = separators(high)) ? 8 + first(mask) : 0;
+        const char *error;
+        uint32_t value = 0;
+        if (length == 0) {
+            error = too_long;
+            length = max_token;
+            while (p + length < end) {
+                mask = separators(load(p + length, end));
+                if (mask) {
+                    length += first(mask);
+                    break;
+                }
+                length += 8;
+            }
+        } else {
+            error = convert(uint128_t{high} << 64 | low, length, value);
+        }
+        if (error) {
+            out.errors.push_back(ColorParseError {
+                base + static_cast<size_t>(p - begin), error });
+        } else {
+            out.colors.push_back(Color::from_argb(value));
+        }
+        p += length;
+    }
+}
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+} // namespace
+
+ParsedColors parse_colors(const char *text, size_t size)
+{
+    ParsedColors parsed;
+    // A guess: most tokens are not shorter.
+    parsed.colors.reserve(size / 8);
+    parse_range(text, text + size, 0, parsed);
+    return parsed;
+}
+
+ParsedColors parse_colors(const char *text, size_t size, ThreadPool &pool,
+    size_t chunk_bytes)
+{
+    // Chunks end at a separator, so that no token is cut in two.
+    chunk_bytes = std::max(chunk_bytes, max_token);
+    std::vector<size_t> bounds { 0 };
+    size_t bound = 0;
+    while (size - bound > chunk_bytes) {
+        bound += chunk_bytes;
+        while (bound < size && !is_separator(text[bound])) {
+            ++bound;
+        }
+        bounds.push_back(bound);
+    }
+    if (bounds.back() < size) {
+        bounds.push_back(size);
+    }
+    if (bounds.size() <= 2) {
+        return parse_colors(text, size);
+    }
+
+    std::vector<ParsedColors> parts(bounds.size() - 1);
+    pool.parallel_for(size_t{0}, parts.size(), [&](size_t i) {
+        parts[i].colors.reserve((bounds[i + 1] - bounds[i]) / 8);
+        parse_range(text + bounds[i], text + bounds[i + 1], bounds[i],
+            parts[i]);
+    }, 1);
+
+    ParsedColors parsed;
+    size_t colors = 0, errors = 0;
+    for (const ParsedColors &part: parts) {
+        colors += part.colors.size();
+        errors += part.errors.size();
+    }
+    parsed.colors.reserve(colors);
+    parsed.errors.reserve(errors);
+    for (const ParsedColors &part: parts) {
+        parsed.colors.insert(parsed.colors.end(), part.colors.begin(),
+            part.colors.end());
+        parsed.errors.insert(parsed.errors.end(), part.errors.begin(),
+            part.errors.end());
+    }
+    return parsed;
+}
+
+void ColorStreamParser::parse(const char *data, size_t size,
+    ParsedColors &out)
+{
+    const char *const end = data + size;
+    const char *p = data;
+    if (!carry_.empty()) {
+        while (p < end && !is_separator(*p)) {
+            ++p;
+        }
+        // Beyond max_token it is too long anyway.
+        carry_.append(data, std::min(static_cast<size_t>(p - data),
+            max_token + 1 - std::min(carry_.size(), max_token + 1)));
+        if (p == end) {
+            offset_ += size;
+            return;
+        }
+        finish(out);
+    }
+    const char *last = end;
+    while (last > p && !is_separator(last[-1])) {
+        --last;
+    }
+    parse_range(p, last, offset_ + static_cast<size_t>(p - data), out);
+    if (last < end) {
+        carry_offset_ = offset_ + static_cast<size_t>(last - data);
+        carry_.assign(last, std::min(static_cast<size_t>(end - last),
+            max_token + 1));
+    }
+    offset_ += size;
+}
+
+void ColorStreamParser::finish(ParsedColors &out)
+{
+    parse_range(carry_.data(), carry_.data() + carry_.size(),
+        carry_offset_, out);
+    carry_.clear();
+}
+
+MappedFile::MappedFile(const std::string &path)
+    : data_(nullptr), size_(0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw_errno("MappedFile: open " + path);
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        throw_errno("MappedFile: stat " + path);
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    // Empty files cannot be mapped, and need not.
+    if (size_ > 0) {
+        void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            errno = error;
+            throw_errno("MappedFile: mmap " + path);
+        }
+        ::madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(data);
+    } else {
+        ::close(fd);
+    }
+}
+
+MappedFile::MappedFile(MappedFile &&other)
+    : data_(other.data_), size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_) {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+ParsedColors parse_color_file(const std::string &path, ThreadPool &pool,
+    size_t chunk_bytes)
+{
+    const MappedFile file { path };
+    return parse_colors(file.data(), file.size(), pool, chunk_bytes);
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
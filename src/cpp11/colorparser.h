@@ -0,0 +1,107 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/colorparser.h Parses large texts of color values into
+ *       Color arrays, eight characters per step and chunks in parallel.
+ *
+ * A text is a sequence of tokens separated by white space or commas.
+ * Each token is a color as 0xAARRGGBB is written in C:
+ *
+ *  - decimal, up to 4294967295;
+ *  - "0x" or "0X" and one to eight hex digits;
+ *  - "#RRGGBB" (opaque) or "#AARRGGBB", as the _col literals.
+ *
+ * Tokens are found and converted by SWAR (SIMD within a register): up
+ * to eight characters are loaded into a uint64_t, and the digits are
+ * checked and combined for all bytes at once by a few shifts, masks and
+ * multiplications, without a branch per character. A token that is no
+ * color is skipped and reported by its offset in the text.
+ *
+ * \code
+ * ThreadPool pool;
+ * ParsedColors parsed = parse_color_file("colors.txt", pool);
+ * for (const ColorParseError &e: parsed.errors) {
+ *     std::cerr << "offset " << e.offset << ": " << e.what << std::endl;
+ * }
+ * \endcode
+ */
+
+#ifndef CPP11_COLORPARSER_H
+#define CPP11_COLORPARSER_H 1
+
+#include "cpp11/literals.h"
+#include "cpp11/threadpool.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// A token that is not a color.
+struct ColorParseError {
+    /// Byte offset of the token in the text.
+    size_t offset;
+    /// What is wrong, a static string.
+    const char *what;
+};
+
+/// The colors of a text in order, and the tokens that were none.
+struct ParsedColors {
+    std::vector<Color> colors;
+    std::vector<ColorParseError> errors;
+};
+
+/// Parses the \a size bytes at \a text in the calling thread.
+ParsedColors parse_colors(const char *text, size_t size);
+
+/// Parses in chunks of about \a chunk_bytes on \a pool; the result is
+/// the same as of the sequential parse_colors().
+ParsedColors parse_colors(const char *text, size_t size, ThreadPool &pool,
+    size_t chunk_bytes=1 << 20);
+
+/**
+ * Parses a text given piece by piece, e.g. as read() returns it. A token
+ * cut off at the end of a piece is kept until the next one; offsets
+ * count from the start of the first piece.
+ */
+class ColorStreamParser {
+  public:
+    /// Parses the next \a size bytes at \a data, appending to \a out.
+    void parse(const char *data, size_t size, ParsedColors &out);
+    /// Parses a token kept from the last piece, at the end of the text.
+    void finish(ParsedColors &out);
+    /// Bytes passed to parse() so far.
+    size_t offset() const { return offset_; }
+
+  private:
+    std::string carry_;
+    size_t carry_offset_ = 0;
+    size_t offset_ = 0;
+};
+
+/// A file mapped read only into memory.
+class MappedFile {
+  public:
+    /// Throws std::system_error if \a path cannot be opened or mapped.
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &)=delete;
+    MappedFile &operator=(const MappedFile &)=delete;
+    MappedFile(MappedFile &&other);
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    const char *data_;
+    size_t size_;
+};
+
+/// Maps the file \a path and parses it on \a pool.
+ParsedColors parse_color_file(const std::string &path, ThreadPool &pool,
+    size_t chunk_bytes=1 << 20);
+
+#endif // CPP11_COLORPARSER_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,81 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/colorspace.cc Conversions of Colors between sRGB, linear
+ *       light, grayscale and YCbCr through compile time tables.
+ */
+
+#include "cpp11/colorspace.h"
+
+#include <cmath>
+
+// The tables are right if cx::pow() is; the first entries above the
+// linear segment are the most sensitive.
+static_assert(colorspace_detail::EncodeTable::values[0] == 0, "enc 0");
+static_assert(colorspace_detail::EncodeTable::values[4095] == 255,
+    "enc max");
+static_assert(colorspace_detail::DecodeTable::values[255] == 1.0f,
+    "dec max");
+static_assert(cx::abs(colorspace_detail::DecodeTable::values[128]
+    - 0.2158605) < 1e-6, "dec 128");
+
+float srgb_to_linear_exact(uint8_t c)
+{
+    const double v = c / 255.0;
+    return static_cast<float>(v <= 0.04045 ? v / 12.92
+        : std::pow((v + 0.055) / 1.055, 2.4));
+}
+
+uint8_t linear_to_srgb_exact(float v)
+{
+    const double l = v <= 0 ? 0 : v >= 1 ? 1 : v;
+    const double e = l <= 0.0031308 ? l * 12.92
+        : 1.055 * std::pow(l, 1 / 2.4) - 0.055;
+    return static_cast<uint8_t>(std::lround(e * 255));
+}
+
+void to_linear(const Color *in, LinearColor *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = to_linear(in[i]);
+    }
+}
+
+void from_linear(const LinearColor *in, Color *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = from_linear(in[i]);
+    }
+}
+
+void to_gray(const Color *in, uint8_t *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = gray(in[i]);
+    }
+}
+
+void to_luminance(const Color *in, uint8_t *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = luminance(in[i]);
+    }
+}
+
+void to_ycbcr(const Color *in, YCbCr *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = to_ycbcr(in[i]);
+    }
+}
+
+void from_ycbcr(const YCbCr *in, Color *out, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        out[i] = from_ycbcr(in[i]);
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
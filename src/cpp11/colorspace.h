@@ -0,0 +1,211 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/colorspace.h Conversions of Colors between sRGB, linear
+ *       light, grayscale and YCbCr through compile time tables.
+ *
+ * The channels of a Color are sRGB encoded: perceptually even steps,
+ * roughly linear^(1/2.2). Blending or scaling must happen in linear
+ * light, which per channel means a pow() there and one back. Here both
+ * directions are table lookups, the tables computed by the compiler
+ * with cx::pow() (constexprmath.h):
+ *
+ *  - decoding: 256 floats, one per 8 bit value, exact;
+ *  - encoding: linear light quantized to 12 bits, 4096 bytes. This
+ *    is fine enough that decoding and encoding again returns every 8
+ *    bit value unchanged, and other values are off by at most one.
+ *
+ * Grayscale (luma) and YCbCr use the JPEG (BT.601 full range) weights in
+ * 16 bit fixed point, the products of each weight with each byte value
+ * again in tables, as libjpeg does.
+ *
+ * \code
+ * std::vector<LinearColor> light(n);
+ * to_linear(pixels, light.data(), n);   // blend, filter, ...
+ * from_linear(light.data(), pixels, n);
+ * \endcode
+ */
+
+#ifndef CPP11_COLORSPACE_H
+#define CPP11_COLORSPACE_H 1
+
+#include "cpp11/constexprmath.h"
+#include "cpp11/literals.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/// A Color in linear light, channels in [0, 1].
+struct LinearColor {
+    float a, r, g, b;
+};
+
+struct YCbCr {
+    uint8_t y, cb, cr;
+};
+
+namespace colorspace_detail {
+
+// The sRGB transfer functions (IEC 61966-2-1).
+constexpr double decode(double v) {
+    return v <= 0.04045 ? v / 12.92 : cx::pow((v + 0.055) / 1.055, 2.4);
+}
+constexpr double encode(double v) {
+    return v <= 0.0031308 ? v * 12.92
+        : 1.055 * cx::pow(v, 1 / 2.4) - 0.055;
+}
+
+constexpr unsigned encode_bits = 12;
+constexpr size_t encode_size = size_t{1} << encode_bits;
+
+constexpr float decode_entry(unsigned c) {
+    return static_cast<float>(decode(c / 255.0));
+}
+constexpr uint8_t encode_entry(unsigned i) {
+    return static_cast<uint8_t>(
+        cx::round(encode(i / double(encode_size - 1)) * 255));
+}
+
+using DecodeTable = cx::Table<float, unsigned, decode_entry, 256>;
+using EncodeTable = cx::Table<uint8_t, unsigned, encode_entry,
+    encode_size>;
+
+// Fixed point with 16 fraction bits, as libjpeg's jccolor.c and
+// jdcolor.c.
+constexpr int32_t fix(double x) {
+    return static_cast<int32_t>(cx::round(x * 65536));
+}
+constexpr int32_t half = 1 << 15;
+
+// RGB to YCbCr: eight blocks of 256 products; the constants for
+// rounding and the Cb/Cr offset of 128 are folded into some blocks.
+enum { y_r, y_g, y_b, cb_r, cb_g, cb_b_cr_r, cr_g, cr_b };
+constexpr int32_t to_ycc_entry(unsigned i) {
+    return i / 256 == y_r ? fix(0.299) * int32_t(i % 256)
+        : i / 256 == y_g ? fix(0.587) * int32_t(i % 256)
+        : i / 256 == y_b ? fix(0.114) * int32_t(i % 256) + half
+        : i / 256 == cb_r ? -fix(0.168735892) * int32_t(i % 256)
+        : i / 256 == cb_g ? -fix(0.331264108) * int32_t(i % 256)
+        // Also Cr of R; "- 1" keeps 255 from rounding up to 256.
+        : i / 256 == cb_b_cr_r
+            ? fix(0.5) * int32_t(i % 256) + (128 << 16) + half - 1
+        : i / 256 == cr_g ? -fix(0.418687589) * int32_t(i % 256)
+        : -fix(0.081312411) * int32_t(i % 256);
+}
+using ToYccTable = cx::Table<int32_t, unsigned, to_ycc_entry, 8 * 256>;
+
+// YCbCr to RGB: R = Y + 1.402 Cr', G = Y - 0.344 Cb' - 0.714 Cr',
+// B = Y + 1.772 Cb' with Cb' = Cb - 128, Cr' = Cr - 128. Red and blue
+// are rounded in the table, the green terms are fixed point.
+enum { r_cr, b_cb, g_cr, g_cb };
+constexpr int32_t from_ycc_entry(unsigned i) {
+    return i / 256 == r_cr ? int32_t(
+            cx::round(1.402 * (int(i % 256) - 128)))
+        : i / 256 == b_cb ? int32_t(
+            cx::round(1.772 * (int(i % 256) - 128)))
+        : i / 256 == g_cr ? -fix(0.714136286) * (int32_t(i % 256) - 128)
+        : -fix(0.344136286) * (int32_t(i % 256) - 128) + half;
+}
+using FromYccTable = cx::Table<int32_t, unsigned, from_ycc_entry,
+    4 * 256>;
+
+inline uint8_t clamp8(int32_t v) {
+    return static_cast<uint8_t>(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+} // namespace colorspace_detail
+
+/// The linear light value of the sRGB value \a c.
+inline float srgb_to_linear(uint8_t c)
+{
+    return colorspace_detail::DecodeTable::values[c];
+}
+
+/// The sRGB value of linear light \a v, clamped to [0, 1].
+inline uint8_t linear_to_srgb(float v)
+{
+    using namespace colorspace_detail;
+    const float scaled = v * float(encode_size - 1) + 0.5f;
+    // Also false for NaN.
+    return !(scaled > 0) ? 0
+        : scaled >= float(encode_size) ? 255
+        : EncodeTable::values[static_cast<size_t>(scaled)];
+}
+
+/// Both with pow(), as reference and for comparison.
+float srgb_to_linear_exact(uint8_t c);
+uint8_t linear_to_srgb_exact(float v);
+
+inline LinearColor to_linear(Color c)
+{
+    return LinearColor { c.a() / 255.0f, srgb_to_linear(c.r()),
+        srgb_to_linear(c.g()), srgb_to_linear(c.b()) };
+}
+
+inline Color from_linear(const LinearColor &c)
+{
+    using colorspace_detail::clamp8;
+    return Color(clamp8(static_cast<int32_t>(c.a * 255 + 0.5f)),
+        linear_to_srgb(c.r), linear_to_srgb(c.g), linear_to_srgb(c.b));
+}
+
+/// Luma as in JPEG: 0.299 R + 0.587 G + 0.114 B of the sRGB values.
+inline uint8_t gray(Color c)
+{
+    using namespace colorspace_detail;
+    const int32_t *t = ToYccTable::values;
+    return static_cast<uint8_t>((t[y_r * 256 + c.r()]
+        + t[y_g * 256 + c.g()] + t[y_b * 256 + c.b()]) >> 16);
+}
+
+/// Relative luminance: 0.2126 R + 0.7152 G + 0.0722 B in linear light,
+/// encoded as sRGB again. Unlike gray(), a gray color keeps its value.
+inline uint8_t luminance(Color c)
+{
+    return linear_to_srgb(0.2126f * srgb_to_linear(c.r())
+        + 0.7152f * srgb_to_linear(c.g())
+        + 0.0722f * srgb_to_linear(c.b()));
+}
+
+/// JPEG YCbCr (BT.601, full range); alpha is dropped.
+inline YCbCr to_ycbcr(Color c)
+{
+    using namespace colorspace_detail;
+    const int32_t *t = ToYccTable::values;
+    const unsigned r = c.r(), g = c.g(), b = c.b();
+    return YCbCr {
+        static_cast<uint8_t>(
+            (t[y_r * 256 + r] + t[y_g * 256 + g] + t[y_b * 256 + b])
+                >> 16),
+        static_cast<uint8_t>((t[cb_r * 256 + r] + t[cb_g * 256 + g]
+            + t[cb_b_cr_r * 256 + b]) >> 16),
+        static_cast<uint8_t>((t[cb_b_cr_r * 256 + r]
+            + t[cr_g * 256 + g] + t[cr_b * 256 + b]) >> 16)
+    };
+}
+
+/// Back to an opaque Color.
+inline Color from_ycbcr(YCbCr c)
+{
+    using namespace colorspace_detail;
+    const int32_t *t = FromYccTable::values;
+    const int32_t y = c.y;
+    return Color(0xff, clamp8(y + t[r_cr * 256 + c.cr]),
+        clamp8(y + ((t[g_cb * 256 + c.cb] + t[g_cr * 256 + c.cr])
+            >> 16)),
+        clamp8(y + t[b_cb * 256 + c.cb]));
+}
+
+/// The same for arrays of \a n colors.
+void to_linear(const Color *in, LinearColor *out, size_t n);
+void from_linear(const LinearColor *in, Color *out, size_t n);
+void to_gray(const Color *in, uint8_t *out, size_t n);
+void to_luminance(const Color *in, uint8_t *out, size_t n);
+void to_ycbcr(const Color *in, YCbCr *out, size_t n);
+void from_ycbcr(const YCbCr *in, Color *out, size_t n);
+
+#endif // CPP11_COLORSPACE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
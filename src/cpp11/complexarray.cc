@@ -0,0 +1,468 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/complexarray.cc Scalar, SSE2 and AVX2 kernels on split
+ *       complex arrays of float and double.
+ */
+
+#include "cpp11/complexarray.h"
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPP11_COMPLEX_X86 1
+#include <immintrin.h>
+// The generic kernels below are instantiated with AVX types, but only
+// ever inlined into functions compiled for AVX2.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace {
+
+// Each kernel is written once as a loop over "operations" S on vectors
+// of S::width numbers: first with SIMD operations, then with the scalar
+// ones for the remaining tail. always_inline puts them into the kernels
+// compiled for the respective instruction set.
+#define CPP11_INLINE inline __attribute__((always_inline))
+
+template<typename T>
+struct ScalarOps {
+    typedef T V;
+    typedef ScalarOps Narrow;
+    static const size_t width = 1;
+    static V load(const T *p) { return *p; }
+    static void store(T *p, V v) { *p = v; }
+    static V set1(T x) { return x; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    /// a * b + c
+    static V fmadd(V a, V b, V c) { return a * b + c; }
+    /// c - a * b
+    static V fnmadd(V a, V b, V c) { return c - a * b; }
+    static V neg(V a) { return -a; }
+    static V sqrt(V a) { return std::sqrt(a); }
+};
+
+// (r, i) = (ar, ai) * (br, bi)
+template<typename S>
+CPP11_INLINE void cmul(const typename S::V &ar, const typename S::V &ai,
+    const typename S::V &br, const typename S::V &bi, typename S::V &r,
+    typename S::V &i)
+{
+    r = S::fnmadd(ai, bi, S::mul(ar, br));
+    i = S::fmadd(ai, br, S::mul(ar, bi));
+}
+
+template<typename S, typename T>
+CPP11_INLINE void multiply_add_run(size_t &i, size_t n, T *d_re, T *d_im,
+    const T *a_re, const T *a_im, const T *b_re, const T *b_im)
+{
+    for (; i + S::width <= n; i += S::width) {
+        const typename S::V ar = S::load(a_re + i), ai = S::load(a_im + i);
+        const typename S::V br = S::load(b_re + i), bi = S::load(b_im + i);
+        S::store(d_re + i,
+            S::fmadd(ar, br, S::fnmadd(ai, bi, S::load(d_re + i))));
+        S::store(d_im + i,
+            S::fmadd(ar, bi, S::fmadd(ai, br, S::load(d_im + i))));
+    }
+}
+
+template<typename S, typename T>
+CPP11_INLINE void multiply_run(size_t &i, size_t n, T *d_re, T *d_im,
+    const T *a_re, const T *a_im, const T *b_re, const T *b_im)
+{
+    for (; i + S::width <= n; i += S::width) {
+        typename S::V r, im;
+        cmul<S>(S::load(a_re + i), S::load(a_im + i), S::load(b_re + i),
+            S::load(b_im + i), r, im);
+        S::store(d_re + i, r);
+        S::store(d_im + i, im);
+    }
+}
+
+template<typename S, typename T>
+CPP11_INLINE void magnitude_run(size_t &i, size_t n, T *out,
+    const T *re, const T *im)
+{
+    for (; i + S::width <= n; i += S::width) {
+        const typename S::V r = S::load(re + i), m = S::load(im + i);
+        S::store(out + i, S::sqrt(S::fmadd(r, r, S::mul(m, m))));
+    }
+}
+
+template<typename S, typename T>
+CPP11_INLINE void conjugate_run(size_t &i, size_t n, T *im)
+{
+    for (; i + S::width <= n; i += S::width) {
+        S::store(im + i, S::neg(S::load(im + i)));
+    }
+}
+
+template<typename S, typename T>
+CPP11_INLINE void scale_run(size_t &i, size_t n, T *re, T *im, T factor)
+{
+    const typename S::V f = S::set1(factor);
+    for (; i + S::width <= n; i += S::width) {
+        S::store(re + i, S::mul(S::load(re + i), f));
+        S::store(im + i, S::mul(S::load(im + i), f));
+    }
+}
+
+template<typename S, typename T>
+CPP11_INLINE void butterfly2_run(size_t &i, size_t n, T *re, T *im,
+    const T *w_re, const T *w_im)
+{
+    typedef typename S::V V;
+    for (; i + S::width <= n; i += S::width) {
+        V tr, ti;
+        cmul<S>(S::load(w_re + i), S::load(w_im + i),
+            S::load(re + n + i), S::load(im + n + i), tr, ti);
+        const V r = S::load(re + i), m = S::load(im + i);
+        S::store(re + i, S::add(r, tr));
+        S::store(im + i, S::add(m, ti));
+        S::store(re + n + i, S::sub(r, tr));
+        S::store(im + n + i, S::sub(m, ti));
+    }
+}
+
+// Stage one (w) combines x0 with x1 and x2 with x3 to a0..a3, stage two
+// (v) a0 with a2, and a1 with a3 by the twiddle -i v.
+template<typename S, typename T>
+CPP11_INLINE void butterfly4_run(size_t &i, size_t n, T *re, T *im,
+    const T *w_re, const T *w_im, const T *v_re, const T *v_im)
+{
+    typedef typename S::V V;
+    for (; i + S::width <= n; i += S::width) {
+        T *r0 = re + i, *r1 = r0 + n, *r2 = r1 + n, *r3 = r2 + n;
+        T *i0 = im + i, *i1 = i0 + n, *i2 = i1 + n, *i3 = i2 + n;
+        const V wr = S::load(w_re + i), wi = S::load(w_im + i);
+        V t1r, t1i, t3r, t3i;
+        cmul<S>(wr, wi, S::load(r1), S::load(i1), t1r, t1i);
+        cmul<S>(wr, wi, S::load(r3), S::load(i3), t3r, t3i);
+        const V x0r = S::load(r0), x0i = S::load(i0);
+        const V x2r = S::load(r2), x2i = S::load(i2);
+        const V a0r = S::add(x0r, t1r), a0i = S::add(x0i, t1i);
+        const V a1r = S::sub(x0r, t1r), a1i = S::sub(x0i, t1i);
+        const V a2r = S::add(x2r, t3r), a2i = S::add(x2i, t3i);
+        const V a3r = S::sub(x2r, t3r), a3i = S::sub(x2i, t3i);
+        const V vr = S::load(v_re + i), vi = S::load(v_im + i);
+        V tr, ti, ur, ui;
+        cmul<S>(vr, vi, a2r, a2i, tr, ti);
+        cmul<S>(vr, vi, a3r, a3i, ur, ui);
+        S::store(r0, S::add(a0r, tr));
+        S::store(i0, S::add(a0i, ti));
+        S::store(r2, S::sub(a0r, tr));
+        S::store(i2, S::sub(a0i, ti));
+        S::store(r1, S::add(a1r, ui));
+        S::store(i1, S::sub(a1i, ur));
+        S::store(r3, S::sub(a1r, ui));
+        S::store(i3, S::add(a1i, ur));
+    }
+}
+
+// The kernels for operations S on T, then S::Narrow (SSE2 after AVX2),
+// which matters for the short runs of the first FFT stages, then scalar
+// for the tail.
+template<typename S, typename T>
+CPP11_INLINE void multiply_add(T *d_re, T *d_im, const T *a_re,
+    const T *a_im, const T *b_re, const T *b_im, size_t n)
+{
+    size_t i = 0;
+    multiply_add_run<S>(i, n, d_re, d_im, a_re, a_im, b_re, b_im);
+    multiply_add_run<typename S::Narrow>(i, n, d_re, d_im, a_re, a_im,
+        b_re, b_im);
+    multiply_add_run<ScalarOps<T>>(i, n, d_re, d_im, a_re, a_im, b_re,
+        b_im);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void multiply(T *d_re, T *d_im, const T *a_re,
+    const T *a_im, const T *b_re, const T *b_im, size_t n)
+{
+    size_t i = 0;
+    multiply_run<S>(i, n, d_re, d_im, a_re, a_im, b_re, b_im);
+    multiply_run<typename S::Narrow>(i, n, d_re, d_im, a_re, a_im, b_re,
+        b_im);
+    multiply_run<ScalarOps<T>>(i, n, d_re, d_im, a_re, a_im, b_re, b_im);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void magnitude(T *out, const T *re, const T *im, size_t n)
+{
+    size_t i = 0;
+    magnitude_run<S>(i, n, out, re, im);
+    magnitude_run<typename S::Narrow>(i, n, out, re, im);
+    magnitude_run<ScalarOps<T>>(i, n, out, re, im);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void conjugate(T *im, size_t n)
+{
+    size_t i = 0;
+    conjugate_run<S>(i, n, im);
+    conjugate_run<typename S::Narrow>(i, n, im);
+    conjugate_run<ScalarOps<T>>(i, n, im);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void scale(T *re, T *im, T factor, size_t n)
+{
+    size_t i = 0;
+    scale_run<S>(i, n, re, im, factor);
+    scale_run<typename S::Narrow>(i, n, re, im, factor);
+    scale_run<ScalarOps<T>>(i, n, re, im, factor);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void butterfly2(T *re, T *im, const T *w_re, const T *w_im,
+    size_t n)
+{
+    size_t i = 0;
+    butterfly2_run<S>(i, n, re, im, w_re, w_im);
+    butterfly2_run<typename S::Narrow>(i, n, re, im, w_re, w_im);
+    butterfly2_run<ScalarOps<T>>(i, n, re, im, w_re, w_im);
+}
+
+template<typename S, typename T>
+CPP11_INLINE void butterfly4(T *re, T *im, const T *w_re, const T *w_im,
+    const T *v_re, const T *v_im, size_t n)
+{
+    size_t i = 0;
+    butterfly4_run<S>(i, n, re, im, w_re, w_im, v_re, v_im);
+    butterfly4_run<typename S::Narrow>(i, n, re, im, w_re, w_im, v_re,
+        v_im);
+    butterfly4_run<ScalarOps<T>>(i, n, re, im, w_re, w_im, v_re, v_im);
+}
+
+template<typename T>
+struct Scalar {
+    static const ComplexKernels<T> kernels;
+};
+
+template<typename T>
+const ComplexKernels<T> Scalar<T>::kernels = {
+    "scalar", multiply_add<ScalarOps<T>>, multiply<ScalarOps<T>>,
+    magnitude<ScalarOps<T>>, conjugate<ScalarOps<T>>,
+    scale<ScalarOps<T>>, butterfly2<ScalarOps<T>>,
+    butterfly4<ScalarOps<T>>
+};
+
+#ifdef CPP11_COMPLEX_X86
+
+#define CPP11_SSE2 __attribute__((target("sse2")))
+
+template<typename T> struct Sse2Ops;
+
+template<>
+struct Sse2Ops<float> {
+    typedef __m128 V;
+    typedef ScalarOps<float> Narrow;
+    static const size_t width = 4;
+    CPP11_SSE2 static V load(const float *p) { return _mm_loadu_ps(p); }
+    CPP11_SSE2 static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+    CPP11_SSE2 static V set1(float x) { return _mm_set1_ps(x); }
+    CPP11_SSE2 static V add(V a, V b) { return _mm_add_ps(a, b); }
+    CPP11_SSE2 static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    CPP11_SSE2 static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    CPP11_SSE2 static V fmadd(V a, V b, V c) { return add(mul(a, b), c); }
+    CPP11_SSE2 static V fnmadd(V a, V b, V c) {
+        return sub(c, mul(a, b));
+    }
+    CPP11_SSE2 static V neg(V a) {
+        return _mm_xor_ps(a, _mm_set1_ps(-0.0f));
+    }
+    CPP11_SSE2 static V sqrt(V a) { return _mm_sqrt_ps(a); }
+};
+
+template<>
+struct Sse2Ops<double> {
+    typedef __m128d V;
+    typedef ScalarOps<double> Narrow;
+    static const size_t width = 2;
+    CPP11_SSE2 static V load(const double *p) { return _mm_loadu_pd(p); }
+    CPP11_SSE2 static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+    CPP11_SSE2 static V set1(double x) { return _mm_set1_pd(x); }
+    CPP11_SSE2 static V add(V a, V b) { return _mm_add_pd(a, b); }
+    CPP11_SSE2 static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    CPP11_SSE2 static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    CPP11_SSE2 static V fmadd(V a, V b, V c) { return add(mul(a, b), c); }
+    CPP11_SSE2 static V fnmadd(V a, V b, V c) {
+        return sub(c, mul(a, b));
+    }
+    CPP11_SSE2 static V neg(V a) {
+        return _mm_xor_pd(a, _mm_set1_pd(-0.0));
+    }
+    CPP11_SSE2 static V sqrt(V a) { return _mm_sqrt_pd(a); }
+};
+
+template<typename T>
+struct Sse2 {
+    typedef Sse2Ops<T> S;
+    CPP11_SSE2 static void multiply_add(T *d_re, T *d_im, const T *a_re,
+        const T *a_im, const T *b_re, const T *b_im, size_t n) {
+        ::multiply_add<S>(d_re, d_im, a_re, a_im, b_re, b_im, n);
+    }
+    CPP11_SSE2 static void multiply(T *d_re, T *d_im, const T *a_re,
+        const T *a_im, const T *b_re, const T *b_im, size_t n) {
+        ::multiply<S>(d_re, d_im, a_re, a_im, b_re, b_im, n);
+    }
+    CPP11_SSE2 static void magnitude(T *out, const T *re, const T *im,
+        size_t n) {
+        ::magnitude<S>(out, re, im, n);
+    }
+    CPP11_SSE2 static void conjugate(T *im, size_t n) {
+        ::conjugate<S>(im, n);
+    }
+    CPP11_SSE2 static void scale(T *re, T *im, T factor, size_t n) {
+        ::scale<S>(re, im, factor, n);
+    }
+    CPP11_SSE2 static void butterfly2(T *re, T *im, const T *w_re,
+        const T *w_im, size_t n) {
+        ::butterfly2<S>(re, im, w_re, w_im, n);
+    }
+    CPP11_SSE2 static void butterfly4(T *re, T *im, const T *w_re,
+        const T *w_im, const T *v_re, const T *v_im, size_t n) {
+        ::butterfly4<S>(re, im, w_re, w_im, v_re, v_im, n);
+    }
+    static const ComplexKernels<T> kernels;
+};
+
+template<typename T>
+const ComplexKernels<T> Sse2<T>::kernels = {
+    "sse2", multiply_add, multiply, magnitude, conjugate, scale,
+    butterfly2, butterfly4
+};
+
+#define CPP11_AVX2 __attribute__((target("avx2,fma")))
+
+template<typename T> struct Avx2Ops;
+
+template<>
+struct Avx2Ops<float> {
+    typedef __m256 V;
+    typedef Sse2Ops<float> Narrow;
+    static const size_t width = 8;
+    CPP11_AVX2 static V load(const float *p) { return _mm256_loadu_ps(p); }
+    CPP11_AVX2 static void store(float *p, V v) {
+        _mm256_storeu_ps(p, v);
+    }
+    CPP11_AVX2 static V set1(float x) { return _mm256_set1_ps(x); }
+    CPP11_AVX2 static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    CPP11_AVX2 static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    CPP11_AVX2 static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    CPP11_AVX2 static V fmadd(V a, V b, V c) {
+        return _mm256_fmadd_ps(a, b, c);
+    }
+    CPP11_AVX2 static V fnmadd(V a, V b, V c) {
+        return _mm256_fnmadd_ps(a, b, c);
+    }
+    CPP11_AVX2 static V neg(V a) {
+        return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f));
+    }
+    CPP11_AVX2 static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+};
+
+template<>
+struct Avx2Ops<double> {
+    typedef __m256d V;
+    typedef Sse2Ops<double> Narrow;
+    static const size_t width = 4;
+    CPP11_AVX2 static V load(const double *p) {
+        return _mm256_loadu_pd(p);
+    }
+    CPP11_AVX2 static void store(double *p, V v) {
+        _mm256_storeu_pd(p, v);
+    }
+    CPP11_AVX2 static V set1(double x) { return _mm256_set1_pd(x); }
+    CPP11_AVX2 static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    CPP11_AVX2 static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    CPP11_AVX2 static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    CPP11_AVX2 static V fmadd(V a, V b, V c) {
+        return _mm256_fmadd_pd(a, b, c);
+    }
+    CPP11_AVX2 static V fnmadd(V a, V b, V c) {
+        return _mm256_fnmadd_pd(a, b, c);
+    }
+    CPP11_AVX2 static V neg(V a) {
+        return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+    }
+    CPP11_AVX2 static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+};
+
+template<typename T>
+struct Avx2 {
+    typedef Avx2Ops<T> S;
+    CPP11_AVX2 static void multiply_add(T *d_re, T *d_im, const T *a_re,
+        const T *a_im, const T *b_re, const T *b_im, size_t n) {
+        ::multiply_add<S>(d_re, d_im, a_re, a_im, b_re, b_im, n);
+    }
+    CPP11_AVX2 static void multiply(T *d_re, T *d_im, const T *a_re,
+        const T *a_im, const T *b_re, const T *b_im, size_t n) {
+        ::multiply<S>(d_re, d_im, a_re, a_im, b_re, b_im, n);
+    }
+    CPP11_AVX2 static void magnitude(T *out, const T *re, const T *im,
+        size_t n) {
+        ::magnitude<S>(out, re, im, n);
+    }
+    CPP11_AVX2 static void conjugate(T *im, size_t n) {
+        ::conjugate<S>(im, n);
+    }
+    CPP11_AVX2 static void scale(T *re, T *im, T factor, size_t n) {
+        ::scale<S>(re, im, factor, n);
+    }
+    CPP11_AVX2 static void butterfly2(T *re, T *im, const T *w_re,
+        const T *w_im, size_t n) {
+        ::butterfly2<S>(re, im, w_re, w_im, n);
+    }
+    CPP11_AVX2 static void butterfly4(T *re, T *im, const T *w_re,
+        const T *w_im, const T *v_re, const T *v_im, size_t n) {
+        ::butterfly4<S>(re, im, w_re, w_im, v_re, v_im, n);
+    }
+    static const ComplexKernels<T> kernels;
+};
+
+template<typename T>
+const ComplexKernels<T> Avx2<T>::kernels = {
+    "avx2", multiply_add, multiply, magnitude, conjugate, scale,
+    butterfly2, butterfly4
+};
+
+#endif // CPP11_COMPLEX_X86
+
+} // namespace
+
+template<typename T>
+std::vector<const ComplexKernels<T> *> available_complex_kernels()
+{
+    std::vector<const ComplexKernels<T> *> kernels { &Scalar<T>::kernels };
+#ifdef CPP11_COMPLEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back(&Sse2<T>::kernels);
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        kernels.push_back(&Avx2<T>::kernels);
+    }
+#endif
+    return kernels;
+}
+
+template<typename T>
+const ComplexKernels<T> &complex_kernels()
+{
+    static const ComplexKernels<T> *best =
+        available_complex_kernels<T>().back();
+    return *best;
+}
+
+template std::vector<const ComplexKernels<float> *>
+    available_complex_kernels<float>();
+template std::vector<const ComplexKernels<double> *>
+    available_complex_kernels<double>();
+template const ComplexKernels<float> &complex_kernels<float>();
+template const ComplexKernels<double> &complex_kernels<double>();
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,155 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/complexarray.h Arrays of complex numbers stored as split
+ *       real and imaginary parts, with SSE2 or AVX2 kernels.
+ *
+ * The _i literals give std::complex<long double>, which is x87
+ * arithmetic on x86 and one number at a time. A ComplexArray of float or
+ * double keeps all real parts in one array and all imaginary parts in
+ * another ("structure of arrays"), so a SIMD register holds four or
+ * eight real parts and the products of complex numbers are plain
+ * vector multiplications and additions, fused where the CPU has FMA.
+ *
+ * As for Image, the kernels are chosen once at run time by what the CPU
+ * supports; their results may differ from the scalar ones in the last
+ * bits because of the fused multiply-adds.
+ *
+ * \code
+ * ComplexArray<double> a { 1 + 2_i, 3 + 4_i }, b { 2_i, 1 + 0_i };
+ * ComplexArray<double> sum(2);
+ * sum.multiply_add(a, b);                  // sum += a * b
+ * std::vector<double> m = sum.magnitude();
+ * \endcode
+ */
+
+#ifndef CPP11_COMPLEXARRAY_H
+#define CPP11_COMPLEXARRAY_H 1
+
+#include "cpp11/literals.h"
+
+#include <complex>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Kernels on runs of \a n complex numbers given as real and imaginary
+ * parts. Outputs may be the same as inputs (but not otherwise overlap).
+ */
+template<typename T>
+struct ComplexKernels {
+    const char *name;
+    /// d += a * b.
+    void (*multiply_add)(T *d_re, T *d_im, const T *a_re, const T *a_im,
+        const T *b_re, const T *b_im, size_t n);
+    /// d = a * b.
+    void (*multiply)(T *d_re, T *d_im, const T *a_re, const T *a_im,
+        const T *b_re, const T *b_im, size_t n);
+    /// out = |z| as sqrt(re^2 + im^2).
+    void (*magnitude)(T *out, const T *re, const T *im, size_t n);
+    /// Negates the imaginary parts.
+    void (*conjugate)(T *im, size_t n);
+    /// z *= factor.
+    void (*scale)(T *re, T *im, T factor, size_t n);
+    /// Radix-2 FFT butterflies: x0, x1 = x0 + w x1, x0 - w x1, for the
+    /// n numbers at x0 = (re, im) and x1 = (re + n, im + n).
+    void (*butterfly2)(T *re, T *im, const T *w_re, const T *w_im,
+        size_t n);
+    /// Radix-4 FFT butterflies, two radix-2 stages at once: the numbers
+    /// at (re, im) + k n for k in 0..3 with twiddles w of the first
+    /// stage and v of the second.
+    void (*butterfly4)(T *re, T *im, const T *w_re, const T *w_im,
+        const T *v_re, const T *v_im, size_t n);
+};
+
+/// The fastest kernels the CPU supports, for float and double.
+template<typename T>
+const ComplexKernels<T> &complex_kernels();
+/// All kernels the CPU supports, scalar first, fastest last.
+template<typename T>
+std::vector<const ComplexKernels<T> *> available_complex_kernels();
+
+/**
+ * An array of complex numbers of float or double, real and imaginary
+ * parts stored apart.
+ */
+template<typename T>
+class ComplexArray {
+  public:
+    explicit ComplexArray(size_t size=0,
+        const ComplexKernels<T> &kernels=complex_kernels<T>())
+        : kernels_(&kernels), re_(size), im_(size)
+    { }
+    /// From the _i literals, e.g. { 1 + 2_i, 3_i }.
+    ComplexArray(std::initializer_list<std::complex<long double>> values,
+        const ComplexKernels<T> &kernels=complex_kernels<T>())
+        : kernels_(&kernels)
+    {
+        re_.reserve(values.size());
+        im_.reserve(values.size());
+        for (const std::complex<long double> &z: values) {
+            re_.push_back(static_cast<T>(z.real()));
+            im_.push_back(static_cast<T>(z.imag()));
+        }
+    }
+
+    size_t size() const { return re_.size(); }
+    T *real() { return re_.data(); }
+    T *imag() { return im_.data(); }
+    const T *real() const { return re_.data(); }
+    const T *imag() const { return im_.data(); }
+    const ComplexKernels<T> &kernels() const { return *kernels_; }
+
+    std::complex<T> operator[](size_t i) const {
+        return std::complex<T>(re_[i], im_[i]);
+    }
+    void set(size_t i, std::complex<T> z) {
+        re_[i] = z.real();
+        im_[i] = z.imag();
+    }
+
+    /// this += a * b elementwise; throws std::invalid_argument if the
+    /// sizes differ.
+    void multiply_add(const ComplexArray &a, const ComplexArray &b) {
+        check(a);
+        check(b);
+        kernels_->multiply_add(real(), imag(), a.real(), a.imag(),
+            b.real(), b.imag(), size());
+    }
+    /// this *= other elementwise.
+    void multiply(const ComplexArray &other) {
+        check(other);
+        kernels_->multiply(real(), imag(), real(), imag(), other.real(),
+            other.imag(), size());
+    }
+    void conjugate() {
+        kernels_->conjugate(imag(), size());
+    }
+    void scale(T factor) {
+        kernels_->scale(real(), imag(), factor, size());
+    }
+    std::vector<T> magnitude() const {
+        std::vector<T> result(size());
+        kernels_->magnitude(result.data(), real(), imag(), size());
+        return result;
+    }
+
+  private:
+    void check(const ComplexArray &other) const {
+        if (other.size() != size()) {
+            throw std::invalid_argument("ComplexArray: sizes differ");
+        }
+    }
+
+    const ComplexKernels<T> *kernels_;
+    std::vector<T> re_;
+    std::vector<T> im_;
+};
+
+#endif // CPP11_COMPLEXARRAY_H
+
+/* vim: set ts=4 sw=4 tw=76: */
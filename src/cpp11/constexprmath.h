@@ -0,0 +1,119 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/constexprmath.h Compile time math and lookup tables.
+ *
+ * As factorial_func() in factorial.h, these are constexpr functions of a
+ * single return statement, recursing instead of looping, so that they
+ * can fill lookup tables at compile time:
+ *
+ * \code
+ * constexpr double cube_root(size_t i) { return cx::pow(i, 1.0 / 3); }
+ * using CubeRoots = cx::Table<double, size_t, cube_root, 1000>;
+ * double r = CubeRoots::values[343];   // 7, computed by the compiler
+ * \endcode
+ *
+ * The tables are static data of class templates, so each is stored
+ * once (in .rodata) however many translation units use it.
+ */
+
+#ifndef CPP11_CONSTEXPRMATH_H
+#define CPP11_CONSTEXPRMATH_H 1
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace cx {
+
+constexpr double ln2 = 0.693147180559945309417232121458;
+
+constexpr double abs(double x) { return x < 0 ? -x : x; }
+constexpr double square(double x) { return x * x; }
+
+// Taylor series of exp(x) from the term x^n/n!, for small |x|.
+constexpr double exp_series(double x, unsigned n, double term, double sum)
+{
+    return n > 24 || term == 0 ? sum
+        : exp_series(x, n + 1, term * x / (n + 1),
+            sum + term * x / (n + 1));
+}
+
+/// e^x, halving x until the series converges quickly.
+constexpr double exp(double x)
+{
+    return abs(x) > 0.5 ? square(exp(x / 2))
+        : exp_series(x, 0, 1, 1);
+}
+
+// 2 atanh(y) = ln((1+y)/(1-y)) as a series of odd powers of y.
+constexpr double atanh_series(double y2, double power, unsigned n,
+    double sum)
+{
+    return n > 61 ? 2 * sum
+        : atanh_series(y2, power * y2, n + 2, sum + power / n);
+}
+
+/// Natural logarithm, scaling x into [1, 2] by powers of two first.
+constexpr double log(double x)
+{
+    return x <= 0 ? throw std::domain_error("cx::log of x <= 0")
+        : x > 2 ? log(x / 2) + ln2
+        : x < 1 ? log(x * 2) - ln2
+        : atanh_series(square((x - 1) / (x + 1)), (x - 1) / (x + 1), 1,
+            0);
+}
+
+/// x^y for x >= 0.
+constexpr double pow(double x, double y)
+{
+    return x == 0 ? 0 : exp(y * log(x));
+}
+
+/// Rounds to the nearest integer, halves away from zero.
+constexpr long round(double x)
+{
+    return x < 0 ? -static_cast<long>(-x + 0.5)
+        : static_cast<long>(x + 0.5);
+}
+
+/// 0, 1, ..., N-1 as a type (std::index_sequence is C++ 2014).
+template<size_t... I> struct IndexSequence { };
+
+template<typename A, typename B> struct ConcatIndices;
+template<size_t... A, size_t... B>
+struct ConcatIndices<IndexSequence<A...>, IndexSequence<B...>> {
+    using type = IndexSequence<A..., (sizeof...(A) + B)...>;
+};
+
+// Built from two halves, so the template nesting is log2(N) deep.
+template<size_t N> struct MakeIndices {
+    using type = typename ConcatIndices<
+        typename MakeIndices<N / 2>::type,
+        typename MakeIndices<N - N / 2>::type>::type;
+};
+template<> struct MakeIndices<0> { using type = IndexSequence<>; };
+template<> struct MakeIndices<1> { using type = IndexSequence<0>; };
+
+template<typename T, typename Index, T (*F)(Index), typename Indices>
+struct TableOf;
+
+template<typename T, typename Index, T (*F)(Index), size_t... I>
+struct TableOf<T, Index, F, IndexSequence<I...>> {
+    static constexpr size_t size = sizeof...(I);
+    static constexpr T values[sizeof...(I)] = { F(Index(I))... };
+};
+
+template<typename T, typename Index, T (*F)(Index), size_t... I>
+constexpr T TableOf<T, Index, F, IndexSequence<I...>>::values[];
+
+/// The table F(0), F(1), ..., F(N-1), computed at compile time.
+template<typename T, typename Index, T (*F)(Index), size_t N>
+using Table = TableOf<T, Index, F, typename MakeIndices<N>::type>;
+
+} // namespace cx
+
+#endif // CPP11_CONSTEXPRMATH_H
+
+/* vim: set ts=4 sw=4 tw=76: */
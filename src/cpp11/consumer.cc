@@ -7,91 +7,110 @@
  */
 
 #include "cpp11/consumer.h"
+#include "cpp11/counter.h"
+#include "cpp11/timerwheel.h"
+#include "cpp11/topology.h"
 
 #include <iostream>
 #include <thread>
 #include <mutex>
 #include <chrono>
-#include <queue>
-#include <condition_variable>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
 
 void consumer_test()
 {
     using Message=std::string;
-    // A simple synchronized message queue, to be used from multiple threads.
-    class Queue {
-        std::queue<Message> mqueue_;
-        std::condition_variable mcond_;
-        std::mutex mmutex_;
 
+    // The queue itself is quiet, so the demo threads log what they do.
+    class LoggingQueue : public Queue<Message> {
         public:
         void add(const Message &m) {
             std::cout << "add " << m << std::endl;
-            std::unique_lock<std::mutex> lock { mmutex_ };
-            mqueue_.push(m);
-            mcond_.notify_one();
-        }
-        Message get() {
-            std::unique_lock<std::mutex> lock { mmutex_ };
-            if (!mqueue_.empty()) {
-                Message m = mqueue_.front();
-                mqueue_.pop();
-                std::cout << "had " << m << std::endl;
-                return m;
-            }
-            // else: empty --> wait.
-            mcond_.wait(lock);
-            Message m = mqueue_.front();
-            mqueue_.pop();
-            std::cout << "waited for " << m << std::endl;
-            return m;
+            Queue<Message>::add(m);
         }
     };
 
-    // A simple producer producing messages by the time.
+    // A simple producer producing messages by the time. Rather than
+    // sleeping in a thread of its own, it schedules each batch on a
+    // TimerService.
     class Producer {
-        Queue &queue_;
+        LoggingQueue &queue_;
+        TimerService &timers_;
+        // Shared with the timer callbacks, which may still be returning
+        // from set_value() when join() already returned.
+        std::shared_ptr<std::promise<void>> done_;
         public:
-        Producer(Queue &queue) : queue_(queue) { }
-        void operator()() {
-            queue_.add("MSG_0");
-            std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-            queue_.add("MSG_1");
-            std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-            queue_.add("MSG_2a");
-            queue_.add("MSG_2b");
-            std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-            queue_.add("MSG_3a");
-            queue_.add("MSG_3b");
-            std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-            queue_.add("STOP");
-            std::cout << "Producer done" << std::endl;
+        Producer(LoggingQueue &queue, TimerService &timers)
+            : queue_(queue), timers_(timers),
+              done_(std::make_shared<std::promise<void>>()) { }
+        void start() {
+            const std::vector<std::vector<Message>> batches {
+                { "MSG_0" }, { "MSG_1" }, { "MSG_2a", "MSG_2b" },
+                { "MSG_3a", "MSG_3b" }, { "STOP" }
+            };
+            for (size_t n=0; n<batches.size(); ++n) {
+                const std::vector<Message> batch = batches[n];
+                std::shared_ptr<std::promise<void>> done = done_;
+                timers_.schedule_after(std::chrono::milliseconds{1000} * n,
+                    [this, batch, done] {
+                        for (const Message &m: batch) {
+                            queue_.add(m);
+                            if (m=="STOP") {
+                                std::cout << "Producer done" << std::endl;
+                                done->set_value();
+                            }
+                        }
+                    });
+            }
         }
+        // Waits until the last message was added; the queue must live
+        // until then.
+        void join() { done_->get_future().wait(); }
     };
 
+    // Counts consumed messages, whichever thread consumes them.
+    ShardedCounter consumed { "consumer_test.consumed" };
+
     // A simple consumer consuming available messages.
     class Consumer {
-        Queue &queue_;
+        LoggingQueue &queue_;
+        ShardedCounter &consumed_;
         public:
-        Consumer(Queue &queue) : queue_(queue) { }
+        Consumer(LoggingQueue &queue, ShardedCounter &consumed)
+            : queue_(queue), consumed_(consumed) { }
         void operator()() {
             for(;;) {
                 Message m=queue_.get();
                 if (m=="STOP") break;
+                ++consumed_;
                 std::cout << "consumed " << m << std::endl;
             }
             std::cout << "Consumer done" << std::endl;
         }
     };
 
-    Queue queue;
+    LoggingQueue queue;
+    queue.stats().enable();
     // Consumer consumer(queue);
-    // Producer producer(queue);
 
-    std::thread producer { Producer(queue) };
-    std::thread consumer { Consumer(queue) };
+    TimerService timers;
+    Producer producer { queue, timers };
+    producer.start();
+    // The consumer stays on the CPUs of the first node, so the
+    // scheduler does not move it across nodes between messages. Only
+    // the consumer is pinned: the producer runs on the timer thread,
+    // and the queue's deque allocates wherever it grows.
+    const CpuTopology &topology = CpuTopology::system();
+    std::thread consumer = pinned_thread(
+        topology.node_cpus(topology.cpus().front().node),
+        Consumer(queue, consumed));
     producer.join();
     consumer.join();
+    std::cout << queue.stats().snapshot().to_text();
+    std::cout << CounterRegistry::to_text();
 }
 
 /* vim: set ts=4 sw=4 tw=76: */
@@ -9,6 +9,182 @@
 #ifndef CPP11_CONSUMER_H
 #define CPP11_CONSUMER_H 1
 
+#include "cpp11/queuestats.h"
+#include "cpp11/waitstrategy.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <queue>
+#include <mutex>
+#include <stdexcept>
+#include <utility> // for std::move
+
+/**
+ * A simple synchronized message queue, to be used from multiple threads.
+ * Any number of producers may add() and any number of consumers may
+ * get() concurrently, messages are delivered in FIFO order.
+ *
+ * A queue constructed with a capacity is bounded: add() waits while it
+ * is full, which slows down producers to the speed of the consumers
+ * (backpressure). close() ends the stream: add() then throws, and
+ * consumers drain the remaining messages until get(Message&) returns
+ * false.
+ *
+ * The Stats policy (see cpp11/queuestats.h) can record latencies, queue
+ * depths and waiting times; by default it is compiled in but disabled.
+ * The Wait policy (see cpp11/waitstrategy.h) decides how get() waits for
+ * messages, by default on a condition variable.
+ */
+template<typename Message, typename Stats=QueueStats,
+         typename Wait=CondVarWait>
+class Queue {
+    using Stamp = typename Stats::Stamp;
+    // Stamp is an empty base for NoQueueStats, so it takes no space.
+    struct Entry : Stamp {
+        Message message;
+        Entry(const Stamp &stamp, const Message &m)
+            : Stamp(stamp), message(m) { }
+        Entry(const Stamp &stamp, Message &&m)
+            : Stamp(stamp), message(std::move(m)) { }
+    };
+
+    std::queue<Entry> mqueue_;
+    std::mutex mmutex_;
+    // Copy of mqueue_.size() readable without the lock.
+    std::atomic<size_t> msize_;
+    std::atomic<bool> mclosed_;
+    const size_t mcapacity_;        // 0 for unbounded
+    // Producers waiting for space, only used by bounded queues.
+    std::condition_variable mspace_;
+    unsigned mfull_waiters_;
+    Wait mwait_;
+    Stats mstats_;
+
+    template<typename M>
+    void push(M &&m) {
+        const Stamp stamp = mstats_.stamp();
+        size_t depth;
+        {
+            std::unique_lock<std::mutex> lock { mmutex_ };
+            if (mcapacity_ && mqueue_.size() >= mcapacity_) {
+                ++mfull_waiters_;
+                mspace_.wait(lock, [this] {
+                    return mqueue_.size() < mcapacity_ || closed();
+                });
+                --mfull_waiters_;
+            }
+            if (closed()) {
+                throw std::logic_error("Queue::add: queue is closed");
+            }
+            mqueue_.emplace(stamp, std::forward<M>(m));
+            depth = mqueue_.size();
+            msize_.store(depth, std::memory_order_relaxed);
+        }
+        mwait_.notify();
+        mstats_.added(depth);
+    }
+
+    Message pop(std::unique_lock<std::mutex> &lock) {
+        Entry e = std::move(mqueue_.front());
+        mqueue_.pop();
+        msize_.store(mqueue_.size(), std::memory_order_relaxed);
+        const bool wake_producer = mfull_waiters_ != 0;
+        lock.unlock();
+        if (wake_producer) {
+            mspace_.notify_one();
+        }
+        mstats_.removed(e);
+        return std::move(e.message);
+    }
+
+    // Waits while the queue is empty and open, returns false if closed
+    // and drained.
+    bool wait_for_message(std::unique_lock<std::mutex> &lock) {
+        if (mqueue_.empty() && !closed()) {
+            const typename Stats::WaitStamp start = mstats_.begin_wait();
+            mwait_.wait(lock,
+                [this] { return !mqueue_.empty() || closed(); },
+                [this] {
+                    return msize_.load(std::memory_order_relaxed) != 0
+                        || closed();
+                });
+            mstats_.end_wait(start);
+        }
+        return !mqueue_.empty();
+    }
+
+  public:
+    /// An unbounded queue, or one holding at most \a capacity messages.
+    explicit Queue(size_t capacity=0)
+        : msize_{0}, mclosed_{false}, mcapacity_(capacity),
+          mfull_waiters_(0) { }
+
+    /// Appends a message, waits while a bounded queue is full. Throws
+    /// std::logic_error if the queue is (or gets) closed.
+    void add(const Message &m) { push(m); }
+    void add(Message &&m) { push(std::move(m)); }
+
+    /// Removes the oldest message, waits while the queue is empty.
+    /// Throws std::logic_error if the queue is closed and drained.
+    Message get() {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        if (!wait_for_message(lock)) {
+            throw std::logic_error("Queue::get: queue is closed");
+        }
+        return pop(lock);
+    }
+
+    /// Removes the oldest message, waits while the queue is empty.
+    /// Returns false at the end of the stream (closed and drained).
+    bool get(Message &m) {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        if (!wait_for_message(lock)) {
+            return false;
+        }
+        m = pop(lock);
+        return true;
+    }
+
+    /// Removes the oldest message if there is one, never waits.
+    bool try_get(Message &m) {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        if (mqueue_.empty()) {
+            return false;
+        }
+        m = pop(lock);
+        return true;
+    }
+
+    /// Ends the stream: wakes up all waiting producers and consumers.
+    /// Queued messages can still be taken.
+    void close() {
+        {
+            std::unique_lock<std::mutex> lock { mmutex_ };
+            mclosed_.store(true, std::memory_order_relaxed);
+        }
+        mspace_.notify_all();
+        mwait_.notify_all();
+    }
+
+    bool closed() const { return mclosed_.load(std::memory_order_relaxed); }
+
+    /// Maximum number of queued messages, 0 if unbounded.
+    size_t capacity() const { return mcapacity_; }
+
+    /// Number of queued messages (without locking, so it may be
+    /// outdated as soon as it is returned).
+    size_t size() const {
+        return msize_.load(std::memory_order_relaxed);
+    }
+
+    /// The instrumentation, for example to enable() it or to take a
+    /// snapshot().
+    Stats &stats() { return mstats_; }
+
+    /// The wait policy, for example to configure() it.
+    Wait &wait_policy() { return mwait_; }
+};
+
 /**
  * Creates a producer thread, a consumer thread and passed a few
  * test messages.
@@ -19,4 +195,3 @@ void consumer_test();
 #endif // CPP11_CONSUMER_H
 
 /* vim: set ts=4 sw=4 tw=76: */
-
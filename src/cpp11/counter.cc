@@ -0,0 +1,140 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/counter.cc Counters and gauges sharded per thread.
+ */
+
+#include "cpp11/counter.h"
+
+#include "cpp11/cacheline.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+struct ShardedCounter::Cell {
+    std::atomic<uint64_t> value;
+    // Cells of different threads never share a line.
+    char padding[cache_line_size];
+
+    Cell() : value{0} { }
+};
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<const ShardedCounter*> counters;
+};
+
+// Never destroyed, counters with static storage duration may outlive
+// any static registry object.
+Registry &registry()
+{
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+} // namespace
+
+ShardedCounter::ShardedCounter(const std::string &name)
+    : ShardedCounter(name, false)
+{ }
+
+ShardedCounter::ShardedCounter(const std::string &name, bool gauge)
+    : name_(name), gauge_(gauge)
+{
+    if (!name_.empty()) {
+        CounterRegistry::add(this);
+    }
+}
+
+ShardedCounter::~ShardedCounter()
+{
+    if (!name_.empty()) {
+        CounterRegistry::remove(this);
+    }
+}
+
+std::atomic<uint64_t> &ShardedCounter::local()
+{
+    if (void *cell = slot_.get()) {
+        return *static_cast<std::atomic<uint64_t>*>(cell);
+    }
+    return add_cell();
+}
+
+std::atomic<uint64_t> &ShardedCounter::add_cell()
+{
+    Cell *cell = new Cell;
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        cells_.emplace_back(cell);
+    }
+    slot_.set(&cell->value);
+    return cell->value;
+}
+
+uint64_t ShardedCounter::value() const
+{
+    uint64_t sum = 0;
+    std::unique_lock<std::mutex> lock { mutex_ };
+    for (auto &cell: cells_) {
+        sum += cell->value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+size_t ShardedCounter::cells() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return cells_.size();
+}
+
+void CounterRegistry::add(const ShardedCounter *counter)
+{
+    Registry &r = registry();
+    std::unique_lock<std::mutex> lock { r.mutex };
+    r.counters.push_back(counter);
+}
+
+void CounterRegistry::remove(const ShardedCounter *counter)
+{
+    Registry &r = registry();
+    std::unique_lock<std::mutex> lock { r.mutex };
+    r.counters.erase(std::find(r.counters.begin(), r.counters.end(),
+        counter));
+}
+
+std::vector<CounterRegistry::Entry> CounterRegistry::snapshot()
+{
+    std::map<std::string, Entry> sums;
+    {
+        Registry &r = registry();
+        std::unique_lock<std::mutex> lock { r.mutex };
+        for (const ShardedCounter *counter: r.counters) {
+            Entry &entry = sums[counter->name_];
+            entry.name = counter->name_;
+            entry.value += static_cast<int64_t>(counter->value());
+            entry.gauge = counter->gauge_;
+        }
+    }
+    std::vector<Entry> result;
+    for (auto &sum: sums) {
+        result.push_back(sum.second);
+    }
+    return result;
+}
+
+std::string CounterRegistry::to_text()
+{
+    std::ostringstream out;
+    for (const Entry &entry: snapshot()) {
+        out << entry.name << " " << entry.value << "\n";
+    }
+    return out.str();
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,134 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/counter.h Counters and gauges sharded per thread.
+ *
+ * A std::atomic counter incremented by many threads is one cache line
+ * moving from core to core with every increment. ShardedCounter gives
+ * each incrementing thread a cell on a cache line of its own, written
+ * only by that thread (a relaxed load and store, no read-modify-write),
+ * and value() adds up the cells on demand. Increments are cheap,
+ * reading is not: meant for statistics read now and then.
+ *
+ * Named counters register in a global registry for reporting:
+ *
+ * \code
+ * ShardedCounter processed { "consumer.processed" };
+ * ++processed;                                  // any thread
+ * std::cout << CounterRegistry::to_text();      // all named counters
+ * \endcode
+ */
+
+#ifndef CPP11_COUNTER_H
+#define CPP11_COUNTER_H 1
+
+#include "cpp11/threadslot.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * A monotonic counter that any number of threads may add to. Cells
+ * outlive their threads, so no increment gets lost.
+ */
+class ShardedCounter {
+  public:
+    /// Registers in the CounterRegistry unless \a name is empty.
+    explicit ShardedCounter(const std::string &name="");
+    ~ShardedCounter();
+    ShardedCounter(const ShardedCounter &)=delete;
+    ShardedCounter &operator=(const ShardedCounter &)=delete;
+
+    void add(uint64_t n) {
+        std::atomic<uint64_t> &cell = local();
+        cell.store(cell.load(std::memory_order_relaxed) + n,
+            std::memory_order_relaxed);
+    }
+    ShardedCounter &operator++() {
+        add(1);
+        return *this;
+    }
+
+    /// The sum of all cells; may run concurrently with add().
+    uint64_t value() const;
+    const std::string &name() const { return name_; }
+    /// Number of cells (threads that added so far).
+    size_t cells() const;
+
+  protected:
+    ShardedCounter(const std::string &name, bool gauge);
+
+  private:
+    friend class CounterRegistry;
+    struct Cell;
+
+    std::atomic<uint64_t> &local();
+    std::atomic<uint64_t> &add_cell();
+
+    const std::string name_;
+    const bool gauge_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Cell>> cells_;
+    // The cell of each thread; goes before the cells.
+    ThreadSlot slot_;
+};
+
+/**
+ * A sharded value going up and down, for example the number of
+ * messages in flight. Cells wrap around, only the sum is meaningful.
+ */
+class ShardedGauge : private ShardedCounter {
+  public:
+    explicit ShardedGauge(const std::string &name="")
+        : ShardedCounter(name, true) { }
+
+    void add(int64_t n) { ShardedCounter::add(static_cast<uint64_t>(n)); }
+    void sub(int64_t n) { add(-n); }
+    ShardedGauge &operator++() {
+        add(1);
+        return *this;
+    }
+    ShardedGauge &operator--() {
+        add(-1);
+        return *this;
+    }
+
+    int64_t value() const {
+        return static_cast<int64_t>(ShardedCounter::value());
+    }
+    using ShardedCounter::name;
+    using ShardedCounter::cells;
+};
+
+/**
+ * All named counters and gauges alive. Counters of the same name (for
+ * example of several instances of a class) are reported as one sum.
+ */
+class CounterRegistry {
+  public:
+    struct Entry {
+        std::string name;
+        int64_t value;
+        bool gauge;
+    };
+
+    /// The current values, sorted by name.
+    static std::vector<Entry> snapshot();
+    /// A line "name value" per entry.
+    static std::string to_text();
+
+  private:
+    friend class ShardedCounter;
+    static void add(const ShardedCounter *counter);
+    static void remove(const ShardedCounter *counter);
+};
+
+#endif // CPP11_COUNTER_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -41,4 +41,38 @@ void factorial_meta_test()
     static_assert(sizeof(newwaytempl)==sizeof(ref),"newwaytempl");
 }
 
+/**
+ * Compile time tests of the tables: their sizes are the largest that do
+ * not overflow, and lookups are constant expressions.
+ */
+void factorial_table_test()
+{
+    static_assert(max_factorial64==20,      "20! < 2^64 < 21!");
+    static_assert(max_factorial128==34,     "34! < 2^128 < 35!");
+    static_assert(max_factorial_double==170, "170! < DBL_MAX < 171!");
+    static_assert(max_binomial64==67,       "C(67,33) < 2^64 < C(68,34)");
+
+    static_assert(factorial64(0)==1 && factorial64(1)==1, "64(0,1)");
+    static_assert(factorial64(12)==uint64_t(factorial_func(12)), "64(12)");
+    static_assert(factorial64(20)==2432902008176640000ull, "64(20)");
+    static_assert(factorial128(25)==static_cast<unsigned __int128>(
+        factorial64(20))*21*22*23*24*25, "128(25)");
+    static_assert(factorial_double(22)==1124000727777607680000.0,
+        "double(22), the last exact one");
+
+    static_assert(binomial64(0,0)==1 && binomial64(5,2)==10, "C(5,2)");
+    static_assert(binomial64(5,6)==0, "C(5,6)");
+    static_assert(binomial64(20,10)
+        ==factorial64(20)/factorial64(10)/factorial64(10), "C(20,10)");
+    static_assert(binomial64(67,33)==14226520737620288370ull, "C(67,33)");
+    static_assert(binomial64(67,67)==1 && binomial64(67,1)==67, "C(67,k)");
+
+    static_assert(LogFactorials::values[1]==0, "ln 1!");
+    static_assert(cx::abs(LogFactorials::values[20]
+        - 42.335616460753485) < 1e-13, "ln 20!");
+
+    // A table size beyond the type does not compile, e.g.
+    // cx::Table<uint64_t, unsigned, factorial64_entry, 22>.
+}
+
 /* vim: set ts=4 sw=4 tw=76: */
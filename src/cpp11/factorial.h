@@ -3,16 +3,27 @@
  *
  * Examples in form of test code demonstrating C++ 2011.
  *
- * \file cpp11/factorial.h A simple factorialization class.
+ * \file cpp11/factorial.h A simple factorialization class, and tables
+ *       of factorials and binomial coefficients computed at compile time.
  */
 
 #ifndef CPP11_FACTORIAL_H
 #define CPP11_FACTORIAL_H 1
 
+#include "cpp11/constexprmath.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
 // Factorial meta "old" style.
 // A specialization is used, the value must be extracted explicitely.
+// 13! does not fit an int; (N > 0 ? N-1 : 0) ends the recursion when
+// the static_assert fails.
 template<int N> struct Factorial {
-    enum { value = N * Factorial<N-1>::value };
+    static_assert(N >= 0 && N <= 12, "Factorial<N>: int holds up to 12!");
+    enum { value = N * Factorial<(N > 0 ? N-1 : 0)>::value };
 };
 template<> struct Factorial<0> {
     enum { value = 1 };
@@ -21,8 +32,11 @@ template<> struct Factorial<0> {
 // Factorial meta "new" style.
 // Thanks to constexpr, it can be written like an ordinary function, much
 // simpler to read and understand. It can also be called at runtime.
+// Out of range it throws, which at compile time is an error.
 constexpr int factorial_func(const int value) {
-    return (value==0) ? 1 : value*factorial_func(value-1);
+    return (value < 0 || value > 12)
+        ? throw std::out_of_range("factorial_func: int holds up to 12!")
+        : (value==0) ? 1 : value*factorial_func(value-1);
 }
 
 // Factorial meta "old-with-new" style.
@@ -33,13 +47,162 @@ constexpr int factorial_func(const int value) {
 // templates where operator() could do whatever is appropriate without
 // needing to disclose internals nor needing to remember specifics.
 template<int N> struct FactorialNew {
-    enum { value = N * FactorialNew<N-1>::value };
+    static_assert(N >= 0 && N <= 12,
+        "FactorialNew<N>: int holds up to 12!");
+    enum { value = N * FactorialNew<(N > 0 ? N-1 : 0)>::value };
     constexpr int operator()() { return value; };
 };
 template<> struct FactorialNew<0> {
     enum { value = 1 };
 };
 
+// Tables for code that needs many factorials, e.g. of probabilities:
+// each value is computed once by the compiler, a lookup is an index.
+// The multiplications are checked, so a table larger than its type
+// allows does not compile (a throw in a constant expression), and the
+// sizes are computed as the largest that fit rather than written down.
+namespace factorial_detail {
+
+template<typename T>
+constexpr T checked_mul(T a, T b, T max) {
+    return b != 0 && a > max / b
+        ? throw std::overflow_error("factorial: overflow") : a * b;
+}
+
+// n! as T, at most max.
+template<typename T>
+constexpr T factorial(unsigned n, T max) {
+    return n <= 1 ? T(1)
+        : checked_mul(factorial<T>(n - 1, max), T(n), max);
+}
+
+// The largest n with n! <= max; f is n!.
+template<typename T>
+constexpr unsigned largest_factorial(T max, unsigned n=1, T f=1) {
+    return f > max / (n + 1) ? n
+        : largest_factorial<T>(max, n + 1, f * (n + 1));
+}
+
+constexpr uint64_t max64 = std::numeric_limits<uint64_t>::max();
+// No numeric_limits for __int128 in strict C++ 2011.
+constexpr unsigned __int128 max128 = ~static_cast<unsigned __int128>(0);
+// Products in long double, which rounds less; only the result has to
+// fit a double.
+constexpr long double max_double = std::numeric_limits<double>::max();
+
+constexpr uint64_t factorial64_entry(unsigned n) {
+    return factorial<uint64_t>(n, max64);
+}
+constexpr unsigned __int128 factorial128_entry(unsigned n) {
+    return factorial<unsigned __int128>(n, max128);
+}
+constexpr double factorial_double_entry(unsigned n) {
+    return static_cast<double>(factorial<long double>(n, max_double));
+}
+
+// C(n, k) for k <= n/2 and 128 bit products, i.e. n < 128 or so; c is
+// C(n, i - 1).
+constexpr unsigned __int128 binomial128(unsigned n, unsigned k,
+    unsigned i=1, unsigned __int128 c=1) {
+    return i > k ? c
+        : binomial128(n, k, i + 1,
+            checked_mul(c, static_cast<unsigned __int128>(n - i + 1),
+                max128) / i);
+}
+
+// The largest n with all C(n, k) (so the middle one) <= max.
+constexpr unsigned largest_binomial_row(uint64_t max, unsigned n=1) {
+    return binomial128(n + 1, (n + 1) / 2) > max ? n
+        : largest_binomial_row(max, n + 1);
+}
+
+// Pascal's triangle row by row: C(n, k) is at n (n + 1) / 2 + k.
+constexpr unsigned triangle_row(unsigned i, unsigned n=0) {
+    return i <= n ? n : triangle_row(i - n - 1, n + 1);
+}
+// C(n, k) by the smaller of k and n - k.
+constexpr uint64_t binomial64_of(unsigned n, unsigned k) {
+    return static_cast<uint64_t>(binomial128(n, k <= n / 2 ? k : n - k));
+}
+constexpr uint64_t binomial64_entry(unsigned i) {
+    return binomial64_of(triangle_row(i),
+        i - triangle_row(i) * (triangle_row(i) + 1) / 2);
+}
+
+// ln n! = (n + 1/2) ln n - n + ln(2 pi) / 2 + 1/12n - 1/360n^3
+// + 1/1260n^5 - 1/1680n^7 (Stirling), exact in double from n = 20 on.
+constexpr double stirling(double n, double log_n) {
+    return (n + 0.5) * log_n - n + 0.918938533204672741780329736406
+        + (1.0 / 12 - (1.0 / 360 - (1.0 / 1260 - 1.0 / 1680 / (n * n))
+            / (n * n)) / (n * n)) / n;
+}
+constexpr double log_factorial_entry(unsigned n) {
+    return n < 20 ? cx::log(static_cast<double>(factorial64_entry(n)))
+        : stirling(n, cx::log(n));
+}
+
+} // namespace factorial_detail
+
+/// The largest n with n! in uint64_t (20), unsigned __int128 (34) and
+/// double (170).
+constexpr unsigned max_factorial64 =
+    factorial_detail::largest_factorial(factorial_detail::max64);
+constexpr unsigned max_factorial128 =
+    factorial_detail::largest_factorial(factorial_detail::max128);
+constexpr unsigned max_factorial_double =
+    factorial_detail::largest_factorial(factorial_detail::max_double);
+/// The last row of Pascal's triangle in uint64_t (67).
+constexpr unsigned max_binomial64 =
+    factorial_detail::largest_binomial_row(factorial_detail::max64);
+/// log_factorial() is a lookup below this, else Stirling's formula.
+constexpr unsigned log_factorial_table_size = 1024;
+
+using Factorials64 = cx::Table<uint64_t, unsigned,
+    factorial_detail::factorial64_entry, max_factorial64 + 1>;
+using Factorials128 = cx::Table<unsigned __int128, unsigned,
+    factorial_detail::factorial128_entry, max_factorial128 + 1>;
+using FactorialsDouble = cx::Table<double, unsigned,
+    factorial_detail::factorial_double_entry, max_factorial_double + 1>;
+using Binomials64 = cx::Table<uint64_t, unsigned,
+    factorial_detail::binomial64_entry,
+    (max_binomial64 + 1) * (max_binomial64 + 2) / 2>;
+using LogFactorials = cx::Table<double, unsigned,
+    factorial_detail::log_factorial_entry, log_factorial_table_size>;
+
+/// n!, throwing std::out_of_range where it would overflow.
+constexpr uint64_t factorial64(unsigned n) {
+    return n <= max_factorial64 ? Factorials64::values[n]
+        : throw std::out_of_range("factorial64: n > 20");
+}
+constexpr unsigned __int128 factorial128(unsigned n) {
+    return n <= max_factorial128 ? Factorials128::values[n]
+        : throw std::out_of_range("factorial128: n > 34");
+}
+constexpr double factorial_double(unsigned n) {
+    return n <= max_factorial_double ? FactorialsDouble::values[n]
+        : throw std::out_of_range("factorial_double: n > 170");
+}
+
+/// C(n, k), 0 for k > n; throws std::out_of_range for n > 67.
+constexpr uint64_t binomial64(unsigned n, unsigned k) {
+    return k > n ? 0
+        : n <= max_binomial64 ? Binomials64::values[n * (n + 1) / 2 + k]
+        : throw std::out_of_range("binomial64: n > 67");
+}
+
+/// ln n!, for any n.
+inline double log_factorial(unsigned n)
+{
+    return n < log_factorial_table_size ? LogFactorials::values[n]
+        : factorial_detail::stirling(n, std::log(n));
+}
+
+/// ln C(n, k) for k <= n.
+inline double log_binomial(unsigned n, unsigned k)
+{
+    return log_factorial(n) - log_factorial(k) - log_factorial(n - k);
+}
+
 #endif // CPP11_FACTORIAL_H
 
 /* vim: set ts=4 sw=4 tw=76: */
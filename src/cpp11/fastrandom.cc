@@ -0,0 +1,337 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/fastrandom.cc xoshiro256** jumps, the scalar and AVX2
+ *       kernels of BatchRandom and its distributions.
+ */
+
+#include "cpp11/fastrandom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPP11_RANDOM_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+
+/// Raw values per chunk of the derived fills.
+const size_t chunk = 256;
+
+inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// The top 52 bits as the mantissa of a double in [1, 2), minus 1: exact
+// and the same in SIMD, which lacks a conversion from 64 bit integers.
+inline double unit(uint64_t bits)
+{
+    const uint64_t one = bits >> 12 | 0x3ff0000000000000ull;
+    double u;
+    std::memcpy(&u, &one, sizeof u);
+    return u - 1;
+}
+
+void generate_scalar(uint64_t (*s)[8], uint64_t *out, size_t blocks)
+{
+    for (size_t b=0; b<blocks; ++b, out+=BatchRandom::lanes) {
+        for (size_t l=0; l<BatchRandom::lanes; ++l) {
+            const uint64_t s1 = s[1][l];
+            out[l] = rotl(s1 * 5, 7) * 9;
+            s[2][l] ^= s[0][l];
+            s[3][l] ^= s1;
+            s[1][l] ^= s[2][l];
+            s[0][l] ^= s[3][l];
+            s[2][l] ^= s1 << 17;
+            s[3][l] = rotl(s[3][l], 45);
+        }
+    }
+}
+
+void uniform_scalar(double *out, const uint64_t *bits, size_t n,
+    double lo, double hi)
+{
+    const double scale = hi - lo;
+    for (size_t i=0; i<n; ++i) {
+        out[i] = lo + scale * unit(bits[i]);
+    }
+}
+
+const RandomKernels scalar_kernels = {
+    "scalar", generate_scalar, uniform_scalar
+};
+
+#ifdef CPP11_RANDOM_X86
+
+#define CPP11_AVX2 __attribute__((target("avx2")))
+
+// AVX2 has no 64 bit multiplication or rotation: x 5 is x + 4 x, x 9 is
+// x + 8 x.
+CPP11_AVX2 inline __m256i rotl(__m256i x, int k)
+{
+    return _mm256_or_si256(_mm256_slli_epi64(x, k),
+        _mm256_srli_epi64(x, 64 - k));
+}
+
+CPP11_AVX2 void generate_avx2(uint64_t (*s)[8], uint64_t *out,
+    size_t blocks)
+{
+    // Two vectors of four lanes each, interleaved to hide latencies.
+    __m256i s0[2], s1[2], s2[2], s3[2];
+    for (int h=0; h<2; ++h) {
+        s0[h] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(s[0] + 4 * h));
+        s1[h] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(s[1] + 4 * h));
+        s2[h] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(s[2] + 4 * h));
+        s3[h] = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(s[3] + 4 * h));
+    }
+    for (size_t b=0; b<blocks; ++b, out+=BatchRandom::lanes) {
+        for (int h=0; h<2; ++h) {
+            const __m256i x5 = _mm256_add_epi64(s1[h],
+                _mm256_slli_epi64(s1[h], 2));
+            const __m256i r = rotl(x5, 7);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * h),
+                _mm256_add_epi64(r, _mm256_slli_epi64(r, 3)));
+            const __m256i t = _mm256_slli_epi64(s1[h], 17);
+            s2[h] = _mm256_xor_si256(s2[h], s0[h]);
+            s3[h] = _mm256_xor_si256(s3[h], s1[h]);
+            s1[h] = _mm256_xor_si256(s1[h], s2[h]);
+            s0[h] = _mm256_xor_si256(s0[h], s3[h]);
+            s2[h] = _mm256_xor_si256(s2[h], t);
+            s3[h] = rotl(s3[h], 45);
+        }
+    }
+    for (int h=0; h<2; ++h) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(s[0] + 4 * h),
+            s0[h]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(s[1] + 4 * h),
+            s1[h]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(s[2] + 4 * h),
+            s2[h]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(s[3] + 4 * h),
+            s3[h]);
+    }
+}
+
+CPP11_AVX2 void uniform_avx2(double *out, const uint64_t *bits, size_t n,
+    double lo, double hi)
+{
+    const __m256i one = _mm256_set1_epi64x(0x3ff0000000000000ll);
+    const __m256d lo4 = _mm256_set1_pd(lo);
+    const __m256d scale4 = _mm256_set1_pd(hi - lo);
+    const __m256d one4 = _mm256_set1_pd(1);
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(bits + i));
+        const __m256d u = _mm256_sub_pd(_mm256_castsi256_pd(
+            _mm256_or_si256(_mm256_srli_epi64(b, 12), one)), one4);
+        _mm256_storeu_pd(out + i,
+            _mm256_add_pd(lo4, _mm256_mul_pd(scale4, u)));
+    }
+    uniform_scalar(out + i, bits + i, n - i, lo, hi);
+}
+
+const RandomKernels avx2_kernels = {
+    "avx2", generate_avx2, uniform_avx2
+};
+
+#endif // CPP11_RANDOM_X86
+
+/**
+ * The 256 layers of equal area of Marsaglia and Tsang's ziggurat under
+ * exp(-x^2 / 2): layer i is x[i] wide and reaches from f[i] up to
+ * f[i + 1]; layer 0 is the base strip including the tail beyond r.
+ */
+struct Ziggurat {
+    static constexpr double r = 3.6541528853610088;
+    static constexpr double area = 0.00492867323399;
+    double x[257];
+    double f[257];
+
+    Ziggurat() {
+        x[0] = area / std::exp(-r * r / 2);
+        x[1] = r;
+        for (int i=1; i<255; ++i) {
+            x[i + 1] = std::sqrt(-2 * std::log(area / x[i]
+                + std::exp(-x[i] * x[i] / 2)));
+        }
+        x[256] = 0;
+        for (int i=0; i<257; ++i) {
+            f[i] = std::exp(-x[i] * x[i] / 2);
+        }
+    }
+};
+
+const Ziggurat &ziggurat()
+{
+    static const Ziggurat table;
+    return table;
+}
+
+} // namespace
+
+void Xoshiro256StarStar::jump()
+{
+    static const uint64_t polynomial[] = { 0x180ec6d33cfd0abaull,
+        0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull,
+        0x39abdc4529b1661cull };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for (uint64_t word: polynomial) {
+        for (int b=0; b<64; ++b) {
+            if (word >> b & 1) {
+                for (int j=0; j<4; ++j) {
+                    s[j] ^= s_[j];
+                }
+            }
+            (*this)();
+        }
+    }
+    std::copy(s, s + 4, s_);
+}
+
+std::vector<const RandomKernels *> available_random_kernels()
+{
+    std::vector<const RandomKernels *> kernels { &scalar_kernels };
+#ifdef CPP11_RANDOM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&avx2_kernels);
+    }
+#endif
+    return kernels;
+}
+
+const RandomKernels &random_kernels()
+{
+    static const RandomKernels *best = available_random_kernels().back();
+    return *best;
+}
+
+BatchRandom::BatchRandom(uint64_t seed, const RandomKernels &kernels)
+    : kernels_(&kernels), cached_(lanes)
+{
+    Xoshiro256StarStar engine { seed };
+    for (size_t l=0; l<lanes; ++l) {
+        for (int j=0; j<4; ++j) {
+            state_[j][l] = engine.state()[j];
+        }
+        engine.jump();
+    }
+}
+
+void BatchRandom::fill(uint64_t *out, size_t n)
+{
+    const size_t cached = std::min(n, lanes - cached_);
+    std::copy(cache_ + cached_, cache_ + cached_ + cached, out);
+    cached_ += cached;
+    out += cached;
+    n -= cached;
+    kernels_->generate(state_, out, n / lanes);
+    out += n / lanes * lanes;
+    n %= lanes;
+    if (n) {
+        kernels_->generate(state_, cache_, 1);
+        std::copy(cache_, cache_ + n, out);
+        cached_ = n;
+    }
+}
+
+void BatchRandom::fill_uniform(int32_t *out, size_t n, int32_t lo,
+    int32_t hi)
+{
+    if (hi < lo) {
+        throw std::invalid_argument("BatchRandom: empty range");
+    }
+    // Lemire's method: the top half of x s is uniform in [0, s) unless
+    // the bottom half is below 2^64 mod s, which needs a division only
+    // if it is below s (probability s / 2^64).
+    const uint64_t s = static_cast<uint64_t>(int64_t{hi} - lo) + 1;
+    uint64_t bits[chunk];
+    while (n > 0) {
+        const size_t m = std::min(n, chunk);
+        fill(bits, m);
+        for (size_t i=0; i<m; ++i) {
+            uint128_t product = uint128_t{bits[i]} * s;
+            if (static_cast<uint64_t>(product) < s) {
+                const uint64_t threshold = (0 - s) % s;
+                while (static_cast<uint64_t>(product) < threshold) {
+                    product = uint128_t{(*this)()} * s;
+                }
+            }
+            out[i] = static_cast<int32_t>(lo
+                + static_cast<int64_t>(product >> 64));
+        }
+        out += m;
+        n -= m;
+    }
+}
+
+void BatchRandom::fill_uniform(double *out, size_t n, double lo,
+    double hi)
+{
+    uint64_t bits[chunk];
+    while (n > 0) {
+        const size_t m = std::min(n, chunk);
+        fill(bits, m);
+        kernels_->uniform(out, bits, m, lo, hi);
+        out += m;
+        n -= m;
+    }
+}
+
+void BatchRandom::fill_normal(double *out, size_t n, double mean,
+    double stddev)
+{
+    const Ziggurat &z = ziggurat();
+    uint64_t bits[chunk];
+    while (n > 0) {
+        const size_t m = std::min(n, chunk);
+        fill(bits, m);
+        for (size_t i=0; i<m; ++i) {
+            // Bits 0-7 pick the layer, bit 8 the sign, 12-63 the value.
+            uint64_t b = bits[i];
+            double x;
+            for (;;) {
+                const unsigned layer = b & 0xff;
+                x = unit(b) * z.x[layer];
+                if (x < z.x[layer + 1]) {
+                    break;
+                }
+                if (layer == 0) {
+                    // The tail beyond r, by Marsaglia's method.
+                    double a, c;
+                    do {
+                        a = -std::log(1 - unit((*this)())) / Ziggurat::r;
+                        c = -std::log(1 - unit((*this)()));
+                    } while (c + c < a * a);
+                    x = Ziggurat::r + a;
+                    break;
+                }
+                const double y = z.f[layer]
+                    + unit((*this)()) * (z.f[layer + 1] - z.f[layer]);
+                if (y < std::exp(-x * x / 2)) {
+                    break;
+                }
+                b = (*this)();
+            }
+            out[i] = mean + stddev * (b & 0x100 ? -x : x);
+        }
+        out += m;
+        n -= m;
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
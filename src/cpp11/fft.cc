@@ -0,0 +1,121 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/fft.cc Radix-2/4 in-place FFT with precomputed plans.
+ */
+
+#include "cpp11/fft.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+template<typename T>
+FftPlan<T>::FftPlan(size_t size, const ComplexKernels<T> &kernels)
+    : size_(size), kernels_(&kernels)
+{
+    if (size == 0 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("FftPlan: size "
+            + std::to_string(size) + " is no power of two");
+    }
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < size) {
+        ++bits;
+    }
+    for (size_t i=0; i<size; ++i) {
+        size_t reversed = 0;
+        for (unsigned b=0; b<bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        if (i < reversed) {
+            swaps_.push_back(std::make_pair(i, reversed));
+        }
+    }
+    // Each twiddle directly from cos and sin in long double rather
+    // than by recurrence, which would accumulate rounding errors.
+    const long double pi = 3.141592653589793238462643383279502884L;
+    w_re_.reserve(size);
+    w_im_.reserve(size);
+    for (size_t m=1; m<size; m*=2) {
+        for (size_t j=0; j<m; ++j) {
+            const long double angle = pi * j / m;
+            w_re_.push_back(static_cast<T>(std::cos(angle)));
+            w_im_.push_back(static_cast<T>(-std::sin(angle)));
+        }
+    }
+}
+
+template<typename T>
+void FftPlan<T>::check(const ComplexArray<T> &data) const
+{
+    if (data.size() != size_) {
+        throw std::invalid_argument("FftPlan: size "
+            + std::to_string(data.size()) + " instead of "
+            + std::to_string(size_));
+    }
+}
+
+template<typename T>
+void FftPlan<T>::forward(ComplexArray<T> &data) const
+{
+    check(data);
+    T *re = data.real(), *im = data.imag();
+    for (const std::pair<size_t, size_t> &s: swaps_) {
+        std::swap(re[s.first], re[s.second]);
+        std::swap(im[s.first], im[s.second]);
+    }
+
+    const size_t n = size_;
+    size_t m = 1;
+    if (n >= 4) {
+        // The first two stages have only the twiddles 1 and -i.
+        for (size_t k=0; k<n; k+=4) {
+            const T a0r = re[k] + re[k + 1], a0i = im[k] + im[k + 1];
+            const T a1r = re[k] - re[k + 1], a1i = im[k] - im[k + 1];
+            const T a2r = re[k + 2] + re[k + 3];
+            const T a2i = im[k + 2] + im[k + 3];
+            const T a3r = re[k + 2] - re[k + 3];
+            const T a3i = im[k + 2] - im[k + 3];
+            re[k] = a0r + a2r;
+            im[k] = a0i + a2i;
+            re[k + 2] = a0r - a2r;
+            im[k + 2] = a0i - a2i;
+            re[k + 1] = a1r + a3i;
+            im[k + 1] = a1i - a3r;
+            re[k + 3] = a1r - a3i;
+            im[k + 3] = a1i + a3r;
+        }
+        m = 4;
+    }
+    const T *w_re = w_re_.data(), *w_im = w_im_.data();
+    for (; 4 * m <= n; m *= 4) {
+        for (size_t k=0; k<n; k+=4*m) {
+            kernels_->butterfly4(re + k, im + k, w_re + m - 1,
+                w_im + m - 1, w_re + 2 * m - 1, w_im + 2 * m - 1, m);
+        }
+    }
+    if (2 * m <= n) {
+        for (size_t k=0; k<n; k+=2*m) {
+            kernels_->butterfly2(re + k, im + k, w_re + m - 1,
+                w_im + m - 1, m);
+        }
+    }
+}
+
+template<typename T>
+void FftPlan<T>::inverse(ComplexArray<T> &data) const
+{
+    // conj(forward(conj(x))) / n
+    check(data);
+    kernels_->conjugate(data.imag(), size_);
+    forward(data);
+    kernels_->conjugate(data.imag(), size_);
+    kernels_->scale(data.real(), data.imag(), T(1) / T(size_), size_);
+}
+
+template class FftPlan<float>;
+template class FftPlan<double>;
+
+/* vim: set ts=4 sw=4 tw=76: */
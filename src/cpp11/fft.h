@@ -0,0 +1,64 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/fft.h In-place fast Fourier transforms of ComplexArrays
+ *       with precomputed plans.
+ *
+ * An FftPlan is made once per size (a power of two) and computes the
+ * bit reversal and all twiddle factors e^(-2 pi i j / 2m) up front, so
+ * a transform is only table lookups, additions and multiplications.
+ * Stages are done two at a time (radix 4), which halves the passes over
+ * the data; for an odd number of stages the last one is radix 2. Each
+ * stage runs the butterfly kernels of complexarray.h over the twiddles
+ * of a block, contiguous in the split arrays.
+ *
+ * \code
+ * FftPlan<float> plan { 4096 };
+ * ComplexArray<float> signal(4096);
+ * // ... fill signal.real() ...
+ * plan.forward(signal);                    // spectrum
+ * plan.inverse(signal);                    // and back
+ * \endcode
+ */
+
+#ifndef CPP11_FFT_H
+#define CPP11_FFT_H 1
+
+#include "cpp11/complexarray.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class FftPlan {
+  public:
+    /// Throws std::invalid_argument unless \a size is a power of two.
+    explicit FftPlan(size_t size,
+        const ComplexKernels<T> &kernels=complex_kernels<T>());
+
+    size_t size() const { return size_; }
+
+    /// X[k] = sum of x[j] e^(-2 pi i j k / n) over j, in place; throws
+    /// std::invalid_argument if \a data is not of size().
+    void forward(ComplexArray<T> &data) const;
+    /// The inverse of forward(), including the factor 1/n.
+    void inverse(ComplexArray<T> &data) const;
+
+  private:
+    void check(const ComplexArray<T> &data) const;
+
+    size_t size_;
+    const ComplexKernels<T> *kernels_;
+    /// Pairs of indices to swap for the bit reversed order.
+    std::vector<std::pair<size_t, size_t>> swaps_;
+    /// The twiddles of the stage combining blocks of m start at m - 1.
+    std::vector<T> w_re_;
+    std::vector<T> w_im_;
+};
+
+#endif // CPP11_FFT_H
+
+/* vim: set ts=4 sw=4 tw=76: */
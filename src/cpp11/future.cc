@@ -0,0 +1,136 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/future.cc Futures with continuations, when_all() and
+ *       when_any(), run by executors such as a ThreadPool.
+ */
+
+#include "cpp11/future.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+Executor::~Executor()
+{ }
+
+void InlineExecutor::execute(std::function<void()> task)
+{
+    task();
+}
+
+InlineExecutor &InlineExecutor::instance()
+{
+    static InlineExecutor executor;
+    return executor;
+}
+
+void PoolExecutor::execute(std::function<void()> task)
+{
+    pool_.pool().submit(std::move(task));
+}
+
+PoolExecutor &PoolExecutor::shared()
+{
+    static PoolExecutor executor { ThreadPool::shared() };
+    return executor;
+}
+
+namespace future_detail {
+
+namespace {
+
+// The continuations queued while one runs in this thread.
+struct Trampoline {
+    bool running;
+    std::deque<std::function<void()>> queued;
+};
+thread_local Trampoline trampoline;
+
+} // namespace
+
+void StateBase::run(std::function<void()> callback)
+{
+    Trampoline &t = trampoline;
+    if (t.running) {
+        t.queued.push_back(std::move(callback));
+        return;
+    }
+    struct Running {
+        Trampoline &t;
+        explicit Running(Trampoline &t) : t(t) { t.running = true; }
+        ~Running() { t.running = false; }
+    } running { t };
+    callback();
+    run_deferred();
+}
+
+void run_deferred()
+{
+    Trampoline &t = trampoline;
+    while (!t.queued.empty()) {
+        std::function<void()> callback = std::move(t.queued.front());
+        t.queued.pop_front();
+        callback();
+    }
+}
+
+void StateBase::complete()
+{
+    int expected = start;
+    if (phase_.compare_exchange_strong(expected, has_result,
+            std::memory_order_acq_rel)) {
+        return;
+    }
+    // The callback came first (expected == has_callback). It may hold
+    // the last reference to this state, so this must not be touched
+    // after calling it.
+    phase_.store(done, std::memory_order_relaxed);
+    std::function<void()> callback = std::move(callback_);
+    callback_ = nullptr;
+    run(std::move(callback));
+}
+
+void StateBase::set_callback(std::function<void()> callback)
+{
+    callback_ = std::move(callback);
+    int expected = start;
+    if (phase_.compare_exchange_strong(expected, has_callback,
+            std::memory_order_acq_rel)) {
+        return;
+    }
+    // Completed before (expected == has_result): run it here.
+    phase_.store(done, std::memory_order_relaxed);
+    std::function<void()> now = std::move(callback_);
+    callback_ = nullptr;
+    run(std::move(now));
+}
+
+void StateBase::wait()
+{
+    run_deferred();
+    if (ready()) {
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool completed = false;
+    set_callback([&] {
+        // Notified under the lock: the waiter cannot return (and
+        // destroy cond) before it is released.
+        std::unique_lock<std::mutex> lock { mutex };
+        completed = true;
+        cond.notify_one();
+    });
+    // Completed meanwhile, inside a continuation: the callback above is
+    // queued in this thread, not run yet.
+    run_deferred();
+    std::unique_lock<std::mutex> lock { mutex };
+    cond.wait(lock, [&] { return completed; });
+}
+
+} // namespace future_detail
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,612 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/future.h Futures with continuations, when_all() and
+ *       when_any(), run by executors such as a ThreadPool.
+ *
+ * std::future only offers get(), so each dependent step needs a thread
+ * blocked in get() until the previous step is done. Here a step is
+ * attached to its input with then() instead: it is handed to an
+ * executor when the input completes and no thread waits for anything.
+ *
+ * \code
+ * PoolExecutor &pool = PoolExecutor::shared();
+ * Future<std::string> page = spawn(pool, [] { return fetch(url); });
+ * Future<size_t> words = page.then(pool, [](std::string text) {
+ *     return count_words(text);
+ * });
+ * std::cout << words.get() << std::endl;   // the only blocking call
+ * \endcode
+ *
+ * A continuation receives the value; if the input failed, it is skipped
+ * and the exception is passed on. A continuation returning a Future is
+ * unwrapped, so asynchronous steps chain like synchronous ones.
+ * Completing a future is a single compare-and-swap against attaching
+ * its continuation, without locks.
+ */
+
+#ifndef CPP11_FUTURE_H
+#define CPP11_FUTURE_H 1
+
+#include "cpp11/threadpool.h"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Runs tasks somewhere. An executor passed to then() must live until
+ * the continuation ran.
+ */
+class Executor {
+  public:
+    virtual ~Executor();
+    virtual void execute(std::function<void()> task) = 0;
+};
+
+/// Runs tasks in the calling thread: a continuation runs in the thread
+/// completing its input (or attaching it, if that completed before).
+class InlineExecutor : public Executor {
+  public:
+    void execute(std::function<void()> task) override;
+    static InlineExecutor &instance();
+};
+
+/// Runs tasks on a ThreadPool.
+class PoolExecutor : public Executor {
+  public:
+    explicit PoolExecutor(ThreadPool &pool) : pool_(pool) { }
+    void execute(std::function<void()> task) override;
+    ThreadPool &pool() { return pool_; }
+    /// Runs tasks on ThreadPool::shared().
+    static PoolExecutor &shared();
+
+  private:
+    ThreadPool &pool_;
+};
+
+template<typename T> class Future;
+template<typename T> class Promise;
+
+namespace future_detail {
+
+/// A value or an exception, set once.
+template<typename T>
+class Try {
+  public:
+    Try() : has_value_(false) { }
+    ~Try() {
+        if (has_value_) {
+            ref().~T();
+        }
+    }
+    Try(const Try &)=delete;
+    Try &operator=(const Try &)=delete;
+
+    template<typename... Args>
+    void set_value(Args &&...args) {
+        new (&storage_) T(std::forward<Args>(args)...);
+        has_value_ = true;
+    }
+    void set_error(std::exception_ptr error) { error_ = error; }
+    const std::exception_ptr &error() const { return error_; }
+
+    /// Moves the value out or throws the exception.
+    T get() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return std::move(ref());
+    }
+    /// Moves the value or exception to \a to.
+    void move_to(Try &to) {
+        if (error_) {
+            to.set_error(error_);
+        } else {
+            to.set_value(std::move(ref()));
+        }
+    }
+
+  private:
+    T &ref() { return *reinterpret_cast<T *>(&storage_); }
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    bool has_value_;
+    std::exception_ptr error_;
+};
+
+template<>
+class Try<void> {
+  public:
+    void set_value() { }
+    void set_error(std::exception_ptr error) { error_ = error; }
+    const std::exception_ptr &error() const { return error_; }
+    void get() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+    void move_to(Try &to) { to.set_error(error_); }
+
+  private:
+    std::exception_ptr error_;
+};
+
+/**
+ * Completion and continuation of a future; both happen once, in either
+ * order, and whichever comes second runs the continuation.
+ *
+ * A continuation completing further futures would run theirs nested in
+ * its own frame, so a chain of n steps completed at once (inline, or
+ * failing, or a broken promise) would take n frames. Continuations due
+ * while one runs are therefore queued per thread and run one after the
+ * other by the outermost one instead (a trampoline).
+ */
+class StateBase {
+  public:
+    StateBase() : phase_(start) { }
+    StateBase(const StateBase &)=delete;
+    StateBase &operator=(const StateBase &)=delete;
+
+    /// To be called once the result is set.
+    void complete();
+    /// Sets the continuation, at most once.
+    void set_callback(std::function<void()> callback);
+    /// Whether complete() was called (and no callback set).
+    bool ready() const {
+        return phase_.load(std::memory_order_acquire) == has_result;
+    }
+    /// Blocks until complete() was called.
+    void wait();
+
+  private:
+    enum Phase { start, has_result, has_callback, done };
+
+    /// Runs \a callback now, or queues it if a callback runs already.
+    static void run(std::function<void()> callback);
+
+    std::atomic<int> phase_;
+    std::function<void()> callback_;
+};
+
+/// Runs the continuations queued in this thread; waiting inside a
+/// continuation must do so before blocking, they may be waited for.
+void run_deferred();
+
+template<typename T>
+struct State : StateBase {
+    Try<T> result;
+
+    void fail(std::exception_ptr error) {
+        result.set_error(error);
+        complete();
+    }
+};
+
+template<typename T>
+using StatePtr = std::shared_ptr<State<T>>;
+
+/// Access to the state of a Future for the functions below.
+struct Access {
+    template<typename T>
+    static StatePtr<T> &state(Future<T> &future) {
+        return future.state_;
+    }
+    template<typename T>
+    static Future<T> make(StatePtr<T> state) {
+        return Future<T>(std::move(state));
+    }
+};
+
+// Calls f with the value of a Try (none for void).
+template<typename T>
+struct Invoke {
+    template<typename F>
+    using result = typename std::result_of<F(T)>::type;
+    template<typename F>
+    static result<F> call(F &f, Try<T> &input) {
+        return f(input.get());
+    }
+};
+
+template<>
+struct Invoke<void> {
+    template<typename F>
+    using result = typename std::result_of<F()>::type;
+    template<typename F>
+    static result<F> call(F &f, Try<void> &input) {
+        input.get();
+        return f();
+    }
+};
+
+// Sets the result of \a next from calling f: a value, nothing for void,
+// or the eventual result of a returned Future.
+template<typename R>
+struct Fulfil {
+    using type = R;
+    template<typename T, typename F>
+    static void run(const StatePtr<R> &next, F &f, Try<T> &input) {
+        next->result.set_value(Invoke<T>::call(f, input));
+        next->complete();
+    }
+};
+
+template<>
+struct Fulfil<void> {
+    using type = void;
+    template<typename T, typename F>
+    static void run(const StatePtr<void> &next, F &f, Try<T> &input) {
+        Invoke<T>::call(f, input);
+        next->result.set_value();
+        next->complete();
+    }
+};
+
+template<typename U>
+struct Fulfil<Future<U>> {
+    using type = U;
+    template<typename T, typename F>
+    static void run(const StatePtr<U> &next, F &f, Try<T> &input) {
+        Future<U> inner = Invoke<T>::call(f, input);
+        StatePtr<U> state = std::move(Access::state(inner));
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        state->set_callback([state, next] {
+            state->result.move_to(next->result);
+            next->complete();
+        });
+    }
+};
+
+template<typename T, typename F>
+using ThenValue = typename Fulfil<
+    typename Invoke<T>::template result<F>>::type;
+
+} // namespace future_detail
+
+/**
+ * The result of an asynchronous step, consumed once: by get() or by a
+ * continuation attached with then().
+ */
+template<typename T>
+class Future {
+  public:
+    /// An invalid future, without state.
+    Future() { }
+    Future(Future &&)=default;
+    Future &operator=(Future &&)=default;
+    Future(const Future &)=delete;
+    Future &operator=(const Future &)=delete;
+
+    bool valid() const { return bool(state_); }
+    /// Whether the result is there, get() will not block.
+    bool ready() const { return state_ && state_->ready(); }
+
+    /**
+     * Waits for the result and returns it, or rethrows the exception.
+     * Blocks the calling thread; inside a pool, prefer then() or
+     * get(ThreadPool&). Invalidates the future.
+     */
+    T get() {
+        future_detail::StatePtr<T> state = take();
+        state->wait();
+        return state->result.get();
+    }
+    /// As get(), but runs pending tasks of \a pool while waiting, so it
+    /// may be called by a task of \a pool.
+    T get(ThreadPool &pool) {
+        future_detail::StatePtr<T> state = take();
+        future_detail::run_deferred();
+        while (!state->ready()) {
+            if (!pool.pool().run_one()) {
+                std::this_thread::yield();
+            }
+            // Completions by those tasks may have been queued here.
+            future_detail::run_deferred();
+        }
+        return state->result.get();
+    }
+
+    /**
+     * Calls \a f with the value on \a executor once it is there, and
+     * returns a future for its result (which is unwrapped if \a f
+     * returns a Future). If this future fails or \a f throws, the
+     * returned one fails with that exception. \a f is copied into a
+     * std::function and so must be copyable. Invalidates the future.
+     */
+    template<typename F>
+    Future<future_detail::ThenValue<T, F>> then(Executor &executor, F f);
+    /// then() on the InlineExecutor.
+    template<typename F>
+    Future<future_detail::ThenValue<T, F>> then(F f) {
+        return then(InlineExecutor::instance(), std::move(f));
+    }
+
+  private:
+    friend struct future_detail::Access;
+    explicit Future(future_detail::StatePtr<T> state)
+        : state_(std::move(state)) { }
+
+    future_detail::StatePtr<T> take() {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return std::move(state_);
+    }
+
+    future_detail::StatePtr<T> state_;
+};
+
+/**
+ * Sets the result of a Future, from any thread. A promise destroyed
+ * without setting one fails its future with broken_promise.
+ */
+template<typename T>
+class Promise {
+  public:
+    Promise()
+        : state_(std::make_shared<future_detail::State<T>>()),
+          retrieved_(false), satisfied_(false) { }
+    ~Promise() {
+        if (state_ && !satisfied_) {
+            state_->fail(std::make_exception_ptr(std::future_error(
+                std::future_errc::broken_promise)));
+        }
+    }
+    Promise(Promise &&other)
+        : state_(std::move(other.state_)), retrieved_(other.retrieved_),
+          satisfied_(other.satisfied_) { }
+    Promise(const Promise &)=delete;
+    Promise &operator=(const Promise &)=delete;
+
+    /// The future, only once.
+    Future<T> get_future() {
+        if (retrieved_) {
+            throw std::future_error(
+                std::future_errc::future_already_retrieved);
+        }
+        retrieved_ = true;
+        return future_detail::Access::make(state_);
+    }
+    /// Sets the value (none for Promise<void>); runs the continuation
+    /// if there is one.
+    template<typename... Args>
+    void set_value(Args &&...args) {
+        satisfy();
+        state_->result.set_value(std::forward<Args>(args)...);
+        state_->complete();
+    }
+    void set_exception(std::exception_ptr error) {
+        satisfy();
+        state_->fail(error);
+    }
+
+  private:
+    void satisfy() {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        if (satisfied_) {
+            throw std::future_error(
+                std::future_errc::promise_already_satisfied);
+        }
+        satisfied_ = true;
+    }
+
+    future_detail::StatePtr<T> state_;
+    bool retrieved_;
+    bool satisfied_;
+};
+
+template<typename T>
+template<typename F>
+Future<future_detail::ThenValue<T, F>> Future<T>::then(
+    Executor &executor, F f)
+{
+    using namespace future_detail;
+    using R = typename Invoke<T>::template result<F>;
+    StatePtr<T> state = take();
+    StatePtr<ThenValue<T, F>> next =
+        std::make_shared<State<ThenValue<T, F>>>();
+    Executor *run = &executor;
+    state->set_callback([state, next, run, f] {
+        // Failures are passed on without a trip through the executor
+        // (and without recursion, see StateBase).
+        if (state->result.error()) {
+            next->fail(state->result.error());
+            return;
+        }
+        try {
+            run->execute([state, next, f]() mutable {
+                try {
+                    Fulfil<R>::run(next, f, state->result);
+                } catch (...) {
+                    next->fail(std::current_exception());
+                }
+            });
+        } catch (...) {
+            // The executor refused (a pool shut down): the error goes
+            // to next instead of to whoever completed the input.
+            next->fail(std::current_exception());
+        }
+    });
+    return Access::make(next);
+}
+
+/// Runs \a f on \a executor; the future holds its result.
+template<typename F>
+Future<future_detail::ThenValue<void, F>> spawn(Executor &executor, F f)
+{
+    Promise<void> start;
+    Future<void> started = start.get_future();
+    start.set_value();
+    return started.then(executor, std::move(f));
+}
+
+/// A future already holding \a value.
+template<typename T>
+Future<typename std::decay<T>::type> make_ready_future(T &&value)
+{
+    Promise<typename std::decay<T>::type> promise;
+    promise.set_value(std::forward<T>(value));
+    return promise.get_future();
+}
+
+namespace future_detail {
+
+// Result of when_all(): the values in order, nothing for void.
+template<typename T>
+struct All {
+    using type = std::vector<T>;
+    static void set(State<type> &all, std::vector<StatePtr<T>> &inputs) {
+        type values;
+        values.reserve(inputs.size());
+        for (StatePtr<T> &input: inputs) {
+            values.push_back(input->result.get());
+        }
+        all.result.set_value(std::move(values));
+    }
+};
+
+template<>
+struct All<void> {
+    using type = void;
+    static void set(State<void> &all, std::vector<StatePtr<void>> &) {
+        all.result.set_value();
+    }
+};
+
+// Result of when_any(): the index and value, the index for void.
+template<typename T>
+struct Any {
+    using type = std::pair<size_t, T>;
+    static void set(State<type> &any, size_t index, State<T> &input) {
+        any.result.set_value(index, input.result.get());
+    }
+};
+
+template<>
+struct Any<void> {
+    using type = size_t;
+    static void set(State<size_t> &any, size_t index, State<void> &) {
+        any.result.set_value(index);
+    }
+};
+
+} // namespace future_detail
+
+/**
+ * A future for all of \a futures: their values in order (nothing for
+ * void), or the first exception, as soon as one fails.
+ */
+template<typename T>
+Future<typename future_detail::All<T>::type> when_all(
+    std::vector<Future<T>> futures)
+{
+    using namespace future_detail;
+    using Result = typename All<T>::type;
+    struct Shared {
+        std::vector<StatePtr<T>> inputs;
+        StatePtr<Result> all;
+        std::atomic<size_t> left;
+        std::atomic<bool> failed;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->all = std::make_shared<State<Result>>();
+    shared->left = futures.size();
+    shared->failed = false;
+    for (Future<T> &future: futures) {
+        if (!Access::state(future)) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        shared->inputs.push_back(std::move(Access::state(future)));
+    }
+    Future<Result> result = Access::make(shared->all);
+    if (shared->inputs.empty()) {
+        All<T>::set(*shared->all, shared->inputs);
+        shared->all->complete();
+        return result;
+    }
+    for (size_t n=0; n<shared->inputs.size(); ++n) {
+        State<T> *input = shared->inputs[n].get();
+        input->set_callback([shared, input] {
+            // The first failure completes at once; the last input to
+            // complete sees it and does nothing then.
+            if (input->result.error()
+                    && !shared->failed.exchange(true)) {
+                shared->all->fail(input->result.error());
+            }
+            if (shared->left.fetch_sub(1) == 1 && !shared->failed) {
+                All<T>::set(*shared->all, shared->inputs);
+                shared->all->complete();
+            }
+        });
+    }
+    return result;
+}
+
+/**
+ * A future for the first of \a futures to succeed: its index and value
+ * (the index for void). Fails with the last exception if all fail,
+ * and with std::invalid_argument if there are none.
+ */
+template<typename T>
+Future<typename future_detail::Any<T>::type> when_any(
+    std::vector<Future<T>> futures)
+{
+    using namespace future_detail;
+    using Result = typename Any<T>::type;
+    struct Shared {
+        StatePtr<Result> any;
+        size_t count;
+        std::atomic<size_t> failures;
+        std::atomic<bool> done;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->any = std::make_shared<State<Result>>();
+    shared->count = futures.size();
+    shared->failures = 0;
+    shared->done = false;
+    Future<Result> result = Access::make(shared->any);
+    if (futures.empty()) {
+        shared->any->fail(std::make_exception_ptr(
+            std::invalid_argument("when_any: no futures")));
+        return result;
+    }
+    std::vector<StatePtr<T>> inputs;
+    for (Future<T> &future: futures) {
+        if (!Access::state(future)) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        inputs.push_back(std::move(Access::state(future)));
+    }
+    for (size_t n=0; n<inputs.size(); ++n) {
+        StatePtr<T> input = inputs[n];
+        input->set_callback([shared, input, n] {
+            if (!input->result.error()) {
+                if (!shared->done.exchange(true)) {
+                    Any<T>::set(*shared->any, n, *input);
+                    shared->any->complete();
+                }
+            } else if (shared->failures.fetch_add(1) + 1 == shared->count
+                    && !shared->done.exchange(true)) {
+                shared->any->fail(input->result.error());
+            }
+        });
+    }
+    return result;
+}
+
+#endif // CPP11_FUTURE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,212 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/histogram.cc Log-bucketed histograms for latencies and sizes.
+ */
+
+#include "cpp11/histogram.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+constexpr unsigned Histogram::sub_bits;
+constexpr unsigned Histogram::sub_count;
+constexpr size_t Histogram::bucket_count;
+
+uint64_t Histogram::bucket_lower(size_t i)
+{
+    if (i < sub_count) {
+        return i;
+    }
+    const unsigned shift = i / sub_count - 1;
+    return static_cast<uint64_t>(sub_count + i % sub_count) << shift;
+}
+
+uint64_t Histogram::bucket_upper(size_t i)
+{
+    if (i < sub_count) {
+        return i;
+    }
+    const unsigned shift = i / sub_count - 1;
+    return bucket_lower(i) + ((uint64_t{1} << shift) - 1);
+}
+
+Histogram::Histogram()
+    : counts_(bucket_count), count_(0), sum_(0),
+      min_(std::numeric_limits<uint64_t>::max()), max_(0)
+{ }
+
+void Histogram::merge(const Histogram &other)
+{
+    for (size_t i=0; i<bucket_count; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void Histogram::clear()
+{
+    *this = Histogram();
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+    if (count_ == 0) {
+        return 0;
+    }
+    // Rank of the wanted value, 1-based: ceil(q*count), at least 1.
+    const double wanted = q * count_;
+    uint64_t rank = static_cast<uint64_t>(wanted);
+    if (rank < wanted || rank == 0) {
+        ++rank;
+    }
+    uint64_t seen = 0;
+    for (size_t i=0; i<bucket_count; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::max(min(), std::min(bucket_upper(i), max_));
+        }
+    }
+    return max_;
+}
+
+std::string Histogram::to_text(const std::string &unit) const
+{
+    std::ostringstream out;
+    out << "count=" << count()
+        << " min=" << min() << unit
+        << " mean=" << static_cast<uint64_t>(mean() + 0.5) << unit
+        << " p50=" << quantile(0.5) << unit
+        << " p90=" << quantile(0.9) << unit
+        << " p99=" << quantile(0.99) << unit
+        << " p999=" << quantile(0.999) << unit
+        << " max=" << max() << unit;
+    return out.str();
+}
+
+std::string Histogram::to_json() const
+{
+    std::ostringstream out;
+    out << "{\"count\":" << count()
+        << ",\"sum\":" << sum()
+        << ",\"min\":" << min()
+        << ",\"mean\":" << mean()
+        << ",\"p50\":" << quantile(0.5)
+        << ",\"p90\":" << quantile(0.9)
+        << ",\"p99\":" << quantile(0.99)
+        << ",\"p999\":" << quantile(0.999)
+        << ",\"max\":" << max()
+        << ",\"buckets\":[";
+    const char *separator = "";
+    for (size_t i=0; i<bucket_count; ++i) {
+        if (counts_[i]) {
+            out << separator << '[' << bucket_lower(i) << ','
+                << bucket_upper(i) << ',' << counts_[i] << ']';
+            separator = ",";
+        }
+    }
+    out << "]}";
+    return out.str();
+}
+
+// One thread's part of a PerThreadHistogram. Only the owning thread
+// writes, so an increment is a relaxed load and store, no atomic RMW.
+struct PerThreadHistogram::Shard {
+    std::atomic<uint64_t> counts_[Histogram::bucket_count];
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+
+    Shard() : sum_{0}, min_{std::numeric_limits<uint64_t>::max()}, max_{0} {
+        for (auto &c: counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void bump(std::atomic<uint64_t> &a, uint64_t add) {
+        a.store(a.load(std::memory_order_relaxed) + add,
+                std::memory_order_relaxed);
+    }
+
+    void record(uint64_t value) {
+        bump(counts_[Histogram::bucket_of(value)], 1);
+        bump(sum_, value);
+        if (value < min_.load(std::memory_order_relaxed)) {
+            min_.store(value, std::memory_order_relaxed);
+        }
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+};
+
+PerThreadHistogram::PerThreadHistogram()
+{ }
+
+PerThreadHistogram::~PerThreadHistogram()
+{ }
+
+void PerThreadHistogram::record(uint64_t value)
+{
+    local().record(value);
+}
+
+PerThreadHistogram::Shard &PerThreadHistogram::local()
+{
+    if (void *shard = slot_.get()) {
+        return *static_cast<Shard*>(shard);
+    }
+    return add_shard();
+}
+
+PerThreadHistogram::Shard &PerThreadHistogram::add_shard()
+{
+    Shard *shard = new Shard;
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        shards_.emplace_back(shard);
+    }
+    slot_.set(shard);
+    return *shard;
+}
+
+size_t PerThreadHistogram::shard_count() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return shards_.size();
+}
+
+Histogram PerThreadHistogram::snapshot() const
+{
+    Histogram result;
+    std::unique_lock<std::mutex> lock { mutex_ };
+    for (auto &shard: shards_) {
+        uint64_t count = 0;
+        for (size_t i=0; i<Histogram::bucket_count; ++i) {
+            const uint64_t c =
+                shard->counts_[i].load(std::memory_order_relaxed);
+            result.counts_[i] += c;
+            count += c;
+        }
+        if (count == 0) {
+            continue;
+        }
+        // Writers keep going, so the summary may be slightly ahead of the
+        // buckets; fine for statistics.
+        result.count_ += count;
+        result.sum_ += shard->sum_.load(std::memory_order_relaxed);
+        result.min_ = std::min(result.min_,
+            shard->min_.load(std::memory_order_relaxed));
+        result.max_ = std::max(result.max_,
+            shard->max_.load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,141 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/histogram.h Log-bucketed histograms for latencies and sizes.
+ *
+ * Values 0..15 get a bucket each, above that every power of two is split
+ * into 16 linear sub-buckets, so any uint64_t fits into 976 buckets with
+ * a relative error below 1/16. Histograms with the same layout can be
+ * merged by adding bucket counts, which makes it cheap to record per
+ * thread and to combine on demand.
+ *
+ * \code
+ * PerThreadHistogram latency;   // shared by all threads
+ * latency.record(ns);           // no lock, no shared cache line
+ * Histogram h = latency.snapshot();
+ * std::cout << h.quantile(0.99) << std::endl << h.to_json() << std::endl;
+ * \endcode
+ */
+
+#ifndef CPP11_HISTOGRAM_H
+#define CPP11_HISTOGRAM_H 1
+
+#include "cpp11/threadslot.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * A plain (not synchronized) log-bucketed histogram of uint64_t values.
+ */
+class Histogram {
+  public:
+    // Sub-buckets per power of two, as bits.
+    static constexpr unsigned sub_bits = 4;
+    static constexpr unsigned sub_count = 1u << sub_bits;
+    static constexpr size_t bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    /// Index of the bucket counting \a value.
+    static size_t bucket_of(uint64_t value) {
+        if (value < sub_count) {
+            return static_cast<size_t>(value);
+        }
+        const unsigned msb = 63 - __builtin_clzll(value);
+        const unsigned shift = msb - sub_bits;
+        return (shift + 1) * sub_count
+            + static_cast<size_t>((value >> shift) & (sub_count - 1));
+    }
+    /// Smallest value counted by bucket \a i.
+    static uint64_t bucket_lower(size_t i);
+    /// Largest value counted by bucket \a i.
+    static uint64_t bucket_upper(size_t i);
+
+    Histogram();
+
+    void record(uint64_t value, uint64_t count=1) {
+        counts_[bucket_of(value)] += count;
+        count_ += count;
+        sum_ += value * count;
+        if (value < min_) min_ = value;
+        if (value > max_) max_ = value;
+    }
+
+    /// Adds all values recorded by \a other.
+    void merge(const Histogram &other);
+    void clear();
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    /// Smallest recorded value, 0 if empty.
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const {
+        return count_ ? static_cast<double>(sum_) / count_ : 0.0;
+    }
+    uint64_t bucket(size_t i) const { return counts_[i]; }
+
+    /**
+     * Estimated \a q quantile (0..1, e.g. 0.999 for p999): the upper end
+     * of the bucket holding the value of that rank, clamped to max().
+     * Returns 0 for an empty histogram.
+     */
+    uint64_t quantile(double q) const;
+
+    /// One line "count=.. min=.. mean=.. p50=.. p99=.. p999=.. max=..",
+    /// values followed by \a unit.
+    std::string to_text(const std::string &unit="") const;
+    /// A JSON object with the summary values and the non-empty buckets
+    /// as [lower, upper, count] triples.
+    std::string to_json() const;
+
+  private:
+    friend class PerThreadHistogram;
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+/**
+ * A histogram that any number of threads may record into concurrently.
+ * Each recording thread gets its own shard, written only by that thread
+ * (plain relaxed loads and stores, no read-modify-write), and
+ * snapshot() merges the shards. Shards outlive their threads, so nothing
+ * recorded gets lost.
+ */
+class PerThreadHistogram {
+  public:
+    PerThreadHistogram();
+    ~PerThreadHistogram();
+    PerThreadHistogram(const PerThreadHistogram &)=delete;
+    PerThreadHistogram &operator=(const PerThreadHistogram &)=delete;
+
+    void record(uint64_t value);
+
+    /// Merges all shards; may run concurrently with record().
+    Histogram snapshot() const;
+    /// Number of shards: one per thread that recorded.
+    size_t shard_count() const;
+
+  private:
+    struct Shard;
+    Shard &local();
+    Shard &add_shard();
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // The shard of each thread; goes before the shards.
+    ThreadSlot slot_;
+};
+
+#endif // CPP11_HISTOGRAM_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,455 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/image.cc Images of Colors, interleaved and planar, with
+ *       pixel kernels using SSE2 or AVX2 where the CPU has them.
+ */
+
+#include "cpp11/image.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// The SIMD kernels are compiled with target attributes rather than
+// -mavx2 for the whole file, so the rest runs on any x86 CPU.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPP11_IMAGE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// x / 255 rounded, for x <= 255 * 255; the SIMD kernels compute the
+// same in 16 bit lanes.
+inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+void fill_scalar(uint32_t *dst, size_t n, uint32_t argb)
+{
+    std::fill(dst, dst + n, argb);
+}
+
+void blend_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        const uint32_t s = src[i];
+        const uint32_t d = dst[i];
+        const uint32_t inverse = 255 - (s >> 24);
+        uint32_t out = 0;
+        for (unsigned shift=0; shift<32; shift+=8) {
+            const uint32_t c = ((s >> shift) & 0xff)
+                + div255(((d >> shift) & 0xff) * inverse);
+            out |= std::min<uint32_t>(c, 255) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+void premultiply_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        const uint32_t p = src[i];
+        const uint32_t alpha = p >> 24;
+        uint32_t out = p & 0xff000000u;
+        for (unsigned shift=0; shift<24; shift+=8) {
+            out |= div255(((p >> shift) & 0xff) * alpha) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+void argb_to_rgba_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        dst[i] = src[i] << 8 | src[i] >> 24;
+    }
+}
+
+void rgba_to_argb_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        dst[i] = src[i] >> 8 | src[i] << 24;
+    }
+}
+
+void swap_bytes_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        const uint32_t p = src[i] << 16 | src[i] >> 16;
+        dst[i] = (p & 0x00ff00ffu) << 8 | ((p >> 8) & 0x00ff00ffu);
+    }
+}
+
+const PixelKernels scalar_kernels = {
+    "scalar", fill_scalar, blend_scalar, premultiply_scalar,
+    argb_to_rgba_scalar, rgba_to_argb_scalar, swap_bytes_scalar
+};
+
+#ifdef CPP11_IMAGE_X86
+
+// Each kernel widens four pixels to 16 bit lanes (b, g, r, a per pixel),
+// computes, and narrows again; the alpha of each pixel is broadcast to
+// its four lanes with a shuffle.
+#define CPP11_SSE2 __attribute__((target("sse2")))
+
+CPP11_SSE2 void fill_sse2(uint32_t *dst, size_t n, uint32_t argb)
+{
+    const __m128i value = _mm_set1_epi32(static_cast<int>(argb));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), value);
+    }
+    fill_scalar(dst + i, n - i, argb);
+}
+
+CPP11_SSE2 inline __m128i div255_sse2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+CPP11_SSE2 inline __m128i alpha_sse2(__m128i wide)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(wide, 0xff), 0xff);
+}
+
+CPP11_SSE2 void blend_sse2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + i));
+        const __m128i d = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i lo = div255_sse2(_mm_mullo_epi16(
+            _mm_unpacklo_epi8(d, zero),
+            _mm_sub_epi16(full, alpha_sse2(_mm_unpacklo_epi8(s, zero)))));
+        const __m128i hi = div255_sse2(_mm_mullo_epi16(
+            _mm_unpackhi_epi8(d, zero),
+            _mm_sub_epi16(full, alpha_sse2(_mm_unpackhi_epi8(s, zero)))));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+            _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    blend_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_SSE2 void premultiply_sse2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // The alpha lanes keep their value.
+    const __m128i alpha = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + i));
+        const __m128i plo = _mm_unpacklo_epi8(p, zero);
+        const __m128i phi = _mm_unpackhi_epi8(p, zero);
+        const __m128i lo = div255_sse2(
+            _mm_mullo_epi16(plo, alpha_sse2(plo)));
+        const __m128i hi = div255_sse2(
+            _mm_mullo_epi16(phi, alpha_sse2(phi)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+            _mm_packus_epi16(
+                _mm_or_si128(_mm_andnot_si128(alpha, lo),
+                    _mm_and_si128(alpha, plo)),
+                _mm_or_si128(_mm_andnot_si128(alpha, hi),
+                    _mm_and_si128(alpha, phi))));
+    }
+    premultiply_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_SSE2 void argb_to_rgba_sse2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+            _mm_or_si128(_mm_slli_epi32(p, 8), _mm_srli_epi32(p, 24)));
+    }
+    argb_to_rgba_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_SSE2 void rgba_to_argb_sse2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+            _mm_or_si128(_mm_srli_epi32(p, 8), _mm_slli_epi32(p, 24)));
+    }
+    rgba_to_argb_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_SSE2 void swap_bytes_sse2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i p = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + i));
+        // Swap the halves, then the bytes of each half (no pshufb in
+        // SSE2).
+        p = _mm_or_si128(_mm_slli_epi32(p, 16), _mm_srli_epi32(p, 16));
+        p = _mm_or_si128(_mm_slli_epi16(p, 8), _mm_srli_epi16(p, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p);
+    }
+    swap_bytes_scalar(dst + i, src + i, n - i);
+}
+
+const PixelKernels sse2_kernels = {
+    "sse2", fill_sse2, blend_sse2, premultiply_sse2,
+    argb_to_rgba_sse2, rgba_to_argb_sse2, swap_bytes_sse2
+};
+
+// The same with eight pixels; unpack and shuffle work within each 128
+// bit half, which is fine as pixels never cross halves.
+#define CPP11_AVX2 __attribute__((target("avx2")))
+
+CPP11_AVX2 void fill_avx2(uint32_t *dst, size_t n, uint32_t argb)
+{
+    const __m256i value = _mm256_set1_epi32(static_cast<int>(argb));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), value);
+    }
+    fill_scalar(dst + i, n - i, argb);
+}
+
+CPP11_AVX2 inline __m256i div255_avx2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(
+        _mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+CPP11_AVX2 inline __m256i alpha_avx2(__m256i wide)
+{
+    return _mm256_shufflehi_epi16(
+        _mm256_shufflelo_epi16(wide, 0xff), 0xff);
+}
+
+CPP11_AVX2 void blend_avx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i s = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + i));
+        const __m256i d = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(dst + i));
+        const __m256i lo = div255_avx2(_mm256_mullo_epi16(
+            _mm256_unpacklo_epi8(d, zero),
+            _mm256_sub_epi16(full,
+                alpha_avx2(_mm256_unpacklo_epi8(s, zero)))));
+        const __m256i hi = div255_avx2(_mm256_mullo_epi16(
+            _mm256_unpackhi_epi8(d, zero),
+            _mm256_sub_epi16(full,
+                alpha_avx2(_mm256_unpackhi_epi8(s, zero)))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+    }
+    blend_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_AVX2 void premultiply_avx2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0,
+        -1, 0, 0, 0, -1, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i p = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + i));
+        const __m256i plo = _mm256_unpacklo_epi8(p, zero);
+        const __m256i phi = _mm256_unpackhi_epi8(p, zero);
+        const __m256i lo = div255_avx2(
+            _mm256_mullo_epi16(plo, alpha_avx2(plo)));
+        const __m256i hi = div255_avx2(
+            _mm256_mullo_epi16(phi, alpha_avx2(phi)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_packus_epi16(
+                _mm256_blendv_epi8(lo, plo, alpha),
+                _mm256_blendv_epi8(hi, phi, alpha)));
+    }
+    premultiply_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_AVX2 void argb_to_rgba_avx2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i p = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_or_si256(_mm256_slli_epi32(p, 8),
+                _mm256_srli_epi32(p, 24)));
+    }
+    argb_to_rgba_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_AVX2 void rgba_to_argb_avx2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i p = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_or_si256(_mm256_srli_epi32(p, 8),
+                _mm256_slli_epi32(p, 24)));
+    }
+    rgba_to_argb_scalar(dst + i, src + i, n - i);
+}
+
+CPP11_AVX2 void swap_bytes_avx2(uint32_t *dst, const uint32_t *src,
+    size_t n)
+{
+    // AVX2 has a byte shuffle, per 128 bit half.
+    const __m256i order = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i p = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_shuffle_epi8(p, order));
+    }
+    swap_bytes_scalar(dst + i, src + i, n - i);
+}
+
+const PixelKernels avx2_kernels = {
+    "avx2", fill_avx2, blend_avx2, premultiply_avx2,
+    argb_to_rgba_avx2, rgba_to_argb_avx2, swap_bytes_avx2
+};
+
+#endif // CPP11_IMAGE_X86
+
+} // namespace
+
+std::vector<const PixelKernels *> available_pixel_kernels()
+{
+    std::vector<const PixelKernels *> kernels { &scalar_kernels };
+#ifdef CPP11_IMAGE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back(&sse2_kernels);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&avx2_kernels);
+    }
+#endif
+    return kernels;
+}
+
+const PixelKernels &pixel_kernels()
+{
+    static const PixelKernels *best = available_pixel_kernels().back();
+    return *best;
+}
+
+Image::Image(size_t width, size_t height, const PixelKernels &kernels)
+    : width_(width), height_(height), kernels_(&kernels),
+      pixels_(width * height)
+{ }
+
+void Image::fill(Color color)
+{
+    kernels_->fill(pixels(), size(), color.argb());
+}
+
+void Image::blend(const Image &over)
+{
+    if (over.width_ != width_ || over.height_ != height_) {
+        throw std::invalid_argument("Image::blend: size differs");
+    }
+    kernels_->blend(pixels(), over.pixels(), size());
+}
+
+void Image::premultiply()
+{
+    kernels_->premultiply(pixels(), pixels(), size());
+}
+
+void Image::convert_to(PixelFormat format, uint32_t *out) const
+{
+    switch (format) {
+      case PixelFormat::argb:
+        std::copy(pixels_.begin(), pixels_.end(), out);
+        break;
+      case PixelFormat::rgba:
+        kernels_->argb_to_rgba(out, pixels(), size());
+        break;
+      case PixelFormat::bgra:
+        kernels_->swap_bytes(out, pixels(), size());
+        break;
+    }
+}
+
+void Image::convert_from(PixelFormat format, const uint32_t *in)
+{
+    switch (format) {
+      case PixelFormat::argb:
+        std::copy(in, in + size(), pixels_.begin());
+        break;
+      case PixelFormat::rgba:
+        kernels_->rgba_to_argb(pixels(), in, size());
+        break;
+      case PixelFormat::bgra:
+        kernels_->swap_bytes(pixels(), in, size());
+        break;
+    }
+}
+
+PlanarImage::PlanarImage(size_t width, size_t height)
+    : width_(width), height_(height), planes_(4 * width * height)
+{ }
+
+PlanarImage::PlanarImage(const Image &image)
+    : PlanarImage(image.width(), image.height())
+{
+    // Plain loops: the compiler vectorizes these well enough, and the
+    // planes are written sequentially.
+    const uint32_t *in = image.pixels();
+    const size_t n = size();
+    uint8_t *pa = plane(a), *pr = plane(r), *pg = plane(g), *pb = plane(b);
+    for (size_t i=0; i<n; ++i) {
+        const uint32_t p = in[i];
+        pa[i] = static_cast<uint8_t>(p >> 24);
+        pr[i] = static_cast<uint8_t>(p >> 16);
+        pg[i] = static_cast<uint8_t>(p >> 8);
+        pb[i] = static_cast<uint8_t>(p);
+    }
+}
+
+void PlanarImage::merge_into(Image &image) const
+{
+    if (image.width() != width_ || image.height() != height_) {
+        throw std::invalid_argument("PlanarImage::merge_into: size");
+    }
+    uint32_t *out = image.pixels();
+    const size_t n = size();
+    const uint8_t *pa = plane(a), *pr = plane(r), *pg = plane(g),
+        *pb = plane(b);
+    for (size_t i=0; i<n; ++i) {
+        out[i] = uint32_t{pa[i]} << 24 | uint32_t{pr[i]} << 16
+            | uint32_t{pg[i]} << 8 | pb[i];
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,141 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/image.h Images of Colors, interleaved and planar, with
+ *       pixel kernels using SSE2 or AVX2 where the CPU has them.
+ *
+ * An Image stores a pixel as one uint32_t 0xAARRGGBB, so whole rows are
+ * processed four (SSE2) or eight (AVX2) pixels per instruction. Which
+ * kernels run is decided once at run time by what the CPU supports;
+ * the scalar kernels compute exactly the same results and are used
+ * elsewhere and for the tails of rows.
+ *
+ * Alpha is opacity, 0xff being opaque. blend() expects premultiplied
+ * colors (each channel already multiplied by alpha), which makes
+ * "source over destination" one multiply-add per channel:
+ *
+ * \code
+ * Image frame { 1920, 1080 }, overlay { 1920, 1080 };
+ * frame.fill("#ff203040"_col);
+ * overlay.premultiply();
+ * frame.blend(overlay);
+ * std::vector<uint32_t> rgba(frame.size());
+ * frame.convert_to(PixelFormat::rgba, rgba.data());
+ * \endcode
+ */
+
+#ifndef CPP11_IMAGE_H
+#define CPP11_IMAGE_H 1
+
+#include "cpp11/literals.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Order of the channels in a 32 bit pixel value, most significant
+/// byte first.
+enum class PixelFormat { argb, rgba, bgra };
+
+/**
+ * A set of pixel kernels on runs of 0xAARRGGBB pixels. \a dst and
+ * \a src may be the same (but not otherwise overlap).
+ */
+struct PixelKernels {
+    const char *name;
+    void (*fill)(uint32_t *dst, size_t n, uint32_t argb);
+    /// dst = src + dst * (1 - src alpha), all premultiplied.
+    void (*blend)(uint32_t *dst, const uint32_t *src, size_t n);
+    /// Multiplies the color channels by alpha.
+    void (*premultiply)(uint32_t *dst, const uint32_t *src, size_t n);
+    /// ARGB to RGBA (rotate left by a byte).
+    void (*argb_to_rgba)(uint32_t *dst, const uint32_t *src, size_t n);
+    /// RGBA to ARGB (rotate right by a byte).
+    void (*rgba_to_argb)(uint32_t *dst, const uint32_t *src, size_t n);
+    /// ARGB to BGRA and back (byte swap).
+    void (*swap_bytes)(uint32_t *dst, const uint32_t *src, size_t n);
+};
+
+/// The fastest kernels the CPU supports, chosen on first use.
+const PixelKernels &pixel_kernels();
+/// All kernels the CPU supports, scalar first, fastest last.
+std::vector<const PixelKernels *> available_pixel_kernels();
+
+/**
+ * Interleaved pixels, row by row without padding. Uses pixel_kernels()
+ * unless given other kernels.
+ */
+class Image {
+  public:
+    Image(size_t width, size_t height,
+        const PixelKernels &kernels=pixel_kernels());
+
+    size_t width() const { return width_; }
+    size_t height() const { return height_; }
+    /// Number of pixels.
+    size_t size() const { return pixels_.size(); }
+    uint32_t *pixels() { return pixels_.data(); }
+    const uint32_t *pixels() const { return pixels_.data(); }
+    uint32_t *row(size_t y) { return pixels_.data() + y * width_; }
+
+    Color at(size_t x, size_t y) const {
+        return Color::from_argb(pixels_[y * width_ + x]);
+    }
+    void set(size_t x, size_t y, Color color) {
+        pixels_[y * width_ + x] = color.argb();
+    }
+
+    void fill(Color color);
+    /// Blends the premultiplied \a over onto this (premultiplied)
+    /// image; throws std::invalid_argument if the sizes differ.
+    void blend(const Image &over);
+    void premultiply();
+    /// Writes all pixels in \a format to \a out (size() values).
+    void convert_to(PixelFormat format, uint32_t *out) const;
+    /// Reads all pixels in \a format from \a in.
+    void convert_from(PixelFormat format, const uint32_t *in);
+
+  private:
+    size_t width_;
+    size_t height_;
+    const PixelKernels *kernels_;
+    std::vector<uint32_t> pixels_;
+};
+
+/**
+ * A plane of bytes per channel, for algorithms working on one channel
+ * at a time (a channel of consecutive pixels is contiguous).
+ */
+class PlanarImage {
+  public:
+    enum Channel { a, r, g, b };
+
+    PlanarImage(size_t width, size_t height);
+    /// Splits \a image into planes.
+    explicit PlanarImage(const Image &image);
+
+    size_t width() const { return width_; }
+    size_t height() const { return height_; }
+    size_t size() const { return width_ * height_; }
+    uint8_t *plane(Channel channel) {
+        return planes_.data() + channel * size();
+    }
+    const uint8_t *plane(Channel channel) const {
+        return planes_.data() + channel * size();
+    }
+
+    /// Merges the planes into \a image of the same size; throws
+    /// std::invalid_argument otherwise.
+    void merge_into(Image &image) const;
+
+  private:
+    size_t width_;
+    size_t height_;
+    std::vector<uint8_t> planes_;
+};
+
+#endif // CPP11_IMAGE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
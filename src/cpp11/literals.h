@@ -9,6 +9,7 @@
  *
  * \code
  * Complex c2 = 10.0 + 5.0_i;
+ * constexpr Color orange = "#ff8000"_col;
  * \endcode
  */
 
@@ -18,6 +19,7 @@
 #include <complex>
 #include <cstdint> // for uint8_t
 #include <cstddef> // for size_t
+#include <stdexcept>
 
 // Allows Complex i = 5.0_i.
 inline std::complex<long double> operator"" _i(const long double value) {
@@ -36,15 +38,29 @@ inline std::complex<long double> operator+ (
 
 class Color {
   public:
+    constexpr Color() : a_(0), r_(0), g_(0), b_(0) { }
     constexpr Color(uint8_t a, uint8_t r, uint8_t g, uint8_t b)
        : a_(a), r_(r), g_(g), b_(b)
     { }
-    constexpr bool operator==(const Color &color) {
+    /// From 0xAARRGGBB.
+    static constexpr Color from_argb(uint32_t argb) {
+       return Color((argb >> 24) & 0xff, (argb >> 16) & 0xff,
+                    (argb >>  8) & 0xff, (argb      ) & 0xff);
+    }
+    constexpr bool operator==(const Color &color) const {
        return (a_ == color.a_) &&
               (r_ == color.r_) &&
               (g_ == color.g_) &&
               (b_ == color.b_);
     }
+    constexpr uint8_t a() const { return a_; }
+    constexpr uint8_t r() const { return r_; }
+    constexpr uint8_t g() const { return g_; }
+    constexpr uint8_t b() const { return b_; }
+    constexpr uint32_t argb() const {
+       return uint32_t{a_} << 24 | uint32_t{r_} << 16
+            | uint32_t{g_} << 8 | b_;
+    }
   private:
     uint8_t a_;
     uint8_t r_;
@@ -52,12 +68,75 @@ class Color {
     uint8_t b_;
 };
 
-Color operator"" _col (const char *literal, size_t length);
-Color operator"" _col (const unsigned long long value);
+// Parsing of the _col literals, constexpr so that colors are compile
+// time constants. C++ 2011 constexpr functions are a single return
+// statement, hence the recursion and the ?: chains. An invalid literal
+// throws, which in a constant expression (such as a constexpr variable)
+// is a compile error instead.
+namespace literals_detail {
+
+constexpr uint32_t hex_digit(char c) {
+    return (c >= '0' && c <= '9') ? uint32_t(c - '0')
+         : (c >= 'a' && c <= 'f') ? uint32_t(c - 'a' + 10)
+         : (c >= 'A' && c <= 'F') ? uint32_t(c - 'A' + 10)
+         : throw std::invalid_argument("_col: not a hex digit");
+}
+
+// The value of the \a n hex digits at \a s.
+constexpr uint32_t hex(const char *s, size_t n, uint32_t value=0) {
+    return n == 0 ? value : hex(s + 1, n - 1, value << 4 | hex_digit(*s));
+}
+
+constexpr bool is_hex_prefix(const char *s, size_t n) {
+    return n > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X');
+}
+
+constexpr bool is_decimal(const char *s, size_t n) {
+    return n == 0 || (*s >= '0' && *s <= '9' && is_decimal(s + 1, n - 1));
+}
+
+// The value of the \a n decimal digits at \a s.
+constexpr uint32_t decimal(const char *s, size_t n, uint64_t value=0) {
+    return value > 0xffffffffull
+         ? throw std::out_of_range("_col: more than 0xAARRGGBB")
+         : n == 0 ? static_cast<uint32_t>(value)
+         : decimal(s + 1, n - 1, value * 10 + uint32_t(*s - '0'));
+}
+
+} // namespace literals_detail
+
+/**
+ * Allows Color c = "#00ff00"_col: "#RRGGBB" (opaque, alpha 0xff, as in
+ * CSS), "#AARRGGBB", "0x" with one to eight hex digits, or decimal
+ * 0xAARRGGBB as the number literal takes it ("16711680"_col is
+ * 0x00ff0000_col). Anything else throws instead of giving black.
+ */
+constexpr Color operator"" _col (const char *literal, size_t length) {
+    using namespace literals_detail;
+    return length == 7 && literal[0] == '#'
+         ? Color::from_argb(0xff000000u | hex(literal + 1, 6))
+         : length == 9 && literal[0] == '#'
+         ? Color::from_argb(hex(literal + 1, 8))
+         : is_hex_prefix(literal, length) && length <= 10
+         ? Color::from_argb(hex(literal + 2, length - 2))
+         : length > 0 && is_decimal(literal, length)
+         ? Color::from_argb(decimal(literal, length))
+         : throw std::invalid_argument(
+             "_col: expected #RRGGBB, #AARRGGBB, 0xAARRGGBB or decimal");
+}
+
+/// Allows Color c = 0x0000ff00_col (0xAARRGGBB).
+constexpr Color operator"" _col (const unsigned long long value) {
+    return value > 0xffffffffull
+         ? throw std::out_of_range("_col: more than 0xAARRGGBB")
+         : Color::from_argb(static_cast<uint32_t>(value));
+}
 
-const Color red   = 0x00ff0000_col;
-const Color green = 0x0000ff00_col;
-const Color blue  = 0x000000ff_col;
+// Opaque, as "#ff0000"_col. Constant initialized: no code runs at
+// startup for these.
+constexpr Color red   = 0xffff0000_col;
+constexpr Color green = 0xff00ff00_col;
+constexpr Color blue  = 0xff0000ff_col;
 
 #endif // CPP11_LITERALS_H
 
@@ -0,0 +1,204 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/lockfree.h Lock-free stack and queue on top of the
+ *       reclamation domains of reclaim.h.
+ *
+ * TreiberStack is the classic CAS-on-head stack, MSQueue the queue of
+ * Michael and Scott (1996) with a dummy node. Popped nodes are retired
+ * to the Domain (EpochDomain or HazardDomain) instead of deleted, which
+ * also rules out the ABA problem: a node cannot be reused while a
+ * thread still compares against its address.
+ *
+ * \code
+ * MSQueue<Message, HazardDomain> queue;
+ * queue.push(message);
+ * Message m;
+ * if (queue.try_pop(m)) { ... }
+ * \endcode
+ */
+
+#ifndef CPP11_LOCKFREE_H
+#define CPP11_LOCKFREE_H 1
+
+#include "cpp11/cacheline.h"
+#include "cpp11/reclaim.h"
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// An unbounded lock-free LIFO stack.
+template<typename T, typename Domain=EpochDomain>
+class TreiberStack {
+    struct Node {
+        T value;
+        Node *next;
+
+        explicit Node(T &&v) : value(std::move(v)), next(nullptr) { }
+    };
+
+  public:
+    TreiberStack() : head_{nullptr} { }
+    /// Not thread-safe.
+    ~TreiberStack() {
+        Node *node = head_.load();
+        while (node) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+    TreiberStack(const TreiberStack &)=delete;
+    TreiberStack &operator=(const TreiberStack &)=delete;
+
+    void push(T value) {
+        Node *node = new Node(std::move(value));
+        node->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(node->next, node,
+                std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    /// Pops the top into \a value; false if empty.
+    bool try_pop(T &value) {
+        typename Domain::Guard guard { domain_ };
+        for (;;) {
+            Node *head = guard.protect(0, head_);
+            if (!head) {
+                return false;
+            }
+            // head cannot be deleted now, so reading next is safe and a
+            // successful CAS really saw this node (no ABA).
+            if (head_.compare_exchange_weak(head, head->next,
+                    std::memory_order_acquire, std::memory_order_relaxed)) {
+                value = std::move(head->value);
+                guard.retire(head);
+                return true;
+            }
+        }
+    }
+
+    /// A snapshot only while other threads push or pop.
+    bool empty() const { return head_.load() == nullptr; }
+
+    Domain &domain() { return domain_; }
+
+  private:
+    // Destroyed last, deleting the retired nodes.
+    Domain domain_;
+    std::atomic<Node*> head_;
+};
+
+/// An unbounded lock-free FIFO queue.
+template<typename T, typename Domain=EpochDomain>
+class MSQueue {
+    struct Node {
+        std::atomic<Node*> next;
+        bool has_value;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type
+            storage;
+
+        Node() : next{nullptr}, has_value(false) { }
+        explicit Node(T &&v) : next{nullptr}, has_value(true) {
+            new (&storage) T(std::move(v));
+        }
+        ~Node() {
+            if (has_value) {
+                value().~T();
+            }
+        }
+        T &value() { return *reinterpret_cast<T*>(&storage); }
+    };
+
+  public:
+    MSQueue() {
+        Node *dummy = new Node;
+        head_.value.store(dummy, std::memory_order_relaxed);
+        tail_.value.store(dummy, std::memory_order_relaxed);
+    }
+    /// Not thread-safe.
+    ~MSQueue() {
+        Node *node = head_.value.load();
+        while (node) {
+            Node *next = node->next.load();
+            delete node;
+            node = next;
+        }
+    }
+    MSQueue(const MSQueue &)=delete;
+    MSQueue &operator=(const MSQueue &)=delete;
+
+    void push(T value) {
+        Node *node = new Node(std::move(value));
+        typename Domain::Guard guard { domain_ };
+        for (;;) {
+            Node *tail = guard.protect(0, tail_.value);
+            Node *next = tail->next.load(std::memory_order_acquire);
+            if (tail != tail_.value.load()) {
+                continue;
+            }
+            if (next) {
+                // The tail lags behind, help moving it.
+                tail_.value.compare_exchange_weak(tail, next);
+                continue;
+            }
+            if (tail->next.compare_exchange_weak(next, node,
+                    std::memory_order_release, std::memory_order_relaxed)) {
+                tail_.value.compare_exchange_strong(tail, node);
+                return;
+            }
+        }
+    }
+
+    /// Pops the oldest value into \a value; false if empty.
+    bool try_pop(T &value) {
+        typename Domain::Guard guard { domain_ };
+        for (;;) {
+            Node *head = guard.protect(0, head_.value);
+            Node *tail = tail_.value.load();
+            Node *next = guard.protect(1, head->next);
+            if (head != head_.value.load()) {
+                continue;
+            }
+            if (!next) {
+                return false;
+            }
+            if (head == tail) {
+                tail_.value.compare_exchange_weak(tail, next);
+                continue;
+            }
+            if (head_.value.compare_exchange_weak(head, next)) {
+                // next is the new dummy; only the thread that moved
+                // head_ onto it takes its value, and it is protected
+                // until the guard ends.
+                value = std::move(next->value());
+                next->value().~T();
+                next->has_value = false;
+                guard.retire(head);
+                return true;
+            }
+        }
+    }
+
+    /// A snapshot only while other threads push or pop.
+    bool empty() {
+        typename Domain::Guard guard { domain_ };
+        return guard.protect(0, head_.value)->next.load() == nullptr;
+    }
+
+    Domain &domain() { return domain_; }
+
+  private:
+    Domain domain_;
+    // Producers and consumers write different lines.
+    CacheAligned<std::atomic<Node*>> head_;
+    CacheAligned<std::atomic<Node*>> tail_;
+};
+
+#endif // CPP11_LOCKFREE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
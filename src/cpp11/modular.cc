@@ -0,0 +1,263 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/modular.cc Montgomery arithmetic, a Miller-Rabin test and
+ *       the factorial tables of ModularCombinatorics.
+ */
+
+#include "cpp11/modular.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+typedef Montgomery::uint128_t uint128_t;
+
+/// Numbers per chunk when building the tables on a pool, at least.
+const size_t min_table_chunk = 1 << 16;
+/// Queries of a batch looked ahead for prefetching.
+const size_t prefetch_ahead = 16;
+/// Queries per task of a parallel batch.
+const size_t query_chunk = 1 << 14;
+
+uint64_t power_mod(uint64_t base, uint64_t exponent, uint64_t modulus)
+{
+    uint64_t result = 1;
+    base %= modulus;
+    while (exponent) {
+        if (exponent & 1) {
+            result = static_cast<uint64_t>(uint128_t{result} * base
+                % modulus);
+        }
+        base = static_cast<uint64_t>(uint128_t{base} * base % modulus);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+Montgomery::Montgomery(uint64_t modulus)
+    : modulus_(modulus)
+{
+    if (modulus % 2 == 0 || modulus < 3 || modulus >> 63) {
+        throw std::invalid_argument("Montgomery: modulus "
+            + std::to_string(modulus) + " not odd or too large");
+    }
+    // Newton's iteration for 1 / m mod 2^64: m is right to 3 bits (m m
+    // is 1 mod 8 for odd m), each step doubles them.
+    uint64_t inverse = modulus;
+    for (int i=0; i<5; ++i) {
+        inverse *= 2 - modulus * inverse;
+    }
+    minus_inverse_ = 0 - inverse;
+    one_ = static_cast<uint64_t>((uint128_t{1} << 64) % modulus);
+    r2_ = static_cast<uint64_t>(uint128_t{one_} * one_ % modulus);
+}
+
+uint64_t Montgomery::power(uint64_t base, uint64_t exponent) const
+{
+    uint64_t result = one_;
+    while (exponent) {
+        if (exponent & 1) {
+            result = multiply(result, base);
+        }
+        base = multiply(base, base);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+bool is_prime(uint64_t n)
+{
+    for (uint64_t p: { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 }) {
+        if (n % p == 0) {
+            return n == p;
+        }
+    }
+    if (n < 41 * 41) {
+        return n > 1;
+    }
+    // n - 1 = d 2^s; these bases decide all n < 2^64 (Jim Sinclair).
+    const int s = __builtin_ctzll(n - 1);
+    const uint64_t d = (n - 1) >> s;
+    for (uint64_t a: { 2ull, 325ull, 9375ull, 28178ull, 450775ull,
+            9780504ull, 1795265022ull }) {
+        uint64_t x = power_mod(a, d, n);
+        if (x == 0 || x == 1 || x == n - 1) {
+            continue;
+        }
+        int i = 1;
+        for (; i<s; ++i) {
+            x = static_cast<uint64_t>(uint128_t{x} * x % n);
+            if (x == n - 1) {
+                break;
+            }
+        }
+        if (i == s) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ModularCombinatorics::ModularCombinatorics(uint32_t max_n, uint64_t p)
+    : max_n_(max_n), mont_(p)
+{
+    build(nullptr);
+}
+
+ModularCombinatorics::ModularCombinatorics(uint32_t max_n, uint64_t p,
+    ThreadPool &pool)
+    : max_n_(max_n), mont_(p)
+{
+    build(&pool);
+}
+
+void ModularCombinatorics::build(ThreadPool *pool)
+{
+    const uint64_t p = mont_.modulus();
+    if (p <= max_n_ || !is_prime(p)) {
+        throw std::invalid_argument("ModularCombinatorics: "
+            + std::to_string(p) + " is no prime above "
+            + std::to_string(max_n_));
+    }
+    const size_t size = size_t{max_n_} + 1;
+    factorial_r2_.resize(size);
+    inverse_factorial_.resize(size);
+    const size_t chunk = pool ? std::max(min_table_chunk,
+        size / (4 * pool->size()) + 1) : size;
+    const size_t chunks = (size + chunk - 1) / chunk;
+    const auto each_chunk = [&](const std::function<void(size_t, size_t,
+        size_t)> &fn) {
+        const auto body = [&](size_t c) {
+            fn(c, c * chunk, std::min(size, (c + 1) * chunk));
+        };
+        if (pool) {
+            pool->parallel_for(size_t{0}, chunks, body, 1);
+        } else {
+            for (size_t c=0; c<chunks; ++c) {
+                body(c);
+            }
+        }
+    };
+
+    // Products within each chunk, in Montgomery form: from the front
+    // for the factorials, from the back for the inverses.
+    const uint64_t one = mont_.one();
+    std::vector<uint64_t> totals(chunks);
+    each_chunk([&](size_t c, size_t begin, size_t end) {
+        uint64_t number = mont_.multiply(begin, mont_.r2());
+        uint64_t product = one;
+        for (size_t i=begin; i<end; ++i) {
+            if (i > 0) {
+                product = mont_.multiply(product, number);
+            }
+            factorial_r2_[i] = product;
+            number = number + one >= p ? number + one - p : number + one;
+        }
+        totals[c] = product;
+        // number is end now; the suffix product of i holds i + 1 .. end.
+        product = one;
+        for (size_t i=end; i-->begin; ) {
+            number = number >= one ? number - one : number + p - one;
+            inverse_factorial_[i] = product;
+            product = mont_.multiply(product, number);
+        }
+    });
+
+    // before[c] and after[c]: the products of all chunks before and
+    // after chunk c. 1 / N! by Fermat's little theorem.
+    std::vector<uint64_t> before(chunks + 1, one), after(chunks, one);
+    for (size_t c=0; c<chunks; ++c) {
+        before[c + 1] = mont_.multiply(before[c], totals[c]);
+    }
+    for (size_t c=chunks-1; c-->0; ) {
+        after[c] = mont_.multiply(after[c + 1], totals[c + 1]);
+    }
+    const uint64_t inverse_all = mont_.power(before[chunks], p - 2);
+
+    // (x R)(y R^2) / R is x y R^2; (x R) y / R is the plain x y.
+    each_chunk([&](size_t c, size_t begin, size_t end) {
+        const uint64_t scale = mont_.multiply(before[c], mont_.r2());
+        const uint64_t inverse_scale = mont_.from(
+            mont_.multiply(inverse_all, after[c]));
+        for (size_t i=begin; i<end; ++i) {
+            factorial_r2_[i] = mont_.multiply(factorial_r2_[i], scale);
+            inverse_factorial_[i] = mont_.multiply(inverse_factorial_[i],
+                inverse_scale);
+        }
+    });
+}
+
+void ModularCombinatorics::out_of_range(uint32_t n)
+{
+    throw std::out_of_range("ModularCombinatorics: n "
+        + std::to_string(n) + " above the tables");
+}
+
+uint64_t ModularCombinatorics::multinomial(const uint32_t *k,
+    size_t count) const
+{
+    uint64_t n = 0;
+    for (size_t i=0; i<count; ++i) {
+        n += k[i];
+    }
+    if (n > max_n_) {
+        out_of_range(static_cast<uint32_t>(std::min<uint64_t>(n,
+            UINT32_MAX)));
+    }
+    // n! R, times each 1 / k! R.
+    uint64_t result = mont_.from(factorial_r2_[n]);
+    for (size_t i=0; i<count; ++i) {
+        result = mont_.multiply(result,
+            mont_.multiply(inverse_factorial_[k[i]], mont_.r2()));
+    }
+    return mont_.from(result);
+}
+
+void ModularCombinatorics::binomials(const BinomialQuery *queries,
+    size_t count, uint64_t *out) const
+{
+    for (size_t i=0; i<count; ++i) {
+        if (i + prefetch_ahead < count) {
+            const BinomialQuery &next = queries[i + prefetch_ahead];
+            if (next.n <= max_n_ && next.k <= next.n) {
+                __builtin_prefetch(&factorial_r2_[next.n]);
+                __builtin_prefetch(&inverse_factorial_[next.k]);
+                __builtin_prefetch(&inverse_factorial_[next.n - next.k]);
+            }
+        }
+        out[i] = binomial(queries[i].n, queries[i].k);
+    }
+}
+
+std::vector<uint64_t> ModularCombinatorics::binomials(
+    const std::vector<BinomialQuery> &queries) const
+{
+    std::vector<uint64_t> results(queries.size());
+    binomials(queries.data(), queries.size(), results.data());
+    return results;
+}
+
+std::vector<uint64_t> ModularCombinatorics::binomials(
+    const std::vector<BinomialQuery> &queries, ThreadPool &pool) const
+{
+    std::vector<uint64_t> results(queries.size());
+    const size_t chunks = (queries.size() + query_chunk - 1)
+        / query_chunk;
+    pool.parallel_for(size_t{0}, chunks, [&](size_t c) {
+        const size_t begin = c * query_chunk;
+        binomials(queries.data() + begin,
+            std::min(query_chunk, queries.size() - begin),
+            results.data() + begin);
+    }, 1);
+    return results;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,164 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/modular.h Montgomery multiplication, and binomial
+ *       coefficients modulo a prime from tables of factorials.
+ *
+ * a b % p divides by a p known only at run time, which costs tens of
+ * cycles. Montgomery's form keeps a as a R mod p for R = 2^64; then
+ * (a R)(b R) / R is the product in the same form, and dividing by R
+ * needs only multiplications and a shift (Montgomery reduction).
+ *
+ * ModularCombinatorics keeps n! and 1/n! mod p up to some N, so that
+ * C(n, k) = n! / (k! (n - k)!) is two multiplications. The factorials
+ * are stored times R^2, which the two reductions take out again. The
+ * tables are prefix products, built in chunks in parallel: each chunk
+ * multiplies its own numbers, then the chunks are scaled by the product
+ * of all before (or, for the inverses, after) them.
+ *
+ * \code
+ * ModularCombinatorics mod(10000000, 1000000007);
+ * uint64_t c = mod.binomial(10000000, 5000000);
+ * \endcode
+ */
+
+#ifndef CPP11_MODULAR_H
+#define CPP11_MODULAR_H 1
+
+#include "cpp11/threadpool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+/// Arithmetic modulo an odd modulus below 2^63 in Montgomery form.
+class Montgomery {
+  public:
+    typedef unsigned __int128 uint128_t;
+
+    /// Throws std::invalid_argument unless \a modulus is odd, greater
+    /// than 1 and below 2^63.
+    explicit Montgomery(uint64_t modulus);
+
+    uint64_t modulus() const { return modulus_; }
+    /// a R mod m for any a.
+    uint64_t to(uint64_t a) const {
+        return reduce(uint128_t{a % modulus_} * r2_);
+    }
+    /// a / R mod m: out of Montgomery form.
+    uint64_t from(uint64_t a) const { return reduce(a); }
+    /// a b / R mod m; for a and b in Montgomery form, their product.
+    uint64_t multiply(uint64_t a, uint64_t b) const {
+        return reduce(uint128_t{a} * b);
+    }
+    /// t / R mod m for t < m 2^64.
+    uint64_t reduce(uint128_t t) const {
+        // q makes t + q m divisible by 2^64; the sum is below 2 m 2^64.
+        const uint64_t q = static_cast<uint64_t>(t) * minus_inverse_;
+        const uint64_t r = static_cast<uint64_t>(
+            (t + uint128_t{q} * modulus_) >> 64);
+        return r >= modulus_ ? r - modulus_ : r;
+    }
+    /// 1 in Montgomery form, R mod m.
+    uint64_t one() const { return one_; }
+    /// R^2 mod m: multiply() by it brings a into Montgomery form.
+    uint64_t r2() const { return r2_; }
+    /// base^exponent, base and result in Montgomery form.
+    uint64_t power(uint64_t base, uint64_t exponent) const;
+
+  private:
+    uint64_t modulus_;
+    uint64_t minus_inverse_;  // -1 / m mod 2^64
+    uint64_t one_;
+    uint64_t r2_;
+};
+
+/// Deterministic Miller-Rabin test for all 64 bit numbers.
+bool is_prime(uint64_t n);
+
+/// A query of binomial(n, k).
+struct BinomialQuery {
+    uint32_t n;
+    uint32_t k;
+};
+
+/**
+ * Factorials, binomial coefficients, permutations and multinomial
+ * coefficients modulo a prime p, each in O(1) from tables up to N.
+ */
+class ModularCombinatorics {
+  public:
+    /// Tables up to \a max_n for the prime \a p > \a max_n, p < 2^63;
+    /// throws std::invalid_argument otherwise.
+    ModularCombinatorics(uint32_t max_n, uint64_t p);
+    /// The same, building the tables on \a pool.
+    ModularCombinatorics(uint32_t max_n, uint64_t p, ThreadPool &pool);
+
+    uint32_t max_n() const { return max_n_; }
+    uint64_t modulus() const { return mont_.modulus(); }
+
+    /// The queries throw std::out_of_range for n > max_n().
+    uint64_t factorial(uint32_t n) const {
+        check(n);
+        return mont_.from(mont_.from(factorial_r2_[n]));
+    }
+    uint64_t inverse_factorial(uint32_t n) const {
+        check(n);
+        return inverse_factorial_[n];
+    }
+    /// C(n, k), 0 for k > n.
+    uint64_t binomial(uint32_t n, uint32_t k) const {
+        check(n);
+        return k > n ? 0 : binomial_unchecked(n, k);
+    }
+    /// n! / (n - k)!, 0 for k > n.
+    uint64_t permutation(uint32_t n, uint32_t k) const {
+        check(n);
+        return k > n ? 0 : mont_.from(mont_.multiply(factorial_r2_[n],
+            inverse_factorial_[n - k]));
+    }
+    /// (k1 + ... + km)! / (k1! ... km!).
+    uint64_t multinomial(const uint32_t *k, size_t count) const;
+    uint64_t multinomial(std::initializer_list<uint32_t> k) const {
+        return multinomial(k.begin(), k.size());
+    }
+
+    /// binomial() of all \a queries. The table entries of queries a few
+    /// ahead are prefetched, so that their cache misses overlap.
+    std::vector<uint64_t> binomials(
+        const std::vector<BinomialQuery> &queries) const;
+    /// The same, in chunks on \a pool.
+    std::vector<uint64_t> binomials(
+        const std::vector<BinomialQuery> &queries, ThreadPool &pool) const;
+    /// binomial() of \a count queries to \a out.
+    void binomials(const BinomialQuery *queries, size_t count,
+        uint64_t *out) const;
+
+  private:
+    void build(ThreadPool *pool);
+    void check(uint32_t n) const {
+        if (n > max_n_) {
+            out_of_range(n);
+        }
+    }
+    [[noreturn]] static void out_of_range(uint32_t n);
+    // (n! R^2) (1 / k!) / R (1 / (n - k)!) / R.
+    uint64_t binomial_unchecked(uint32_t n, uint32_t k) const {
+        return mont_.multiply(mont_.multiply(factorial_r2_[n],
+            inverse_factorial_[k]), inverse_factorial_[n - k]);
+    }
+
+    uint32_t max_n_;
+    Montgomery mont_;
+    /// n! R^2 mod p.
+    std::vector<uint64_t> factorial_r2_;
+    /// 1 / n! mod p.
+    std::vector<uint64_t> inverse_factorial_;
+};
+
+#endif // CPP11_MODULAR_H
+
+/* vim: set ts=4 sw=4 tw=76: */
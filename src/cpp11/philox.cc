@@ -0,0 +1,81 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/philox.cc Seeking and block fills of Philox4x32.
+ */
+
+#include "cpp11/philox.h"
+
+#include <algorithm>
+
+void Philox4x32::seek(uint64_t n)
+{
+    set_block(n / 4);
+    used_ = 4;
+    if (n % 4) {
+        buffer_ = block(counter_, key_);
+        set_block(n / 4 + 1);
+        used_ = static_cast<unsigned>(n % 4);
+    }
+}
+
+void Philox4x32::fill(uint32_t *out, size_t n)
+{
+    const size_t buffered = std::min<size_t>(n, 4 - used_);
+    std::copy(buffer_.begin() + used_,
+        buffer_.begin() + used_ + buffered, out);
+    used_ += static_cast<unsigned>(buffered);
+    out += buffered;
+    n -= buffered;
+    // Eight blocks at a time, word by word, which the compiler turns
+    // into vector multiplications.
+    uint64_t next = block_number();
+    const size_t wide = 8;
+    for (; n>=4*wide; n-=4*wide, out+=4*wide, next+=wide) {
+        uint32_t c0[wide], c1[wide], c2[wide], c3[wide];
+        for (size_t j=0; j<wide; ++j) {
+            c0[j] = static_cast<uint32_t>(next + j);
+            c1[j] = static_cast<uint32_t>((next + j) >> 32);
+            c2[j] = counter_[2];
+            c3[j] = counter_[3];
+        }
+        Key key = key_;
+        for (int round=0; round<10; ++round) {
+            if (round) {
+                key[0] += 0x9e3779b9;
+                key[1] += 0xbb67ae85;
+            }
+            for (size_t j=0; j<wide; ++j) {
+                const uint64_t p0 = uint64_t{0xd2511f53} * c0[j];
+                const uint64_t p1 = uint64_t{0xcd9e8d57} * c2[j];
+                c0[j] = static_cast<uint32_t>(p1 >> 32) ^ c1[j] ^ key[0];
+                c1[j] = static_cast<uint32_t>(p1);
+                c2[j] = static_cast<uint32_t>(p0 >> 32) ^ c3[j] ^ key[1];
+                c3[j] = static_cast<uint32_t>(p0);
+            }
+        }
+        for (size_t j=0; j<wide; ++j) {
+            out[4 * j] = c0[j];
+            out[4 * j + 1] = c1[j];
+            out[4 * j + 2] = c2[j];
+            out[4 * j + 3] = c3[j];
+        }
+    }
+    Counter counter = counter_;
+    for (; n>=4; n-=4, out+=4, ++next) {
+        counter[0] = static_cast<uint32_t>(next);
+        counter[1] = static_cast<uint32_t>(next >> 32);
+        const Counter values = block(counter, key_);
+        std::copy(values.begin(), values.end(), out);
+    }
+    set_block(next);
+    if (n) {
+        (*this)();
+        std::copy(buffer_.begin(), buffer_.begin() + n, out);
+        used_ = static_cast<unsigned>(n);
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,159 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/philox.h A counter-based random engine, for random numbers
+ *       that do not depend on how work is split among threads.
+ *
+ * An engine per thread, seeded from the thread number, gives results
+ * that change with the number of threads, and seeds close to each other
+ * may give correlated streams. Philox4x32-10 by Salmon et al. (Random123)
+ * instead computes value n of stream s as a keyed bijection of the
+ * counter (n, s): ten rounds of multiplications and xors, which pass
+ * BigCrush. Any value is as cheap to reach as the next one, so each work
+ * item can have its own stream:
+ *
+ * \code
+ * parallel_for_random(pool, 42, size_t{0}, n,
+ *     [&](size_t i, Philox4x32 &engine) {
+ *         out[i] = std::normal_distribution<>()(engine);
+ *     });
+ * \endcode
+ *
+ * gives the same out for every pool size and schedule.
+ */
+
+#ifndef CPP11_PHILOX_H
+#define CPP11_PHILOX_H 1
+
+#include "cpp11/threadpool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Philox4x32-10 as a UniformRandomBitGenerator. The 128 bit counter of
+ * a block of four values is the block number (low 64 bits) and the
+ * substream (high 64 bits); the key is the seed.
+ */
+class Philox4x32 {
+  public:
+    typedef uint32_t result_type;
+    typedef std::array<uint32_t, 4> Counter;
+    typedef std::array<uint32_t, 2> Key;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    /// The four values of \a counter under \a key.
+    static Counter block(Counter counter, Key key) {
+        for (int round=0; round<10; ++round) {
+            if (round) {
+                key[0] += 0x9e3779b9;
+                key[1] += 0xbb67ae85;
+            }
+            const uint64_t p0 = uint64_t{0xd2511f53} * counter[0];
+            const uint64_t p1 = uint64_t{0xcd9e8d57} * counter[2];
+            counter = Counter {{
+                static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(p1),
+                static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(p0) }};
+        }
+        return counter;
+    }
+
+    explicit Philox4x32(uint64_t seed=0, uint64_t substream=0) {
+        this->seed(seed, substream);
+    }
+
+    void seed(uint64_t seed, uint64_t substream=0) {
+        key_ = Key {{ static_cast<uint32_t>(seed),
+            static_cast<uint32_t>(seed >> 32) }};
+        counter_ = Counter {{ 0, 0, static_cast<uint32_t>(substream),
+            static_cast<uint32_t>(substream >> 32) }};
+        buffer_ = Counter();
+        used_ = 4;
+    }
+
+    result_type operator()() {
+        if (used_ == 4) {
+            buffer_ = block(counter_, key_);
+            set_block(block_number() + 1);
+            used_ = 0;
+        }
+        return buffer_[used_++];
+    }
+
+    /// Skips \a n values in O(1).
+    void discard(unsigned long long n) { seek(position() + n); }
+    /// Continues at value \a n of the substream.
+    void seek(uint64_t n);
+    /// Number of values taken from the substream.
+    uint64_t position() const {
+        return block_number() * 4 - (4 - used_);
+    }
+    /// Stream \a id of the same seed, from its start. Different ids
+    /// never overlap (each has 2^66 values).
+    Philox4x32 substream(uint64_t id) const {
+        Philox4x32 engine { *this };
+        engine.counter_[2] = static_cast<uint32_t>(id);
+        engine.counter_[3] = static_cast<uint32_t>(id >> 32);
+        engine.seek(0);
+        return engine;
+    }
+    uint64_t substream_id() const {
+        return uint64_t{counter_[3]} << 32 | counter_[2];
+    }
+
+    /// The next \a n values, as \a n calls would give them.
+    void fill(uint32_t *out, size_t n);
+
+    friend bool operator==(const Philox4x32 &a, const Philox4x32 &b) {
+        return a.key_ == b.key_ && a.substream_id() == b.substream_id()
+            && a.position() == b.position();
+    }
+    friend bool operator!=(const Philox4x32 &a, const Philox4x32 &b) {
+        return !(a == b);
+    }
+
+  private:
+    uint64_t block_number() const {
+        return uint64_t{counter_[1]} << 32 | counter_[0];
+    }
+    void set_block(uint64_t n) {
+        counter_[0] = static_cast<uint32_t>(n);
+        counter_[1] = static_cast<uint32_t>(n >> 32);
+    }
+
+    Key key_;
+    Counter counter_;  // of the block after buffer_
+    Counter buffer_;
+    unsigned used_;    // values of buffer_ taken
+};
+
+/**
+ * Calls \a body(i, engine) for all i in [begin, end) on \a pool, as
+ * ThreadPool::parallel_for() does, engine being substream i of \a seed.
+ * What body draws from it therefore depends on i only, not on the
+ * number of threads, the \a grain nor the order of the calls.
+ */
+template<typename Index, typename Body>
+void parallel_for_random(ThreadPool &pool, uint64_t seed, Index begin,
+    Index end, Body body, size_t grain=0)
+{
+    const Philox4x32 root { seed };
+    pool.parallel_for(begin, end, [&](Index i) {
+        Philox4x32 engine = root.substream(static_cast<uint64_t>(i));
+        body(i, engine);
+    }, grain);
+}
+
+#endif // CPP11_PHILOX_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,234 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/pipeline.cc Multi-stage pipelines of threads connected by
+ *       bounded queues.
+ */
+
+#include "cpp11/pipeline.h"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+uint64_t Pipeline::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double Pipeline::StageReport::throughput() const
+{
+    const uint64_t items = capacity ? items_in : items_out;
+    return seconds > 0 ? items / seconds : 0.0;
+}
+
+double Pipeline::StageReport::utilization() const
+{
+    return seconds > 0 && workers
+        ? busy_seconds / (seconds * workers) : 0.0;
+}
+
+Pipeline::Stage::Stage(Pipeline &pipeline, const std::string &name,
+    unsigned workers)
+    : name_(name), workers_(workers), running_{0}, end_ns_{0},
+      pipeline_(pipeline), items_in_("pipeline." + name + ".in"),
+      items_out_("pipeline." + name + ".out")
+{
+    if (workers == 0) {
+        throw std::invalid_argument("Pipeline: stage without workers");
+    }
+}
+
+Pipeline::Stage::~Stage()
+{ }
+
+void Pipeline::Stage::start()
+{
+    running_ = workers_;
+    for (unsigned n=0; n<workers_; ++n) {
+        threads_.emplace_back(&Stage::worker, this);
+    }
+}
+
+void Pipeline::Stage::join()
+{
+    for (auto &thread: threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void Pipeline::Stage::worker()
+{
+    try {
+        work();
+    } catch (...) {
+        pipeline_.fail(std::current_exception());
+    }
+    if (running_.fetch_sub(1) == 1) {
+        end_ns_.store(now_ns());
+        finish();
+    }
+}
+
+Pipeline::StageReport Pipeline::Stage::report(uint64_t now)
+{
+    StageReport report;
+    report.name = name_;
+    report.workers = workers_;
+    report.items_in = items_in_.value();
+    report.items_out = items_out_.value();
+    const uint64_t end = end_ns_.load() ? end_ns_.load() : now;
+    const uint64_t start = pipeline_.start_ns_;
+    report.seconds = start && end > start ? (end - start) / 1e9 : 0.0;
+    const uint64_t busy = busy_ns_.value();
+    const uint64_t blocked = blocked_ns_.value();
+    // The stage function also runs while blocked in the emitter.
+    report.busy_seconds = (busy > blocked ? busy - blocked : 0) / 1e9;
+    report.blocked_seconds = blocked / 1e9;
+    report.capacity = 0;
+    report_input(report);
+    return report;
+}
+
+Pipeline::Pipeline(size_t capacity)
+    : capacity_(capacity), state_(building), start_ns_(0),
+      cancelled_{false}
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("Pipeline: capacity must not be 0");
+    }
+}
+
+Pipeline::~Pipeline()
+{
+    if (state_ == running) {
+        cancel();
+        for (auto &stage: stages_) {
+            stage->join();
+        }
+    }
+}
+
+void Pipeline::check_building() const
+{
+    if (state_ != building) {
+        throw std::logic_error("Pipeline: stage added after run()");
+    }
+}
+
+void Pipeline::add(Stage *stage)
+{
+    std::unique_ptr<Stage> owner { stage };
+    check_building();
+    stages_.push_back(std::move(owner));
+}
+
+void Pipeline::run()
+{
+    check_building();
+    state_ = running;
+    start_ns_ = now_ns();
+    for (auto &stage: stages_) {
+        stage->start();
+    }
+}
+
+void Pipeline::wait()
+{
+    if (state_ != running) {
+        throw std::logic_error("Pipeline::wait: not running");
+    }
+    for (auto &stage: stages_) {
+        stage->join();
+    }
+    state_ = joined;
+    std::unique_lock<std::mutex> lock { error_mutex_ };
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void Pipeline::cancel()
+{
+    if (cancelled_.exchange(true)) {
+        return;
+    }
+    for (auto &stage: stages_) {
+        stage->abort();
+    }
+}
+
+void Pipeline::fail(std::exception_ptr error)
+{
+    {
+        std::unique_lock<std::mutex> lock { error_mutex_ };
+        // Exceptions caused by cancelling (adding to a closed queue)
+        // are no news.
+        if (!error_ && !cancelled()) {
+            error_ = error;
+        }
+    }
+    cancel();
+}
+
+std::vector<Pipeline::StageReport> Pipeline::report() const
+{
+    const uint64_t now = now_ns();
+    std::vector<StageReport> result;
+    for (auto &stage: stages_) {
+        result.push_back(stage->report(now));
+    }
+    return result;
+}
+
+std::string Pipeline::report_text() const
+{
+    const std::vector<StageReport> stages = report();
+    std::ostringstream out;
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(4) << "thr" << std::setw(11) << "items in"
+        << std::setw(11) << "items out" << std::setw(12) << "items/s"
+        << std::setw(7) << "busy%" << std::setw(7) << "blkd%"
+        << std::setw(15) << "depth p50/p99" << std::setw(7) << "cap"
+        << std::setw(12) << "wait p99 us" << std::endl;
+    const StageReport *bottleneck = nullptr;
+    for (const StageReport &s: stages) {
+        const double wall = s.seconds * s.workers;
+        std::ostringstream depth;
+        if (s.capacity) {
+            depth << s.occupancy.quantile(0.5) << '/'
+                  << s.occupancy.quantile(0.99);
+        } else {
+            depth << '-';
+        }
+        out << std::left << std::setw(12) << s.name << std::right
+            << std::setw(4) << s.workers
+            << std::setw(11) << s.items_in
+            << std::setw(11) << s.items_out
+            << std::setw(12) << static_cast<uint64_t>(s.throughput())
+            << std::fixed << std::setprecision(1)
+            << std::setw(7) << 100.0 * s.utilization()
+            << std::setw(7)
+            << (wall > 0 ? 100.0 * s.blocked_seconds / wall : 0.0)
+            << std::setw(15) << depth.str()
+            << std::setw(7) << s.capacity
+            << std::setw(12) << s.latency.quantile(0.99) / 1000.0
+            << std::endl;
+        if (!bottleneck || s.utilization() > bottleneck->utilization()) {
+            bottleneck = &s;
+        }
+    }
+    if (bottleneck) {
+        out << "bottleneck: " << bottleneck->name << " ("
+            << std::fixed << std::setprecision(1)
+            << 100.0 * bottleneck->utilization() << "% busy)" << std::endl;
+    }
+    return out.str();
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,400 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/pipeline.h Multi-stage pipelines of threads connected by
+ *       bounded queues.
+ *
+ * Each stage runs on its own worker threads and takes its input from a
+ * bounded Queue. A full queue blocks the upstream stage (backpressure),
+ * and when all stages feeding a queue are done the queue is closed, so
+ * end-of-stream flows down the pipeline until the sinks are drained.
+ *
+ * \code
+ * Pipeline pipeline;
+ * auto lines = pipeline.source<std::string>("read",
+ *     [&](Pipeline::Emitter<std::string> &emit) {
+ *         std::string line;
+ *         if (!std::getline(in, line)) return false;
+ *         emit(line);
+ *         return true;
+ *     });
+ * auto numbers = lines.map<int>("parse",
+ *     [](const std::string &s) { return std::stoi(s); }, 4);
+ * numbers.sink("sum", [&](const int &n) { sum += n; });
+ * pipeline.run();
+ * pipeline.wait();
+ * std::cout << pipeline.report_text();
+ * \endcode
+ *
+ * A flow consumed by several stages is copied to each of them (fan-out),
+ * merge() feeds the output of several stages into one (fan-in), and the
+ * workers of a stage share its input queue (parallelism).
+ *
+ * The message counts of each stage are also published in the
+ * CounterRegistry as pipeline.<stage>.in and pipeline.<stage>.out.
+ */
+
+#ifndef CPP11_PIPELINE_H
+#define CPP11_PIPELINE_H 1
+
+#include "cpp11/consumer.h"
+#include "cpp11/counter.h"
+#include "cpp11/histogram.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A set of stages and the queues connecting them. Stages are added via
+ * source() and the Flow objects it returns, then run() starts all
+ * workers and wait() joins them.
+ *
+ * Messages must be copyable and default constructible. Stage functions
+ * of stages with more than one worker are called concurrently. If a
+ * stage function throws, the pipeline is cancelled and wait() rethrows
+ * the exception.
+ */
+class Pipeline {
+    class Stage;
+    template<typename T> struct Channel;
+    template<typename T> struct Output;
+
+  public:
+    /// Passes messages of a stage downstream, handed to stage functions.
+    template<typename T>
+    class Emitter {
+        Output<T> &output_;
+        Stage &stage_;
+      public:
+        Emitter(Output<T> &output, Stage &stage)
+            : output_(output), stage_(stage) { }
+        /// Sends \a value to all consuming stages, waits while a queue
+        /// is full.
+        void operator()(const T &value) {
+            ++stage_.items_out_;
+            for (auto &target: output_.targets) {
+                stage_.put(target->queue, value);
+            }
+        }
+    };
+
+    /// The output of one or more stages, to be consumed by further
+    /// stages. Consuming a flow more than once copies the messages.
+    template<typename T>
+    class Flow {
+        friend class Pipeline;
+        template<typename> friend class Flow;
+        Pipeline *pipeline_;
+        std::vector<std::shared_ptr<Output<T>>> outputs_;
+
+        Flow(Pipeline *pipeline, std::shared_ptr<Output<T>> output)
+            : pipeline_(pipeline), outputs_ { output } { }
+
+        // A new input queue fed by all outputs of this flow.
+        std::shared_ptr<Channel<T>> attach() const {
+            pipeline_->check_building();
+            std::shared_ptr<Channel<T>> channel =
+                std::make_shared<Channel<T>>(pipeline_->capacity_);
+            for (auto &output: outputs_) {
+                output->targets.push_back(channel);
+                ++channel->producers;
+            }
+            return channel;
+        }
+
+      public:
+        /// A stage emitting any number of messages per input message.
+        template<typename U>
+        Flow<U> flat_map(const std::string &name,
+            std::function<void(const T&, Emitter<U>&)> fn,
+            unsigned workers=1) const
+        {
+            std::shared_ptr<Output<U>> output =
+                std::make_shared<Output<U>>();
+            pipeline_->add(new TransformStage<T, U>(*pipeline_, name,
+                workers, attach(), output, std::move(fn)));
+            return Flow<U>(pipeline_, output);
+        }
+
+        /// A stage emitting exactly one message per input message.
+        template<typename U>
+        Flow<U> map(const std::string &name,
+            std::function<U(const T&)> fn, unsigned workers=1) const
+        {
+            return flat_map<U>(name,
+                [fn](const T &in, Emitter<U> &emit) { emit(fn(in)); },
+                workers);
+        }
+
+        /// A final stage consuming all messages.
+        void sink(const std::string &name,
+            std::function<void(const T&)> fn, unsigned workers=1) const
+        {
+            pipeline_->add(new SinkStage<T>(*pipeline_, name, workers,
+                attach(), std::move(fn)));
+        }
+
+        /// The messages of this and \a other flow in one (fan-in).
+        Flow<T> merge(const Flow<T> &other) const {
+            Flow<T> result(*this);
+            result.outputs_.insert(result.outputs_.end(),
+                other.outputs_.begin(), other.outputs_.end());
+            return result;
+        }
+    };
+
+    /// Statistics of one stage, see report().
+    struct StageReport {
+        std::string name;
+        unsigned workers;
+        uint64_t items_in;        // taken from the input queue
+        uint64_t items_out;       // emitted downstream
+        double seconds;           // since run(), until the stage finished
+        double busy_seconds;      // in stage functions, all workers
+        double blocked_seconds;   // waiting for space downstream
+        size_t capacity;          // of the input queue, 0 for sources
+        Histogram occupancy;      // input queue depths seen when adding
+        Histogram latency;        // ns messages waited in the input queue
+
+        /// Messages per second, inputs or (for sources) outputs.
+        double throughput() const;
+        /// Fraction of the workers' time spent working, 0..1.
+        double utilization() const;
+    };
+
+    /// Stages connected by queues holding up to \a capacity messages.
+    explicit Pipeline(size_t capacity=1024);
+    /// Cancels and joins a pipeline still running.
+    ~Pipeline();
+    Pipeline(const Pipeline &)=delete;
+    Pipeline &operator=(const Pipeline &)=delete;
+
+    /**
+     * A first stage: \a fn is called until it returns false, and emits
+     * any number of messages per call.
+     */
+    template<typename T>
+    Flow<T> source(const std::string &name,
+        std::function<bool(Emitter<T>&)> fn, unsigned workers=1)
+    {
+        std::shared_ptr<Output<T>> output = std::make_shared<Output<T>>();
+        add(new SourceStage<T>(*this, name, workers, output,
+            std::move(fn)));
+        return Flow<T>(this, output);
+    }
+
+    /// Starts all stages; no stages may be added afterwards.
+    void run();
+    /// Waits until all stages are done, rethrows the first exception
+    /// thrown by a stage function.
+    void wait();
+    /// Stops the sources and closes all queues; wait() still drains
+    /// messages already queued.
+    void cancel();
+    bool cancelled() const { return cancelled_.load(); }
+
+    /// Statistics of all stages in the order they were added; may be
+    /// called while running.
+    std::vector<StageReport> report() const;
+    /// The report as a table, with the bottleneck (the stage with the
+    /// highest utilization) named in the last line.
+    std::string report_text() const;
+
+  private:
+    static uint64_t now_ns();
+
+    // Base of all stages: worker threads and statistics.
+    class Stage {
+        const std::string name_;
+        const unsigned workers_;
+        std::vector<std::thread> threads_;
+        std::atomic<unsigned> running_;
+        std::atomic<uint64_t> end_ns_;
+
+        void worker();
+
+      public:
+        Pipeline &pipeline_;
+        // Sharded: the workers of a stage count without contention.
+        ShardedCounter items_in_;
+        ShardedCounter items_out_;
+        ShardedCounter busy_ns_;
+        ShardedCounter blocked_ns_;
+
+        Stage(Pipeline &pipeline, const std::string &name,
+            unsigned workers);
+        virtual ~Stage();
+        void start();
+        void join();
+        StageReport report(uint64_t now);
+
+        // Runs one worker until its input is drained.
+        virtual void work()=0;
+        // Called by the last worker done: ends the stream downstream.
+        virtual void finish()=0;
+        // Closes the input queue, if any.
+        virtual void abort()=0;
+        // Fills in the input queue statistics.
+        virtual void report_input(StageReport &) { }
+
+        // Adds to a downstream queue, timing a wait for space.
+        template<typename Q, typename V>
+        void put(Q &queue, V &&value) {
+            if (queue.capacity() && queue.size() >= queue.capacity()) {
+                const uint64_t start = now_ns();
+                queue.add(std::forward<V>(value));
+                blocked_ns_.add(now_ns() - start);
+            } else {
+                queue.add(std::forward<V>(value));
+            }
+        }
+
+        // Calls fn, adding its duration to the busy time.
+        template<typename F>
+        auto timed(F fn) -> decltype(fn()) {
+            struct Timer {
+                ShardedCounter &busy;
+                const uint64_t start;
+                ~Timer() { busy.add(now_ns() - start); }
+            } timer { busy_ns_, now_ns() };
+            return fn();
+        }
+    };
+
+    // A stage's input queue, closed when all producing stages are done.
+    template<typename T>
+    struct Channel {
+        Queue<T> queue;
+        std::atomic<unsigned> producers;
+
+        explicit Channel(size_t capacity) : queue(capacity), producers{0} {
+            queue.stats().enable();
+        }
+        void producer_done() {
+            if (producers.fetch_sub(1) == 1) {
+                queue.close();
+            }
+        }
+    };
+
+    // A stage's output: the input queues of all consuming stages.
+    template<typename T>
+    struct Output {
+        std::vector<std::shared_ptr<Channel<T>>> targets;
+
+        void finish() {
+            for (auto &target: targets) {
+                target->producer_done();
+            }
+        }
+    };
+
+    template<typename T>
+    class SourceStage : public Stage {
+        std::shared_ptr<Output<T>> output_;
+        std::function<bool(Emitter<T>&)> fn_;
+      public:
+        SourceStage(Pipeline &pipeline, const std::string &name,
+            unsigned workers, std::shared_ptr<Output<T>> output,
+            std::function<bool(Emitter<T>&)> fn)
+            : Stage(pipeline, name, workers), output_(output),
+              fn_(std::move(fn)) { }
+        void work() override {
+            Emitter<T> emit(*output_, *this);
+            while (!pipeline_.cancelled()
+                && timed([&] { return fn_(emit); })) {
+            }
+        }
+        void finish() override { output_->finish(); }
+        void abort() override { }
+    };
+
+    // A stage taking messages from an input queue.
+    template<typename T>
+    class InputStage : public Stage {
+      protected:
+        std::shared_ptr<Channel<T>> input_;
+
+        // Calls fn for each message until the input is drained.
+        template<typename F>
+        void drain(F fn) {
+            T item;
+            while (input_->queue.get(item)) {
+                ++items_in_;
+                timed([&] { fn(item); });
+            }
+        }
+
+      public:
+        InputStage(Pipeline &pipeline, const std::string &name,
+            unsigned workers, std::shared_ptr<Channel<T>> input)
+            : Stage(pipeline, name, workers), input_(input) { }
+        void abort() override { input_->queue.close(); }
+        void report_input(StageReport &report) override {
+            const QueueStats::Snapshot s = input_->queue.stats().snapshot();
+            report.capacity = input_->queue.capacity();
+            report.occupancy = s.depth;
+            report.latency = s.latency;
+        }
+    };
+
+    template<typename T>
+    class SinkStage : public InputStage<T> {
+        std::function<void(const T&)> fn_;
+      public:
+        SinkStage(Pipeline &pipeline, const std::string &name,
+            unsigned workers, std::shared_ptr<Channel<T>> input,
+            std::function<void(const T&)> fn)
+            : InputStage<T>(pipeline, name, workers, input),
+              fn_(std::move(fn)) { }
+        void work() override {
+            this->drain([this](const T &item) { fn_(item); });
+        }
+        void finish() override { }
+    };
+
+    template<typename T, typename U>
+    class TransformStage : public InputStage<T> {
+        std::shared_ptr<Output<U>> output_;
+        std::function<void(const T&, Emitter<U>&)> fn_;
+      public:
+        TransformStage(Pipeline &pipeline, const std::string &name,
+            unsigned workers, std::shared_ptr<Channel<T>> input,
+            std::shared_ptr<Output<U>> output,
+            std::function<void(const T&, Emitter<U>&)> fn)
+            : InputStage<T>(pipeline, name, workers, input),
+              output_(output), fn_(std::move(fn)) { }
+        void work() override {
+            Emitter<U> emit(*output_, *this);
+            this->drain([&](const T &item) { fn_(item, emit); });
+        }
+        void finish() override { output_->finish(); }
+    };
+
+    void check_building() const;
+    void add(Stage *stage);
+    // Records the first exception of a stage function and cancels.
+    void fail(std::exception_ptr error);
+
+    const size_t capacity_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    enum { building, running, joined } state_;
+    uint64_t start_ns_;
+    std::atomic<bool> cancelled_;
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+#endif // CPP11_PIPELINE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,19 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/priorityqueue.cc Message queues ordered by priority or by
+ *       deadline.
+ */
+
+#include "cpp11/priorityqueue.h"
+
+#include <string>
+
+// Just to check compilation of all members, trivial instantiation.
+template class PriorityQueue<std::string>;
+template class DaryHeap<int, 4>;
+template class DeadlineQueue<std::string>;
+
+/* vim: set ts=4 sw=4 tw=76: */
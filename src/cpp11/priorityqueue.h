@@ -0,0 +1,242 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/priorityqueue.h Message queues ordered by priority or by
+ *       deadline, with the add()/get() interface of Queue.
+ *
+ * \code
+ * PriorityQueue<Message> queue;
+ * queue.add("bulk");     // lowest priority lane
+ * queue.add("STOP", 0);  // overtakes all bulk traffic
+ *
+ * DeadlineQueue<Message> edf;
+ * edf.add("soon", std::chrono::steady_clock::now() + deadline);
+ * \endcode
+ */
+
+#ifndef CPP11_PRIORITYQUEUE_H
+#define CPP11_PRIORITYQUEUE_H 1
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * A synchronized queue with a small fixed number of FIFO lanes, lane 0
+ * being the most urgent one. A bit mask of non-empty lanes makes add()
+ * and get() O(1): get() takes from the lowest set bit.
+ */
+template<typename Message, unsigned Lanes=4>
+class PriorityQueue {
+    static_assert(Lanes >= 1 && Lanes <= 32, "1 to 32 lanes supported");
+
+    std::deque<Message> lanes_[Lanes];
+    uint32_t nonempty_;
+    size_t size_;
+    std::condition_variable mcond_;
+    std::mutex mmutex_;
+
+    Message pop() {
+        const unsigned lane = __builtin_ctz(nonempty_);
+        Message m = std::move(lanes_[lane].front());
+        lanes_[lane].pop_front();
+        if (lanes_[lane].empty()) {
+            nonempty_ &= ~(1u << lane);
+        }
+        --size_;
+        return m;
+    }
+
+  public:
+    static constexpr unsigned lanes = Lanes;
+    static constexpr unsigned lowest = Lanes-1;
+
+    PriorityQueue() : nonempty_(0), size_(0) { }
+
+    /// Adds \a m to lane \a priority; throws std::out_of_range if there
+    /// is no such lane. Without priority, m is bulk (lowest priority).
+    void add(const Message &m, unsigned priority=lowest) {
+        if (priority >= Lanes) {
+            throw std::out_of_range("PriorityQueue::add priority");
+        }
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        lanes_[priority].push_back(m);
+        nonempty_ |= 1u << priority;
+        ++size_;
+        mcond_.notify_one();
+    }
+
+    /// Removes the oldest message of the most urgent non-empty lane,
+    /// waits while the queue is empty.
+    Message get() {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        mcond_.wait(lock, [this] { return nonempty_ != 0; });
+        return pop();
+    }
+
+    bool try_get(Message &m) {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        if (nonempty_ == 0) {
+            return false;
+        }
+        m = pop();
+        return true;
+    }
+
+    size_t size() {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        return size_;
+    }
+};
+
+template<typename Message, unsigned Lanes>
+constexpr unsigned PriorityQueue<Message, Lanes>::lanes;
+template<typename Message, unsigned Lanes>
+constexpr unsigned PriorityQueue<Message, Lanes>::lowest;
+
+/**
+ * A d-ary min-heap (the top is the smallest element by Compare) in a
+ * vector. Compared to a binary heap (D=2), a 4-ary heap halves the tree
+ * height and keeps the children of a node within one cache line, so
+ * pushes get cheaper and pops touch fewer lines.
+ */
+template<typename T, unsigned D=4, typename Compare=std::less<T>>
+class DaryHeap {
+    static_assert(D >= 2, "a heap needs at least two children per node");
+
+    std::vector<T> heap_;
+    Compare less_;
+
+    void sift_up(size_t i) {
+        T value = std::move(heap_[i]);
+        while (i > 0) {
+            size_t parent = (i-1) / D;
+            if (!less_(value, heap_[parent])) {
+                break;
+            }
+            heap_[i] = std::move(heap_[parent]);
+            i = parent;
+        }
+        heap_[i] = std::move(value);
+    }
+
+    void sift_down(size_t i) {
+        const size_t n = heap_.size();
+        T value = std::move(heap_[i]);
+        for (;;) {
+            size_t first = i*D + 1;
+            if (first >= n) {
+                break;
+            }
+            size_t last = std::min(first + D, n);
+            size_t best = first;
+            for (size_t c=first+1; c<last; ++c) {
+                if (less_(heap_[c], heap_[best])) {
+                    best = c;
+                }
+            }
+            if (!less_(heap_[best], value)) {
+                break;
+            }
+            heap_[i] = std::move(heap_[best]);
+            i = best;
+        }
+        heap_[i] = std::move(value);
+    }
+
+  public:
+    explicit DaryHeap(Compare less=Compare()) : less_(less) { }
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+    const T &top() const { return heap_.front(); }
+
+    void push(T value) {
+        heap_.push_back(std::move(value));
+        sift_up(heap_.size()-1);
+    }
+
+    /// Removes and returns the top element; heap must not be empty.
+    T pop() {
+        T top = std::move(heap_.front());
+        if (heap_.size() > 1) {
+            heap_.front() = std::move(heap_.back());
+            heap_.pop_back();
+            sift_down(0);
+        } else {
+            heap_.pop_back();
+        }
+        return top;
+    }
+};
+
+/**
+ * A synchronized earliest-deadline-first queue: get() returns the message
+ * with the earliest deadline, messages with equal deadlines in FIFO
+ * order. Messages without a deadline sort after all others.
+ */
+template<typename Message, unsigned D=4>
+class DeadlineQueue {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Deadline = Clock::time_point;
+
+  private:
+    struct Entry {
+        Deadline deadline;
+        uint64_t seq;
+        Message message;
+        bool operator<(const Entry &e) const {
+            return deadline < e.deadline
+                || (deadline == e.deadline && seq < e.seq);
+        }
+    };
+
+    DaryHeap<Entry, D> heap_;
+    uint64_t seq_;
+    std::condition_variable mcond_;
+    std::mutex mmutex_;
+
+  public:
+    DeadlineQueue() : seq_(0) { }
+
+    void add(const Message &m, Deadline deadline=Deadline::max()) {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        heap_.push(Entry { deadline, seq_++, m });
+        mcond_.notify_one();
+    }
+
+    /// Removes the most urgent message, waits while the queue is empty.
+    Message get() {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        mcond_.wait(lock, [this] { return !heap_.empty(); });
+        return heap_.pop().message;
+    }
+
+    bool try_get(Message &m) {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        if (heap_.empty()) {
+            return false;
+        }
+        m = heap_.pop().message;
+        return true;
+    }
+
+    size_t size() {
+        std::unique_lock<std::mutex> lock { mmutex_ };
+        return heap_.size();
+    }
+};
+
+#endif // CPP11_PRIORITYQUEUE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
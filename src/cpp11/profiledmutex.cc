@@ -0,0 +1,116 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/profiledmutex.cc A std::mutex recording lock contention.
+ */
+
+#include "cpp11/profiledmutex.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace {
+
+// The registry of profiles by name. Allocated once and never destroyed,
+// so mutexes with static storage duration may still use it at exit.
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<LockProfile>> profiles;
+};
+
+Registry &registry()
+{
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+} // namespace
+
+std::shared_ptr<LockProfile> LockProfile::get(const std::string &name)
+{
+    Registry &r = registry();
+    std::unique_lock<std::mutex> lock { r.mutex };
+    std::shared_ptr<LockProfile> &profile = r.profiles[name];
+    if (!profile) {
+        profile = std::make_shared<LockProfile>(name);
+    }
+    return profile;
+}
+
+LockProfile::Snapshot LockProfile::snapshot() const
+{
+    Snapshot s;
+    s.name = name_;
+    s.wait = wait_.snapshot();
+    s.hold = hold_.snapshot();
+    return s;
+}
+
+std::vector<LockProfile::Snapshot> LockProfile::report(size_t top)
+{
+    std::vector<std::shared_ptr<LockProfile>> profiles;
+    {
+        Registry &r = registry();
+        std::unique_lock<std::mutex> lock { r.mutex };
+        for (auto &entry: r.profiles) {
+            profiles.push_back(entry.second);
+        }
+    }
+    std::vector<Snapshot> result;
+    for (auto &profile: profiles) {
+        Snapshot s = profile->snapshot();
+        if (s.acquisitions()) {
+            result.push_back(std::move(s));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(),
+        [](const Snapshot &a, const Snapshot &b) {
+            if (a.wait.sum() != b.wait.sum()) {
+                return a.wait.sum() > b.wait.sum();
+            }
+            return a.contended() > b.contended();
+        });
+    if (top && result.size() > top) {
+        result.resize(top);
+    }
+    return result;
+}
+
+std::string LockProfile::Snapshot::to_text() const
+{
+    std::ostringstream out;
+    out << name << ": acquisitions=" << acquisitions()
+        << " contended=" << contended()
+        << " wait " << wait.to_text("ns")
+        << " hold " << hold.to_text("ns");
+    return out.str();
+}
+
+std::string LockProfile::report_text(size_t top)
+{
+    std::ostringstream out;
+    out << std::left << std::setw(24) << "lock" << std::right
+        << std::setw(12) << "acquired" << std::setw(8) << "cont%"
+        << std::setw(12) << "wait ms" << std::setw(12) << "wait p99"
+        << std::setw(12) << "hold p50" << std::setw(12) << "hold p99"
+        << "\n";
+    for (const Snapshot &s: report(top)) {
+        out << std::left << std::setw(24) << s.name << std::right
+            << std::setw(12) << s.acquisitions()
+            << std::fixed << std::setprecision(1)
+            << std::setw(8) << 100.0 * s.contention()
+            << std::setprecision(3)
+            << std::setw(12) << s.wait.sum() / 1e6
+            << std::setw(10) << s.wait.quantile(0.99) << "ns"
+            << std::setw(10) << s.hold.quantile(0.5) << "ns"
+            << std::setw(10) << s.hold.quantile(0.99) << "ns"
+            << "\n";
+    }
+    return out.str();
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,144 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/profiledmutex.h A std::mutex recording lock contention.
+ *
+ * ProfiledMutex is Lockable, so it works with std::unique_lock,
+ * std::lock_guard and std::lock. Each one has a name; all mutexes of
+ * the same name share one LockProfile (for example the per-object
+ * mutexes of a class), which keeps counting after the mutexes are gone.
+ *
+ * lock() first tries try_lock(): an uncontended acquisition costs two
+ * clock reads and a per-thread histogram update, only a contended one
+ * measures its wait time.
+ *
+ * \code
+ * ProfiledMutex mutex { "cache" };
+ * {
+ *     std::unique_lock<ProfiledMutex> lock { mutex };
+ *     ...
+ * }
+ * std::cout << LockProfile::report_text(10);  // the ten hottest locks
+ * \endcode
+ */
+
+#ifndef CPP11_PROFILEDMUTEX_H
+#define CPP11_PROFILEDMUTEX_H 1
+
+#include "cpp11/histogram.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Contention statistics of the locks of one name, obtained by get().
+ */
+class LockProfile {
+  public:
+    /// A merged copy of the statistics.
+    struct Snapshot {
+        std::string name;
+        Histogram wait;  // contended acquisitions, time waited in ns
+        Histogram hold;  // all acquisitions, time held in ns
+
+        uint64_t acquisitions() const { return hold.count(); }
+        uint64_t contended() const { return wait.count(); }
+        /// Fraction of the acquisitions that had to wait.
+        double contention() const {
+            return acquisitions()
+                ? static_cast<double>(contended()) / acquisitions() : 0.0;
+        }
+        /// One line with counts and wait and hold quantiles.
+        std::string to_text() const;
+    };
+
+    /// The profile for \a name, created on first use; never destroyed.
+    static std::shared_ptr<LockProfile> get(const std::string &name);
+
+    /**
+     * Snapshots of all profiles with at least one acquisition, hottest
+     * first: ranked by the total time waited, then by the number of
+     * contended acquisitions. Returns at most \a top entries unless 0.
+     */
+    static std::vector<Snapshot> report(size_t top=0);
+    /// report() as a table, a line per lock.
+    static std::string report_text(size_t top=0);
+
+    explicit LockProfile(const std::string &name) : name_(name) { }
+    LockProfile(const LockProfile &)=delete;
+    LockProfile &operator=(const LockProfile &)=delete;
+
+    const std::string &name() const { return name_; }
+    void waited(uint64_t ns) { wait_.record(ns); }
+    void held(uint64_t ns) { hold_.record(ns); }
+    Snapshot snapshot() const;
+
+  private:
+    const std::string name_;
+    PerThreadHistogram wait_;
+    PerThreadHistogram hold_;
+};
+
+/**
+ * A std::mutex recording wait and hold times into the LockProfile of its
+ * name.
+ */
+class ProfiledMutex {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ProfiledMutex(const std::string &name)
+        : profile_(LockProfile::get(name)) { }
+    ProfiledMutex(const ProfiledMutex &)=delete;
+    ProfiledMutex &operator=(const ProfiledMutex &)=delete;
+
+    void lock() {
+        if (!mutex_.try_lock()) {
+            const Clock::time_point start = Clock::now();
+            mutex_.lock();
+            locked_at_ = Clock::now();
+            profile_->waited(nanoseconds(start, locked_at_));
+            return;
+        }
+        locked_at_ = Clock::now();
+    }
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        locked_at_ = Clock::now();
+        return true;
+    }
+    void unlock() {
+        // locked_at_ belongs to the next owner once unlocked.
+        const Clock::time_point locked_at = locked_at_;
+        mutex_.unlock();
+        profile_->held(nanoseconds(locked_at, Clock::now()));
+    }
+
+    const std::string &name() const { return profile_->name(); }
+    LockProfile &profile() { return *profile_; }
+
+  private:
+    static uint64_t nanoseconds(Clock::time_point from,
+        Clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            to - from).count();
+    }
+
+    std::mutex mutex_;
+    // Written and read only by the thread holding mutex_.
+    Clock::time_point locked_at_;
+    const std::shared_ptr<LockProfile> profile_;
+};
+
+#endif // CPP11_PROFILEDMUTEX_H
+
+/* vim: set ts=4 sw=4 tw=76: */
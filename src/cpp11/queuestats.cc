@@ -0,0 +1,34 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/queuestats.cc Instrumentation policies for Queue.
+ */
+
+#include "cpp11/queuestats.h"
+
+QueueStats::Snapshot QueueStats::snapshot() const
+{
+    Snapshot s;
+    s.latency = latency_.snapshot();
+    s.depth = depth_.snapshot();
+    s.wait = wait_.snapshot();
+    return s;
+}
+
+std::string QueueStats::Snapshot::to_text() const
+{
+    return "latency: " + latency.to_text("ns") + "\n"
+         + "depth:   " + depth.to_text() + "\n"
+         + "wait:    " + wait.to_text("ns") + "\n";
+}
+
+std::string QueueStats::Snapshot::to_json() const
+{
+    return "{\"latency_ns\":" + latency.to_json()
+         + ",\"depth\":" + depth.to_json()
+         + ",\"wait_ns\":" + wait.to_json() + "}";
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
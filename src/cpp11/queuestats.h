@@ -0,0 +1,118 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/queuestats.h Instrumentation policies for Queue.
+ *
+ * Queue calls its Stats policy at a few points:
+ *
+ * - stamp() before add() takes the lock, the returned Stamp is stored
+ *   together with the message,
+ * - added(depth) after add(), with the queue depth including the message,
+ * - begin_wait() when get() has to wait and end_wait() when it got a
+ *   message,
+ * - removed(stamp) after get() with the stamp stored by add().
+ *
+ * NoQueueStats does nothing (its Stamp is empty and costs no space).
+ * QueueStats records into per-thread histograms, but only after enable();
+ * while disabled each call costs one relaxed load of a flag.
+ *
+ * \code
+ * Queue<Message> queue;
+ * queue.stats().enable();
+ * ...
+ * std::cout << queue.stats().snapshot().to_text();
+ * \endcode
+ */
+
+#ifndef CPP11_QUEUESTATS_H
+#define CPP11_QUEUESTATS_H 1
+
+#include "cpp11/histogram.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/// Stats policy compiling all instrumentation out.
+struct NoQueueStats {
+    struct Stamp { };
+    struct WaitStamp { };
+
+    Stamp stamp() { return Stamp(); }
+    void added(size_t) { }
+    void removed(const Stamp &) { }
+    WaitStamp begin_wait() { return WaitStamp(); }
+    void end_wait(const WaitStamp &) { }
+};
+
+/// Stats policy recording latency, depth and wait time histograms.
+class QueueStats {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Time of add(), the epoch if the stats were disabled then.
+    struct Stamp {
+        Clock::time_point added;
+    };
+    using WaitStamp = Clock::time_point;
+
+    /// A merged copy of all histograms.
+    struct Snapshot {
+        Histogram latency; // add() to get(), in nanoseconds
+        Histogram depth;   // queue depth seen by add(), in messages
+        Histogram wait;    // time get() waited, in nanoseconds
+
+        std::string to_text() const;
+        std::string to_json() const;
+    };
+
+    QueueStats() : enabled_{false} { }
+
+    void enable(bool on=true) {
+        enabled_.store(on, std::memory_order_relaxed);
+    }
+    bool enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const;
+
+    Stamp stamp() {
+        return Stamp { enabled() ? Clock::now() : Clock::time_point() };
+    }
+    void added(size_t depth) {
+        if (enabled()) {
+            depth_.record(depth);
+        }
+    }
+    void removed(const Stamp &stamp) {
+        if (stamp.added != Clock::time_point()) {
+            latency_.record(nanoseconds_since(stamp.added));
+        }
+    }
+    WaitStamp begin_wait() {
+        return enabled() ? Clock::now() : Clock::time_point();
+    }
+    void end_wait(const WaitStamp &start) {
+        if (start != Clock::time_point()) {
+            wait_.record(nanoseconds_since(start));
+        }
+    }
+
+  private:
+    static uint64_t nanoseconds_since(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start).count();
+    }
+
+    std::atomic<bool> enabled_;
+    PerThreadHistogram latency_;
+    PerThreadHistogram depth_;
+    PerThreadHistogram wait_;
+};
+
+#endif // CPP11_QUEUESTATS_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,281 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/reclaim.cc Safe memory reclamation for lock-free
+ *       structures: epochs and hazard pointers.
+ */
+
+#include "cpp11/reclaim.h"
+
+#include <algorithm>
+
+using reclaim_detail::Retired;
+
+struct EpochDomain::Record {
+    std::atomic<bool> in_use;
+    // (epoch << 1) | 1 while inside a Guard, 0 outside.
+    std::atomic<uint64_t> state;
+    // Touched only by the thread owning in_use.
+    std::vector<Retired> retired;
+    Record *next;
+
+    Record() : in_use{true}, state{0}, next(nullptr) { }
+};
+
+struct HazardDomain::Record {
+    std::atomic<bool> in_use;
+    std::atomic<void*> hazards[HazardDomain::slots];
+    std::vector<Retired> retired;
+    Record *next;
+
+    Record() : in_use{true}, next(nullptr) {
+        for (auto &h: hazards) {
+            h.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+namespace {
+
+std::atomic<uint64_t> next_domain_id { 1 };
+
+// Per-thread cache of the record a thread used last in a domain, by
+// domain id (never reused, so entries of dead domains never match).
+struct RecordCache {
+    static constexpr size_t size = 8;
+    uint64_t ids[size];
+    void *records[size];
+};
+thread_local RecordCache record_cache {};
+
+template<typename Record>
+bool claim(Record *record)
+{
+    bool expected = false;
+    return !record->in_use.load(std::memory_order_relaxed)
+        && record->in_use.compare_exchange_strong(expected, true,
+            std::memory_order_acquire);
+}
+
+template<typename Record>
+void release(Record *record)
+{
+    record->in_use.store(false, std::memory_order_release);
+}
+
+// Claims a free record of the domain, preferably the one the thread
+// used last, or adds a new one. Records are only freed with the domain.
+template<typename Record>
+Record *acquire(std::atomic<Record*> &records, uint64_t id, bool &created)
+{
+    created = false;
+    const size_t slot = id % RecordCache::size;
+    if (record_cache.ids[slot] == id) {
+        Record *record = static_cast<Record*>(record_cache.records[slot]);
+        if (claim(record)) {
+            return record;
+        }
+    }
+    Record *record = records.load(std::memory_order_acquire);
+    while (record && !claim(record)) {
+        record = record->next;
+    }
+    if (!record) {
+        record = new Record;
+        record->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(record->next, record,
+                std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        created = true;
+    }
+    record_cache.ids[slot] = id;
+    record_cache.records[slot] = record;
+    return record;
+}
+
+template<typename Record>
+void destroy_records(std::atomic<Record*> &records)
+{
+    Record *record = records.load();
+    while (record) {
+        Record *next = record->next;
+        for (const Retired &r: record->retired) {
+            r.destroy();
+        }
+        delete record;
+        record = next;
+    }
+}
+
+} // namespace
+
+EpochDomain::Guard::Guard(EpochDomain &domain)
+    : domain_(domain)
+{
+    bool created;
+    record_ = acquire(domain.records_, domain.id_, created);
+    // Pin an epoch that was current after the pin became visible.
+    uint64_t epoch = domain.epoch_.load();
+    for (;;) {
+        record_->state.store((epoch << 1) | 1);
+        const uint64_t now = domain.epoch_.load();
+        if (now == epoch) {
+            break;
+        }
+        epoch = now;
+    }
+}
+
+EpochDomain::Guard::~Guard()
+{
+    record_->state.store(0, std::memory_order_release);
+    release(record_);
+}
+
+EpochDomain::EpochDomain(size_t threshold)
+    : id_(next_domain_id.fetch_add(1)), threshold_(std::max<size_t>(1,
+        threshold)), epoch_{0}, pending_{0}, records_{nullptr}
+{ }
+
+EpochDomain::~EpochDomain()
+{
+    destroy_records(records_);
+}
+
+void EpochDomain::retire(Record &record, void (*deleter)(void *),
+    void *object)
+{
+    record.retired.push_back(Retired { object, deleter, epoch_.load() });
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    if (record.retired.size() >= threshold_) {
+        try_advance();
+        reclaim(record);
+    }
+}
+
+bool EpochDomain::try_advance()
+{
+    uint64_t epoch = epoch_.load();
+    for (Record *r = records_.load(std::memory_order_acquire); r;
+            r = r->next) {
+        const uint64_t state = r->state.load();
+        if ((state & 1) && (state >> 1) != epoch) {
+            return false;
+        }
+    }
+    return epoch_.compare_exchange_strong(epoch, epoch + 1);
+}
+
+void EpochDomain::reclaim(Record &record)
+{
+    const uint64_t epoch = epoch_.load();
+    auto gone = std::partition(record.retired.begin(),
+        record.retired.end(),
+        [epoch](const Retired &r) { return r.epoch + 2 > epoch; });
+    for (auto it=gone; it!=record.retired.end(); ++it) {
+        it->destroy();
+    }
+    pending_.fetch_sub(record.retired.end() - gone,
+        std::memory_order_relaxed);
+    record.retired.erase(gone, record.retired.end());
+}
+
+void EpochDomain::collect()
+{
+    try_advance();
+    try_advance();
+    for (Record *r = records_.load(std::memory_order_acquire); r;
+            r = r->next) {
+        if (claim(r)) {
+            reclaim(*r);
+            release(r);
+        }
+    }
+}
+
+HazardDomain::Guard::Guard(HazardDomain &domain)
+    : domain_(domain)
+{
+    bool created;
+    record_ = acquire(domain.records_, domain.id_, created);
+    if (created) {
+        domain.record_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+HazardDomain::Guard::~Guard()
+{
+    for (auto &h: record_->hazards) {
+        h.store(nullptr, std::memory_order_release);
+    }
+    release(record_);
+}
+
+void HazardDomain::Guard::set(size_t slot, void *p)
+{
+    record_->hazards[slot].store(p);
+}
+
+HazardDomain::HazardDomain(size_t threshold)
+    : id_(next_domain_id.fetch_add(1)), threshold_(std::max<size_t>(1,
+        threshold)), pending_{0}, record_count_{0}, records_{nullptr}
+{ }
+
+HazardDomain::~HazardDomain()
+{
+    destroy_records(records_);
+}
+
+void HazardDomain::retire(Record &record, void (*deleter)(void *),
+    void *object)
+{
+    record.retired.push_back(Retired { object, deleter, 0 });
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    // Scanning only after twice the possible hazards makes sure that a
+    // scan frees at least half of the list: amortized constant cost.
+    const size_t hazards =
+        slots * record_count_.load(std::memory_order_relaxed);
+    if (record.retired.size() >= std::max(threshold_, 2 * hazards)) {
+        scan(record);
+    }
+}
+
+void HazardDomain::scan(Record &record)
+{
+    std::vector<void*> hazards;
+    for (Record *r = records_.load(std::memory_order_acquire); r;
+            r = r->next) {
+        for (auto &h: r->hazards) {
+            if (void *p = h.load()) {
+                hazards.push_back(p);
+            }
+        }
+    }
+    std::sort(hazards.begin(), hazards.end());
+    auto gone = std::partition(record.retired.begin(),
+        record.retired.end(), [&hazards](const Retired &r) {
+            return std::binary_search(hazards.begin(), hazards.end(),
+                r.object);
+        });
+    for (auto it=gone; it!=record.retired.end(); ++it) {
+        it->destroy();
+    }
+    pending_.fetch_sub(record.retired.end() - gone,
+        std::memory_order_relaxed);
+    record.retired.erase(gone, record.retired.end());
+}
+
+void HazardDomain::collect()
+{
+    for (Record *r = records_.load(std::memory_order_acquire); r;
+            r = r->next) {
+        if (claim(r)) {
+            scan(*r);
+            release(r);
+        }
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
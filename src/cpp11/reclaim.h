@@ -0,0 +1,202 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/reclaim.h Safe memory reclamation for lock-free
+ *       structures: epochs and hazard pointers.
+ *
+ * A thread that unlinks a node from a lock-free structure cannot delete
+ * it right away, another thread may just be reading it. Instead it
+ * retires the node to a domain, which deletes it once no thread can
+ * still hold a pointer to it.
+ *
+ * Both domains have the same interface, so structures take the domain
+ * as a template argument (see lockfree.h):
+ *
+ * \code
+ * Domain::Guard guard { domain };       // per operation
+ * Node *head = guard.protect(0, head_); // safe to dereference now
+ * ...
+ * guard.retire(head);                   // after unlinking it
+ * \endcode
+ *
+ * EpochDomain: protect() is a plain load, entering a Guard costs a
+ * store and a fence. A thread stalled inside a Guard delays all
+ * reclamation, so garbage is only bounded while threads make progress.
+ *
+ * HazardDomain: protect() publishes each pointer (a store, a fence and
+ * a reload), but a stalled thread only keeps the nodes alive it
+ * protects, so garbage is bounded always: per thread at most the scan
+ * threshold plus the number of hazard pointers.
+ */
+
+#ifndef CPP11_RECLAIM_H
+#define CPP11_RECLAIM_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reclaim_detail {
+
+// A retired object and how to delete it.
+struct Retired {
+    void *object;
+    void (*deleter)(void *);
+    uint64_t epoch; // EpochDomain only
+
+    void destroy() const { deleter(object); }
+};
+
+template<typename T>
+void delete_object(void *object)
+{
+    delete static_cast<T*>(object);
+}
+
+} // namespace reclaim_detail
+
+/**
+ * Epoch based reclamation: objects retired in epoch e are deleted once
+ * the global epoch reached e+2, which requires all threads inside a
+ * Guard to have seen epoch e+1.
+ */
+class EpochDomain {
+    struct Record;
+  public:
+    /// Pins the current epoch for the lifetime of the guard.
+    class Guard {
+      public:
+        explicit Guard(EpochDomain &domain);
+        ~Guard();
+        Guard(const Guard &)=delete;
+        Guard &operator=(const Guard &)=delete;
+
+        /// Loads \a source; the result stays valid while the guard
+        /// lives. \a slot is ignored (see HazardDomain).
+        template<typename T>
+        T *protect(size_t, const std::atomic<T*> &source) {
+            return source.load(std::memory_order_acquire);
+        }
+        void clear(size_t) { }
+
+        /// Deletes \a object once no guard can reference it anymore.
+        template<typename T>
+        void retire(T *object) {
+            domain_.retire(*record_,
+                reclaim_detail::delete_object<T>, object);
+        }
+
+      private:
+        EpochDomain &domain_;
+        Record *record_;
+    };
+
+    /// Tries to reclaim after \a threshold retires per thread.
+    explicit EpochDomain(size_t threshold=64);
+    /// Deletes all retired objects; no Guard may be alive.
+    ~EpochDomain();
+    EpochDomain(const EpochDomain &)=delete;
+    EpochDomain &operator=(const EpochDomain &)=delete;
+
+    /// Number of retired objects not deleted yet.
+    size_t pending() const {
+        return pending_.load(std::memory_order_relaxed);
+    }
+    /// Deletes what can be deleted, also garbage left by threads that
+    /// are gone. Must not be called inside a Guard.
+    void collect();
+
+    uint64_t epoch() const { return epoch_.load(); }
+
+  private:
+    void retire(Record &record, void (*deleter)(void *), void *object);
+    // Advances the epoch if all active records are in the current one.
+    bool try_advance();
+    void reclaim(Record &record);
+
+    const uint64_t id_;
+    const size_t threshold_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<size_t> pending_;
+    std::atomic<Record*> records_;
+};
+
+/**
+ * Hazard pointer reclamation: each Guard owns a few hazard pointers
+ * (slots) announcing the objects it uses; retired objects are deleted
+ * when no hazard pointer holds them.
+ */
+class HazardDomain {
+    struct Record;
+  public:
+    /// Hazard pointers per Guard.
+    static constexpr size_t slots = 2;
+
+    /// Owns slots hazard pointers for its lifetime.
+    class Guard {
+      public:
+        explicit Guard(HazardDomain &domain);
+        ~Guard();
+        Guard(const Guard &)=delete;
+        Guard &operator=(const Guard &)=delete;
+
+        /// Loads \a source and protects the result with hazard pointer
+        /// \a slot, until the slot is reused or cleared.
+        template<typename T>
+        T *protect(size_t slot, const std::atomic<T*> &source) {
+            T *p = source.load(std::memory_order_relaxed);
+            for (;;) {
+                set(slot, p);
+                T *again = source.load();
+                if (again == p) {
+                    return p;
+                }
+                p = again;
+            }
+        }
+        void clear(size_t slot) { set(slot, nullptr); }
+
+        /// Deletes \a object once no hazard pointer holds it.
+        template<typename T>
+        void retire(T *object) {
+            domain_.retire(*record_,
+                reclaim_detail::delete_object<T>, object);
+        }
+
+      private:
+        void set(size_t slot, void *p);
+
+        HazardDomain &domain_;
+        Record *record_;
+    };
+
+    /// Scans the hazard pointers after \a threshold retires per thread
+    /// (at least twice the number of hazard pointers in use).
+    explicit HazardDomain(size_t threshold=64);
+    /// Deletes all retired objects; no Guard may be alive.
+    ~HazardDomain();
+    HazardDomain(const HazardDomain &)=delete;
+    HazardDomain &operator=(const HazardDomain &)=delete;
+
+    size_t pending() const {
+        return pending_.load(std::memory_order_relaxed);
+    }
+    void collect();
+
+  private:
+    void retire(Record &record, void (*deleter)(void *), void *object);
+    void scan(Record &record);
+
+    const uint64_t id_;
+    const size_t threshold_;
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> record_count_;
+    std::atomic<Record*> records_;
+};
+
+#endif // CPP11_RECLAIM_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,99 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/rwlock.cc Synchronization for data read often and written
+ *       rarely.
+ */
+
+#include "cpp11/rwlock.h"
+
+#include "cpp11/waitstrategy.h"
+
+namespace {
+
+// Threads get consecutive numbers, so up to slots() threads each have a
+// counter of their own.
+std::atomic<size_t> next_thread_number { 0 };
+thread_local size_t thread_number = next_thread_number.fetch_add(1);
+
+} // namespace
+
+DistributedRWLock::DistributedRWLock(size_t slots)
+{
+    if (!slots) {
+        slots = std::thread::hardware_concurrency();
+    }
+    size_t size = 1;
+    while (size < slots) {
+        size *= 2;
+    }
+    readers_.reset(new CacheAligned<std::atomic<long>>[size]);
+    mask_ = size - 1;
+    for (size_t i=0; i<size; ++i) {
+        readers_[i].value.store(0, std::memory_order_relaxed);
+    }
+    writer_.value.store(false, std::memory_order_relaxed);
+}
+
+size_t DistributedRWLock::slot() const
+{
+    return thread_number & mask_;
+}
+
+void DistributedRWLock::wait_for_writer() const
+{
+    for (unsigned n=0; writer_.value.load(std::memory_order_relaxed); ++n) {
+        if (n < 64) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool DistributedRWLock::readers_gone() const
+{
+    for (size_t i=0; i<=mask_; ++i) {
+        if (readers_[i].value.load() != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DistributedRWLock::lock()
+{
+    writers_.lock();
+    writer_.value.store(true);
+    for (unsigned n=0; !readers_gone(); ++n) {
+        if (n < 64) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool DistributedRWLock::try_lock()
+{
+    if (!writers_.try_lock()) {
+        return false;
+    }
+    writer_.value.store(true);
+    if (!readers_gone()) {
+        writer_.value.store(false);
+        writers_.unlock();
+        return false;
+    }
+    return true;
+}
+
+void DistributedRWLock::unlock()
+{
+    writer_.value.store(false, std::memory_order_release);
+    writers_.unlock();
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
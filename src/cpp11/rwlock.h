@@ -0,0 +1,227 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/rwlock.h Synchronization for data read often and written
+ *       rarely.
+ *
+ * A reader-writer lock with a single reader count makes every reader
+ * write the same cache line, so readers on different cores slow each
+ * other down although they never block each other. DistributedRWLock
+ * gives each thread one of several counters on its own cache line;
+ * only the (rare) writer looks at all of them.
+ *
+ * SeqLock goes further for small trivially copyable values: readers do
+ * not write at all, they copy the value and retry if a writer was busy
+ * meanwhile.
+ *
+ * \code
+ * DistributedRWLock lock;
+ * {
+ *     ReadLock<DistributedRWLock> read { lock };
+ *     route = table.find(address);
+ * }
+ *
+ * SeqLock<Config> config { initial };
+ * Config c = config.load();
+ * config.store(updated);
+ * \endcode
+ */
+
+#ifndef CPP11_RWLOCK_H
+#define CPP11_RWLOCK_H 1
+
+#include "cpp11/cacheline.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+/**
+ * A reader-writer lock with a reader counter per slot (about one per
+ * core). Writers are preferred: once a writer waits, new readers wait
+ * for it, so a stream of readers cannot starve writers.
+ *
+ * Provides lock()/unlock() and lock_shared()/unlock_shared() as
+ * std::shared_mutex of C++ 2017 does; use std::unique_lock for writing
+ * and ReadLock for reading. Not recursive.
+ */
+class DistributedRWLock {
+  public:
+    /// \a slots reader counters, 0 for one per hardware thread (rounded
+    /// up to a power of two).
+    explicit DistributedRWLock(size_t slots=0);
+    DistributedRWLock(const DistributedRWLock &)=delete;
+    DistributedRWLock &operator=(const DistributedRWLock &)=delete;
+
+    void lock_shared() {
+        std::atomic<long> &readers = readers_[slot()].value;
+        for (;;) {
+            // Announce first, then check: the writer sets writer_ first,
+            // then checks the counters (both sequentially consistent),
+            // so at least one of both sees the other.
+            readers.fetch_add(1);
+            if (!writer_.value.load()) {
+                return;
+            }
+            readers.fetch_sub(1);
+            wait_for_writer();
+        }
+    }
+    bool try_lock_shared() {
+        std::atomic<long> &readers = readers_[slot()].value;
+        readers.fetch_add(1);
+        if (!writer_.value.load()) {
+            return true;
+        }
+        readers.fetch_sub(1);
+        return false;
+    }
+    void unlock_shared() {
+        readers_[slot()].value.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    size_t slots() const { return mask_ + 1; }
+
+  private:
+    // The slot of the calling thread, fixed per thread.
+    size_t slot() const;
+    void wait_for_writer() const;
+    bool readers_gone() const;
+
+    std::unique_ptr<CacheAligned<std::atomic<long>>[]> readers_;
+    size_t mask_;
+    CacheAligned<std::atomic<bool>> writer_;
+    // Serializes writers, held from lock() to unlock().
+    std::mutex writers_;
+};
+
+/// RAII shared ownership of a lock, as std::shared_lock of C++ 2014.
+template<typename Lock>
+class ReadLock {
+  public:
+    explicit ReadLock(Lock &lock) : lock_(lock) { lock_.lock_shared(); }
+    ~ReadLock() { lock_.unlock_shared(); }
+    ReadLock(const ReadLock &)=delete;
+    ReadLock &operator=(const ReadLock &)=delete;
+  private:
+    Lock &lock_;
+};
+
+/**
+ * A sequence lock protecting a value of trivially copyable type T.
+ *
+ * store() increments the sequence number to an odd value, writes and
+ * increments it to even again; load() copies the value and retries
+ * until the sequence was even and unchanged during the copy. Readers
+ * never block writers and write no shared memory. Best for small T
+ * (a few cache lines) and rare writes; concurrent writers serialize.
+ *
+ * The value is kept in relaxed atomic words, so that a torn read is no
+ * data race (it is discarded anyway).
+ */
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "SeqLock needs a trivially copyable type");
+  public:
+    SeqLock() : seq_{0} { write_words(T()); }
+    explicit SeqLock(const T &value) : seq_{0} { write_words(value); }
+    SeqLock(const SeqLock &)=delete;
+    SeqLock &operator=(const SeqLock &)=delete;
+
+    T load() const {
+        T value;
+        while (!try_load(value)) {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+
+    /// One attempt of load(); false if a writer interfered.
+    bool try_load(T &value) const {
+        const unsigned before = seq_.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        uint64_t copy[words];
+        for (size_t i=0; i<words; ++i) {
+            copy[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&value, copy, sizeof(T));
+        return true;
+    }
+
+    void store(const T &value) {
+        const unsigned seq = begin_write();
+        write_words(value);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// Replaces the value by \a f(value), atomically for other writers.
+    template<typename F>
+    void update(F f) {
+        const unsigned seq = begin_write();
+        T value;
+        uint64_t copy[words];
+        for (size_t i=0; i<words; ++i) {
+            copy[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, copy, sizeof(T));
+        write_words(f(value));
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// Number of completed writes.
+    unsigned version() const {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+  private:
+    static constexpr size_t words = (sizeof(T) + 7) / 8;
+
+    // Makes the sequence odd, waiting for a concurrent writer.
+    unsigned begin_write() {
+        unsigned seq = seq_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(seq & 1) && seq_.compare_exchange_weak(seq, seq + 1,
+                    std::memory_order_acquire)) {
+                break;
+            }
+            std::this_thread::yield();
+            seq = seq_.load(std::memory_order_relaxed);
+        }
+        // Readers seeing one of the following stores also see the odd
+        // sequence.
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    void write_words(const T &value) {
+        uint64_t copy[words] = { };
+        std::memcpy(copy, &value, sizeof(T));
+        for (size_t i=0; i<words; ++i) {
+            words_[i].store(copy[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<unsigned> seq_;
+    std::atomic<uint64_t> words_[words];
+};
+
+#endif // CPP11_RWLOCK_H
+
+/* vim: set ts=4 sw=4 tw=76: */
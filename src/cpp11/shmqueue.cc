@@ -0,0 +1,486 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/shmqueue.cc A message queue between processes in POSIX
+ *       shared memory.
+ */
+
+#include "cpp11/shmqueue.h"
+#include "cpp11/cacheline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "atomics in shared memory must not use hidden locks");
+
+// The start of the segment. Positions are byte counters, the offset in
+// the data area is position % capacity.
+struct ShmRing::Header {
+    std::atomic<uint64_t> magic;        // stored last when initialized
+    uint32_t version;
+    uint32_t header_size;               // data area offset
+    uint64_t capacity;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> recoveries;
+
+    // Written by the reader.
+    alignas(cache_line_size) std::atomic<uint64_t> read_pos;
+    std::atomic<uint32_t> space_seq;    // futex word of the writer
+    std::atomic<uint32_t> writer_waiting;
+
+    // Written by the writer.
+    alignas(cache_line_size) std::atomic<uint64_t> write_pos;
+    std::atomic<uint32_t> data_seq;     // futex word of the reader
+    std::atomic<uint32_t> reader_waiting;
+};
+
+constexpr size_t ShmRing::record_header;
+
+namespace {
+
+constexpr uint64_t shm_magic = 0x5145554d48533131ull;   // "11SHMUEQ"
+constexpr uint32_t shm_version = 1;
+constexpr size_t min_capacity = 4096;
+
+// Record kinds, 0 is never valid (fresh or overwritten memory).
+constexpr uint32_t record_data = 1;
+constexpr uint32_t record_wrap = 2;   // padding up to the end of the ring
+
+// How long a sleeping peer waits at most, so that a lost wake-up (peer
+// died) costs some latency but never a hang.
+constexpr long futex_timeout_ns = 100*1000*1000;
+
+uint64_t round_up8(uint64_t n) { return (n + 7) & ~uint64_t{7}; }
+
+uint64_t record_size(size_t size)
+{
+    return 8 + round_up8(size);
+}
+
+void futex_wait(std::atomic<uint32_t> &word, uint32_t expected)
+{
+#ifdef __linux__
+    timespec timeout { 0, futex_timeout_ns };
+    // Not FUTEX_PRIVATE_FLAG: the word is shared between processes.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT,
+        expected, &timeout, nullptr, 0);
+#else
+    if (word.load() == expected) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+#endif
+}
+
+void futex_wake(std::atomic<uint32_t> &word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE,
+        INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Spins and yields per strategy, then sleeps on seq until ready(). The
+// sleeper sets waiting so that the peer knows to call futex_wake().
+template<typename Ready>
+void wait_until(const WaitStrategy &strategy, Ready ready,
+    std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting)
+{
+    for (unsigned n=0; n<strategy.spins; ++n) {
+        if (ready()) return;
+        cpu_relax();
+    }
+    for (unsigned n=0; n<strategy.yields; ++n) {
+        if (ready()) return;
+        std::this_thread::yield();
+    }
+    while (!ready()) {
+        const uint32_t key = seq.load();
+        waiting.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready()) {
+            waiting.store(0);
+            return;
+        }
+        futex_wait(seq, key);
+        waiting.store(0);
+    }
+}
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+// Closes a file descriptor when leaving the scope.
+struct FdCloser {
+    int fd;
+    ~FdCloser() { ::close(fd); }
+};
+
+} // namespace
+
+ShmRing::ShmRing(const std::string &name, size_t capacity)
+    : name_(name), capacity_(capacity), header_(nullptr), data_(nullptr),
+      mapped_(0), strategy_(WaitStrategy::spin_then_park()),
+      cached_read_(0), cached_write_(0), peeked_end_(0)
+{
+    if (capacity < min_capacity || (capacity & (capacity - 1))) {
+        throw std::invalid_argument(
+            "ShmRing: capacity must be a power of two >= 4096");
+    }
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        FdCloser closer { fd };
+        initialize(fd);
+        return;
+    }
+    if (errno != EEXIST) {
+        throw_errno("ShmRing: shm_open " + name);
+    }
+    fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        throw_errno("ShmRing: shm_open " + name);
+    }
+    FdCloser closer { fd };
+    // The creator may still be initializing, give it some time. If it
+    // died on the way, take the segment over.
+    const auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::milliseconds{200};
+    while (std::chrono::steady_clock::now() < deadline) {
+        map(fd);
+        if (header_ && header_->magic.load(std::memory_order_acquire)
+            == shm_magic) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    if (!header_ || header_->magic.load() != shm_magic) {
+        initialize(fd);
+        return;
+    }
+    validate();
+    if (capacity_ != capacity) {
+        throw std::runtime_error("ShmRing: " + name
+            + " exists with another capacity");
+    }
+    recover();
+}
+
+ShmRing::ShmRing(const std::string &name)
+    : name_(name), capacity_(0), header_(nullptr), data_(nullptr),
+      mapped_(0), strategy_(WaitStrategy::spin_then_park()),
+      cached_read_(0), cached_write_(0), peeked_end_(0)
+{
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        throw_errno("ShmRing: shm_open " + name);
+    }
+    FdCloser closer { fd };
+    map(fd);
+    if (!header_
+        || header_->magic.load(std::memory_order_acquire) != shm_magic) {
+        throw std::runtime_error("ShmRing: " + name + " is not a ring");
+    }
+    validate();
+    recover();
+}
+
+ShmRing::~ShmRing()
+{
+    if (header_) {
+        ::munmap(header_, mapped_);
+    }
+}
+
+void ShmRing::unlink(const std::string &name)
+{
+    if (::shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+        throw_errno("ShmRing: shm_unlink " + name);
+    }
+}
+
+// Maps the whole segment if it is at least as large as the header.
+void ShmRing::map(int fd)
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw_errno("ShmRing: fstat " + name_);
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(Header) || size == mapped_) {
+        return;
+    }
+    if (header_) {
+        ::munmap(header_, mapped_);
+        header_ = nullptr;
+    }
+    void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd, 0);
+    if (p == MAP_FAILED) {
+        throw_errno("ShmRing: mmap " + name_);
+    }
+    header_ = static_cast<Header*>(p);
+    mapped_ = size;
+}
+
+void ShmRing::initialize(int fd)
+{
+    const size_t header_size =
+        (sizeof(Header) + cache_line_size - 1) & ~(cache_line_size - 1);
+    if (header_) {
+        header_->magic.store(0);
+    }
+    if (::ftruncate(fd, header_size + capacity_) != 0) {
+        throw_errno("ShmRing: ftruncate " + name_);
+    }
+    map(fd);
+    Header *h = header_;
+    h->version = shm_version;
+    h->header_size = header_size;
+    h->capacity = capacity_;
+    h->closed.store(0);
+    h->recoveries.store(0);
+    h->read_pos.store(0);
+    h->space_seq.store(0);
+    h->writer_waiting.store(0);
+    h->write_pos.store(0);
+    h->data_seq.store(0);
+    h->reader_waiting.store(0);
+    data_ = reinterpret_cast<char*>(h) + header_size;
+    h->magic.store(shm_magic, std::memory_order_release);
+}
+
+void ShmRing::validate()
+{
+    const Header *h = header_;
+    const uint64_t capacity = h->capacity;
+    if (h->version != shm_version || h->header_size < sizeof(Header)
+        || capacity < min_capacity || (capacity & (capacity - 1))
+        || mapped_ < h->header_size + capacity) {
+        throw std::runtime_error("ShmRing: " + name_ + " is not a ring");
+    }
+    capacity_ = capacity;
+    data_ = reinterpret_cast<char*>(header_) + h->header_size;
+}
+
+// The positions must be ordered, aligned and no further apart than the
+// capacity, and the records between them must be intact. If not, all
+// records are dropped.
+void ShmRing::recover()
+{
+    Header *h = header_;
+    const uint64_t read = h->read_pos.load();
+    const uint64_t write = h->write_pos.load();
+    bool ok = read <= write && write - read <= capacity_
+        && read % 8 == 0 && write % 8 == 0;
+    uint64_t pos = read;
+    while (ok && pos < write) {
+        const size_t offset = pos & (capacity_ - 1);
+        uint32_t record[2];
+        std::memcpy(record, data_ + offset, sizeof(record));
+        if (record[1] == record_wrap) {
+            pos += capacity_ - offset;
+        } else if (record[1] == record_data && record[0] <= max_record()
+            && offset + record_size(record[0]) <= capacity_) {
+            pos += record_size(record[0]);
+        } else {
+            ok = false;
+        }
+    }
+    if (ok && pos == write) {
+        return;
+    }
+    const uint64_t restart = round_up8(std::max(read, write));
+    h->write_pos.store(restart);
+    h->read_pos.store(restart);
+    h->recoveries.fetch_add(1);
+}
+
+bool ShmRing::try_write(const void *data, size_t size)
+{
+    if (size > max_record()) {
+        throw std::length_error("ShmRing: record too large");
+    }
+    if (closed()) {
+        throw std::logic_error("ShmRing: write to closed ring");
+    }
+    Header *h = header_;
+    const uint64_t need = record_size(size);
+    uint64_t pos = h->write_pos.load(std::memory_order_relaxed);
+    size_t offset = pos & (capacity_ - 1);
+    // A record never wraps; the rest of the ring is padding then.
+    const uint64_t pad = capacity_ - offset < need ? capacity_ - offset : 0;
+    if (pos + pad + need - cached_read_ > capacity_) {
+        cached_read_ = h->read_pos.load(std::memory_order_acquire);
+        if (pos + pad + need - cached_read_ > capacity_) {
+            return false;
+        }
+    }
+    if (pad) {
+        const uint32_t wrap[2] = { 0, record_wrap };
+        std::memcpy(data_ + offset, wrap, sizeof(wrap));
+        pos += pad;
+        offset = 0;
+    }
+    const uint32_t record[2] = { static_cast<uint32_t>(size), record_data };
+    std::memcpy(data_ + offset, record, sizeof(record));
+    std::memcpy(data_ + offset + record_header, data, size);
+    // Publishes the record (and the padding).
+    h->write_pos.store(pos + need, std::memory_order_release);
+    wake_reader();
+    return true;
+}
+
+void ShmRing::write(const void *data, size_t size)
+{
+    if (try_write(data, size)) {
+        return;
+    }
+    wait_until(strategy_, [&] { return try_write(data, size); },
+        header_->space_seq, header_->writer_waiting);
+}
+
+bool ShmRing::try_peek(const char *&data, size_t &size)
+{
+    const Header *h = header_;
+    uint64_t pos = h->read_pos.load(std::memory_order_relaxed);
+    // The cache may be behind pos if another object read meanwhile.
+    if (cached_write_ <= pos) {
+        cached_write_ = h->write_pos.load(std::memory_order_acquire);
+        if (cached_write_ <= pos) {
+            return false;
+        }
+    }
+    size_t offset = pos & (capacity_ - 1);
+    uint32_t record[2];
+    std::memcpy(record, data_ + offset, sizeof(record));
+    if (record[1] == record_wrap) {
+        pos += capacity_ - offset;
+        offset = 0;
+        std::memcpy(record, data_, sizeof(record));
+    }
+    if (record[1] != record_data || record[0] > max_record()
+        || pos + record_size(record[0]) > cached_write_) {
+        throw std::runtime_error("ShmRing: corrupt record in " + name_);
+    }
+    data = data_ + offset + record_header;
+    size = record[0];
+    peeked_end_ = pos + record_size(record[0]);
+    return true;
+}
+
+bool ShmRing::peek(const char *&data, size_t &size)
+{
+    if (try_peek(data, size)) {
+        return true;
+    }
+    bool found = false;
+    wait_until(strategy_, [&] {
+            found = try_peek(data, size);
+            return found || closed();
+        },
+        header_->data_seq, header_->reader_waiting);
+    // Closed: records written before are still delivered.
+    return found || try_peek(data, size);
+}
+
+void ShmRing::consume()
+{
+    if (!peeked_end_) {
+        throw std::logic_error("ShmRing::consume without peek");
+    }
+    header_->read_pos.store(peeked_end_, std::memory_order_release);
+    peeked_end_ = 0;
+    wake_writer();
+}
+
+bool ShmRing::try_read(std::string &record)
+{
+    const char *data;
+    size_t size;
+    if (!try_peek(data, size)) {
+        return false;
+    }
+    record.assign(data, size);
+    consume();
+    return true;
+}
+
+bool ShmRing::read(std::string &record)
+{
+    const char *data;
+    size_t size;
+    if (!peek(data, size)) {
+        return false;
+    }
+    record.assign(data, size);
+    consume();
+    return true;
+}
+
+void ShmRing::close()
+{
+    Header *h = header_;
+    h->closed.store(1);
+    h->data_seq.fetch_add(1);
+    h->space_seq.fetch_add(1);
+    futex_wake(h->data_seq);
+    futex_wake(h->space_seq);
+}
+
+bool ShmRing::closed() const
+{
+    return header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t ShmRing::used() const
+{
+    const uint64_t read = header_->read_pos.load();
+    return static_cast<size_t>(header_->write_pos.load() - read);
+}
+
+uint32_t ShmRing::recoveries() const
+{
+    return header_->recoveries.load();
+}
+
+void ShmRing::wake_reader()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Header *h = header_;
+    if (h->reader_waiting.load(std::memory_order_relaxed)) {
+        h->data_seq.fetch_add(1);
+        futex_wake(h->data_seq);
+    }
+}
+
+void ShmRing::wake_writer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Header *h = header_;
+    if (h->writer_waiting.load(std::memory_order_relaxed)) {
+        h->space_seq.fetch_add(1);
+        futex_wake(h->space_seq);
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
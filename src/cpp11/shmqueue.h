@@ -0,0 +1,192 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/shmqueue.h A message queue between processes in POSIX
+ *       shared memory.
+ *
+ * The ring lives in a named segment (shm_open() and mmap()), so a
+ * producer and a consumer process exchange messages without system calls
+ * or copies through the kernel. It holds only offsets, never pointers,
+ * as each process maps the segment at another address.
+ *
+ * It is a single-producer, single-consumer ring: one thread (in any
+ * process) writes and one reads. The write and read positions are 64 bit
+ * byte counters that only grow; a record is published by storing the
+ * write position after the record is complete. A process dying half way
+ * thus leaves no torn records behind: an unpublished record is simply
+ * not there, and a record read but not consumed is delivered again to
+ * the next reader. Opening a segment validates it and repairs
+ * inconsistent positions, and a segment whose creator died before
+ * initializing it is taken over.
+ *
+ * Waiting spins, yields and then sleeps on a futex with the peer only
+ * calling futex wake when a waiting flag is set, as in EventCount.
+ *
+ * \code
+ * // producer process                  // consumer process
+ * ShmQueue<Tick> q("/ticks", 1<<20);   ShmQueue<Tick> q("/ticks", 1<<20);
+ * q.add(tick);                         Tick t;
+ * q.close();                           while (q.get(t)) { ... }
+ * \endcode
+ */
+
+#ifndef CPP11_SHMQUEUE_H
+#define CPP11_SHMQUEUE_H 1
+
+#include "cpp11/waitstrategy.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/**
+ * A ring of variable sized byte records in a named shared memory segment.
+ * Throws std::system_error if the segment cannot be created or mapped.
+ */
+class ShmRing {
+  public:
+    /// Opens the segment \a name (as for shm_open(), "/something") or
+    /// creates it with \a capacity data bytes (a power of two, at least
+    /// 4096). An existing segment must have the same capacity.
+    ShmRing(const std::string &name, size_t capacity);
+    /// Opens the existing segment \a name; throws std::runtime_error if
+    /// it is not a valid ring.
+    explicit ShmRing(const std::string &name);
+    ~ShmRing();
+    ShmRing(const ShmRing &)=delete;
+    ShmRing &operator=(const ShmRing &)=delete;
+
+    /// Removes the name; mappings stay valid until unmapped.
+    static void unlink(const std::string &name);
+
+    /// Appends a record, returns false if there is not enough space.
+    /// Throws std::length_error if \a size exceeds max_record() and
+    /// std::logic_error if the ring is closed.
+    bool try_write(const void *data, size_t size);
+    /// Appends a record, waits while there is not enough space.
+    void write(const void *data, size_t size);
+
+    /**
+     * Makes the oldest record available in place (no copy): \a data
+     * and \a size stay valid until consume(). Returns false if the ring
+     * is empty.
+     */
+    bool try_peek(const char *&data, size_t &size);
+    /// As try_peek(), but waits while the ring is empty. Returns false
+    /// at the end of the stream (closed and drained).
+    bool peek(const char *&data, size_t &size);
+    /// Releases the record of the last peek.
+    void consume();
+
+    /// Copies and consumes the oldest record.
+    bool try_read(std::string &record);
+    bool read(std::string &record);
+
+    /// Ends the stream, see Queue::close().
+    void close();
+    bool closed() const;
+
+    size_t capacity() const { return capacity_; }
+    /// The largest record that fits.
+    size_t max_record() const { return capacity_ / 2 - record_header; }
+    /// Bytes used by records not yet consumed (an estimate while the
+    /// peers work).
+    size_t used() const;
+    /// How often the ring state had to be repaired when opened.
+    uint32_t recoveries() const;
+
+    /// How long waiting writers and readers spin before they sleep.
+    void configure(WaitStrategy strategy) { strategy_ = strategy; }
+
+  private:
+    struct Header;
+    static constexpr size_t record_header = 8;
+
+    void map(int fd);
+    void initialize(int fd);
+    void validate();
+    void recover();
+    // After a seq_cst fence: wakes a peer that announced it sleeps.
+    void wake_reader();
+    void wake_writer();
+
+    std::string name_;
+    size_t capacity_;
+    Header *header_;
+    char *data_;
+    size_t mapped_;
+    WaitStrategy strategy_;
+    // The peer's position as last seen, saves touching its cache line.
+    uint64_t cached_read_;
+    uint64_t cached_write_;
+    // End of the record of the last peek, 0 if none.
+    uint64_t peeked_end_;
+};
+
+/**
+ * A typed interface to ShmRing with the interface of Queue: one record
+ * per trivially copyable message.
+ */
+template<typename Message>
+class ShmQueue {
+    static_assert(std::is_trivially_copyable<Message>::value,
+                  "messages are copied between processes as bytes");
+    ShmRing ring_;
+
+    bool take(const char *data, size_t size, Message &m) {
+        if (size != sizeof(Message)) {
+            ring_.consume();
+            throw std::runtime_error("ShmQueue: record of wrong size");
+        }
+        std::memcpy(&m, data, sizeof(Message));
+        ring_.consume();
+        return true;
+    }
+
+  public:
+    /// Opens or creates the queue \a name with \a capacity bytes.
+    ShmQueue(const std::string &name, size_t capacity)
+        : ring_(name, capacity) { }
+    /// Opens the existing queue \a name.
+    explicit ShmQueue(const std::string &name) : ring_(name) { }
+
+    void add(const Message &m) { ring_.write(&m, sizeof(Message)); }
+    bool try_add(const Message &m) {
+        return ring_.try_write(&m, sizeof(Message));
+    }
+
+    /// Waits for a message; false at the end of the stream.
+    bool get(Message &m) {
+        const char *data;
+        size_t size;
+        return ring_.peek(data, size) && take(data, size, m);
+    }
+    /// Waits for a message; throws std::logic_error at the end of
+    /// the stream.
+    Message get() {
+        Message m;
+        if (!get(m)) {
+            throw std::logic_error("ShmQueue::get: queue is closed");
+        }
+        return m;
+    }
+    bool try_get(Message &m) {
+        const char *data;
+        size_t size;
+        return ring_.try_peek(data, size) && take(data, size, m);
+    }
+
+    void close() { ring_.close(); }
+    bool closed() const { return ring_.closed(); }
+
+    ShmRing &ring() { return ring_; }
+};
+
+#endif // CPP11_SHMQUEUE_H
+
+/* vim: set ts=4 sw=4 tw=76: */
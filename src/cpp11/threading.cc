@@ -6,11 +6,17 @@
  * \file cpp11/threading.cc A simple multithreading test.
  */
 #include "cpp11/threading.h"
+#include "cpp11/future.h"
+#include "cpp11/threadpool.h"
+#include "cpp11/profiledmutex.h"
+#include "cpp11/timerwheel.h"
+#include "cpp11/topology.h"
 
 #include <iostream>
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <memory>
 
 void threading_test()
 {
@@ -31,9 +37,29 @@ void threading_test()
         }
     };
 
-    // Note that std::thread constructor copies "MyThread".
-    std::thread t1 { MyThread { "t1" } };
-    std::thread t2 { MyThread { "t2" } };
+    // Note that std::thread constructor copies "MyThread". The thread
+    // is bound to the CPUs of the first NUMA node (of those we may use),
+    // rather than wandering between nodes and away from its memory.
+    const CpuTopology &topology = CpuTopology::system();
+    std::thread t1 = pinned_thread(
+        topology.node_cpus(topology.cpus().front().node),
+        MyThread { "t1" });
+
+    // Rather than a thread per task, reuse the threads of a pool, and
+    // rather than blocking one of them in sleep_for, let a timer finish
+    // the task after one second; what follows it is attached with
+    // then() and runs on the pool, nobody waits in between.
+    ThreadPool &pool = ThreadPool::shared();
+    TimerService timers { pool };
+    auto t2_timer = std::make_shared<Promise<void>>();
+    std::cout << "start t2" << std::endl;
+    Future<void> t2 = t2_timer->get_future().then(
+        PoolExecutor::shared(), [] {
+            std::cout << "done t2" << std::endl;
+        });
+    timers.schedule_after(std::chrono::milliseconds{1000}, [t2_timer] {
+        t2_timer->set_value();
+    });
 
     // Let's lock a mutex:
     {
@@ -41,20 +67,21 @@ void threading_test()
         std::unique_lock<std::mutex> lock { m };
     }
 
-    // Let's look mulitple mutexes atomically:
+    // Let's look mulitple mutexes atomically (these ones record how long
+    // threads wait for them, see LockProfile::report_text()):
     {
-        std::mutex m1;
-        std::mutex m2;
-        std::unique_lock<std::mutex> lock1 { m1, std::defer_lock };
-        std::unique_lock<std::mutex> lock2 { m2, std::defer_lock };
+        ProfiledMutex m1 { "threading_test.m1" };
+        ProfiledMutex m2 { "threading_test.m2" };
+        std::unique_lock<ProfiledMutex> lock1 { m1, std::defer_lock };
+        std::unique_lock<ProfiledMutex> lock2 { m2, std::defer_lock };
 
         std::lock(lock1, lock2);
     }
 
-    // Wait for both threads to be finished (take approximately
+    // Wait for both tasks to be finished (take approximately
     // one second in total).
     t1.join();
-    t2.join();
+    t2.get(pool);
 }
 
 /* vim: set ts=4 sw=4 tw=76: */
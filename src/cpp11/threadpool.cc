@@ -0,0 +1,114 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/threadpool.cc A persistent thread pool with futures and
+ *       parallel loops.
+ */
+
+#include "cpp11/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+namespace {
+
+// Chunks of a parallel loop, claimed one by one by the helper tasks and
+// the calling thread (dynamic scheduling: fast threads take more).
+struct ChunkState {
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    const size_t chunks;
+    const std::function<void(size_t)> &fn;
+    std::atomic<bool> failed;
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    ChunkState(size_t chunks, const std::function<void(size_t)> &fn)
+        : next{0}, done{0}, chunks(chunks), fn(fn), failed{false} { }
+
+    // fn is only called for claimed chunks, all of which the caller
+    // waits for, so helpers running late never touch it.
+    void work() {
+        for (;;) {
+            const size_t chunk = next.fetch_add(1);
+            if (chunk >= chunks) {
+                return;
+            }
+            if (!failed.load(std::memory_order_relaxed)) {
+                try {
+                    fn(chunk);
+                } catch (...) {
+                    std::unique_lock<std::mutex> lock { mutex };
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true);
+                }
+            }
+            done.fetch_add(1, std::memory_order_release);
+        }
+    }
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t workers)
+    : pool_(workers)
+{ }
+
+ThreadPool::~ThreadPool()
+{
+    pool_.shutdown();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::grain_for(size_t n, size_t grain) const
+{
+    if (grain) {
+        return grain;
+    }
+    // Eight chunks per thread (the caller counts, too): small enough to
+    // even out uneven chunks, large enough to make claiming cheap.
+    const size_t chunks = 8 * (size() + 1);
+    return std::max<size_t>(1, n / chunks);
+}
+
+void ThreadPool::run_chunks(size_t chunks,
+    const std::function<void(size_t)> &fn)
+{
+    if (chunks == 1) {
+        fn(0);
+        return;
+    }
+    std::shared_ptr<ChunkState> state =
+        std::make_shared<ChunkState>(chunks, fn);
+    const size_t helpers = std::min(chunks - 1, size());
+    for (size_t n=0; n<helpers; ++n) {
+        pool_.submit([state] { state->work(); });
+    }
+    state->work();
+    while (state->done.load(std::memory_order_acquire) < chunks) {
+        help();
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void ThreadPool::help()
+{
+    if (!pool_.run_one()) {
+        std::this_thread::yield();
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
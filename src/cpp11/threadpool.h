@@ -0,0 +1,153 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/threadpool.h A persistent thread pool with futures and
+ *       parallel loops.
+ *
+ * Starting a std::thread per piece of work costs tens of microseconds;
+ * the ThreadPool keeps its threads (a WorkStealingPool) and hands out
+ * std::futures instead of threads to join.
+ *
+ * \code
+ * ThreadPool pool;
+ * std::future<int> answer = pool.submit([] { return 6*7; });
+ * pool.parallel_for(0, n, [&](size_t i) { out[i] = f(in[i]); });
+ * double sum = pool.parallel_reduce(size_t{0}, n, 0.0,
+ *     [&](size_t b, size_t e) { double s = 0; while (b<e) s += in[b++];
+ *                               return s; },
+ *     std::plus<double>());
+ * std::cout << pool.wait(answer) << std::endl;
+ * \endcode
+ *
+ * Threads waiting for the pool (in wait(), parallel_for() and
+ * parallel_reduce()) run pending tasks meanwhile, so these may also be
+ * called from tasks of the same pool without dead-locking.
+ */
+
+#ifndef CPP11_THREADPOOL_H
+#define CPP11_THREADPOOL_H 1
+
+#include "cpp11/workstealing.h"
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+  public:
+    /// Starts \a workers threads (at least one).
+    explicit ThreadPool(
+        size_t workers = std::thread::hardware_concurrency());
+    /// Runs all submitted tasks and joins the threads.
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &)=delete;
+    ThreadPool &operator=(const ThreadPool &)=delete;
+
+    /// A pool with a thread per core, started on first use.
+    static ThreadPool &shared();
+
+    /**
+     * Schedules \a f and returns a future for its result; an exception
+     * thrown by \a f is rethrown by the future's get().
+     */
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F f) {
+        using Result = typename std::result_of<F()>::type;
+        std::shared_ptr<std::packaged_task<Result()>> task =
+            std::make_shared<std::packaged_task<Result()>>(std::move(f));
+        std::future<Result> future = task->get_future();
+        pool_.submit([task] { (*task)(); });
+        return future;
+    }
+
+    /// Waits for \a future, running pending tasks meanwhile, and
+    /// returns its result.
+    template<typename T>
+    T wait(std::future<T> &future) {
+        while (future.wait_for(std::chrono::seconds{0})
+                != std::future_status::ready) {
+            help();
+        }
+        return future.get();
+    }
+
+    /**
+     * Calls \a body(i) for all i in [begin, end), in chunks of \a grain
+     * indices run in parallel. With grain 0 the range is split into
+     * about eight chunks per thread, which balances uneven work without
+     * much scheduling. Returns when all calls returned; rethrows the
+     * first exception thrown by \a body (later chunks are skipped then).
+     */
+    template<typename Index, typename Body>
+    void parallel_for(Index begin, Index end, Body body, size_t grain=0) {
+        if (end <= begin) {
+            return;
+        }
+        const size_t n = static_cast<size_t>(end - begin);
+        grain = grain_for(n, grain);
+        run_chunks((n + grain - 1) / grain, [&](size_t chunk) {
+            const Index first = begin + static_cast<Index>(chunk * grain);
+            const Index last = static_cast<size_t>(end - first) > grain
+                ? first + static_cast<Index>(grain) : end;
+            for (Index i=first; i<last; ++i) {
+                body(i);
+            }
+        });
+    }
+
+    /**
+     * Reduces [begin, end): \a fn(b, e) computes the result of a chunk
+     * [b, e), the chunk results are combined with \a reduce starting
+     * from \a identity. Chunks are combined in index order, so with a
+     * fixed \a grain the result does not depend on the scheduling (also
+     * for floating point).
+     */
+    template<typename T, typename Index, typename Fn, typename Reduce>
+    T parallel_reduce(Index begin, Index end, T identity, Fn fn,
+        Reduce reduce, size_t grain=0)
+    {
+        if (end <= begin) {
+            return identity;
+        }
+        const size_t n = static_cast<size_t>(end - begin);
+        grain = grain_for(n, grain);
+        const size_t chunks = (n + grain - 1) / grain;
+        std::vector<T> results(chunks, identity);
+        run_chunks(chunks, [&](size_t chunk) {
+            const Index first = begin + static_cast<Index>(chunk * grain);
+            const Index last = static_cast<size_t>(end - first) > grain
+                ? first + static_cast<Index>(grain) : end;
+            results[chunk] = fn(first, last);
+        });
+        T result = identity;
+        for (const T &r: results) {
+            result = reduce(result, r);
+        }
+        return result;
+    }
+
+    /// Number of worker threads.
+    size_t size() const { return pool_.size(); }
+
+    /// The underlying pool, for example to submit() without a future.
+    WorkStealingPool &pool() { return pool_; }
+
+  private:
+    // The grain to use for n indices: \a grain, or a heuristic for 0.
+    size_t grain_for(size_t n, size_t grain) const;
+    // Runs fn(0) .. fn(chunks-1) on the pool and the calling thread.
+    void run_chunks(size_t chunks, const std::function<void(size_t)> &fn);
+    // Runs a pending task or yields.
+    void help();
+
+    WorkStealingPool pool_;
+};
+
+#endif // CPP11_THREADPOOL_H
+
+/* vim: set ts=4 sw=4 tw=76: */
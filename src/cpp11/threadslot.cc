@@ -0,0 +1,117 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/threadslot.cc Per-thread pointers of objects.
+ */
+
+#include "cpp11/threadslot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> next_slot_id { 1 };
+
+// In front of the map: a hit costs neither a lock nor a hash.
+struct Cache {
+    static constexpr size_t size = 64;
+    uint64_t ids[size];
+    void *pointers[size];
+};
+thread_local Cache cache {};
+
+struct ThreadMap;
+
+struct Threads {
+    std::mutex mutex;
+    std::vector<ThreadMap*> maps;
+};
+
+// Never destroyed, slots with static storage duration may outlive any
+// static object.
+Threads &threads()
+{
+    static Threads *instance = new Threads;
+    return *instance;
+}
+
+// The pointers of a thread. Its mutex is only contended by a slot being
+// destroyed.
+struct ThreadMap {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, void*> pointers;
+
+    ThreadMap() {
+        Threads &t = threads();
+        std::unique_lock<std::mutex> lock { t.mutex };
+        t.maps.push_back(this);
+    }
+    ~ThreadMap() {
+        Threads &t = threads();
+        std::unique_lock<std::mutex> lock { t.mutex };
+        t.maps.erase(std::find(t.maps.begin(), t.maps.end(), this));
+    }
+};
+thread_local ThreadMap thread_map;
+
+} // namespace
+
+ThreadSlot::ThreadSlot()
+    : id_(next_slot_id.fetch_add(1))
+{ }
+
+ThreadSlot::~ThreadSlot()
+{
+    Threads &t = threads();
+    std::unique_lock<std::mutex> lock { t.mutex };
+    for (ThreadMap *map: t.maps) {
+        std::unique_lock<std::mutex> map_lock { map->mutex };
+        map->pointers.erase(id_);
+    }
+}
+
+void *ThreadSlot::get() const
+{
+    const size_t i = id_ % Cache::size;
+    if (cache.ids[i] == id_) {
+        return cache.pointers[i];
+    }
+    void *p = nullptr;
+    {
+        std::unique_lock<std::mutex> lock { thread_map.mutex };
+        auto it = thread_map.pointers.find(id_);
+        if (it != thread_map.pointers.end()) {
+            p = it->second;
+        }
+    }
+    if (p) {
+        cache.ids[i] = id_;
+        cache.pointers[i] = p;
+    }
+    return p;
+}
+
+void ThreadSlot::set(void *p) const
+{
+    {
+        std::unique_lock<std::mutex> lock { thread_map.mutex };
+        thread_map.pointers[id_] = p;
+    }
+    const size_t i = id_ % Cache::size;
+    cache.ids[i] = id_;
+    cache.pointers[i] = p;
+}
+
+size_t ThreadSlot::thread_entries()
+{
+    std::unique_lock<std::mutex> lock { thread_map.mutex };
+    return thread_map.pointers.size();
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
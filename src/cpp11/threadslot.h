@@ -0,0 +1,49 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/threadslot.h Per-thread pointers of objects, for state
+ *       sharded per thread such as ShardedCounter cells.
+ *
+ * thread_local can only make variables per thread, not members. An
+ * object instead takes a ThreadSlot, and each thread looks its pointer
+ * up by the slot's id: in a small direct mapped cache first, then in a
+ * map of the thread. The map takes a lock of its own thread only, so
+ * threads never wait for each other. When the object goes away, the
+ * slot removes its entries from the maps of all threads alive.
+ */
+
+#ifndef CPP11_THREADSLOT_H
+#define CPP11_THREADSLOT_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A pointer per thread, nullptr until set() in that thread. Ids are
+ * never reused, so a cache entry of a destroyed slot is never hit.
+ */
+class ThreadSlot {
+  public:
+    ThreadSlot();
+    /// Forgets the pointers of all threads (not what they point to).
+    ~ThreadSlot();
+    ThreadSlot(const ThreadSlot &)=delete;
+    ThreadSlot &operator=(const ThreadSlot &)=delete;
+
+    /// The pointer of the current thread.
+    void *get() const;
+    void set(void *p) const;
+
+    uint64_t id() const { return id_; }
+    /// Number of slots the current thread has a pointer in.
+    static size_t thread_entries();
+
+  private:
+    const uint64_t id_;
+};
+
+#endif // CPP11_THREADSLOT_H
+
+/* vim: set ts=4 sw=4 tw=76: */
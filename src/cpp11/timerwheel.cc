@@ -0,0 +1,261 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/timerwheel.cc Hierarchical timing wheel and a timer
+ *       service running callbacks on a ThreadPool.
+ */
+
+#include "cpp11/timerwheel.h"
+
+constexpr uint32_t TimerWheel::nil;
+
+TimerWheel::TimerWheel(uint64_t now)
+    : now_(now), size_(0), free_(nil), heads_(levels * slots, nil)
+{ }
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t expires,
+    Callback callback)
+{
+    uint32_t index;
+    if (free_ != nil) {
+        index = free_;
+        free_ = nodes_[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.push_back(Node { 0, nullptr, nil, nil, nil, 1 });
+    }
+    Node &node = nodes_[index];
+    // The slot of the current tick already fired.
+    node.expires = expires > now_ ? expires : now_ + 1;
+    node.callback = std::move(callback);
+    insert(index);
+    ++size_;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    const uint32_t index = static_cast<uint32_t>(id);
+    if (index >= nodes_.size() || nodes_[index].slot == nil
+            || nodes_[index].generation != (id >> 32)) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimerWheel::insert(uint32_t index)
+{
+    Node &node = nodes_[index];
+    // The lowest level whose higher digits equal those of now_. Timers
+    // beyond the top level wait in its slot 0, which is cascaded when
+    // the next round starts (it holds no other timers, these always go
+    // to a slot after the current one).
+    unsigned level = 0;
+    while (level < levels
+        && (node.expires >> (level_bits * (level + 1)))
+            != (now_ >> (level_bits * (level + 1)))) {
+        ++level;
+    }
+    size_t slot;
+    if (level < levels) {
+        slot = (node.expires >> (level_bits * level)) & (slots - 1);
+    } else {
+        level = levels - 1;
+        slot = 0;
+    }
+    const uint32_t head = static_cast<uint32_t>(level * slots + slot);
+    node.slot = head;
+    node.prev = nil;
+    node.next = heads_[head];
+    if (node.next != nil) {
+        nodes_[node.next].prev = index;
+    }
+    heads_[head] = index;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node &node = nodes_[index];
+    if (node.prev != nil) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.slot] = node.next;
+    }
+    if (node.next != nil) {
+        nodes_[node.next].prev = node.prev;
+    }
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node &node = nodes_[index];
+    node.callback = nullptr;
+    node.slot = nil;
+    if (++node.generation == 0) {
+        node.generation = 1;
+    }
+    node.next = free_;
+    free_ = index;
+    --size_;
+}
+
+void TimerWheel::cascade(unsigned level, size_t slot)
+{
+    const uint32_t head = static_cast<uint32_t>(level * slots + slot);
+    uint32_t index = heads_[head];
+    heads_[head] = nil;
+    while (index != nil) {
+        const uint32_t next = nodes_[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+size_t TimerWheel::advance(uint64_t now,
+    const std::function<void(Callback&)> &fire)
+{
+    size_t fired = 0;
+    while (now_ < now) {
+        // Skip ticks without anything to fire or cascade.
+        const uint64_t next = next_expiry();
+        if (next > now) {
+            now_ = now;
+            break;
+        }
+        if (next > now_ + 1) {
+            now_ = next - 1;
+        }
+        ++now_;
+        // Entering a new round of level l means cascading its current
+        // slot; higher levels first, they may refill lower ones.
+        unsigned top = 0;
+        while (top + 1 < levels
+            && (now_ & ((uint64_t{1} << (level_bits * (top + 1))) - 1))
+                == 0) {
+            ++top;
+        }
+        for (unsigned level=top; level>0; --level) {
+            cascade(level,
+                (now_ >> (level_bits * level)) & (slots - 1));
+        }
+        const uint32_t head = static_cast<uint32_t>(now_ & (slots - 1));
+        while (heads_[head] != nil) {
+            const uint32_t index = heads_[head];
+            unlink(index);
+            Callback callback = std::move(nodes_[index].callback);
+            release(index);
+            ++fired;
+            // May schedule and cancel, but only for later ticks.
+            fire(callback);
+        }
+    }
+    return fired;
+}
+
+uint64_t TimerWheel::next_expiry() const
+{
+    if (size_ == 0) {
+        return UINT64_MAX;
+    }
+    for (unsigned level=0; level<levels; ++level) {
+        const unsigned shift = level_bits * level;
+        const uint64_t round = (now_ >> (shift + level_bits))
+            << (shift + level_bits);
+        const size_t current = (now_ >> shift) & (slots - 1);
+        for (size_t slot=current+1; slot<slots; ++slot) {
+            if (heads_[level * slots + slot] != nil) {
+                return round | (static_cast<uint64_t>(slot) << shift);
+            }
+        }
+    }
+    // Only timers beyond the top level's round: next round.
+    const unsigned bits = level_bits * levels;
+    return ((now_ >> bits) + 1) << bits;
+}
+
+TimerService::TimerService(ThreadPool &pool, Clock::duration tick)
+    : pool_(pool), tick_(tick), start_(Clock::now()), wheel_(0),
+      wakeup_(UINT64_MAX), stopping_(false)
+{
+    driver_ = std::thread(&TimerService::drive, this);
+}
+
+TimerService::~TimerService()
+{
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        stopping_ = true;
+    }
+    changed_.notify_one();
+    driver_.join();
+}
+
+uint64_t TimerService::tick_of(Clock::time_point t) const
+{
+    // Rounded up: a timer never fires early.
+    if (t <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((t - start_ + tick_ - Clock::duration{1})
+        / tick_);
+}
+
+TimerService::TimerId TimerService::schedule_at(Clock::time_point when,
+    Callback callback)
+{
+    const uint64_t tick = tick_of(when);
+    std::unique_lock<std::mutex> lock { mutex_ };
+    const TimerId id = wheel_.schedule(tick, std::move(callback));
+    if (tick < wakeup_) {
+        wakeup_ = tick;
+        changed_.notify_one();
+    }
+    return id;
+}
+
+bool TimerService::cancel(TimerId id)
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return wheel_.cancel(id);
+}
+
+size_t TimerService::pending() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return wheel_.size();
+}
+
+void TimerService::drive()
+{
+    std::vector<Callback> due;
+    std::unique_lock<std::mutex> lock { mutex_ };
+    while (!stopping_) {
+        // The last tick that fully passed.
+        const uint64_t now = static_cast<uint64_t>(
+            (Clock::now() - start_) / tick_);
+        wheel_.advance(now, [&due](Callback &callback) {
+            due.push_back(std::move(callback));
+        });
+        if (!due.empty()) {
+            lock.unlock();
+            for (Callback &callback: due) {
+                pool_.pool().submit(std::move(callback));
+            }
+            due.clear();
+            lock.lock();
+            continue;
+        }
+        wakeup_ = wheel_.next_expiry();
+        if (wakeup_ == UINT64_MAX) {
+            changed_.wait(lock);
+        } else {
+            changed_.wait_until(lock, start_ + tick_ * wakeup_);
+        }
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,150 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/timerwheel.h Hierarchical timing wheel and a timer service
+ *       running callbacks on a ThreadPool.
+ *
+ * Sleeping in a thread per timeout does not scale to many timeouts. A
+ * timing wheel keeps timers in slots by expiry tick: four levels of 256
+ * slots each, level l counting in steps of 256^l ticks. A timer goes to
+ * the lowest level whose range covers its expiry; when level 0 wrapped
+ * around, the current slot of level 1 is redistributed to level 0, and
+ * so on ("cascading"). Scheduling and cancelling are O(1), firing is
+ * O(1) per timer plus each timer cascading at most three times.
+ *
+ * \code
+ * TimerService timers;   // one driver thread, callbacks on the pool
+ * TimerWheel::TimerId id = timers.schedule_after(
+ *     std::chrono::milliseconds{500}, [] { std::cout << "late"; });
+ * timers.cancel(id);
+ * \endcode
+ */
+
+#ifndef CPP11_TIMERWHEEL_H
+#define CPP11_TIMERWHEEL_H 1
+
+#include "cpp11/threadpool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * The timing wheel itself, counting in abstract ticks; not thread-safe.
+ */
+class TimerWheel {
+  public:
+    using Callback = std::function<void()>;
+    /// Identifies a timer; 0 is never used.
+    using TimerId = uint64_t;
+
+    static constexpr unsigned level_bits = 8;
+    static constexpr unsigned levels = 4;
+    static constexpr size_t slots = size_t{1} << level_bits;
+
+    /// A wheel whose current tick is \a now.
+    explicit TimerWheel(uint64_t now=0);
+
+    /**
+     * Schedules \a callback to fire when the wheel advances to tick
+     * \a expires (or at the next advance() if that already passed).
+     */
+    TimerId schedule(uint64_t expires, Callback callback);
+    /// Removes a pending timer; false if it fired or was cancelled.
+    bool cancel(TimerId id);
+
+    /**
+     * Advances to tick \a now, handing the callback of each expired
+     * timer to \a fire, in expiry order. Returns the number fired.
+     */
+    size_t advance(uint64_t now,
+        const std::function<void(Callback&)> &fire);
+
+    /// The earliest tick at which a timer may fire; a lower bound
+    /// (cascades are reported as possible expiries), UINT64_MAX if
+    /// empty.
+    uint64_t next_expiry() const;
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+  private:
+    static constexpr uint32_t nil = UINT32_MAX;
+
+    struct Node {
+        uint64_t expires;
+        Callback callback;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t slot;       // index into heads_, nil when free
+        uint32_t generation; // bumped on reuse, part of the TimerId
+    };
+
+    void insert(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    // Moves the timers of slot \a slot of \a level down.
+    void cascade(unsigned level, size_t slot);
+
+    uint64_t now_;
+    size_t size_;
+    std::vector<Node> nodes_;
+    uint32_t free_;
+    // List heads, levels * slots.
+    std::vector<uint32_t> heads_;
+};
+
+/**
+ * A thread-safe TimerWheel with a driver thread advancing it in real
+ * time. Expired callbacks run on a ThreadPool, so a slow callback
+ * neither delays other timers nor the driver.
+ */
+class TimerService {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = TimerWheel::Callback;
+    using TimerId = TimerWheel::TimerId;
+
+    /// Callbacks run on \a pool; timers are rounded up to \a tick.
+    explicit TimerService(ThreadPool &pool=ThreadPool::shared(),
+        Clock::duration tick=std::chrono::milliseconds{1});
+    /// Stops the driver; pending timers are dropped.
+    ~TimerService();
+    TimerService(const TimerService &)=delete;
+    TimerService &operator=(const TimerService &)=delete;
+
+    TimerId schedule_at(Clock::time_point when, Callback callback);
+    TimerId schedule_after(Clock::duration delay, Callback callback) {
+        return schedule_at(Clock::now() + delay, std::move(callback));
+    }
+    /// False if the timer already fired (its callback may be running).
+    bool cancel(TimerId id);
+
+    size_t pending() const;
+
+  private:
+    uint64_t tick_of(Clock::time_point t) const;
+    void drive();
+
+    ThreadPool &pool_;
+    const Clock::duration tick_;
+    const Clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    TimerWheel wheel_;
+    // The tick the driver sleeps until.
+    uint64_t wakeup_;
+    bool stopping_;
+    std::thread driver_;
+};
+
+#endif // CPP11_TIMERWHEEL_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,355 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/topology.cc CPU topology from sysfs, threads pinned to
+ *       CPUs and memory placed on a NUMA node.
+ */
+
+#include "cpp11/topology.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// The first line of a sysfs file, empty if there is none.
+std::string read_line(const std::string &path)
+{
+    std::ifstream in { path };
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+unsigned read_unsigned(const std::string &path, unsigned fallback)
+{
+    const std::string line = read_line(path);
+    try {
+        // -1 (e.g. no package id on some platforms) is no id either.
+        const long value = std::stol(line);
+        return value < 0 ? fallback : static_cast<unsigned>(value);
+    } catch (const std::logic_error &) {
+        return fallback;
+    }
+}
+
+cpu_set_t to_cpu_set(const CpuList &cpus)
+{
+    if (cpus.empty()) {
+        throw std::invalid_argument("pin: no CPUs given");
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu: cpus) {
+        if (cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("pin: CPU "
+                + std::to_string(cpu) + " out of range");
+        }
+        CPU_SET(cpu, &set);
+    }
+    return set;
+}
+
+CpuList cpus_of(const cpu_set_t &set)
+{
+    CpuList cpus;
+    for (unsigned cpu=0; cpu<CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void pin(pthread_t thread, const CpuList &cpus)
+{
+    const cpu_set_t set = to_cpu_set(cpus);
+    // Returns the error rather than setting errno.
+    const int error = ::pthread_setaffinity_np(thread, sizeof set, &set);
+    if (error != 0) {
+        throw std::system_error(error, std::system_category(),
+            "pthread_setaffinity_np");
+    }
+}
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+} // namespace
+
+CpuList parse_cpu_list(const std::string &text)
+{
+    CpuList cpus;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        const std::string range = text.substr(begin, end - begin);
+        begin = end + 1;
+        if (range.find_first_not_of(" \t\n") == std::string::npos) {
+            continue;
+        }
+        if (range.find_first_not_of("0123456789- \t\n")
+                != std::string::npos) {
+            throw std::invalid_argument("bad CPU list: " + text);
+        }
+        try {
+            size_t used;
+            const unsigned long first = std::stoul(range, &used);
+            unsigned long last = first;
+            if (used < range.size() && range[used] == '-') {
+                last = std::stoul(range.substr(used + 1));
+            }
+            if (last < first || last >= 1ul << 20) {
+                throw std::invalid_argument(range);
+            }
+            for (unsigned long cpu=first; cpu<=last; ++cpu) {
+                cpus.push_back(static_cast<unsigned>(cpu));
+            }
+        } catch (const std::logic_error &) {
+            throw std::invalid_argument("bad CPU list: " + text);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+const CpuTopology &CpuTopology::system()
+{
+    static const CpuTopology topology { process_cpus() };
+    return topology;
+}
+
+CpuTopology::CpuTopology(const CpuList &allowed, const std::string &sysfs)
+{
+    CpuList ids = allowed;
+    if (ids.empty()) {
+        ids = parse_cpu_list(read_line(sysfs + "/cpu/online"));
+    }
+    if (ids.empty()) {
+        const unsigned n = std::thread::hardware_concurrency();
+        for (unsigned cpu=0; cpu<std::max(1u, n); ++cpu) {
+            ids.push_back(cpu);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::map<unsigned, unsigned> node_of;
+    const std::string nodes = sysfs + "/node/node";
+    for (unsigned node: parse_cpu_list(read_line(sysfs + "/node/online"))) {
+        const std::string path = nodes + std::to_string(node) + "/cpulist";
+        for (unsigned cpu: parse_cpu_list(read_line(path))) {
+            node_of[cpu] = node;
+        }
+    }
+    for (unsigned id: ids) {
+        const std::string dir = sysfs + "/cpu/cpu" + std::to_string(id)
+            + "/topology/";
+        const auto node = node_of.find(id);
+        cpus_.push_back(Cpu { id, read_unsigned(dir + "core_id", id),
+            read_unsigned(dir + "physical_package_id", 0),
+            node == node_of.end() ? 0 : node->second });
+    }
+}
+
+const CpuTopology::Cpu &CpuTopology::cpu(unsigned id) const
+{
+    const auto it = std::lower_bound(cpus_.begin(), cpus_.end(), id,
+        [](const Cpu &cpu, unsigned id) { return cpu.id < id; });
+    if (it == cpus_.end() || it->id != id) {
+        throw std::out_of_range("CpuTopology: no CPU "
+            + std::to_string(id));
+    }
+    return *it;
+}
+
+CpuList CpuTopology::nodes() const
+{
+    CpuList nodes;
+    for (const Cpu &cpu: cpus_) {
+        nodes.push_back(cpu.node);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    return nodes;
+}
+
+CpuList CpuTopology::node_cpus(unsigned node) const
+{
+    CpuList cpus;
+    for (const Cpu &cpu: cpus_) {
+        if (cpu.node == node) {
+            cpus.push_back(cpu.id);
+        }
+    }
+    return cpus;
+}
+
+CpuList CpuTopology::siblings(unsigned id) const
+{
+    const Cpu &of = cpu(id);
+    CpuList cpus;
+    for (const Cpu &cpu: cpus_) {
+        if (distance(of, cpu) <= 1) {
+            cpus.push_back(cpu.id);
+        }
+    }
+    return cpus;
+}
+
+CpuList CpuTopology::nearest(unsigned id) const
+{
+    const Cpu &of = cpu(id);
+    std::vector<Cpu> sorted = cpus_;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [&](const Cpu &a, const Cpu &b) {
+            return distance(of, a) < distance(of, b);
+        });
+    CpuList cpus;
+    for (const Cpu &cpu: sorted) {
+        cpus.push_back(cpu.id);
+    }
+    return cpus;
+}
+
+unsigned CpuTopology::distance(const Cpu &a, const Cpu &b) const
+{
+    if (a.id == b.id) {
+        return 0;
+    }
+    if (a.package == b.package && a.core == b.core) {
+        return 1;
+    }
+    if (a.package == b.package) {
+        return 2;
+    }
+    return a.node == b.node ? 3 : 4;
+}
+
+std::pair<unsigned, unsigned> CpuTopology::close_pair() const
+{
+    // Rank of a distance as a pair: another core of the package first.
+    static const unsigned rank[] = { 4, 1, 0, 2, 3 };
+    std::pair<unsigned, unsigned> best { cpus_[0].id, cpus_[0].id };
+    unsigned best_rank = rank[0];
+    for (size_t i=0; i<cpus_.size(); ++i) {
+        for (size_t j=i+1; j<cpus_.size(); ++j) {
+            const unsigned r = rank[distance(cpus_[i], cpus_[j])];
+            if (r < best_rank) {
+                best_rank = r;
+                best = std::make_pair(cpus_[i].id, cpus_[j].id);
+            }
+        }
+        if (best_rank == 0) {
+            break;
+        }
+    }
+    return best;
+}
+
+CpuList this_thread_cpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const int error = ::pthread_getaffinity_np(::pthread_self(),
+        sizeof set, &set);
+    if (error != 0) {
+        throw std::system_error(error, std::system_category(),
+            "pthread_getaffinity_np");
+    }
+    return cpus_of(set);
+}
+
+CpuList process_cpus()
+{
+    // The pid names the main thread.
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(::getpid(), sizeof set, &set) != 0) {
+        throw_errno("sched_getaffinity");
+    }
+    return cpus_of(set);
+}
+
+void pin_this_thread(const CpuList &cpus)
+{
+    pin(::pthread_self(), cpus);
+}
+
+void pin_thread(std::thread &thread, const CpuList &cpus)
+{
+    pin(thread.native_handle(), cpus);
+}
+
+NodeBuffer::NodeBuffer(size_t bytes, int node,
+    const CpuTopology &topology)
+    : data_(nullptr), size_(0)
+{
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t size = std::max(page, (bytes + page - 1) / page * page);
+    void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        throw_errno("NodeBuffer: mmap");
+    }
+    // Write a byte of each page, which allocates it on the node of the
+    // writing CPU (through volatile: the compiler cannot know the pages
+    // are zero, but must not drop the writes either way).
+    auto touch = [data, size, page] {
+        volatile char *bytes = static_cast<char *>(data);
+        for (size_t offset=0; offset<size; offset+=page) {
+            bytes[offset] = 0;
+        }
+    };
+    try {
+        if (node < 0) {
+            touch();
+        } else {
+            const CpuList cpus =
+                topology.node_cpus(static_cast<unsigned>(node));
+            if (cpus.empty()) {
+                throw std::invalid_argument("NodeBuffer: no CPU on node "
+                    + std::to_string(node));
+            }
+            pinned_thread(cpus, touch).join();
+        }
+    } catch (...) {
+        ::munmap(data, size);
+        throw;
+    }
+    data_ = data;
+    size_ = size;
+}
+
+NodeBuffer::NodeBuffer(NodeBuffer &&other)
+    : data_(other.data_), size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+NodeBuffer::~NodeBuffer()
+{
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,174 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/topology.h CPU topology from sysfs, threads pinned to
+ *       CPUs and memory placed on a NUMA node.
+ *
+ * The scheduler moves threads between CPUs as it likes. For a producer
+ * and a consumer handing cache lines to each other, the distance of
+ * their CPUs decides the latency: cores of one package share the last
+ * level cache, while a line crossing packages (and NUMA nodes) costs
+ * several times more. Likewise memory is fastest when it is local to
+ * the node of the CPU using it.
+ *
+ * CpuTopology reads /sys/devices/system/{cpu,node}, pinned_thread()
+ * starts a thread already bound to a set of CPUs and NodeBuffer places
+ * memory by the first-touch policy of Linux: a page is allocated on the
+ * node of the CPU that first writes it.
+ *
+ * \code
+ * const CpuTopology &topology = CpuTopology::system();
+ * std::pair<unsigned, unsigned> cpus = topology.close_pair();
+ * NodeBuffer ring { 1 << 20, int(topology.cpu(cpus.second).node) };
+ * std::thread consumer = pinned_thread({ cpus.second }, consume);
+ * std::thread producer = pinned_thread({ cpus.first }, produce);
+ * \endcode
+ */
+
+#ifndef CPP11_TOPOLOGY_H
+#define CPP11_TOPOLOGY_H 1
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// CPU numbers as used by the kernel, ascending.
+using CpuList = std::vector<unsigned>;
+
+/// Parses a sysfs CPU list such as "0-3,8,10-11"; throws
+/// std::invalid_argument if malformed.
+CpuList parse_cpu_list(const std::string &text);
+
+/**
+ * Cores, packages and NUMA nodes of a set of CPUs.
+ */
+class CpuTopology {
+  public:
+    struct Cpu {
+        unsigned id;
+        unsigned core;    // core_id, unique within the package only
+        unsigned package; // physical_package_id
+        unsigned node;    // NUMA node, 0 without NUMA
+    };
+
+    /// The process_cpus() as of the first call, from whichever thread.
+    static const CpuTopology &system();
+
+    /**
+     * Reads the topology of \a allowed (all online CPUs if empty) below
+     * \a sysfs. Missing files are taken as a flat machine: a core of
+     * its own per CPU, one package and one node.
+     */
+    explicit CpuTopology(const CpuList &allowed=CpuList(),
+        const std::string &sysfs="/sys/devices/system");
+
+    /// Ordered by id, never empty.
+    const std::vector<Cpu> &cpus() const { return cpus_; }
+    /// Throws std::out_of_range for an unknown CPU.
+    const Cpu &cpu(unsigned id) const;
+
+    CpuList nodes() const;
+    CpuList node_cpus(unsigned node) const;
+    /// The hardware threads of the core of \a id, \a id included.
+    CpuList siblings(unsigned id) const;
+    /// All CPUs ordered by distance from \a id: \a id, its siblings,
+    /// its package, its node, the rest.
+    CpuList nearest(unsigned id) const;
+
+    /**
+     * Two CPUs for a pair of threads exchanging data: preferably two
+     * cores of one package, which share the last level cache without
+     * competing for the execution units of a core as hardware thread
+     * siblings do; else siblings, else the closest pair there is. With
+     * a single CPU, both are the same.
+     */
+    std::pair<unsigned, unsigned> close_pair() const;
+
+  private:
+    // Smaller is closer.
+    unsigned distance(const Cpu &a, const Cpu &b) const;
+
+    std::vector<Cpu> cpus_;
+};
+
+/// The CPUs the calling thread may run on.
+CpuList this_thread_cpus();
+/// The CPUs the process may run on. Linux keeps the affinity per
+/// thread, so this is the one of the main thread (the one the process
+/// was started with unless the main thread pinned itself), not that of
+/// the calling thread.
+CpuList process_cpus();
+/// Binds the calling thread to \a cpus; throws std::system_error (or
+/// std::invalid_argument for an empty or out of range list).
+void pin_this_thread(const CpuList &cpus);
+/// Binds \a thread to \a cpus, as pin_this_thread().
+void pin_thread(std::thread &thread, const CpuList &cpus);
+
+/**
+ * Starts a thread running \a f bound to \a cpus. Unlike pinning after
+ * the start, \a f never runs elsewhere (and touches its first memory on
+ * the right node); if pinning fails, \a f does not run and the error is
+ * thrown here.
+ */
+template<typename F>
+std::thread pinned_thread(const CpuList &cpus, F f)
+{
+    auto pinned = std::make_shared<std::promise<void>>();
+    std::future<void> ready = pinned->get_future();
+    std::thread thread([cpus, f, pinned]() mutable {
+        try {
+            pin_this_thread(cpus);
+        } catch (...) {
+            pinned->set_exception(std::current_exception());
+            return;
+        }
+        pinned->set_value();
+        f();
+    });
+    try {
+        ready.get();
+    } catch (...) {
+        thread.join();
+        throw;
+    }
+    return thread;
+}
+
+/**
+ * Zeroed anonymous memory on a given NUMA node. Fresh pages of mmap()
+ * are only allocated when first written, so writing each page from a
+ * thread pinned to the node places them there (as long as the memory
+ * policy is the default one and the node has free memory).
+ */
+class NodeBuffer {
+  public:
+    /// Maps \a bytes (rounded up to pages) on \a node, or on the node
+    /// of the calling thread for -1. Throws std::system_error, or
+    /// std::invalid_argument if \a topology has no CPU on \a node.
+    explicit NodeBuffer(size_t bytes, int node=-1,
+        const CpuTopology &topology=CpuTopology::system());
+    ~NodeBuffer();
+    NodeBuffer(const NodeBuffer &)=delete;
+    NodeBuffer &operator=(const NodeBuffer &)=delete;
+    NodeBuffer(NodeBuffer &&other);
+
+    void *data() const { return data_; }
+    size_t size() const { return size_; }
+    template<typename T>
+    T *as() const { return static_cast<T *>(data_); }
+
+  private:
+    void *data_;
+    size_t size_;
+};
+
+#endif // CPP11_TOPOLOGY_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,44 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/waitstrategy.cc How Queue consumers wait for messages.
+ */
+
+#include "cpp11/waitstrategy.h"
+
+constexpr unsigned EventCount::epoch_shift;
+constexpr uint64_t EventCount::waiter_mask;
+
+WaitStrategy WaitStrategy::spin_then_park()
+{
+    static const bool single_cpu = std::thread::hardware_concurrency() == 1;
+    return WaitStrategy { single_cpu ? 0u : 4000u, 50 };
+}
+
+void EventCount::wait(Key key)
+{
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        while (static_cast<Key>(state_.load() >> epoch_shift) == key) {
+            cond_.wait(lock);
+        }
+    }
+    state_.fetch_sub(1);
+}
+
+void EventCount::wake(bool all)
+{
+    state_.fetch_add(uint64_t{1} << epoch_shift);
+    // A waiter holds the mutex from checking the epoch until it sleeps,
+    // so taking it here means the notification cannot fall in between.
+    { std::unique_lock<std::mutex> lock { mutex_ }; }
+    if (all) {
+        cond_.notify_all();
+    } else {
+        cond_.notify_one();
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
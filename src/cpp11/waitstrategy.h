@@ -0,0 +1,189 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/waitstrategy.h How Queue consumers wait for messages.
+ *
+ * Parking a consumer on a condition variable as soon as the queue is
+ * empty costs a futex sleep and wake-up per message at moderate rates.
+ * SpinThenParkWait first spins (with a pause instruction) and then yields
+ * for a bounded time, and only then parks on an EventCount, whose
+ * notify is free while nobody sleeps.
+ *
+ * A Wait policy of Queue provides:
+ *
+ * - notify(), called by add() after releasing the queue lock,
+ * - notify_all(), called by close() after releasing the queue lock,
+ * - wait(lock, ready, hint), called by get() holding the lock while the
+ *   queue is empty; returns holding the lock with ready() true. hint()
+ *   may be called without the lock and tells if ready() is likely.
+ *
+ * \code
+ * Queue<Message, QueueStats, SpinThenParkWait> queue;
+ * queue.wait_policy().configure(WaitStrategy { 2000, 20 });
+ * \endcode
+ */
+
+#ifndef CPP11_WAITSTRATEGY_H
+#define CPP11_WAITSTRATEGY_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/// Tells the CPU that we are busy waiting (saves power and lets the
+/// sibling hyper-thread run).
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * An event count (as in Dmitry Vyukov's and Folly's EventCount): lets a
+ * thread wait for a condition that other threads make true without a
+ * lock, while notifiers skip all work if nobody waits.
+ *
+ * Waiter:
+ * \code
+ * while (!condition()) {
+ *     EventCount::Key key = events.prepare_wait();
+ *     if (condition()) { events.cancel_wait(); break; }
+ *     events.wait(key);
+ * }
+ * \endcode
+ * Notifier: make condition() true, then call notify_one() or notify_all().
+ */
+class EventCount {
+  public:
+    using Key = uint32_t;
+
+    EventCount() : state_{0} { }
+    EventCount(const EventCount &)=delete;
+    EventCount &operator=(const EventCount &)=delete;
+
+    /// Announces a waiter; the condition must be re-checked afterwards.
+    Key prepare_wait() {
+        const uint64_t previous = state_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return static_cast<Key>(previous >> epoch_shift);
+    }
+    /// The condition got true after prepare_wait(): no wait().
+    void cancel_wait() {
+        state_.fetch_sub(1);
+    }
+    /// Blocks until a notify after prepare_wait() returned \a key.
+    void wait(Key key);
+
+    void notify_one() { notify(false); }
+    void notify_all() { notify(true); }
+
+    /// Number of threads between prepare_wait() and wake-up.
+    uint32_t waiters() const {
+        return static_cast<uint32_t>(state_.load() & waiter_mask);
+    }
+
+  private:
+    void notify(bool all) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((state_.load(std::memory_order_relaxed) & waiter_mask) == 0) {
+            return; // the fast path: no syscall, no lock
+        }
+        wake(all);
+    }
+    void wake(bool all);
+
+    static constexpr unsigned epoch_shift = 32;
+    static constexpr uint64_t waiter_mask = (uint64_t{1} << epoch_shift) - 1;
+
+    // Epoch in the high, number of waiters in the low 32 bits.
+    std::atomic<uint64_t> state_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+/// How long SpinThenParkWait busy waits before it parks.
+struct WaitStrategy {
+    unsigned spins;  // polls with cpu_relax() in between
+    unsigned yields; // polls with std::this_thread::yield() in between
+
+    /// Park immediately, as a plain condition variable does.
+    static WaitStrategy park() { return WaitStrategy { 0, 0 }; }
+    /// A few microseconds of spinning, then a few yields. On a single
+    /// CPU spinning only delays the producer, so there it only yields.
+    static WaitStrategy spin_then_park();
+};
+
+/// The classic Wait policy: a condition variable (the default of Queue).
+class CondVarWait {
+    std::condition_variable cond_;
+  public:
+    void notify() { cond_.notify_one(); }
+    void notify_all() { cond_.notify_all(); }
+
+    template<typename Ready, typename Hint>
+    void wait(std::unique_lock<std::mutex> &lock, Ready ready, Hint) {
+        // The predicate protects against spurious wake-ups.
+        cond_.wait(lock, ready);
+    }
+};
+
+/// Wait policy spinning, then yielding, then parking on an EventCount.
+class SpinThenParkWait {
+    WaitStrategy strategy_;
+    EventCount events_;
+
+    template<typename Hint>
+    void wait_unlocked(Hint hint) {
+        for (unsigned n=0; n<strategy_.spins; ++n) {
+            if (hint()) return;
+            cpu_relax();
+        }
+        for (unsigned n=0; n<strategy_.yields; ++n) {
+            if (hint()) return;
+            std::this_thread::yield();
+        }
+        const EventCount::Key key = events_.prepare_wait();
+        if (hint()) {
+            events_.cancel_wait();
+            return;
+        }
+        events_.wait(key);
+    }
+
+  public:
+    explicit SpinThenParkWait(
+        WaitStrategy strategy=WaitStrategy::spin_then_park())
+        : strategy_(strategy) { }
+
+    /// Changes the strategy; only while no thread waits.
+    void configure(WaitStrategy strategy) { strategy_ = strategy; }
+    const WaitStrategy &strategy() const { return strategy_; }
+
+    void notify() { events_.notify_one(); }
+    void notify_all() { events_.notify_all(); }
+
+    template<typename Ready, typename Hint>
+    void wait(std::unique_lock<std::mutex> &lock, Ready ready, Hint hint) {
+        while (!ready()) {
+            lock.unlock();
+            wait_unlocked(hint);
+            lock.lock();
+        }
+    }
+
+    /// Number of consumers currently parked (or about to park).
+    uint32_t sleepers() const { return events_.waiters(); }
+};
+
+#endif // CPP11_WAITSTRATEGY_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,487 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/wal.cc A write-ahead log with group commit.
+ */
+
+#include "cpp11/wal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Precedes each record in a segment file. The CRC covers the payload
+// followed by the sequence number.
+struct RecordHeader {
+    uint32_t size;
+    uint32_t crc;
+    uint64_t seq;
+};
+static_assert(sizeof(RecordHeader) == 16, "no padding");
+
+constexpr size_t max_record_size = 1u << 30;
+const char *const segment_suffix = ".wal";
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+void write_all(int fd, const char *data, size_t size,
+    const std::string &path)
+{
+    while (size) {
+        const ssize_t done = ::write(fd, data, size);
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("WriteAheadLog: write " + path);
+        }
+        data += done;
+        size -= done;
+    }
+}
+
+// Makes a new or renamed directory entry durable.
+void sync_directory(const std::string &directory)
+{
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw_errno("WriteAheadLog: open " + directory);
+    }
+    ::fsync(fd);
+    ::close(fd);
+}
+
+std::vector<char> read_file(const std::string &path)
+{
+    std::vector<char> data;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return data;    // removed by a checkpoint meanwhile
+        }
+        throw_errno("WriteAheadLog: open " + path);
+    }
+    char buffer[1 << 16];
+    for (;;) {
+        const ssize_t done = ::read(fd, buffer, sizeof(buffer));
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            throw_errno("WriteAheadLog: read " + path);
+        }
+        if (done == 0) break;
+        data.insert(data.end(), buffer, buffer + done);
+    }
+    ::close(fd);
+    return data;
+}
+
+// Whether a whole record numbered \a expected or later starts anywhere
+// after \a offset in \a data, that is whether the damage at offset is
+// more than a torn end.
+bool record_after(const std::vector<char> &data, size_t offset,
+    uint64_t expected)
+{
+    for (size_t at=offset+1; data.size() - at >= sizeof(RecordHeader);
+        ++at) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + at, sizeof(header));
+        const size_t rest = data.size() - at - sizeof(header);
+        // Each record between takes at least a header.
+        if (header.seq < expected || header.size > rest
+            || header.seq - expected > (at - offset) / sizeof(header)) {
+            continue;
+        }
+        const char *payload = data.data() + at + sizeof(header);
+        if (crc32(&header.seq, sizeof(header.seq),
+                crc32(payload, header.size)) == header.crc) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+uint32_t crc32(const void *data, size_t size, uint32_t crc)
+{
+    // Byte-wise table of the reflected polynomial 0xedb88320.
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n=0; n<256; ++n) {
+            uint32_t c = n;
+            for (int k=0; k<8; ++k) {
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i=0; i<size; ++i) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+WriteAheadLog::WriteAheadLog(const std::string &directory,
+    const WalOptions &options)
+    : directory_(directory), options_(options), replay_end_(0), fd_(-1),
+      segment_size_(0), next_(1), durable_(0), checkpoint_(0),
+      flush_now_(false), stopping_(false)
+{
+    open_directory();
+    thread_ = std::thread(&WriteAheadLog::flusher, this);
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        stopping_ = true;
+    }
+    flush_cond_.notify_one();
+    thread_.join();
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void WriteAheadLog::open_directory()
+{
+    if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw_errno("WriteAheadLog: mkdir " + directory_);
+    }
+    std::ifstream in(directory_ + "/checkpoint");
+    if (in && !(in >> checkpoint_)) {
+        throw std::runtime_error("WriteAheadLog: bad checkpoint file in "
+            + directory_);
+    }
+
+    DIR *dir = ::opendir(directory_.c_str());
+    if (!dir) {
+        throw_errno("WriteAheadLog: opendir " + directory_);
+    }
+    while (const dirent *entry = ::readdir(dir)) {
+        const std::string name = entry->d_name;
+        const size_t suffix = name.size() - std::strlen(segment_suffix);
+        if (name.size() > std::strlen(segment_suffix)
+            && name.compare(suffix, std::string::npos,
+                segment_suffix) == 0) {
+            segments_.push_back(Segment {
+                std::strtoull(name.c_str(), nullptr, 10),
+                directory_ + "/" + name });
+        }
+    }
+    ::closedir(dir);
+    std::sort(segments_.begin(), segments_.end(),
+        [](const Segment &a, const Segment &b) {
+            return a.first < b.first;
+        });
+
+    if (segments_.empty()) {
+        next_ = checkpoint_ + 1;
+        start_segment(next_);
+    } else {
+        Sequence expected = segments_.front().first;
+        size_t intact = 0;
+        for (size_t i=0; i<segments_.size(); ++i) {
+            if (segments_[i].first != expected) {
+                throw std::runtime_error("WriteAheadLog: records missing "
+                    "before " + segments_[i].path);
+            }
+            struct stat st;
+            if (::stat(segments_[i].path.c_str(), &st) != 0) {
+                throw_errno("WriteAheadLog: stat " + segments_[i].path);
+            }
+            const size_t size = static_cast<size_t>(st.st_size);
+            intact = scan(segments_[i], expected, nullptr);
+            if (intact != size && (i + 1 != segments_.size()
+                    || record_after(read_file(segments_[i].path),
+                        intact, expected))) {
+                throw std::runtime_error("WriteAheadLog: damaged record in "
+                    + segments_[i].path);
+            }
+        }
+        // Cut off the records torn by a crash while they were written:
+        // the damage runs to the end of the file.
+        path_ = segments_.back().path;
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND);
+        if (fd_ < 0 || ::ftruncate(fd_, intact) != 0) {
+            throw_errno("WriteAheadLog: open " + path_);
+        }
+        segment_size_ = intact;
+        next_ = expected;
+    }
+    replay_end_ = next_ - 1;
+    durable_ = next_ - 1;
+}
+
+size_t WriteAheadLog::scan(const Segment &segment, Sequence &expected,
+    std::function<void(Sequence, const char*, size_t)> fn) const
+{
+    const std::vector<char> data = read_file(segment.path);
+    size_t offset = 0;
+    while (data.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        const size_t rest = data.size() - offset - sizeof(header);
+        if (header.size > rest || header.seq != expected) {
+            break;
+        }
+        const char *payload = data.data() + offset + sizeof(header);
+        const uint32_t crc = crc32(&header.seq, sizeof(header.seq),
+            crc32(payload, header.size));
+        if (crc != header.crc) {
+            break;
+        }
+        if (fn) {
+            fn(header.seq, payload, header.size);
+        }
+        ++expected;
+        offset += sizeof(header) + header.size;
+    }
+    return offset;
+}
+
+void WriteAheadLog::start_segment(Sequence first)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu%s",
+        static_cast<unsigned long long>(first), segment_suffix);
+    const std::string path = directory_ + "/" + name;
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND,
+        0644);
+    if (fd < 0) {
+        throw_errno("WriteAheadLog: open " + path);
+    }
+    sync_directory(directory_);
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = fd;
+    path_ = path;
+    segment_size_ = 0;
+    std::unique_lock<std::mutex> lock { mutex_ };
+    segments_.push_back(Segment { first, path });
+}
+
+WriteAheadLog::Sequence WriteAheadLog::append_async(const void *data,
+    size_t size)
+{
+    if (size > max_record_size) {
+        throw std::length_error("WriteAheadLog: record too large");
+    }
+    const uint32_t payload_crc = crc32(data, size);
+    bool wake;
+    Sequence seq;
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        seq = next_++;
+        const RecordHeader header { static_cast<uint32_t>(size),
+            crc32(&seq, sizeof(seq), payload_crc), seq };
+        wake = pending_.empty();
+        if (wake) {
+            first_pending_ = Clock::now();
+        }
+        const char *h = reinterpret_cast<const char*>(&header);
+        pending_.insert(pending_.end(), h, h + sizeof(header));
+        const char *p = static_cast<const char*>(data);
+        pending_.insert(pending_.end(), p, p + size);
+        wake = wake || pending_.size() >= options_.max_batch_bytes;
+    }
+    if (wake) {
+        flush_cond_.notify_one();
+    }
+    return seq;
+}
+
+void WriteAheadLog::wait_durable(Sequence seq)
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    durable_cond_.wait(lock, [&] { return durable_ >= seq || error_; });
+    if (durable_ < seq) {
+        std::rethrow_exception(error_);
+    }
+}
+
+WriteAheadLog::Sequence WriteAheadLog::durable() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return durable_;
+}
+
+void WriteAheadLog::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        flush_now_ = true;
+    }
+    flush_cond_.notify_one();
+}
+
+void WriteAheadLog::flusher()
+{
+    std::vector<char> batch;
+    std::unique_lock<std::mutex> lock { mutex_ };
+    for (;;) {
+        flush_cond_.wait(lock,
+            [this] { return !pending_.empty() || stopping_; });
+        if (pending_.empty()) {
+            break;
+        }
+        // The group commit window: let more records join the batch.
+        const Clock::time_point deadline =
+            first_pending_ + options_.max_delay;
+        while (!stopping_ && !flush_now_
+            && pending_.size() < options_.max_batch_bytes
+            && Clock::now() < deadline) {
+            flush_cond_.wait_until(lock, deadline);
+        }
+        flush_now_ = false;
+        batch.swap(pending_);
+        const Sequence last = next_ - 1;
+        const Sequence records = last - durable_;
+        lock.unlock();
+
+        uint64_t ns = 0;
+        try {
+            const Clock::time_point start = Clock::now();
+            write_batch(batch);
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start).count();
+            if (segment_size_ >= options_.segment_bytes) {
+                start_segment(last + 1);
+            }
+        } catch (...) {
+            lock.lock();
+            error_ = std::current_exception();
+            durable_cond_.notify_all();
+            return;
+        }
+
+        lock.lock();
+        durable_ = last;
+        stats_.records += records;
+        stats_.bytes += batch.size();
+        stats_.batch_records.record(records);
+        stats_.sync_ns.record(ns);
+        durable_cond_.notify_all();
+        batch.clear();
+    }
+}
+
+void WriteAheadLog::write_batch(const std::vector<char> &batch)
+{
+    write_all(fd_, batch.data(), batch.size(), path_);
+    if (options_.sync && ::fdatasync(fd_) != 0) {
+        throw_errno("WriteAheadLog: fdatasync " + path_);
+    }
+    segment_size_ += batch.size();
+}
+
+void WriteAheadLog::replay(
+    std::function<void(Sequence, const char*, size_t)> fn) const
+{
+    std::vector<Segment> segments;
+    Sequence checkpoint;
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        segments = segments_;
+        checkpoint = checkpoint_;
+    }
+    if (segments.empty()) {
+        return;
+    }
+    Sequence expected = segments.front().first;
+    for (const Segment &segment: segments) {
+        if (expected > replay_end_ || segment.first != expected) {
+            break;
+        }
+        scan(segment, expected,
+            [&](Sequence seq, const char *data, size_t size) {
+                if (seq > checkpoint && seq <= replay_end_) {
+                    fn(seq, data, size);
+                }
+            });
+    }
+}
+
+void WriteAheadLog::checkpoint(Sequence seq)
+{
+    std::unique_lock<std::mutex> serial { checkpoint_mutex_ };
+    if (seq > durable()) {
+        throw std::logic_error("WriteAheadLog::checkpoint: record "
+            "not durable yet");
+    }
+    if (seq <= checkpointed()) {
+        return;
+    }
+    // Replace the checkpoint file atomically.
+    const std::string path = directory_ + "/checkpoint";
+    const std::string temp = path + ".tmp";
+    const std::string text = std::to_string(seq) + "\n";
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw_errno("WriteAheadLog: open " + temp);
+    }
+    write_all(fd, text.data(), text.size(), temp);
+    if (::fdatasync(fd) != 0) {
+        ::close(fd);
+        throw_errno("WriteAheadLog: fdatasync " + temp);
+    }
+    ::close(fd);
+    if (::rename(temp.c_str(), path.c_str()) != 0) {
+        throw_errno("WriteAheadLog: rename " + temp);
+    }
+    sync_directory(directory_);
+
+    // Segments followed by one starting at or before seq+1 are done;
+    // the last segment is never removed.
+    std::vector<std::string> done;
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        checkpoint_ = seq;
+        size_t n = 0;
+        while (n + 1 < segments_.size()
+            && segments_[n+1].first <= seq + 1) {
+            done.push_back(segments_[n].path);
+            ++n;
+        }
+        segments_.erase(segments_.begin(), segments_.begin() + n);
+    }
+    for (const std::string &file: done) {
+        ::unlink(file.c_str());
+    }
+}
+
+WriteAheadLog::Sequence WriteAheadLog::checkpointed() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return checkpoint_;
+}
+
+WalStats WriteAheadLog::stats() const
+{
+    std::unique_lock<std::mutex> lock { mutex_ };
+    return stats_;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,268 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/wal.h A write-ahead log with group commit, and a Queue
+ *       whose messages survive the process.
+ *
+ * Records are appended to segment files in a directory, each with its
+ * length, a CRC-32 and a sequence number. A flusher thread writes all
+ * records appended meanwhile with one write() and one fdatasync() (a
+ * group commit), so concurrent producers share the cost of syncing. It
+ * waits up to max_delay for more records to join a batch, or until
+ * max_batch_bytes are pending.
+ *
+ * When opened, the log is scanned: damage at the end of the last
+ * segment, with no intact record behind it, is a batch torn by a crash
+ * and cut off; any other damage throws. replay() then returns all
+ * records after the last checkpoint().
+ *
+ * \code
+ * WalOptions options;
+ * options.max_delay = std::chrono::microseconds{500};
+ * DurableQueue<Order> orders("/var/lib/app/orders", options);
+ * orders.add(order);                       // returns when on disk
+ * WriteAheadLog::Sequence seq;
+ * Order o = orders.get(seq);
+ * process(o);
+ * orders.checkpoint(seq);                  // not replayed again
+ * \endcode
+ */
+
+#ifndef CPP11_WAL_H
+#define CPP11_WAL_H 1
+
+#include "cpp11/consumer.h"
+#include "cpp11/histogram.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// CRC-32 as used by zlib and Ethernet; pass the result of the previous
+/// part as \a crc to continue.
+uint32_t crc32(const void *data, size_t size, uint32_t crc=0);
+
+/// Settings of a WriteAheadLog.
+struct WalOptions {
+    /// A new segment file is started when the current one exceeds this.
+    size_t segment_bytes = 64 << 20;
+    /// How long the first record of a batch waits for others to join.
+    std::chrono::microseconds max_delay { 1000 };
+    /// A batch is written as soon as it has this many bytes.
+    size_t max_batch_bytes = 1 << 20;
+    /// fdatasync() each batch; false only writes (survives a process
+    /// crash, but not a power failure).
+    bool sync = true;
+};
+
+/// Counters of a WriteAheadLog.
+struct WalStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    Histogram batch_records;    // records per group commit
+    Histogram sync_ns;          // duration of write() and fdatasync()
+};
+
+/**
+ * An append-only log of byte records in segment files. Any number of
+ * threads may append concurrently. Throws std::system_error on I/O
+ * errors, std::runtime_error on damaged files.
+ */
+class WriteAheadLog {
+  public:
+    /// Numbers records from 1 on, in append order.
+    using Sequence = uint64_t;
+    using Clock = std::chrono::steady_clock;
+
+    /// Opens (or creates) the log in \a directory and cuts off torn
+    /// records at its end.
+    explicit WriteAheadLog(const std::string &directory,
+        const WalOptions &options=WalOptions());
+    /// Commits all pending records.
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog &)=delete;
+    WriteAheadLog &operator=(const WriteAheadLog &)=delete;
+
+    /// Appends a record and waits until it is durable.
+    Sequence append(const void *data, size_t size) {
+        const Sequence seq = append_async(data, size);
+        wait_durable(seq);
+        return seq;
+    }
+    Sequence append(const std::string &record) {
+        return append(record.data(), record.size());
+    }
+    /// Appends a record without waiting, see wait_durable().
+    Sequence append_async(const void *data, size_t size);
+    /// Waits until record \a seq is durable; rethrows a write error.
+    void wait_durable(Sequence seq);
+    /// The last durable record.
+    Sequence durable() const;
+    /// Starts a group commit now, without waiting for max_delay.
+    void flush();
+
+    /**
+     * Calls \a fn for each record found when opening that comes after
+     * the checkpoint, in order.
+     */
+    void replay(std::function<void(Sequence, const char*, size_t)> fn)
+        const;
+
+    /**
+     * Marks all records up to \a seq as processed: replay() skips them
+     * from now on and segment files holding only such records are
+     * removed.
+     */
+    void checkpoint(Sequence seq);
+    Sequence checkpointed() const;
+
+    WalStats stats() const;
+
+  private:
+    struct Segment {
+        Sequence first;     // sequence of the first record
+        std::string path;
+    };
+
+    void open_directory();
+    // Reads a segment, calls fn for the intact records, returns the
+    // length of the intact part.
+    size_t scan(const Segment &segment, Sequence &expected,
+        std::function<void(Sequence, const char*, size_t)> fn) const;
+    void start_segment(Sequence first);
+    void flusher();
+    void write_batch(const std::vector<char> &batch);
+
+    const std::string directory_;
+    const WalOptions options_;
+    std::vector<Segment> segments_;
+    Sequence replay_end_;               // last record found when opened
+    // The last segment, only used by the flusher once it runs.
+    std::string path_;
+    int fd_;
+    size_t segment_size_;
+
+    std::mutex checkpoint_mutex_;           // serializes checkpoint()
+    mutable std::mutex mutex_;
+    std::condition_variable flush_cond_;    // wakes the flusher
+    std::condition_variable durable_cond_;  // wakes waiting producers
+    std::vector<char> pending_;             // records not yet written
+    Clock::time_point first_pending_;
+    Sequence next_;
+    Sequence durable_;
+    Sequence checkpoint_;
+    bool flush_now_;
+    bool stopping_;
+    std::exception_ptr error_;
+    WalStats stats_;
+    std::thread thread_;
+};
+
+/**
+ * A Queue whose messages are logged before they are queued: after a
+ * crash the messages not checkpointed are queued again (at least once
+ * delivery). Messages are trivially copyable, as for ShmQueue.
+ */
+template<typename Message>
+class DurableQueue {
+    static_assert(std::is_trivially_copyable<Message>::value,
+                  "messages are logged as bytes");
+    struct Entry {
+        WriteAheadLog::Sequence seq;
+        Message message;
+    };
+    WriteAheadLog log_;
+    Queue<Entry> queue_;
+    // Durable messages wait here until all lower sequence numbers are
+    // queued, so the queue is in sequence order; failed appends leave
+    // a hole (false) that is skipped.
+    std::mutex order_mutex_;
+    std::map<WriteAheadLog::Sequence, std::pair<bool, Entry>> durable_;
+    WriteAheadLog::Sequence next_;
+
+    void release(const Entry &e, bool logged) {
+        std::lock_guard<std::mutex> lock(order_mutex_);
+        durable_[e.seq] = std::make_pair(logged, e);
+        auto it = durable_.begin();
+        while (it != durable_.end() && it->first == next_) {
+            if (it->second.first) {
+                queue_.add(it->second.second);
+            }
+            it = durable_.erase(it);
+            ++next_;
+        }
+    }
+
+  public:
+    /// Opens the log in \a directory and queues its messages.
+    explicit DurableQueue(const std::string &directory,
+        const WalOptions &options=WalOptions())
+        : log_(directory, options)
+    {
+        log_.replay([this](WriteAheadLog::Sequence seq, const char *data,
+                size_t size) {
+            if (size != sizeof(Message)) {
+                throw std::runtime_error(
+                    "DurableQueue: wrong record size");
+            }
+            Entry e;
+            e.seq = seq;
+            std::memcpy(&e.message, data, sizeof(Message));
+            queue_.add(e);
+        });
+        next_ = log_.durable() + 1;
+    }
+
+    /// Logs and queues \a m, returns when it is durable. Messages are
+    /// queued in the order of their sequence numbers, also when added
+    /// by several threads.
+    WriteAheadLog::Sequence add(const Message &m) {
+        Entry e;
+        e.message = m;
+        e.seq = log_.append_async(&m, sizeof(Message));
+        try {
+            log_.wait_durable(e.seq);
+        } catch (...) {
+            release(e, false);
+            throw;
+        }
+        release(e, true);
+        return e.seq;
+    }
+
+    /// Removes the oldest message, waits while the queue is empty;
+    /// \a seq is to be passed to checkpoint() when it is processed.
+    Message get(WriteAheadLog::Sequence &seq) {
+        Entry e = queue_.get();
+        seq = e.seq;
+        return e.message;
+    }
+    Message get() {
+        WriteAheadLog::Sequence seq;
+        return get(seq);
+    }
+
+    /// All messages up to \a seq are processed (see
+    /// WriteAheadLog::checkpoint()). With several consumers, that is
+    /// the lowest \a seq not processed yet, minus one.
+    void checkpoint(WriteAheadLog::Sequence seq) { log_.checkpoint(seq); }
+
+    size_t size() const { return queue_.size(); }
+    WriteAheadLog &log() { return log_; }
+};
+
+#endif // CPP11_WAL_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,213 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/workstealing.cc A work-stealing pool of consumer threads.
+ */
+
+#include "cpp11/workstealing.h"
+
+#include <stdexcept>
+
+struct WorkStealingPool::Worker {
+    WorkStealingPool &pool_;
+    ChaseLevDeque<Task*> deque_;
+    // xorshift state for picking victims, seeded per worker.
+    uint32_t random_;
+
+    Worker(WorkStealingPool &pool, uint32_t seed)
+        : pool_(pool), random_(seed) { }
+
+    uint32_t next_random() {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+    }
+};
+
+thread_local WorkStealingPool::Worker *WorkStealingPool::current_ = nullptr;
+
+WorkStealingPool::WorkStealingPool(size_t workers)
+    : inject_size_{0}, sleepers_{0}, stopping_{false}
+{
+    pending_.value.store(0);
+    if (workers == 0) {
+        workers = 1;
+    }
+    for (size_t n=0; n<workers; ++n) {
+        workers_.emplace_back(new Worker(*this, 2463534242u + 97u*n));
+    }
+    for (auto &worker: workers_) {
+        Worker *w = worker.get();
+        threads_.emplace_back([this, w] { run(*w); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    shutdown();
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    Task *t = new Task(std::move(task));
+    Worker *self = current_;
+    // Publish first, then count: the seq_cst pair pending_/sleepers_ makes
+    // sure that either we see the sleeper or the sleeper sees the task.
+    if (self && &self->pool_ == this) {
+        self->deque_.push(t);
+        pending_.value.fetch_add(1);
+    } else {
+        std::unique_lock<std::mutex> lock { inject_mutex_ };
+        if (stopping_.load()) {
+            lock.unlock();
+            delete t;
+            throw std::logic_error(
+                "WorkStealingPool::submit after shutdown");
+        }
+        inject_.push_back(t);
+        inject_size_.fetch_add(1, std::memory_order_relaxed);
+        // Still under the lock, so shutdown() cannot let the workers
+        // stop between the push and the count.
+        pending_.value.fetch_add(1);
+    }
+    if (sleepers_.load() > 0) {
+        wake_one();
+    }
+}
+
+void WorkStealingPool::wake_one()
+{
+    // Taking the mutex avoids notifying between the sleeper's predicate
+    // check and its actual wait.
+    { std::unique_lock<std::mutex> lock { park_mutex_ }; }
+    park_cond_.notify_one();
+}
+
+void WorkStealingPool::shutdown()
+{
+    std::call_once(shutdown_once_, [this] {
+        {
+            // Under inject_mutex_, so no external submit can slip in.
+            std::unique_lock<std::mutex> lock { inject_mutex_ };
+            stopping_.store(true);
+        }
+        {
+            std::unique_lock<std::mutex> lock { park_mutex_ };
+        }
+        park_cond_.notify_all();
+        for (auto &t: threads_) {
+            t.join();
+        }
+    });
+}
+
+WorkStealingPool::Task *WorkStealingPool::steal(Worker &self)
+{
+    const size_t n = workers_.size();
+    if (n < 2) {
+        return nullptr;
+    }
+    // A few rounds of random victims; it is not a problem to miss work
+    // here, the caller re-checks pending_ before parking.
+    for (size_t attempt=0; attempt<2*n; ++attempt) {
+        Worker &victim = *workers_[self.next_random() % n];
+        if (&victim == &self) {
+            continue;
+        }
+        if (Task *t = victim.deque_.steal()) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+WorkStealingPool::Task *WorkStealingPool::find_task(Worker &self)
+{
+    if (Task *t = self.deque_.take()) {
+        return t;
+    }
+    if (inject_size_.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> lock { inject_mutex_ };
+        if (!inject_.empty()) {
+            Task *t = inject_.front();
+            inject_.pop_front();
+            inject_size_.fetch_sub(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+    return steal(self);
+}
+
+WorkStealingPool::Task *WorkStealingPool::steal_from_outside()
+{
+    if (inject_size_.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> lock { inject_mutex_ };
+        if (!inject_.empty()) {
+            Task *t = inject_.front();
+            inject_.pop_front();
+            inject_size_.fetch_sub(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+    // Any thread may steal; start at a per-thread varying victim.
+    static thread_local uint32_t start = 0;
+    const size_t n = workers_.size();
+    for (size_t i=0; i<n; ++i) {
+        if (Task *t = workers_[(start + i) % n]->deque_.steal()) {
+            ++start;
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::execute(Task *t)
+{
+    pending_.value.fetch_sub(1);
+    std::unique_ptr<Task> task { t };
+    (*task)();
+}
+
+bool WorkStealingPool::run_one()
+{
+    Worker *self = current_;
+    Task *t = self && &self->pool_ == this
+        ? find_task(*self) : steal_from_outside();
+    if (!t) {
+        return false;
+    }
+    execute(t);
+    return true;
+}
+
+void WorkStealingPool::run(Worker &self)
+{
+    current_ = &self;
+    for (;;) {
+        if (Task *t = find_task(self)) {
+            execute(t);
+            continue;
+        }
+        if (pending_.value.load() > 0) {
+            // Counted but not visible yet, or lost a steal race.
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock { park_mutex_ };
+        sleepers_.fetch_add(1);
+        park_cond_.wait(lock, [this] {
+            return pending_.value.load() > 0 || stopping_.load();
+        });
+        sleepers_.fetch_sub(1);
+        if (stopping_.load() && pending_.value.load() <= 0
+            && inject_size_.load() == 0) {
+            break;
+        }
+    }
+    current_ = nullptr;
+}
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,280 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file cpp11/workstealing.h A work-stealing pool of consumer threads.
+ *
+ * A single Queue drained by several consumers scales badly, because
+ * every get() serializes on the same mutex and cache line. Here each
+ * worker owns a Chase-Lev deque: the owner pushes and pops at the bottom
+ * without any lock, idle workers steal from the top of a randomly chosen
+ * victim. Work submitted from outside the pool enters through a shared
+ * injection queue.
+ *
+ * \code
+ * WorkStealingPool pool { 4 };
+ * pool.submit([] { std::cout << "hello" << std::endl; });
+ * pool.shutdown(); // runs everything submitted so far, then joins
+ * \endcode
+ */
+
+#ifndef CPP11_WORKSTEALING_H
+#define CPP11_WORKSTEALING_H 1
+
+#include "cpp11/cacheline.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+/**
+ * The lock-free work-stealing deque of Chase and Lev ("Dynamic Circular
+ * Work-Stealing Deque", SPAA 2005), using the C++ 2011 memory orders
+ * proposed by Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+ *
+ * Only the owning thread may push() and take(), any thread may steal().
+ * T must be a trivially copyable handle (such as a pointer), and the
+ * value T() means "nothing".
+ */
+template<typename T>
+class ChaseLevDeque {
+    // A circular array; grows by replacing it with a copy twice as big.
+    struct Array {
+        const int64_t size_;
+        std::unique_ptr<std::atomic<T>[]> slots_;
+
+        explicit Array(int64_t size)
+            : size_(size), slots_(new std::atomic<T>[size]) { }
+        T get(int64_t i) const {
+            return slots_[i & (size_-1)].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, T value) {
+            slots_[i & (size_-1)].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    CacheAligned<std::atomic<int64_t>> top_;
+    CacheAligned<std::atomic<int64_t>> bottom_;
+    std::atomic<Array*> array_;
+    // Replaced arrays may still be read by a concurrent thief, so they
+    // are only released together with the deque (total size is bounded
+    // by twice the final array size).
+    std::vector<std::unique_ptr<Array>> arrays_;
+
+    Array *grow(Array *a, int64_t bottom, int64_t top) {
+        Array *bigger = new Array(a->size_*2);
+        for (int64_t i=top; i<bottom; ++i) {
+            bigger->put(i, a->get(i));
+        }
+        arrays_.emplace_back(bigger);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+  public:
+    explicit ChaseLevDeque(int64_t initial_size=256) {
+        // Size must be a power of two for cheap index masking.
+        int64_t size = 1;
+        while (size < initial_size) {
+            size *= 2;
+        }
+        top_.value.store(0, std::memory_order_relaxed);
+        bottom_.value.store(0, std::memory_order_relaxed);
+        arrays_.emplace_back(new Array(size));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+    ChaseLevDeque(const ChaseLevDeque &)=delete;
+    ChaseLevDeque &operator=(const ChaseLevDeque &)=delete;
+
+    /// Owner only: adds an element at the bottom.
+    void push(T value) {
+        int64_t b = bottom_.value.load(std::memory_order_relaxed);
+        int64_t t = top_.value.load(std::memory_order_acquire);
+        Array *a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->size_ - 1) {
+            a = grow(a, b, t);
+        }
+        a->put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.value.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// Owner only: removes the most recently pushed element (LIFO).
+    T take() {
+        int64_t b = bottom_.value.load(std::memory_order_relaxed) - 1;
+        Array *a = array_.load(std::memory_order_relaxed);
+        bottom_.value.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.value.load(std::memory_order_relaxed);
+        T value = T();
+        if (t <= b) {
+            value = a->get(b);
+            if (t == b) {
+                // Last element: race against thieves for it.
+                if (!top_.value.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst,
+                        std::memory_order_relaxed)) {
+                    value = T();
+                }
+                bottom_.value.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.value.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    /// Any thread: removes the oldest element (FIFO), T() if none or if
+    /// another thread won the race for it.
+    T steal() {
+        int64_t t = top_.value.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.value.load(std::memory_order_acquire);
+        if (t < b) {
+            Array *a = array_.load(std::memory_order_acquire);
+            T value = a->get(t);
+            if (top_.value.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed)) {
+                return value;
+            }
+        }
+        return T();
+    }
+
+    /// Approximate number of elements, exact if called by the owner
+    /// while nobody steals.
+    int64_t size() const {
+        int64_t b = bottom_.value.load(std::memory_order_relaxed);
+        int64_t t = top_.value.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+};
+
+/**
+ * A fixed set of worker threads executing submitted callables.
+ *
+ * Tasks submitted by a task running in the pool go to the local deque
+ * of the running worker (cheap and cache friendly), other submissions
+ * go to the injection queue. Idle workers first look at their own deque,
+ * then at the injection queue, then try to steal from random victims,
+ * and finally park on a condition variable.
+ */
+class WorkStealingPool {
+  public:
+    using Task = std::function<void()>;
+
+    /// Starts \a workers threads (at least one).
+    explicit WorkStealingPool(
+        size_t workers = std::thread::hardware_concurrency());
+    /// Calls shutdown().
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &)=delete;
+    WorkStealingPool &operator=(const WorkStealingPool &)=delete;
+
+    /**
+     * Schedules \a task for execution by some worker. Like with
+     * std::thread, an exception escaping a task terminates. Throws
+     * std::logic_error when called from outside of the pool after
+     * shutdown() has been started.
+     */
+    void submit(Task task);
+
+    /**
+     * Graceful shutdown: no new work is accepted from outside, all work
+     * submitted so far (including work spawned by it) is run, then the
+     * workers are joined. Calling it again does nothing.
+     */
+    void shutdown();
+
+    /**
+     * Runs one pending task on the calling thread, if it finds one, and
+     * returns whether it did. Lets a thread that waits for results of
+     * the pool help instead of blocking (which could dead-lock when
+     * called from within a task).
+     */
+    bool run_one();
+
+    /// Number of worker threads.
+    size_t size() const { return workers_.size(); }
+
+    /// Number of tasks that have been submitted but not yet started.
+    int64_t pending() const {
+        return pending_.value.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Worker;
+
+    void run(Worker &self);
+    Task *find_task(Worker &self);
+    Task *steal(Worker &self);
+    Task *steal_from_outside();
+    void execute(Task *t);
+    void wake_one();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    // Work from threads which are not workers of this pool.
+    std::mutex inject_mutex_;
+    std::deque<Task*> inject_;
+    std::atomic<size_t> inject_size_;
+
+    // Submitted but not yet taken. Temporarily negative when a thief
+    // takes a task before the submitter counted it.
+    CacheAligned<std::atomic<int64_t>> pending_;
+
+    // Parking of idle workers.
+    std::mutex park_mutex_;
+    std::condition_variable park_cond_;
+    std::atomic<int> sleepers_;
+    std::atomic<bool> stopping_;
+    std::once_flag shutdown_once_;
+
+    // The worker the current thread belongs to, if it is one.
+    static thread_local Worker *current_;
+};
+
+/**
+ * A consumer pool for messages: the callable \a handler is invoked by
+ * the workers for each message passed to add(), so a MessagePool can
+ * replace a Queue with a single Consumer thread. Messages may be handled
+ * concurrently and in any order.
+ */
+template<typename Message>
+class MessagePool {
+  public:
+    using Handler = std::function<void(const Message &)>;
+
+    explicit MessagePool(Handler handler,
+        size_t workers = std::thread::hardware_concurrency())
+        : handler_(handler), pool_(workers) { }
+
+    void add(const Message &m) {
+        const Handler *handler = &handler_;
+        pool_.submit([handler, m] { (*handler)(m); });
+    }
+
+    /// Handles all messages added so far and stops the workers.
+    void shutdown() { pool_.shutdown(); }
+
+    size_t size() const { return pool_.size(); }
+
+  private:
+    // Declared before pool_, so the pool is joined before it goes away.
+    const Handler handler_;
+    WorkStealingPool pool_;
+};
+
+#endif // CPP11_WORKSTEALING_H
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,190 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/biguinttest.cc Tests BigUInt arithmetic, Karatsuba against
+ *       limb by limb products, decimal conversion and big_factorial.
+ */
+
+#include "cpp11/biguint.h"
+#include "cpp11/factorial.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+BigUInt random_number(std::mt19937_64 &random, size_t limbs)
+{
+    std::vector<BigUInt::Limb> values(limbs);
+    for (BigUInt::Limb &value: values) {
+        value = random();
+    }
+    // Also all ones, which gives the most carries.
+    if (limbs % 3 == 0) {
+        std::fill(values.begin(), values.end(), ~BigUInt::Limb{0});
+    }
+    return BigUInt::from_limbs(values);
+}
+
+// a b as the sum of a b[i] 2^(64 i), without Karatsuba.
+BigUInt reference_product(const BigUInt &a, const BigUInt &b)
+{
+    BigUInt product;
+    for (size_t i=0; i<b.limbs().size(); ++i) {
+        product += (a * b.limbs()[i]) << (64 * i);
+    }
+    return product;
+}
+
+// Decimal digits by dividing by 10 again and again.
+std::string reference_decimal(BigUInt value)
+{
+    std::string digits;
+    do {
+        digits.insert(digits.begin(),
+            static_cast<char>('0' + value.divide(10)));
+    } while (!value.is_zero());
+    return digits;
+}
+
+std::string random_digits(std::mt19937_64 &random, size_t size)
+{
+    std::string digits;
+    for (size_t i=0; i<size; ++i) {
+        digits.push_back(static_cast<char>('0' + random() % 10));
+    }
+    // No leading zero, to_string() drops it.
+    if (digits[0] == '0') {
+        digits[0] = '1';
+    }
+    return digits;
+}
+
+} // namespace
+
+class BigUIntTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(BigUIntTest);
+    CPPUNIT_TEST(testArithmetic);
+    CPPUNIT_TEST(testMultiply);
+    CPPUNIT_TEST(testDecimal);
+    CPPUNIT_TEST(testFactorial);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testArithmetic() {
+        const BigUInt max = ~BigUInt::Limb{0};
+        BigUInt a = max + 1;
+        CPPUNIT_ASSERT(a.limbs().size() == 2 && a.bits() == 65);
+        CPPUNIT_ASSERT(a - 1 == max);
+        CPPUNIT_ASSERT((a << 100) >> 100 == a);
+        CPPUNIT_ASSERT((a << 100).bits() == 165);
+        CPPUNIT_ASSERT((max >> 64).is_zero());
+        CPPUNIT_ASSERT(max * max == (a - 2) * a + 1);
+        CPPUNIT_ASSERT(BigUInt(7) < a && a > max && a != max);
+        CPPUNIT_ASSERT(a * 0 == BigUInt());
+        CPPUNIT_ASSERT_THROW(max - a, std::underflow_error);
+
+        BigUInt b = BigUInt(1) << 130;
+        CPPUNIT_ASSERT(b.divide(1000) == 824);
+        CPPUNIT_ASSERT(b * 1000 + 824 == BigUInt(1) << 130);
+        CPPUNIT_ASSERT_THROW(b.divide(0), std::domain_error);
+
+        CPPUNIT_ASSERT_THROW(BigUInt::from_string(""),
+            std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(BigUInt::from_string("12a"),
+            std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(BigUInt::from_string("-1"),
+            std::invalid_argument);
+    }
+
+    void testMultiply() {
+        std::mt19937_64 random { 47 };
+        ThreadPool pool { 4 };
+        // Schoolbook, balanced and unbalanced Karatsuba, and parallel.
+        const size_t sizes[][2] = { { 1, 1 }, { 31, 40 }, { 32, 32 },
+            { 33, 64 }, { 65, 64 }, { 100, 33 }, { 257, 255 },
+            { 1000, 999 }, { 2500, 1100 }, { 3000, 3000 } };
+        for (const size_t *size: sizes) {
+            const BigUInt a = random_number(random, size[0]);
+            const BigUInt b = random_number(random, size[1]);
+            const BigUInt expected = reference_product(a, b);
+            CPPUNIT_ASSERT(a * b == expected);
+            CPPUNIT_ASSERT(b * a == expected);
+            CPPUNIT_ASSERT(BigUInt::multiply(a, b, &pool) == expected);
+            CPPUNIT_ASSERT(a * a == reference_product(a, a));
+        }
+    }
+
+    void testDecimal() {
+        CPPUNIT_ASSERT(BigUInt().to_string() == "0");
+        CPPUNIT_ASSERT(BigUInt::from_string("000") == BigUInt());
+        CPPUNIT_ASSERT(BigUInt::from_string("18446744073709551616")
+            == BigUInt(1) << 64);
+        CPPUNIT_ASSERT((BigUInt(1) << 64).to_string()
+            == "18446744073709551616");
+
+        std::mt19937_64 random { 4711 };
+        ThreadPool pool { 4 };
+        for (size_t size: { 1, 19, 20, 38, 39, 457, 1000, 5000, 60000 }) {
+            const std::string digits = random_digits(random, size);
+            const BigUInt value = BigUInt::from_string(digits);
+            CPPUNIT_ASSERT(value.to_string() == digits);
+            CPPUNIT_ASSERT(BigUInt::from_string(digits, pool) == value);
+            CPPUNIT_ASSERT(value.to_string(pool) == digits);
+            if (size <= 5000) {
+                CPPUNIT_ASSERT(reference_decimal(value) == digits);
+            }
+        }
+        // Powers of ten are the conversion's divisors; 10^k - 1 is right
+        // below them.
+        BigUInt power = 1;
+        for (size_t k=1; k<=3000; ++k) {
+            power *= 10;
+            if (k % 19 == 0 || k % 19 == 1 || k == 2432) {
+                CPPUNIT_ASSERT(power.to_string()
+                    == "1" + std::string(k, '0'));
+                CPPUNIT_ASSERT((power - 1).to_string()
+                    == std::string(k, '9'));
+            }
+        }
+    }
+
+    void testFactorial() {
+        for (unsigned n=0; n<=max_factorial128; ++n) {
+            const unsigned __int128 expected = factorial128(n);
+            CPPUNIT_ASSERT(big_factorial(n) == BigUInt::from_limbs({
+                static_cast<BigUInt::Limb>(expected),
+                static_cast<BigUInt::Limb>(expected >> 64) }));
+        }
+        CPPUNIT_ASSERT(big_factorial(100).to_string() ==
+            "93326215443944152681699238856266700490715968264381621468592963"
+            "89521759999322991560894146397615651828625369792082722375825118"
+            "5210916864000000000000000000000000");
+
+        const std::string digits = big_factorial(1000).to_string();
+        unsigned sum = 0;
+        for (char c: digits) {
+            sum += static_cast<unsigned>(c - '0');
+        }
+        CPPUNIT_ASSERT(digits.size() == 2568 && sum == 10539);
+
+        ThreadPool pool { 4 };
+        for (unsigned n: { 1u, 2u, 3u, 200u, 4321u, 30000u }) {
+            const BigUInt expected = range_product(1, n);
+            CPPUNIT_ASSERT(big_factorial(n) == expected);
+            CPPUNIT_ASSERT(big_factorial(n, pool) == expected);
+        }
+        CPPUNIT_ASSERT(range_product(5, 4) == 1);
+        CPPUNIT_ASSERT(range_product(11, 13) == 1716);
+        CPPUNIT_ASSERT(big_factorial(30000).to_string(pool).size()
+            == 121288);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BigUIntTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,222 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/colorparsertest.cc Tests the SWAR color parser of
+ *       src/cpp11/colorparser.h against the _col literals.
+ */
+
+#include "cpp11/colorparser.h"
+
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+// Global, for std::vector's == to find them by argument lookup.
+inline bool operator==(const ColorParseError &a, const ColorParseError &b)
+{
+    return a.offset == b.offset && std::string(a.what) == b.what;
+}
+
+inline bool operator==(const ParsedColors &a, const ParsedColors &b)
+{
+    return a.colors == b.colors && a.errors == b.errors;
+}
+
+namespace {
+
+// Parses token by token with the _col literal operator (and stoull for
+// decimal), recording only the offsets of errors.
+ParsedColors reference(const std::string &text)
+{
+    ParsedColors parsed;
+    const char *separators = " \t\r\n,";
+    size_t begin = text.find_first_not_of(separators);
+    while (begin != std::string::npos) {
+        size_t end = text.find_first_of(separators, begin);
+        end = end == std::string::npos ? text.size() : end;
+        const std::string token = text.substr(begin, end - begin);
+        try {
+            if (token[0] == '#' || token.find_first_not_of("0123456789")
+                != std::string::npos) {
+                parsed.colors.push_back(
+                    operator"" _col(token.data(), token.size()));
+            } else if (token.size() <= 10) {
+                parsed.colors.push_back(operator"" _col(
+                    std::stoull(token)));
+            } else {
+                throw std::out_of_range("decimal");
+            }
+        } catch (const std::logic_error &) {
+            parsed.errors.push_back(ColorParseError { begin, "" });
+        }
+        begin = text.find_first_not_of(separators, end);
+    }
+    return parsed;
+}
+
+// Random tokens of all kinds, some broken.
+std::string random_text(size_t tokens, unsigned seed)
+{
+    std::mt19937 random { seed };
+    const char *hex = "0123456789abcdefABCDEF";
+    const char *junk = "xg#-.Z\x80";
+    const char *space[] = { " ", "\n", ",", ", ", "\t\t", "\r\n",
+        "               " };
+    std::string text;
+    for (size_t i=0; i<tokens; ++i) {
+        std::string token;
+        const uint32_t value = random() >> (random() % 32);
+        char buffer[16];
+        switch (random() % 4) {
+        case 0:
+            std::snprintf(buffer, sizeof(buffer), "%u", value);
+            break;
+        case 1:
+            std::snprintf(buffer, sizeof(buffer), "0%c%x",
+                random() % 2 ? 'x' : 'X', value);
+            break;
+        case 2:
+            std::snprintf(buffer, sizeof(buffer), "#%08x", value);
+            break;
+        default:
+            std::snprintf(buffer, sizeof(buffer), "#%06x",
+                value & 0xffffff);
+        }
+        token = buffer;
+        if (random() % 8 == 0) {
+            // Mixed case, an odd character or length.
+            token[random() % token.size()] = random() % 2
+                ? hex[random() % 22] : junk[random() % 7];
+            if (random() % 2) {
+                token.append(random() % 12, hex[random() % 10]);
+            }
+        }
+        text += token;
+        text += space[random() % 7];
+    }
+    return text;
+}
+
+// The same ignoring the error messages (the reference has none).
+bool same(ParsedColors a, ParsedColors b)
+{
+    for (ColorParseError &e: a.errors) {
+        e.what = "";
+    }
+    for (ColorParseError &e: b.errors) {
+        e.what = "";
+    }
+    return a == b;
+}
+
+} // namespace
+
+class ColorParserTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ColorParserTest);
+    CPPUNIT_TEST(testTokens);
+    CPPUNIT_TEST(testErrors);
+    CPPUNIT_TEST(testRandom);
+    CPPUNIT_TEST(testParallel);
+    CPPUNIT_TEST(testStream);
+    CPPUNIT_TEST(testFile);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testTokens() {
+        const std::string text = "0 4294967295 0x1 0XaBcDeF01,#00ff00"
+            "\n#80FF0000\t0000000012 0x00000000";
+        const ParsedColors parsed = parse_colors(text.data(), text.size());
+        CPPUNIT_ASSERT(parsed.errors.empty());
+        const std::vector<Color> expected { 0_col, 0xffffffff_col,
+            0x1_col, 0xabcdef01_col, 0xff00ff00_col, "#80ff0000"_col,
+            12_col, 0_col };
+        CPPUNIT_ASSERT(parsed.colors == expected);
+        CPPUNIT_ASSERT(parse_colors("", 0).colors.empty());
+        CPPUNIT_ASSERT(parse_colors(" ,\n", 3).colors.empty());
+    }
+
+    void testErrors() {
+        const std::string text = "12 4294967296 0x 0x123456789 #12345 "
+            "#1234567g 12a 01234567890123456789 7";
+        const ParsedColors parsed = parse_colors(text.data(), text.size());
+        CPPUNIT_ASSERT(parsed.colors == std::vector<Color>({ 12_col,
+            7_col }));
+        const std::vector<ColorParseError> expected {
+            { 3, "more than 0xffffffff" }, { 14, "not a color" },
+            { 17, "not a color" }, { 29, "not a color" },
+            { 36, "not a color" }, { 46, "not a color" },
+            { 50, "too long for a color" } };
+        CPPUNIT_ASSERT(parsed.errors == expected);
+    }
+
+    void testRandom() {
+        for (unsigned seed=0; seed<20; ++seed) {
+            const std::string text = random_text(1000, seed);
+            const ParsedColors parsed =
+                parse_colors(text.data(), text.size());
+            CPPUNIT_ASSERT(same(parsed, reference(text)));
+            CPPUNIT_ASSERT(!parsed.errors.empty());
+        }
+    }
+
+    // Any chunk size gives the sequential result.
+    void testParallel() {
+        ThreadPool pool { 4 };
+        const std::string text = random_text(10000, 42);
+        const ParsedColors expected =
+            parse_colors(text.data(), text.size());
+        for (size_t chunk: { 0, 1, 17, 100, 4096, 1 << 20 }) {
+            CPPUNIT_ASSERT(parse_colors(text.data(), text.size(), pool,
+                chunk) == expected);
+        }
+    }
+
+    // Also pieces that cut tokens, or are within a token.
+    void testStream() {
+        const std::string text = random_text(2000, 7);
+        const ParsedColors expected =
+            parse_colors(text.data(), text.size());
+        std::mt19937 random { 1 };
+        for (size_t most: { 1, 3, 9, 20, 1000 }) {
+            ColorStreamParser parser;
+            ParsedColors parsed;
+            size_t at = 0;
+            while (at < text.size()) {
+                const size_t n = std::min(text.size() - at,
+                    size_t{random() % most + 1});
+                parser.parse(text.data() + at, n, parsed);
+                at += n;
+            }
+            parser.finish(parsed);
+            CPPUNIT_ASSERT(parser.offset() == text.size());
+            CPPUNIT_ASSERT(parsed == expected);
+        }
+    }
+
+    void testFile() {
+        char name[] = "/tmp/cpp11-colorparsertest-XXXXXX";
+        const int fd = ::mkstemp(name);
+        CPPUNIT_ASSERT(fd >= 0);
+        const std::string text = random_text(5000, 3);
+        CPPUNIT_ASSERT(::write(fd, text.data(), text.size())
+            == ssize_t(text.size()));
+        ::close(fd);
+        ThreadPool pool { 2 };
+        const ParsedColors parsed = parse_color_file(name, pool, 4096);
+        ::unlink(name);
+        CPPUNIT_ASSERT(parsed == parse_colors(text.data(), text.size()));
+        CPPUNIT_ASSERT_THROW(MappedFile { name }, std::system_error);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ColorParserTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
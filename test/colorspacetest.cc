@@ -0,0 +1,167 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/colorspacetest.cc Tests the compile time math of
+ *       src/cpp11/constexprmath.h and the conversions of
+ *       src/cpp11/colorspace.h against the direct math.
+ */
+
+#include "cpp11/colorspace.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+constexpr unsigned twice(unsigned i) { return 2 * i; }
+
+// Reference JPEG conversion in double.
+YCbCr ycbcr_exact(Color c)
+{
+    const double r = c.r(), g = c.g(), b = c.b();
+    return YCbCr {
+        static_cast<uint8_t>(std::lround(0.299 * r + 0.587 * g
+            + 0.114 * b)),
+        static_cast<uint8_t>(std::lround(128 - 0.168735892 * r
+            - 0.331264108 * g + 0.5 * b)),
+        static_cast<uint8_t>(std::lround(128 + 0.5 * r
+            - 0.418687589 * g - 0.081312411 * b))
+    };
+}
+
+} // namespace
+
+class ColorspaceTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ColorspaceTest);
+    CPPUNIT_TEST(testMath);
+    CPPUNIT_TEST(testLinear);
+    CPPUNIT_TEST(testEncode);
+    CPPUNIT_TEST(testGray);
+    CPPUNIT_TEST(testYCbCr);
+    CPPUNIT_TEST(testBatch);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testMath() {
+        static_assert(cx::abs(cx::exp(1) - 2.718281828459045) < 1e-14,
+            "e");
+        static_assert(cx::abs(cx::log(1000) - 6.907755278982137) < 1e-13,
+            "log");
+        static_assert(cx::abs(cx::pow(2, 0.5) - 1.4142135623730951)
+            < 1e-14, "sqrt 2");
+        static_assert(cx::round(-2.5) == -3 && cx::round(2.49) == 2,
+            "round");
+        using Twice = cx::Table<unsigned, unsigned, twice, 1000>;
+        static_assert(Twice::size == 1000 && Twice::values[999] == 1998,
+            "table");
+        for (double x: { 1e-6, 0.01, 0.5, 1.0, 3.7, 123.0, 1e8 }) {
+            CPPUNIT_ASSERT(std::fabs(cx::log(x) - std::log(x)) < 1e-12);
+            CPPUNIT_ASSERT(std::fabs(cx::pow(x, 2.4) / std::pow(x, 2.4)
+                - 1) < 1e-12);
+        }
+        CPPUNIT_ASSERT(std::fabs(cx::exp(-20) / std::exp(-20) - 1)
+            < 1e-12);
+    }
+
+    void testLinear() {
+        for (unsigned c=0; c<256; ++c) {
+            const float exact = srgb_to_linear_exact(uint8_t(c));
+            CPPUNIT_ASSERT(std::fabs(srgb_to_linear(uint8_t(c)) - exact)
+                <= 1e-6f * exact);
+            // Every 8 bit value survives the round trip.
+            CPPUNIT_ASSERT(linear_to_srgb(srgb_to_linear(uint8_t(c)))
+                == c);
+        }
+        const Color c = "#80ff8000"_col;
+        const LinearColor l = to_linear(c);
+        CPPUNIT_ASSERT(std::fabs(l.a - 128 / 255.0f) < 1e-6f);
+        CPPUNIT_ASSERT(l.r == 1.0f && l.b == 0.0f);
+        CPPUNIT_ASSERT(std::fabs(l.g - 0.2158605f) < 1e-6f);
+        CPPUNIT_ASSERT(from_linear(l) == c);
+    }
+
+    void testEncode() {
+        std::mt19937 random { 7 };
+        std::uniform_real_distribution<float> unit { 0, 1 };
+        for (int n=0; n<100000; ++n) {
+            const float v = unit(random);
+            CPPUNIT_ASSERT(std::abs(int(linear_to_srgb(v))
+                - int(linear_to_srgb_exact(v))) <= 1);
+        }
+        CPPUNIT_ASSERT(linear_to_srgb(-1) == 0);
+        CPPUNIT_ASSERT(linear_to_srgb(2) == 255);
+        CPPUNIT_ASSERT(linear_to_srgb(std::nanf("")) == 0);
+    }
+
+    void testGray() {
+        CPPUNIT_ASSERT(gray(Color(0, 255, 255, 255)) == 255);
+        CPPUNIT_ASSERT(gray(Color(0, 0, 0, 0)) == 0);
+        CPPUNIT_ASSERT(gray(Color(0, 255, 0, 0)) == 76);
+        CPPUNIT_ASSERT(gray(Color(0, 0, 255, 0)) == 150);
+        for (unsigned v=0; v<256; ++v) {
+            const uint8_t c = uint8_t(v);
+            CPPUNIT_ASSERT(gray(Color(0, c, c, c)) == v);
+            CPPUNIT_ASSERT(luminance(Color(0, c, c, c)) == v);
+        }
+        // Green is brighter than red in linear light, too.
+        CPPUNIT_ASSERT(luminance(green) > luminance(red));
+        CPPUNIT_ASSERT(luminance(red) > luminance(blue));
+    }
+
+    void testYCbCr() {
+        std::mt19937 random { 11 };
+        for (int n=0; n<100000; ++n) {
+            const Color c = Color::from_argb(random() | 0xff000000u);
+            const YCbCr ycc = to_ycbcr(c);
+            const YCbCr exact = ycbcr_exact(c);
+            CPPUNIT_ASSERT(std::abs(ycc.y - exact.y) <= 1);
+            CPPUNIT_ASSERT(std::abs(ycc.cb - exact.cb) <= 1);
+            CPPUNIT_ASSERT(std::abs(ycc.cr - exact.cr) <= 1);
+            // Back within the rounding of the 8 bit YCbCr values.
+            const Color back = from_ycbcr(ycc);
+            CPPUNIT_ASSERT(back.a() == 0xff);
+            CPPUNIT_ASSERT(std::abs(back.r() - c.r()) <= 2);
+            CPPUNIT_ASSERT(std::abs(back.g() - c.g()) <= 2);
+            CPPUNIT_ASSERT(std::abs(back.b() - c.b()) <= 2);
+        }
+        const YCbCr white = to_ycbcr(Color(0, 255, 255, 255));
+        CPPUNIT_ASSERT(white.y == 255 && white.cb == 128
+            && white.cr == 128);
+    }
+
+    void testBatch() {
+        std::mt19937 random { 3 };
+        std::vector<Color> colors(1000);
+        for (Color &c: colors) {
+            c = Color::from_argb(random());
+        }
+        const size_t n = colors.size();
+        std::vector<LinearColor> light(n);
+        std::vector<Color> back(n);
+        to_linear(colors.data(), light.data(), n);
+        from_linear(light.data(), back.data(), n);
+        CPPUNIT_ASSERT(back == colors);
+
+        std::vector<uint8_t> grays(n), lum(n);
+        std::vector<YCbCr> ycc(n);
+        to_gray(colors.data(), grays.data(), n);
+        to_luminance(colors.data(), lum.data(), n);
+        to_ycbcr(colors.data(), ycc.data(), n);
+        from_ycbcr(ycc.data(), back.data(), n);
+        for (size_t i=0; i<n; ++i) {
+            CPPUNIT_ASSERT(grays[i] == gray(colors[i]));
+            CPPUNIT_ASSERT(lum[i] == luminance(colors[i]));
+            CPPUNIT_ASSERT(ycc[i].y == grays[i]);
+            CPPUNIT_ASSERT(back[i] == from_ycbcr(ycc[i]));
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ColorspaceTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
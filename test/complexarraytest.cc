@@ -0,0 +1,115 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/complexarraytest.cc Tests ComplexArray and its kernels of
+ *       src/cpp11/complexarray.h against std::complex.
+ */
+
+#include "cpp11/complexarray.h"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+template<typename T>
+ComplexArray<T> random_array(size_t n, unsigned seed,
+    const ComplexKernels<T> &kernels)
+{
+    std::mt19937 random { seed };
+    std::uniform_real_distribution<T> value { -10, 10 };
+    ComplexArray<T> a(n, kernels);
+    for (size_t i=0; i<n; ++i) {
+        a.set(i, std::complex<T>(value(random), value(random)));
+    }
+    return a;
+}
+
+template<typename T>
+bool near(std::complex<T> a, std::complex<T> b, T tolerance)
+{
+    return std::abs(a - b) <= tolerance * (1 + std::abs(b));
+}
+
+// Every kernel set against std::complex, also for lengths with tails.
+template<typename T>
+void check_kernels(T tolerance)
+{
+    for (const ComplexKernels<T> *k: available_complex_kernels<T>()) {
+        for (size_t n: { 0, 1, 3, 4, 7, 8, 9, 17, 100 }) {
+            const ComplexArray<T> a = random_array<T>(n, 1, *k);
+            const ComplexArray<T> b = random_array<T>(n, 2, *k);
+            ComplexArray<T> sum = random_array<T>(n, 3, *k);
+            ComplexArray<T> product = a;
+            sum.multiply_add(a, b);
+            product.multiply(b);
+            const std::vector<T> magnitude = a.magnitude();
+            ComplexArray<T> conjugate = a;
+            conjugate.conjugate();
+            ComplexArray<T> scaled = a;
+            scaled.scale(T(0.5));
+            const ComplexArray<T> before = random_array<T>(n, 3, *k);
+            for (size_t i=0; i<n; ++i) {
+                CPPUNIT_ASSERT(near(sum[i], before[i] + a[i] * b[i],
+                    tolerance));
+                CPPUNIT_ASSERT(near(product[i], a[i] * b[i], tolerance));
+                CPPUNIT_ASSERT(std::fabs(magnitude[i] - std::abs(a[i]))
+                    <= tolerance * magnitude[i]);
+                CPPUNIT_ASSERT(conjugate[i] == std::conj(a[i]));
+                CPPUNIT_ASSERT(scaled[i] == a[i] * T(0.5));
+            }
+        }
+    }
+}
+
+} // namespace
+
+class ComplexArrayTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ComplexArrayTest);
+    CPPUNIT_TEST(testLiterals);
+    CPPUNIT_TEST(testKernelSets);
+    CPPUNIT_TEST(testFloat);
+    CPPUNIT_TEST(testDouble);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testLiterals() {
+        ComplexArray<double> a { 1 + 2_i, 3 + 4_i }, b { 2_i, 1 + 0_i };
+        CPPUNIT_ASSERT(a.size() == 2);
+        CPPUNIT_ASSERT(a[1] == std::complex<double>(3, 4));
+        ComplexArray<double> sum(2);
+        sum.multiply_add(a, b);
+        CPPUNIT_ASSERT(sum[0] == std::complex<double>(-4, 2));
+        CPPUNIT_ASSERT(sum[1] == std::complex<double>(3, 4));
+        CPPUNIT_ASSERT(sum.magnitude()[1] == 5);
+        CPPUNIT_ASSERT_THROW(sum.multiply(ComplexArray<double>(3)),
+            std::invalid_argument);
+    }
+
+    void testKernelSets() {
+        const std::vector<const ComplexKernels<float> *> all =
+            available_complex_kernels<float>();
+        CPPUNIT_ASSERT(std::string(all.front()->name) == "scalar");
+        CPPUNIT_ASSERT(&complex_kernels<float>() == all.back());
+        CPPUNIT_ASSERT(std::string(complex_kernels<double>().name)
+            == all.back()->name);
+    }
+
+    void testFloat() {
+        check_kernels<float>(1e-5f);
+    }
+
+    void testDouble() {
+        check_kernels<double>(1e-13);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ComplexArrayTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,131 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/countertest.cc Tests the sharded counters of
+ *       src/cpp11/counter.h.
+ */
+
+#include "cpp11/counter.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+const CounterRegistry::Entry *find(
+    const std::vector<CounterRegistry::Entry> &entries,
+    const std::string &name)
+{
+    for (const auto &entry: entries) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+class CounterTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(CounterTest);
+    CPPUNIT_TEST(testCounter);
+    CPPUNIT_TEST(testThreads);
+    CPPUNIT_TEST(testGauge);
+    CPPUNIT_TEST(testManyCounters);
+    CPPUNIT_TEST(testRegistry);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testCounter() {
+        ShardedCounter counter;
+        CPPUNIT_ASSERT(counter.value() == 0);
+        CPPUNIT_ASSERT(counter.cells() == 0);
+        ++counter;
+        counter.add(41);
+        CPPUNIT_ASSERT(counter.value() == 42);
+        CPPUNIT_ASSERT(counter.cells() == 1);
+    }
+
+    void testThreads() {
+        ShardedCounter counter;
+        std::vector<std::thread> threads;
+        for (int t=0; t<4; ++t) {
+            threads.emplace_back([&counter] {
+                for (int n=0; n<100000; ++n) {
+                    ++counter;
+                }
+            });
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+        // Increments of finished threads are kept.
+        CPPUNIT_ASSERT(counter.value() == 400000);
+        CPPUNIT_ASSERT(counter.cells() >= 1 && counter.cells() <= 4);
+    }
+
+    void testGauge() {
+        ShardedGauge gauge;
+        ++gauge;
+        std::thread other { [&gauge] {
+            gauge.sub(5);
+            --gauge;
+        } };
+        other.join();
+        CPPUNIT_ASSERT(gauge.value() == -5);
+        gauge.add(10);
+        CPPUNIT_ASSERT(gauge.value() == 5);
+    }
+
+    // More counters than thread cache slots, used alternately: cache
+    // conflicts must not add cells. Destroyed counters leave nothing
+    // behind in the thread.
+    void testManyCounters() {
+        const size_t entries = ThreadSlot::thread_entries();
+        std::vector<std::unique_ptr<ShardedCounter>> counters;
+        for (int n=0; n<200; ++n) {
+            counters.emplace_back(new ShardedCounter);
+        }
+        for (int round=0; round<10; ++round) {
+            for (auto &counter: counters) {
+                ++*counter;
+            }
+        }
+        for (auto &counter: counters) {
+            CPPUNIT_ASSERT(counter->value() == 10);
+            CPPUNIT_ASSERT(counter->cells() == 1);
+        }
+        CPPUNIT_ASSERT(ThreadSlot::thread_entries() == entries + 200);
+        counters.clear();
+        CPPUNIT_ASSERT(ThreadSlot::thread_entries() == entries);
+    }
+
+    void testRegistry() {
+        CPPUNIT_ASSERT(!find(CounterRegistry::snapshot(), "test.items"));
+        {
+            ShardedCounter a { "test.items" };
+            ShardedCounter b { "test.items" };
+            ShardedGauge depth { "test.depth" };
+            a.add(3);
+            b.add(4);
+            depth.sub(2);
+            const auto entries = CounterRegistry::snapshot();
+            const CounterRegistry::Entry *items =
+                find(entries, "test.items");
+            CPPUNIT_ASSERT(items && items->value == 7 && !items->gauge);
+            const CounterRegistry::Entry *d = find(entries, "test.depth");
+            CPPUNIT_ASSERT(d && d->value == -2 && d->gauge);
+            CPPUNIT_ASSERT(CounterRegistry::to_text().find("test.items 7")
+                != std::string::npos);
+        }
+        CPPUNIT_ASSERT(!find(CounterRegistry::snapshot(), "test.items"));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CounterTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
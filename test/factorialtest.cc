@@ -0,0 +1,75 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/factorialtest.cc Tests the run time side of the factorial
+ *       tables of src/cpp11/factorial.h (the compile time side is tested
+ *       by static_assert in factorial.cc).
+ */
+
+#include "cpp11/factorial.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FactorialTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(FactorialTest);
+    CPPUNIT_TEST(testRange);
+    CPPUNIT_TEST(testTables);
+    CPPUNIT_TEST(testLog);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testRange() {
+        CPPUNIT_ASSERT(factorial_func(12) == 479001600);
+        CPPUNIT_ASSERT_THROW(factorial_func(13), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(factorial_func(-1), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(factorial64(21), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(factorial128(35), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(factorial_double(171), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(binomial64(68, 1), std::out_of_range);
+    }
+
+    void testTables() {
+        for (unsigned n=1; n<=max_factorial64; ++n) {
+            CPPUNIT_ASSERT(factorial64(n) == n * factorial64(n - 1));
+        }
+        for (unsigned n=1; n<=max_factorial128; ++n) {
+            CPPUNIT_ASSERT(factorial128(n) == n * factorial128(n - 1));
+        }
+        for (unsigned n=1; n<=max_factorial_double; ++n) {
+            const double expected = std::exp(std::lgamma(n + 1.0));
+            CPPUNIT_ASSERT(std::fabs(factorial_double(n) / expected - 1)
+                < 1e-12);
+        }
+        CPPUNIT_ASSERT(std::isinf(factorial_double(170) * 171));
+        // Pascal's rule all over the triangle.
+        for (unsigned n=1; n<=max_binomial64; ++n) {
+            CPPUNIT_ASSERT(binomial64(n, 0) == 1);
+            for (unsigned k=1; k<=n; ++k) {
+                CPPUNIT_ASSERT(binomial64(n, k) == binomial64(n - 1, k - 1)
+                    + binomial64(n - 1, k));
+            }
+        }
+    }
+
+    void testLog() {
+        // Table and Stirling's formula beyond both agree with lgamma.
+        for (unsigned n=0; n<3 * log_factorial_table_size; ++n) {
+            const double expected = std::lgamma(n + 1.0);
+            CPPUNIT_ASSERT(std::fabs(log_factorial(n) - expected)
+                <= 4e-15 * std::max(1.0, expected));
+        }
+        CPPUNIT_ASSERT(std::fabs(log_binomial(67, 33)
+            - std::log(double(binomial64(67, 33)))) < 1e-13);
+        CPPUNIT_ASSERT(std::fabs(std::exp(log_binomial(1000, 2))
+            - 499500) < 1e-6);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FactorialTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,182 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/fastrandomtest.cc Tests the xoshiro256** and PCG64 engines
+ *       with <random> distributions, and the fills of BatchRandom.
+ */
+
+#include "cpp11/fastrandom.h"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// Rolls a dice 1000 times as the dice test in randomtest.cc does.
+template<typename Engine>
+void roll_dice(Engine &engine)
+{
+    std::uniform_int_distribution<> roll_a_dice { 1, 6 };
+    int values[6] = { 0 };
+    for (int n=0; n<1000; n++) {
+        const int rand_val = roll_a_dice(engine);
+        CPPUNIT_ASSERT(rand_val>=1 && rand_val<=6);
+        ++(values[rand_val-1]);
+    }
+    for (auto v: values) {
+        CPPUNIT_ASSERT(v>20);
+        CPPUNIT_ASSERT(v<800);
+    }
+}
+
+} // namespace
+
+class FastRandomTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(FastRandomTest);
+    CPPUNIT_TEST(testEngines);
+    CPPUNIT_TEST(testKernels);
+    CPPUNIT_TEST(testUniform);
+    CPPUNIT_TEST(testNormal);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testEngines() {
+        // The reference implementations' first values.
+        Xoshiro256StarStar xoshiro { 1, 2, 3, 4 };
+        CPPUNIT_ASSERT(xoshiro() == 11520);
+        CPPUNIT_ASSERT(xoshiro() == 0);
+        CPPUNIT_ASSERT(xoshiro() == 1509978240);
+        CPPUNIT_ASSERT(xoshiro() == 1215971899390074240ull);
+        Pcg64 pcg { 42, 54 };
+        CPPUNIT_ASSERT(pcg() == 0x86b1da1d72062b68ull);
+        CPPUNIT_ASSERT(pcg() == 0x1304aa46c9853d39ull);
+        CPPUNIT_ASSERT(pcg() == 0xa3670e9e0dd50358ull);
+
+        Xoshiro256StarStar engine { 42 };
+        roll_dice(engine);
+        Pcg64 pcg_engine;
+        roll_dice(pcg_engine);
+        BatchRandom batch;
+        roll_dice(batch);
+
+        // Jumped engines differ, and jump the same from the same state.
+        Xoshiro256StarStar a { 7 }, b { 7 };
+        CPPUNIT_ASSERT(a == b);
+        b.jump();
+        CPPUNIT_ASSERT(!(a == b));
+        a.jump();
+        CPPUNIT_ASSERT(a == b);
+        Pcg64 c { 1, 1 }, d { 1, 2 };
+        CPPUNIT_ASSERT(!(c == d) && c() != d());
+    }
+
+    void testKernels() {
+        // Each lane is a jumped xoshiro256**, whatever the kernels.
+        Xoshiro256StarStar lane[BatchRandom::lanes];
+        Xoshiro256StarStar engine { 5 };
+        for (auto &l: lane) {
+            l = engine;
+            engine.jump();
+        }
+        std::vector<uint64_t> expected(1003);
+        for (size_t i=0; i<expected.size(); ++i) {
+            expected[i] = lane[i % BatchRandom::lanes]();
+        }
+        for (const RandomKernels *k: available_random_kernels()) {
+            BatchRandom random(5, *k);
+            std::vector<uint64_t> values(expected.size());
+            // Split at odd places, crossing the cached values.
+            random.fill(values.data(), 3);
+            random.fill(values.data() + 3, 2);
+            CPPUNIT_ASSERT(random() == expected[5]);
+            random.fill(values.data() + 6, values.size() - 6);
+            values[5] = expected[5];
+            CPPUNIT_ASSERT(values == expected);
+
+            BatchRandom whole(9, *k), split(9, *k);
+            std::vector<double> u(1000), v(1000);
+            whole.fill_uniform(u.data(), u.size(), -2, 3);
+            split.fill_uniform(v.data(), 300, -2, 3);
+            split.fill_uniform(v.data() + 300, 700, -2, 3);
+            CPPUNIT_ASSERT(u == v);
+        }
+    }
+
+    void testUniform() {
+        BatchRandom random { 49 };
+        std::vector<int32_t> dice(6000);
+        random.fill_uniform(dice.data(), dice.size(), 1, 6);
+        int values[6] = { 0 };
+        for (auto rand_val: dice) {
+            CPPUNIT_ASSERT(rand_val>=1 && rand_val<=6);
+            ++(values[rand_val-1]);
+        }
+        for (auto v: values) {
+            CPPUNIT_ASSERT(v>800);
+            CPPUNIT_ASSERT(v<1200);
+        }
+        std::vector<int32_t> full(1000);
+        random.fill_uniform(full.data(), full.size(), INT32_MIN, INT32_MAX);
+        int negative = 0;
+        for (auto v: full) {
+            negative += v < 0;
+        }
+        CPPUNIT_ASSERT(negative>400 && negative<600);
+        random.fill_uniform(full.data(), full.size(), 3, 3);
+        for (auto v: full) {
+            CPPUNIT_ASSERT(v == 3);
+        }
+        CPPUNIT_ASSERT_THROW(random.fill_uniform(full.data(), 1, 2, 1),
+            std::invalid_argument);
+
+        std::vector<double> real(100000);
+        random.fill_uniform(real.data(), real.size());
+        double sum = 0;
+        for (auto v: real) {
+            CPPUNIT_ASSERT(v>=0 && v<1);
+            sum += v;
+        }
+        CPPUNIT_ASSERT(std::fabs(sum / real.size() - 0.5) < 0.01);
+        random.fill_uniform(real.data(), real.size(), -10, -5);
+        for (auto v: real) {
+            CPPUNIT_ASSERT(v>=-10 && v<-5);
+        }
+    }
+
+    void testNormal() {
+        for (const RandomKernels *k: available_random_kernels()) {
+            BatchRandom random(50, *k);
+            std::vector<double> values(1000000);
+            random.fill_normal(values.data(), values.size());
+            double sum = 0, squares = 0;
+            size_t within_one = 0, beyond_r = 0;
+            for (auto v: values) {
+                sum += v;
+                squares += v * v;
+                within_one += std::fabs(v) < 1;
+                beyond_r += std::fabs(v) > 3.6541528853610088;
+            }
+            const double n = values.size();
+            CPPUNIT_ASSERT(std::fabs(sum / n) < 0.01);
+            CPPUNIT_ASSERT(std::fabs(squares / n - 1) < 0.01);
+            CPPUNIT_ASSERT(std::fabs(within_one / n - 0.6827) < 0.005);
+            // P(|z| > r) is 2.6e-4; the tail is drawn separately.
+            CPPUNIT_ASSERT(beyond_r > 150 && beyond_r < 380);
+
+            random.fill_normal(values.data(), 10000, 8, 2);
+            sum = 0;
+            for (size_t i=0; i<10000; ++i) {
+                sum += values[i];
+            }
+            CPPUNIT_ASSERT(std::fabs(sum / 10000 - 8) < 0.1);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FastRandomTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,124 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/ffttest.cc Tests FftPlan of src/cpp11/fft.h against a
+ *       discrete Fourier transform by definition in long double.
+ */
+
+#include "cpp11/fft.h"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+typedef std::complex<long double> Complex;
+
+// X[k] = sum of x[j] e^(-2 pi i j k / n), O(n^2).
+std::vector<Complex> dft(const std::vector<Complex> &x)
+{
+    const long double pi = 3.141592653589793238462643383279502884L;
+    const size_t n = x.size();
+    std::vector<Complex> roots(n), result(n);
+    for (size_t r=0; r<n; ++r) {
+        roots[r] = std::exp(-2 * pi * r / n * 1.0_i);
+    }
+    for (size_t k=0; k<n; ++k) {
+        for (size_t j=0; j<n; ++j) {
+            result[k] += x[j] * roots[(j * k) % n];
+        }
+    }
+    return result;
+}
+
+// The largest difference relative to the largest value.
+template<typename T>
+long double error(const ComplexArray<T> &a, const std::vector<Complex> &b)
+{
+    long double most = 0, diff = 0;
+    for (size_t i=0; i<b.size(); ++i) {
+        const Complex ai(a[i].real(), a[i].imag());
+        diff = std::max(diff, std::abs(ai - b[i]));
+        most = std::max(most, std::abs(b[i]));
+    }
+    return diff / most;
+}
+
+template<typename T>
+void check_fft(long double tolerance)
+{
+    std::mt19937 random { 5 };
+    std::uniform_real_distribution<T> value { -1, 1 };
+    for (size_t n=1; n<=2048; n*=2) {
+        std::vector<std::complex<T>> input(n);
+        std::vector<Complex> x(n);
+        for (size_t i=0; i<n; ++i) {
+            input[i] = std::complex<T>(value(random), value(random));
+            x[i] = Complex(input[i].real(), input[i].imag());
+        }
+        const std::vector<Complex> expected = dft(x);
+        for (const ComplexKernels<T> *k: available_complex_kernels<T>()) {
+            ComplexArray<T> data(n, *k);
+            for (size_t i=0; i<n; ++i) {
+                data.set(i, input[i]);
+            }
+            const FftPlan<T> plan { n, *k };
+            plan.forward(data);
+            CPPUNIT_ASSERT(error(data, expected) < tolerance);
+            plan.inverse(data);
+            CPPUNIT_ASSERT(error(data, x) < tolerance);
+        }
+    }
+}
+
+} // namespace
+
+class FftTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(FftTest);
+    CPPUNIT_TEST(testSmall);
+    CPPUNIT_TEST(testFloat);
+    CPPUNIT_TEST(testDouble);
+    CPPUNIT_TEST(testErrors);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testSmall() {
+        // A constant has only a DC part, an impulse a flat spectrum.
+        ComplexArray<double> data { 1 + 0_i, 1 + 0_i, 1 + 0_i, 1 + 0_i };
+        const FftPlan<double> plan { 4 };
+        plan.forward(data);
+        CPPUNIT_ASSERT(data[0] == std::complex<double>(4, 0));
+        CPPUNIT_ASSERT(data[1] == 0.0 && data[2] == 0.0 && data[3] == 0.0);
+        ComplexArray<double> impulse { 0_i, 1 + 0_i, 0_i, 0_i };
+        plan.forward(impulse);
+        // e^(-2 pi i k / 4) for k = 0..3 is 1, -i, -1, i.
+        CPPUNIT_ASSERT(impulse[1] == std::complex<double>(0, -1));
+        CPPUNIT_ASSERT(impulse[2] == std::complex<double>(-1, 0));
+        CPPUNIT_ASSERT(impulse[3] == std::complex<double>(0, 1));
+    }
+
+    void testFloat() {
+        check_fft<float>(1e-5L);
+    }
+
+    void testDouble() {
+        check_fft<double>(1e-13L);
+    }
+
+    void testErrors() {
+        CPPUNIT_ASSERT_THROW(FftPlan<float>(0), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(FftPlan<float>(12), std::invalid_argument);
+        const FftPlan<float> plan { 8 };
+        ComplexArray<float> data(4);
+        CPPUNIT_ASSERT_THROW(plan.forward(data), std::invalid_argument);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FftTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,278 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/futuretest.cc Tests Future, Promise, when_all() and
+ *       when_any() of src/cpp11/future.h.
+ */
+
+#include "cpp11/future.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FutureTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(FutureTest);
+    CPPUNIT_TEST(testThen);
+    CPPUNIT_TEST(testVoid);
+    CPPUNIT_TEST(testErrors);
+    CPPUNIT_TEST(testShutDownPool);
+    CPPUNIT_TEST(testPromise);
+    CPPUNIT_TEST(testUnwrap);
+    CPPUNIT_TEST(testDeepChain);
+    CPPUNIT_TEST(testDeepFailingChain);
+    CPPUNIT_TEST(testWaitInContinuation);
+    CPPUNIT_TEST(testWhenAll);
+    CPPUNIT_TEST(testWhenAny);
+    CPPUNIT_TEST(testGetInPool);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testThen() {
+        Promise<int> promise;
+        Future<std::string> text = promise.get_future()
+            .then([](int x) { return 2 * x; })
+            .then([](int x) { return std::to_string(x); });
+        CPPUNIT_ASSERT(text.valid() && !text.ready());
+        promise.set_value(21);
+        CPPUNIT_ASSERT(text.ready());
+        CPPUNIT_ASSERT(text.get() == "42");
+        CPPUNIT_ASSERT(!text.valid());
+
+        // Attached after completion, on a pool.
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        Future<int> ready = make_ready_future(std::string("abc"))
+            .then(executor, [](std::string s) { return int(s.size()); });
+        CPPUNIT_ASSERT(ready.get() == 3);
+    }
+
+    void testVoid() {
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        std::atomic<int> steps { 0 };
+        Future<void> done = spawn(executor, [&] { ++steps; })
+            .then(executor, [&] { ++steps; return 5; })
+            .then(executor, [&](int x) { steps += x; });
+        done.get();
+        CPPUNIT_ASSERT(steps == 7);
+    }
+
+    void testErrors() {
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        std::atomic<int> skipped { 0 };
+        Future<int> failed = spawn(executor, []() -> int {
+                throw std::runtime_error("step 1");
+            })
+            .then(executor, [&](int x) { ++skipped; return x; })
+            .then([&](int x) { ++skipped; return x; });
+        CPPUNIT_ASSERT_THROW(failed.get(), std::runtime_error);
+        CPPUNIT_ASSERT(skipped == 0);
+        CPPUNIT_ASSERT_THROW(failed.get(), std::future_error);
+
+        Future<int> invalid;
+        CPPUNIT_ASSERT_THROW(invalid.then([](int x) { return x; }),
+            std::future_error);
+    }
+
+    void testShutDownPool() {
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        pool.pool().shutdown();
+        std::atomic<int> ran { 0 };
+        Promise<int> promise;
+        Future<int> chained = promise.get_future()
+            .then(executor, [&](int x) { ++ran; return x; })
+            .then([&](int x) { ++ran; return x; });
+        // Completing the input must not throw, the chain fails instead.
+        promise.set_value(1);
+        CPPUNIT_ASSERT_THROW(chained.get(), std::logic_error);
+        CPPUNIT_ASSERT(ran == 0);
+
+        // Also when the input was complete before.
+        Future<int> late = make_ready_future(2)
+            .then(executor, [&](int x) { ++ran; return x; });
+        CPPUNIT_ASSERT_THROW(late.get(), std::logic_error);
+        CPPUNIT_ASSERT(ran == 0);
+    }
+
+    void testPromise() {
+        Future<int> orphan;
+        {
+            Promise<int> promise;
+            orphan = promise.get_future();
+            CPPUNIT_ASSERT_THROW(promise.get_future(), std::future_error);
+        }
+        try {
+            orphan.get();
+            CPPUNIT_FAIL("no broken_promise");
+        } catch (const std::future_error &e) {
+            CPPUNIT_ASSERT(e.code() == std::future_errc::broken_promise);
+        }
+
+        Promise<void> promise;
+        Future<void> future = promise.get_future();
+        promise.set_exception(
+            std::make_exception_ptr(std::logic_error("no")));
+        CPPUNIT_ASSERT_THROW(promise.set_value(), std::future_error);
+        CPPUNIT_ASSERT_THROW(future.get(), std::logic_error);
+    }
+
+    void testUnwrap() {
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        Future<int> nested = spawn(executor, [] { return 6; })
+            .then(executor, [&](int x) {
+                return spawn(executor, [x] { return x * 7; });
+            });
+        CPPUNIT_ASSERT(nested.get() == 42);
+
+        Future<int> broken = make_ready_future(1).then([](int) {
+            return Future<int>();
+        });
+        CPPUNIT_ASSERT_THROW(broken.get(), std::future_error);
+    }
+
+    // Nothing waits in between, so the chain needs no thread per step.
+    void testDeepChain() {
+        ThreadPool pool { 2 };
+        PoolExecutor executor { pool };
+        Promise<long> start;
+        Future<long> chain = start.get_future();
+        for (int n=0; n<10000; ++n) {
+            chain = chain.then(executor, [](long x) { return x + 1; });
+        }
+        start.set_value(0);
+        CPPUNIT_ASSERT(chain.get() == 10000);
+    }
+
+    void testDeepFailingChain() {
+        // Failures skip the executor; they must not take a stack frame
+        // per step either.
+        PoolExecutor &executor = PoolExecutor::shared();
+        std::atomic<int> ran { 0 };
+        Promise<int> start;
+        Future<int> chain = start.get_future();
+        for (int n=0; n<200000; ++n) {
+            chain = chain.then(executor, [&](int x) { ++ran; return x; });
+        }
+        start.set_exception(std::make_exception_ptr(
+            std::runtime_error("head")));
+        CPPUNIT_ASSERT_THROW(chain.get(), std::runtime_error);
+        CPPUNIT_ASSERT(ran == 0);
+
+        // Dropping the head promise breaks the whole chain.
+        Future<int> broken;
+        {
+            Promise<int> dropped;
+            broken = dropped.get_future();
+            for (int n=0; n<200000; ++n) {
+                broken = broken.then(executor, [](int x) { return x; });
+            }
+        }
+        CPPUNIT_ASSERT_THROW(broken.get(), std::future_error);
+
+        // Inline, successful steps complete one after the other too.
+        Promise<long> inline_start;
+        Future<long> inline_chain = inline_start.get_future();
+        for (int n=0; n<1000000; ++n) {
+            inline_chain = inline_chain.then([](long x) { return x + 1; });
+        }
+        inline_start.set_value(0);
+        CPPUNIT_ASSERT(inline_chain.ready());
+        CPPUNIT_ASSERT(inline_chain.get() == 1000000);
+    }
+
+    void testWaitInContinuation() {
+        // A continuation waiting for a future it completed itself: the
+        // completion is queued, and get() must run it, not block.
+        Promise<int> first, second;
+        Future<int> inner = second.get_future().then([](int x) {
+            return x + 1;
+        });
+        Future<int> outer = first.get_future().then(
+            [&second, &inner](int x) {
+                second.set_value(x);
+                return inner.get();
+            });
+        first.set_value(41);
+        CPPUNIT_ASSERT(outer.get() == 42);
+    }
+
+    void testWhenAll() {
+        ThreadPool pool { 3 };
+        PoolExecutor executor { pool };
+        std::vector<Future<int>> squares;
+        for (int n=0; n<100; ++n) {
+            squares.push_back(spawn(executor, [n] { return n * n; }));
+        }
+        const std::vector<int> all = when_all(std::move(squares)).get();
+        CPPUNIT_ASSERT(all.size() == 100);
+        for (int n=0; n<100; ++n) {
+            CPPUNIT_ASSERT(all[n] == n * n);
+        }
+
+        // Fails as soon as one fails, even if others never complete.
+        Promise<void> never;
+        std::vector<Future<void>> tasks;
+        tasks.push_back(never.get_future());
+        tasks.push_back(spawn(executor, [] {
+            throw std::runtime_error("task");
+        }));
+        Future<void> failed = when_all(std::move(tasks));
+        CPPUNIT_ASSERT_THROW(failed.get(), std::runtime_error);
+        never.set_value();
+
+        CPPUNIT_ASSERT(
+            when_all(std::vector<Future<int>>()).get().empty());
+    }
+
+    void testWhenAny() {
+        std::vector<Promise<std::string>> promises(3);
+        std::vector<Future<std::string>> futures;
+        for (auto &p: promises) {
+            futures.push_back(p.get_future());
+        }
+        Future<std::pair<size_t, std::string>> first =
+            when_any(std::move(futures));
+        promises[1].set_exception(
+            std::make_exception_ptr(std::runtime_error("1")));
+        CPPUNIT_ASSERT(!first.ready());
+        promises[2].set_value("two");
+        promises[0].set_value("zero");
+        const std::pair<size_t, std::string> any = first.get();
+        CPPUNIT_ASSERT(any.first == 2 && any.second == "two");
+
+        std::vector<Future<void>> failing;
+        failing.push_back(make_ready_future(0).then([](int) {
+            throw std::runtime_error("a");
+        }));
+        failing.push_back(make_ready_future(0).then([](int) {
+            throw std::logic_error("b");
+        }));
+        CPPUNIT_ASSERT_THROW(when_any(std::move(failing)).get(),
+            std::logic_error);
+        CPPUNIT_ASSERT_THROW(when_any(std::vector<Future<int>>()).get(),
+            std::invalid_argument);
+    }
+
+    // A task of a single worker pool waits for another task of it.
+    void testGetInPool() {
+        ThreadPool pool { 1 };
+        PoolExecutor executor { pool };
+        Future<int> outer = spawn(executor, [&] {
+            Future<int> inner = spawn(executor, [] { return 1; });
+            return inner.get(pool) + 1;
+        });
+        CPPUNIT_ASSERT(outer.get(pool) == 2);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FutureTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
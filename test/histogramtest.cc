@@ -0,0 +1,148 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/histogramtest.cc Tests src/cpp11/histogram.h.
+ */
+
+#include "cpp11/histogram.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class HistogramTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(HistogramTest);
+    CPPUNIT_TEST(testBuckets);
+    CPPUNIT_TEST(testQuantiles);
+    CPPUNIT_TEST(testMerge);
+    CPPUNIT_TEST(testExport);
+    CPPUNIT_TEST(testPerThread);
+    CPPUNIT_TEST(testCacheConflicts);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testBuckets() {
+        // Buckets are contiguous and cover all values.
+        CPPUNIT_ASSERT(Histogram::bucket_lower(0)==0);
+        for (size_t i=1; i<Histogram::bucket_count; ++i) {
+            CPPUNIT_ASSERT(Histogram::bucket_lower(i)
+                == Histogram::bucket_upper(i-1)+1);
+            CPPUNIT_ASSERT(Histogram::bucket_of(Histogram::bucket_lower(i))==i);
+            CPPUNIT_ASSERT(Histogram::bucket_of(Histogram::bucket_upper(i))==i);
+        }
+        CPPUNIT_ASSERT(Histogram::bucket_upper(Histogram::bucket_count-1)
+            == UINT64_MAX);
+        CPPUNIT_ASSERT(Histogram::bucket_of(15)==15);
+        CPPUNIT_ASSERT(Histogram::bucket_of(16)==16);
+        CPPUNIT_ASSERT(Histogram::bucket_of(1000)==Histogram::bucket_of(1023));
+    }
+
+    void testQuantiles() {
+        Histogram h;
+        CPPUNIT_ASSERT(h.quantile(0.5)==0);
+        for (uint64_t v=1; v<=10000; ++v) {
+            h.record(v);
+        }
+        CPPUNIT_ASSERT(h.count()==10000);
+        CPPUNIT_ASSERT(h.min()==1);
+        CPPUNIT_ASSERT(h.max()==10000);
+        CPPUNIT_ASSERT(h.mean()==5000.5);
+        // Within the relative bucket error of 1/16.
+        auto near = [] (uint64_t value, double exact) {
+            return value >= exact && value <= exact * (1.0 + 1.0/16);
+        };
+        CPPUNIT_ASSERT(near(h.quantile(0.5), 5000));
+        CPPUNIT_ASSERT(near(h.quantile(0.99), 9900));
+        CPPUNIT_ASSERT(near(h.quantile(0.999), 9990));
+        CPPUNIT_ASSERT(h.quantile(1.0)==10000);
+        CPPUNIT_ASSERT(h.quantile(0.0)==1);
+    }
+
+    void testMerge() {
+        Histogram a, b, both;
+        for (uint64_t v=0; v<100; ++v) {
+            a.record(v);
+            both.record(v);
+        }
+        b.record(1000000, 5);
+        both.record(1000000, 5);
+        a.merge(b);
+        CPPUNIT_ASSERT(a.count()==both.count());
+        CPPUNIT_ASSERT(a.sum()==both.sum());
+        CPPUNIT_ASSERT(a.max()==1000000);
+        CPPUNIT_ASSERT(a.min()==0);
+        for (size_t i=0; i<Histogram::bucket_count; ++i) {
+            CPPUNIT_ASSERT(a.bucket(i)==both.bucket(i));
+        }
+        a.clear();
+        CPPUNIT_ASSERT(a.count()==0 && a.max()==0 && a.min()==0);
+    }
+
+    void testExport() {
+        Histogram h;
+        h.record(3);
+        h.record(100, 2);
+        CPPUNIT_ASSERT(h.to_text("ns")
+            == "count=3 min=3ns mean=68ns p50=100ns p90=100ns"
+               " p99=100ns p999=100ns max=100ns");
+        const std::string json = h.to_json();
+        CPPUNIT_ASSERT(json.find("\"count\":3,")!=std::string::npos);
+        CPPUNIT_ASSERT(json.find("\"buckets\":[[3,3,1],[100,103,2]]}")
+            !=std::string::npos);
+    }
+
+    void testPerThread() {
+        PerThreadHistogram h;
+        std::vector<std::thread> threads;
+        for (uint64_t t=1; t<=4; ++t) {
+            threads.emplace_back([&h, t] {
+                for (int n=0; n<10000; ++n) {
+                    h.record(t*100);
+                }
+            });
+        }
+        // Snapshots while recording are allowed.
+        CPPUNIT_ASSERT(h.snapshot().count() <= 40000);
+        for (auto &t: threads) {
+            t.join();
+        }
+        Histogram s = h.snapshot();
+        CPPUNIT_ASSERT(s.count()==40000);
+        CPPUNIT_ASSERT(s.sum()==10000*(100+200+300+400));
+        CPPUNIT_ASSERT(s.min()==100);
+        CPPUNIT_ASSERT(s.max()==400);
+        CPPUNIT_ASSERT(s.bucket(Histogram::bucket_of(300))==10000);
+        CPPUNIT_ASSERT(h.shard_count()==4);
+    }
+
+    void testCacheConflicts() {
+        // Histograms created in a row get ids in a row, so some of them
+        // share slots of the thread cache. Alternating between them must
+        // neither lose values nor add shards, and destroying them must
+        // not leave entries in the thread.
+        const size_t entries = ThreadSlot::thread_entries();
+        std::vector<std::unique_ptr<PerThreadHistogram>> histograms;
+        for (int i=0; i<200; ++i) {
+            histograms.emplace_back(new PerThreadHistogram);
+        }
+        for (int n=0; n<1000; ++n) {
+            for (auto &h: histograms) {
+                h->record(n);
+            }
+        }
+        for (auto &h: histograms) {
+            CPPUNIT_ASSERT(h->snapshot().count()==1000);
+            CPPUNIT_ASSERT(h->shard_count()==1);
+        }
+        CPPUNIT_ASSERT(ThreadSlot::thread_entries()==entries+200);
+        histograms.clear();
+        CPPUNIT_ASSERT(ThreadSlot::thread_entries()==entries);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HistogramTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,184 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/imagetest.cc Tests Image, PlanarImage and the pixel
+ *       kernels of src/cpp11/image.h.
+ */
+
+#include "cpp11/image.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+std::vector<uint32_t> random_pixels(size_t n, unsigned seed)
+{
+    std::mt19937 random { seed };
+    std::vector<uint32_t> pixels(n);
+    for (auto &p: pixels) {
+        p = random();
+    }
+    return pixels;
+}
+
+// Runs \a kernel on a copy of \a dst.
+template<typename Kernel>
+std::vector<uint32_t> run(Kernel kernel, std::vector<uint32_t> dst,
+    const std::vector<uint32_t> &src)
+{
+    kernel(dst.data(), src.data(), dst.size());
+    return dst;
+}
+
+} // namespace
+
+class ImageTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ImageTest);
+    CPPUNIT_TEST(testScalar);
+    CPPUNIT_TEST(testKernelsAgree);
+    CPPUNIT_TEST(testImage);
+    CPPUNIT_TEST(testConvert);
+    CPPUNIT_TEST(testPlanar);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testScalar() {
+        const std::vector<const PixelKernels *> all =
+            available_pixel_kernels();
+        CPPUNIT_ASSERT(!all.empty());
+        CPPUNIT_ASSERT(std::string(all.front()->name) == "scalar");
+        CPPUNIT_ASSERT(&pixel_kernels() == all.back());
+        const PixelKernels &scalar = *all.front();
+
+        // Half transparent red over opaque blue.
+        uint32_t dst = 0xff0000ff;
+        const uint32_t half = 0x80ff0000;
+        uint32_t over;
+        scalar.premultiply(&over, &half, 1);
+        CPPUNIT_ASSERT(over == 0x80800000);
+        scalar.blend(&dst, &over, 1);
+        CPPUNIT_ASSERT(dst == 0xff80007f);
+        // Opaque replaces, transparent keeps.
+        const uint32_t opaque = 0xff102030, clear = 0;
+        scalar.blend(&dst, &clear, 1);
+        CPPUNIT_ASSERT(dst == 0xff80007f);
+        scalar.blend(&dst, &opaque, 1);
+        CPPUNIT_ASSERT(dst == opaque);
+
+        uint32_t p = 0x11223344;
+        scalar.argb_to_rgba(&p, &p, 1);
+        CPPUNIT_ASSERT(p == 0x22334411);
+        scalar.rgba_to_argb(&p, &p, 1);
+        CPPUNIT_ASSERT(p == 0x11223344);
+        scalar.swap_bytes(&p, &p, 1);
+        CPPUNIT_ASSERT(p == 0x44332211);
+    }
+
+    // The SIMD kernels give exactly the scalar results, also for
+    // lengths that leave a tail.
+    void testKernelsAgree() {
+        const std::vector<const PixelKernels *> all =
+            available_pixel_kernels();
+        const PixelKernels &scalar = *all.front();
+        for (size_t n: { 0, 1, 3, 4, 7, 8, 9, 17, 1000 }) {
+            const std::vector<uint32_t> src = random_pixels(n, 1);
+            std::vector<uint32_t> dst = random_pixels(n, 2);
+            // Blending needs premultiplied colors.
+            const std::vector<uint32_t> pre =
+                run(scalar.premultiply, src, src);
+            const std::vector<uint32_t> blended =
+                run(scalar.blend, dst, pre);
+            for (const PixelKernels *k: all) {
+                CPPUNIT_ASSERT(run(k->premultiply, src, src) == pre);
+                CPPUNIT_ASSERT(run(k->blend, dst, pre) == blended);
+                CPPUNIT_ASSERT(run(k->argb_to_rgba, src, src)
+                    == run(scalar.argb_to_rgba, src, src));
+                CPPUNIT_ASSERT(run(k->rgba_to_argb, src, src)
+                    == run(scalar.rgba_to_argb, src, src));
+                CPPUNIT_ASSERT(run(k->swap_bytes, src, src)
+                    == run(scalar.swap_bytes, src, src));
+                std::vector<uint32_t> filled(n);
+                k->fill(filled.data(), n, 0xdeadbeef);
+                CPPUNIT_ASSERT(filled == std::vector<uint32_t>(n,
+                    0xdeadbeef));
+            }
+        }
+    }
+
+    void testImage() {
+        Image image { 5, 3 };
+        CPPUNIT_ASSERT(image.size() == 15 && image.width() == 5);
+        CPPUNIT_ASSERT(image.at(4, 2) == Color(0, 0, 0, 0));
+        image.fill("#ff0000ff"_col);
+        image.set(1, 2, red);
+        CPPUNIT_ASSERT(image.at(1, 2) == red);
+        CPPUNIT_ASSERT(image.row(2)[1] == 0xffff0000);
+
+        Image over { 5, 3 };
+        over.fill("#80ff0000"_col);
+        over.premultiply();
+        CPPUNIT_ASSERT(over.at(0, 0) == "#80800000"_col);
+        image.blend(over);
+        CPPUNIT_ASSERT(image.at(0, 0) == "#ff80007f"_col);
+        // "#RRGGBB" is opaque and covers what is below.
+        over.fill("#00ff00"_col);
+        image.blend(over);
+        CPPUNIT_ASSERT(image.at(0, 0) == "#ff00ff00"_col);
+        CPPUNIT_ASSERT_THROW(image.blend(Image(3, 5)),
+            std::invalid_argument);
+    }
+
+    void testConvert() {
+        Image image { 7, 3 };
+        const std::vector<uint32_t> pixels = random_pixels(21, 3);
+        image.convert_from(PixelFormat::argb, pixels.data());
+        std::vector<uint32_t> rgba(21), bgra(21);
+        image.convert_to(PixelFormat::rgba, rgba.data());
+        image.convert_to(PixelFormat::bgra, bgra.data());
+        const Color c = image.at(6, 2);
+        CPPUNIT_ASSERT(rgba[20] == (uint32_t{c.r()} << 24
+            | uint32_t{c.g()} << 16 | uint32_t{c.b()} << 8 | c.a()));
+        CPPUNIT_ASSERT(bgra[20] == (uint32_t{c.b()} << 24
+            | uint32_t{c.g()} << 16 | uint32_t{c.r()} << 8 | c.a()));
+
+        Image back { 7, 3 };
+        back.convert_from(PixelFormat::rgba, rgba.data());
+        CPPUNIT_ASSERT(std::vector<uint32_t>(back.pixels(),
+            back.pixels() + 21) == pixels);
+        back.fill(Color(0, 0, 0, 0));
+        back.convert_from(PixelFormat::bgra, bgra.data());
+        CPPUNIT_ASSERT(std::vector<uint32_t>(back.pixels(),
+            back.pixels() + 21) == pixels);
+    }
+
+    void testPlanar() {
+        Image image { 4, 2 };
+        image.set(3, 1, "#01020304"_col);
+        const PlanarImage planar { image };
+        CPPUNIT_ASSERT(planar.size() == 8);
+        CPPUNIT_ASSERT(planar.plane(PlanarImage::a)[7] == 1);
+        CPPUNIT_ASSERT(planar.plane(PlanarImage::r)[7] == 2);
+        CPPUNIT_ASSERT(planar.plane(PlanarImage::g)[7] == 3);
+        CPPUNIT_ASSERT(planar.plane(PlanarImage::b)[7] == 4);
+        CPPUNIT_ASSERT(planar.plane(PlanarImage::b)[6] == 0);
+
+        Image merged { 4, 2 };
+        merged.fill(blue);
+        planar.merge_into(merged);
+        CPPUNIT_ASSERT(merged.at(3, 1) == "#01020304"_col);
+        CPPUNIT_ASSERT(merged.at(0, 0) == Color(0, 0, 0, 0));
+        Image wrong { 2, 4 };
+        CPPUNIT_ASSERT_THROW(planar.merge_into(wrong),
+            std::invalid_argument);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ImageTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
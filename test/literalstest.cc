@@ -8,12 +8,15 @@
 
 #include "cpp11/literals.h"
 
+#include <stdexcept>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 class LiteralsTest : public CppUnit::TestCase {
     CPPUNIT_TEST_SUITE(LiteralsTest);
     CPPUNIT_TEST(testComplex);
     CPPUNIT_TEST(testColor);
+    CPPUNIT_TEST(testColorString);
     CPPUNIT_TEST_SUITE_END();
   public:
     void testComplex() {
@@ -50,6 +53,33 @@ class LiteralsTest : public CppUnit::TestCase {
             Color ref{ 1, 2, 16, 0x44};
             CPPUNIT_ASSERT(color==ref);
         }
+        static_assert(red == Color(0xff, 0xff, 0, 0), "red");
+        static_assert(red == "#ff0000"_col, "red is opaque");
+        static_assert(green == "#00ff00"_col, "green is opaque");
+        static_assert(blue.argb() == 0xff0000ff, "blue");
+        static_assert(0x80402010_col == Color(0x80, 0x40, 0x20, 0x10),
+                      "argb");
+    }
+    void testColorString() {
+        static_assert("#00ff00"_col == Color(0xff, 0, 0xff, 0),
+                      "#RRGGBB is opaque");
+        static_assert("#80FF8000"_col == Color(0x80, 0xff, 0x80, 0),
+                      "#AARRGGBB");
+        static_assert("0xff0000ff"_col == blue, "0x");
+        static_assert("0Xff"_col == Color(0, 0, 0, 0xff), "short 0x");
+        static_assert("16711680"_col == 0x00ff0000_col, "decimal");
+        static_assert("4294967295"_col == 0xffffffff_col, "max");
+        // Not constant expressions, so these throw at run time (as
+        // constexpr variables they would not compile).
+        CPPUNIT_ASSERT_THROW("#12345"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW("ff0000"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW("#00gg00"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW("0x"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW("0x123456789"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(0x100000000_col, std::out_of_range);
+        CPPUNIT_ASSERT_THROW("4294967296"_col, std::out_of_range);
+        CPPUNIT_ASSERT_THROW("12a"_col, std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(""_col, std::invalid_argument);
     }
 };
 
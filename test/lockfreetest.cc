@@ -0,0 +1,119 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/lockfreetest.cc Stress tests of TreiberStack and MSQueue of
+ *       src/cpp11/lockfree.h with both reclamation domains; meant to
+ *       be run under ThreadSanitizer, too (configure with
+ *       CXXFLAGS=-fsanitize=thread LDFLAGS=-fsanitize=thread).
+ */
+
+#include "cpp11/lockfree.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+const int producers = 3;
+const int consumers = 3;
+const int per_producer = 20000;
+
+// Producers push distinct numbers, consumers pop until all arrived;
+// every number must be popped exactly once. For FIFO containers, the
+// numbers of each producer must arrive in order per consumer.
+template<typename Container>
+void stress(bool fifo)
+{
+    Container container;
+    std::vector<std::atomic<int>> seen(producers * per_producer);
+    for (auto &s: seen) {
+        s.store(0);
+    }
+    std::atomic<int> popped { 0 };
+    std::atomic<int> misordered { 0 };
+    std::vector<std::thread> threads;
+    for (int p=0; p<producers; ++p) {
+        threads.emplace_back([&container, p] {
+            for (int n=0; n<per_producer; ++n) {
+                container.push(p * per_producer + n);
+            }
+        });
+    }
+    for (int c=0; c<consumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int> last(producers, -1);
+            int value;
+            while (popped.load() < producers * per_producer) {
+                if (!container.try_pop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++popped;
+                seen[value].fetch_add(1);
+                const int producer = value / per_producer;
+                if (fifo && value <= last[producer]) {
+                    ++misordered;
+                }
+                last[producer] = value;
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    for (auto &s: seen) {
+        CPPUNIT_ASSERT(s.load() == 1);
+    }
+    CPPUNIT_ASSERT(misordered == 0);
+    CPPUNIT_ASSERT(container.empty());
+    container.domain().collect();
+    CPPUNIT_ASSERT(container.domain().pending() == 0);
+}
+
+} // namespace
+
+class LockFreeTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(LockFreeTest);
+    CPPUNIT_TEST(testSingleThread);
+    CPPUNIT_TEST(testStackEpoch);
+    CPPUNIT_TEST(testStackHazard);
+    CPPUNIT_TEST(testQueueEpoch);
+    CPPUNIT_TEST(testQueueHazard);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testSingleThread() {
+        TreiberStack<std::string> stack;
+        MSQueue<std::unique_ptr<std::string>, HazardDomain> queue;
+        CPPUNIT_ASSERT(stack.empty() && queue.empty());
+        for (const char *s: { "a", "b", "c" }) {
+            stack.push(s);
+            queue.push(std::unique_ptr<std::string>(new std::string(s)));
+        }
+        std::string top;
+        std::unique_ptr<std::string> front;
+        CPPUNIT_ASSERT(stack.try_pop(top) && top == "c");
+        CPPUNIT_ASSERT(queue.try_pop(front) && *front == "a");
+        CPPUNIT_ASSERT(stack.try_pop(top) && top == "b");
+        CPPUNIT_ASSERT(queue.try_pop(front) && *front == "b");
+        CPPUNIT_ASSERT(!stack.empty() && !queue.empty());
+        // The rest is freed by the destructors.
+    }
+
+    void testStackEpoch() { stress<TreiberStack<int, EpochDomain>>(false); }
+    void testStackHazard() {
+        stress<TreiberStack<int, HazardDomain>>(false);
+    }
+    void testQueueEpoch() { stress<MSQueue<int, EpochDomain>>(true); }
+    void testQueueHazard() { stress<MSQueue<int, HazardDomain>>(true); }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LockFreeTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,159 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/modulartest.cc Tests Montgomery arithmetic, is_prime() and
+ *       ModularCombinatorics against plain % arithmetic.
+ */
+
+#include "cpp11/modular.h"
+
+#include <random>
+#include <stdexcept>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+
+uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return static_cast<uint64_t>(uint128_t{a} * b % m);
+}
+
+} // namespace
+
+class ModularTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ModularTest);
+    CPPUNIT_TEST(testMontgomery);
+    CPPUNIT_TEST(testIsPrime);
+    CPPUNIT_TEST(testTables);
+    CPPUNIT_TEST(testQueries);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testMontgomery() {
+        std::mt19937_64 random { 48 };
+        for (uint64_t m: { 3ull, 10007ull, 998244353ull, 1000000007ull,
+                (1ull << 61) - 1, (1ull << 63) - 25 }) {
+            const Montgomery mont { m };
+            for (int i=0; i<1000; ++i) {
+                const uint64_t a = random(), b = random() % m;
+                const uint64_t e = random() % 1000;
+                CPPUNIT_ASSERT(mont.from(mont.to(a)) == a % m);
+                CPPUNIT_ASSERT(mont.from(mont.multiply(mont.to(a),
+                    mont.to(b))) == mul_mod(a % m, b, m));
+                uint64_t expected = 1 % m;
+                for (uint64_t j=0; j<e; ++j) {
+                    expected = mul_mod(expected, b, m);
+                }
+                CPPUNIT_ASSERT(mont.from(mont.power(mont.to(b), e))
+                    == expected);
+            }
+        }
+        CPPUNIT_ASSERT_THROW(Montgomery(1), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(Montgomery(1000), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(Montgomery((1ull << 63) + 1),
+            std::invalid_argument);
+    }
+
+    void testIsPrime() {
+        const uint64_t n = 100000;
+        std::vector<bool> composite(n);
+        for (uint64_t i=2; i<n; ++i) {
+            CPPUNIT_ASSERT(is_prime(i) == !composite[i]);
+            for (uint64_t j=i*i; j<n; j+=i) {
+                composite[j] = true;
+            }
+        }
+        CPPUNIT_ASSERT(!is_prime(0) && !is_prime(1));
+        // Strong pseudoprimes to base 2, and a Carmichael number.
+        CPPUNIT_ASSERT(!is_prime(2047) && !is_prime(3215031751ull));
+        CPPUNIT_ASSERT(!is_prime(561));
+        CPPUNIT_ASSERT(is_prime((1ull << 61) - 1));
+        CPPUNIT_ASSERT(is_prime(18446744073709551557ull));
+        CPPUNIT_ASSERT(!is_prime(4294967291ull * 4294967279ull));
+    }
+
+    void testTables() {
+        // All of a small prime's tables, against Pascal's triangle.
+        const uint64_t p = 10007;
+        const ModularCombinatorics small(p - 1, p);
+        uint64_t factorial = 1;
+        for (uint32_t n=0; n<p; ++n) {
+            factorial = n ? factorial * n % p : 1;
+            CPPUNIT_ASSERT(small.factorial(n) == factorial);
+            CPPUNIT_ASSERT(small.inverse_factorial(n) * factorial % p
+                == 1);
+        }
+        std::vector<uint64_t> row { 1 };
+        for (uint32_t n=1; n<=300; ++n) {
+            std::vector<uint64_t> next(n + 1, 1);
+            for (uint32_t k=1; k<n; ++k) {
+                next[k] = (row[k - 1] + row[k]) % p;
+            }
+            row.swap(next);
+            for (uint32_t k=0; k<=n; ++k) {
+                CPPUNIT_ASSERT(small.binomial(n, k) == row[k]);
+            }
+        }
+
+        // Chunks built in parallel give the same tables.
+        ThreadPool pool { 4 };
+        const uint32_t max_n = 500000;
+        const ModularCombinatorics serial(max_n, 1000000007);
+        const ModularCombinatorics parallel(max_n, 1000000007, pool);
+        for (uint32_t n=0; n<=max_n; ++n) {
+            CPPUNIT_ASSERT(serial.factorial(n) == parallel.factorial(n));
+            CPPUNIT_ASSERT(serial.inverse_factorial(n)
+                == parallel.inverse_factorial(n));
+        }
+        CPPUNIT_ASSERT(mul_mod(serial.factorial(max_n),
+            serial.inverse_factorial(max_n), 1000000007) == 1);
+
+        CPPUNIT_ASSERT_THROW(ModularCombinatorics(10, 1001),
+            std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(ModularCombinatorics(10007, 10007),
+            std::invalid_argument);
+    }
+
+    void testQueries() {
+        const uint64_t p = (1ull << 61) - 1;
+        const ModularCombinatorics mod(100000, p);
+        std::mt19937 random { 4 };
+        std::vector<BinomialQuery> queries;
+        for (int i=0; i<10000; ++i) {
+            const uint32_t a = random() % 30000, b = random() % 30000,
+                c = random() % 30000;
+            CPPUNIT_ASSERT(mod.permutation(a + b, b) == mul_mod(
+                mod.binomial(a + b, b), mod.factorial(b), p));
+            CPPUNIT_ASSERT(mod.multinomial({ a, b, c }) == mul_mod(
+                mod.binomial(a + b + c, a), mod.binomial(b + c, b), p));
+            queries.push_back(BinomialQuery { a + b, a });
+            queries.push_back(BinomialQuery { a, b });
+        }
+        CPPUNIT_ASSERT(mod.binomial(5, 6) == 0 && mod.permutation(5, 6)
+            == 0);
+        CPPUNIT_ASSERT(mod.binomial(100000, 0) == 1);
+        CPPUNIT_ASSERT(mod.multinomial({}) == 1);
+        CPPUNIT_ASSERT_THROW(mod.binomial(100001, 1), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(mod.multinomial({ 50000, 50001 }),
+            std::out_of_range);
+
+        ThreadPool pool { 4 };
+        const std::vector<uint64_t> batch = mod.binomials(queries);
+        CPPUNIT_ASSERT(mod.binomials(queries, pool) == batch);
+        for (size_t i=0; i<queries.size(); ++i) {
+            CPPUNIT_ASSERT(batch[i]
+                == mod.binomial(queries[i].n, queries[i].k));
+        }
+        queries.push_back(BinomialQuery { 100001, 0 });
+        CPPUNIT_ASSERT_THROW(mod.binomials(queries, pool),
+            std::out_of_range);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ModularTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
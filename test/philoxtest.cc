@@ -0,0 +1,146 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/philoxtest.cc Tests Philox4x32 against the Random123
+ *       answers, its seeking and substreams, and that parallel_for_random
+ *       gives the same results on any number of threads.
+ */
+
+#include "cpp11/philox.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PhiloxTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(PhiloxTest);
+    CPPUNIT_TEST(testBlock);
+    CPPUNIT_TEST(testStreams);
+    CPPUNIT_TEST(testDeterminism);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testBlock() {
+        // Known answers of philox4x32_10 from Random123.
+        typedef Philox4x32::Counter Counter;
+        typedef Philox4x32::Key Key;
+        CPPUNIT_ASSERT((Philox4x32::block(Counter {{ 0, 0, 0, 0 }},
+            Key {{ 0, 0 }}) == Counter {{ 0x6627e8d5, 0xe169c58d,
+            0xbc57ac4c, 0x9b00dbd8 }}));
+        CPPUNIT_ASSERT((Philox4x32::block(Counter {{ ~0u, ~0u, ~0u,
+            ~0u }}, Key {{ ~0u, ~0u }}) == Counter {{ 0x408f276d,
+            0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }}));
+        CPPUNIT_ASSERT((Philox4x32::block(Counter {{ 0x243f6a88,
+            0x85a308d3, 0x13198a2e, 0x03707344 }}, Key {{ 0xa4093822,
+            0x299f31d0 }}) == Counter {{ 0xd16cfe09, 0x94fdcceb,
+            0x5001e420, 0x24126ea1 }}));
+
+        // Rolling a dice, as in randomtest.cc.
+        Philox4x32 engine;
+        std::uniform_int_distribution<> roll_a_dice { 1, 6 };
+        int values[6] = { 0 };
+        for (int n=0; n<1000; n++) {
+            const int rand_val = roll_a_dice(engine);
+            CPPUNIT_ASSERT(rand_val>=1 && rand_val<=6);
+            ++(values[rand_val-1]);
+        }
+        for (auto v: values) {
+            CPPUNIT_ASSERT(v>20);
+            CPPUNIT_ASSERT(v<800);
+        }
+    }
+
+    void testStreams() {
+        Philox4x32 engine { 50, 7 };
+        std::vector<uint32_t> expected(1000);
+        for (auto &v: expected) {
+            v = engine();
+        }
+        CPPUNIT_ASSERT(engine.position() == 1000);
+
+        // Seeking and discarding in O(1) land where calls would.
+        for (uint64_t n: { 0, 1, 3, 4, 5, 997 }) {
+            Philox4x32 seeking { 50, 7 };
+            seeking.seek(n);
+            CPPUNIT_ASSERT(seeking.position() == n);
+            CPPUNIT_ASSERT(seeking() == expected[n]);
+            seeking.discard(1);
+            CPPUNIT_ASSERT(seeking() == expected[n + 2]);
+        }
+
+        // Fills split anywhere give the calls' values.
+        Philox4x32 filling { 50, 7 };
+        std::vector<uint32_t> values(expected.size());
+        filling.fill(values.data(), 1);
+        CPPUNIT_ASSERT(filling() == expected[1]);
+        filling.fill(values.data() + 2, 5);
+        filling.fill(values.data() + 7, values.size() - 7);
+        values[1] = expected[1];
+        CPPUNIT_ASSERT(values == expected);
+        CPPUNIT_ASSERT(filling == engine);
+
+        // Substreams start over and differ from each other.
+        const Philox4x32 other = engine.substream(8);
+        CPPUNIT_ASSERT(other == Philox4x32(50, 8));
+        CPPUNIT_ASSERT(engine.substream(7) == Philox4x32(50, 7));
+        CPPUNIT_ASSERT(engine.substream(7) != engine);
+        Philox4x32 a { 50, 7 }, b { 50, 8 }, c { 51, 7 };
+        int same = 0;
+        for (int i=0; i<1000; ++i) {
+            const uint32_t x = a();
+            same += x == b();
+            same += x == c();
+        }
+        CPPUNIT_ASSERT(same == 0);
+    }
+
+    void testDeterminism() {
+        // A Monte-Carlo estimate of pi, per item and in total, on pools
+        // of different sizes with different grains.
+        const size_t n = 2000;
+        std::vector<std::vector<double>> results;
+        for (size_t threads: { 1, 2, 3, 8 }) {
+            ThreadPool pool { threads };
+            for (size_t grain: { size_t{0}, size_t{1}, size_t{7} }) {
+                std::vector<double> hits(n);
+                parallel_for_random(pool, 2014, size_t{0}, n,
+                    [&](size_t i, Philox4x32 &engine) {
+                        std::uniform_real_distribution<> u { -1, 1 };
+                        // Items draw different amounts.
+                        const size_t draws = 100 + i % 13;
+                        for (size_t d=0; d<draws; ++d) {
+                            const double x = u(engine), y = u(engine);
+                            hits[i] += x * x + y * y < 1;
+                        }
+                        hits[i] /= draws;
+                    }, grain);
+                results.push_back(hits);
+            }
+        }
+        for (const auto &hits: results) {
+            CPPUNIT_ASSERT(hits == results[0]);
+        }
+        double sum = 0;
+        for (auto h: results[0]) {
+            sum += h;
+        }
+        CPPUNIT_ASSERT(std::abs(4 * sum / n - 3.14159) < 0.02);
+
+        // Item i draws from substream i, independent of the pool.
+        Philox4x32 item { 2014, 5 };
+        std::uniform_real_distribution<> u { -1, 1 };
+        double hits = 0;
+        for (size_t d=0; d<105; ++d) {
+            const double x = u(item), y = u(item);
+            hits += x * x + y * y < 1;
+        }
+        CPPUNIT_ASSERT(hits / 105 == results[0][5]);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PhiloxTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
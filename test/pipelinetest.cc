@@ -0,0 +1,219 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/pipelinetest.cc Tests bounded, closable Queues and the
+ *       Pipeline of src/cpp11/pipeline.h.
+ */
+
+#include "cpp11/pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// A source emitting 1..n.
+std::function<bool(Pipeline::Emitter<int>&)> count_to(int n)
+{
+    std::shared_ptr<int> next = std::make_shared<int>(0);
+    return [next, n](Pipeline::Emitter<int> &emit) {
+        if (*next >= n) {
+            return false;
+        }
+        emit(++*next);
+        return true;
+    };
+}
+
+} // namespace
+
+class PipelineTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(PipelineTest);
+    CPPUNIT_TEST(testQueueClose);
+    CPPUNIT_TEST(testQueueBounded);
+    CPPUNIT_TEST(testStages);
+    CPPUNIT_TEST(testFanOutFanIn);
+    CPPUNIT_TEST(testBackpressure);
+    CPPUNIT_TEST(testException);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST_EXCEPTION(testAddAfterRun, std::logic_error);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testQueueClose() {
+        Queue<int> queue;
+        queue.add(1);
+        queue.close();
+        CPPUNIT_ASSERT(queue.closed());
+        bool thrown = false;
+        try {
+            queue.add(2);
+        } catch (const std::logic_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+        int m = 0;
+        CPPUNIT_ASSERT(queue.get(m) && m==1);    // drains first
+        CPPUNIT_ASSERT(!queue.get(m));
+
+        // close() wakes up a waiting consumer.
+        Queue<int, QueueStats, SpinThenParkWait> waiting;
+        std::atomic<bool> ended { false };
+        std::thread consumer { [&] {
+            int m;
+            ended = !waiting.get(m);
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        waiting.close();
+        consumer.join();
+        CPPUNIT_ASSERT(ended);
+    }
+
+    void testQueueBounded() {
+        Queue<int> queue(2);
+        CPPUNIT_ASSERT(queue.capacity()==2);
+        queue.add(1);
+        queue.add(2);
+        std::atomic<bool> added { false };
+        std::thread producer { [&] {
+            queue.add(3);           // waits for space
+            added = true;
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        CPPUNIT_ASSERT(!added);
+        CPPUNIT_ASSERT(queue.get()==1);
+        producer.join();
+        CPPUNIT_ASSERT(added);
+        CPPUNIT_ASSERT(queue.size()==2);
+        CPPUNIT_ASSERT(queue.get()==2);
+        CPPUNIT_ASSERT(queue.get()==3);
+    }
+
+    void testStages() {
+        Pipeline pipeline(16);
+        std::atomic<long> sum { 0 };
+        pipeline.source<int>("count", count_to(10000))
+            .map<long>("square", [](const int &n) { return long{n}*n; }, 4)
+            .flat_map<long>("odd",
+                [](const long &n, Pipeline::Emitter<long> &emit) {
+                    if (n % 2) emit(n);
+                })
+            .sink("sum", [&sum](const long &n) { sum += n; });
+        pipeline.run();
+        pipeline.wait();
+        long expected = 0;
+        for (long n=1; n<=10000; n+=2) {
+            expected += n*n;
+        }
+        CPPUNIT_ASSERT(sum==expected);
+
+        const std::vector<Pipeline::StageReport> r = pipeline.report();
+        CPPUNIT_ASSERT(r.size()==4);
+        CPPUNIT_ASSERT(r[0].name=="count" && r[0].items_out==10000);
+        CPPUNIT_ASSERT(r[0].capacity==0);
+        CPPUNIT_ASSERT(r[1].workers==4 && r[1].items_in==10000);
+        CPPUNIT_ASSERT(r[2].items_in==10000 && r[2].items_out==5000);
+        CPPUNIT_ASSERT(r[3].items_in==5000 && r[3].capacity==16);
+        CPPUNIT_ASSERT(r[3].occupancy.count()==5000);
+        CPPUNIT_ASSERT(r[3].occupancy.max()<=16);
+        CPPUNIT_ASSERT(pipeline.report_text().find("bottleneck: ")
+            !=std::string::npos);
+    }
+
+    void testFanOutFanIn() {
+        Pipeline pipeline;
+        auto numbers = pipeline.source<int>("count", count_to(1000));
+        // Both branches get every message.
+        auto text = numbers.map<std::string>("text",
+            [](const int &n) { return std::to_string(n); }, 2);
+        auto negative = numbers.map<std::string>("negative",
+            [](const int &n) { return std::to_string(-n); });
+        std::atomic<long> sum { 0 };
+        std::atomic<int> count { 0 };
+        text.merge(negative).sink("sum", [&](const std::string &s) {
+            sum += std::stol(s);
+            ++count;
+        }, 3);
+        pipeline.run();
+        pipeline.wait();
+        CPPUNIT_ASSERT(count==2000);
+        CPPUNIT_ASSERT(sum==0);
+    }
+
+    void testBackpressure() {
+        Pipeline pipeline(4);
+        pipeline.source<int>("fast", count_to(50))
+            .sink("slow", [](const int &) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            });
+        pipeline.run();
+        pipeline.wait();
+        const std::vector<Pipeline::StageReport> r = pipeline.report();
+        CPPUNIT_ASSERT(r[1].occupancy.max()<=4);
+        // The source spent most of its time waiting for the sink.
+        CPPUNIT_ASSERT(r[0].blocked_seconds > 0.02);
+        CPPUNIT_ASSERT(r[1].utilization() > r[0].utilization());
+        CPPUNIT_ASSERT(pipeline.report_text().find("bottleneck: slow")
+            !=std::string::npos);
+    }
+
+    void testException() {
+        Pipeline pipeline(8);
+        pipeline.source<int>("count", count_to(100000))
+            .map<int>("check", [](const int &n) -> int {
+                if (n == 500) throw std::runtime_error("bad message");
+                return n;
+            })
+            .sink("drop", [](const int &) { });
+        pipeline.run();
+        bool thrown = false;
+        try {
+            pipeline.wait();
+        } catch (const std::runtime_error &e) {
+            thrown = std::string(e.what())=="bad message";
+        }
+        CPPUNIT_ASSERT(thrown);
+        CPPUNIT_ASSERT(pipeline.cancelled());
+        CPPUNIT_ASSERT(pipeline.report()[0].items_out < 100000);
+    }
+
+    void testCancel() {
+        Pipeline pipeline;
+        std::atomic<long> seen { 0 };
+        pipeline.source<int>("endless", [](Pipeline::Emitter<int> &emit) {
+                emit(1);
+                return true;
+            })
+            .sink("count", [&seen](const int &) { ++seen; }, 2);
+        pipeline.run();
+        while (seen < 100) {
+            std::this_thread::yield();
+        }
+        pipeline.cancel();
+        pipeline.wait();            // no exception
+        CPPUNIT_ASSERT(seen >= 100);
+    }
+
+    void testAddAfterRun() {
+        Pipeline pipeline;
+        auto numbers = pipeline.source<int>("count", count_to(10));
+        numbers.sink("drop", [](const int &) { });
+        pipeline.run();
+        try {
+            numbers.sink("late", [](const int &) { });
+        } catch (...) {
+            pipeline.wait();
+            throw;
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PipelineTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
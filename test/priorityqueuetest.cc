@@ -0,0 +1,116 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/priorityqueuetest.cc Tests src/cpp11/priorityqueue.h.
+ */
+
+#include "cpp11/priorityqueue.h"
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PriorityQueueTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(PriorityQueueTest);
+    CPPUNIT_TEST(testLanes);
+    CPPUNIT_TEST_EXCEPTION(testBadLane, std::out_of_range);
+    CPPUNIT_TEST(testStopOvertakes);
+    CPPUNIT_TEST(testDaryHeap);
+    CPPUNIT_TEST(testDeadline);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testLanes() {
+        PriorityQueue<std::string, 3> queue;
+        queue.add("bulk1");
+        queue.add("normal1", 1);
+        queue.add("bulk2", 2);
+        queue.add("urgent", 0);
+        queue.add("normal2", 1);
+        CPPUNIT_ASSERT(queue.size()==5);
+        CPPUNIT_ASSERT(queue.get()=="urgent");
+        CPPUNIT_ASSERT(queue.get()=="normal1");
+        CPPUNIT_ASSERT(queue.get()=="normal2");
+        CPPUNIT_ASSERT(queue.get()=="bulk1");
+        std::string m;
+        CPPUNIT_ASSERT(queue.try_get(m) && m=="bulk2");
+        CPPUNIT_ASSERT(!queue.try_get(m));
+        CPPUNIT_ASSERT(queue.size()==0);
+    }
+
+    void testBadLane() {
+        PriorityQueue<int, 2> queue;
+        queue.add(1, 2);
+    }
+
+    void testStopOvertakes() {
+        // A consumer thread sees STOP before the bulk backlog.
+        PriorityQueue<std::string> queue;
+        for (int n=0; n<1000; ++n) {
+            queue.add("MSG_" + std::to_string(n));
+        }
+        queue.add("STOP", 0);
+        int consumed = 0;
+        std::thread consumer { [&] {
+            for (;;) {
+                std::string m = queue.get();
+                if (m=="STOP") break;
+                ++consumed;
+            }
+        } };
+        consumer.join();
+        CPPUNIT_ASSERT(consumed==0);
+        CPPUNIT_ASSERT(queue.size()==1000);
+    }
+
+    void testDaryHeap() {
+        std::default_random_engine engine;
+        std::uniform_int_distribution<> dist { 0, 999 };
+        DaryHeap<int, 4> heap4;
+        DaryHeap<int, 2, std::greater<int>> maxheap;
+        std::vector<int> ref;
+        for (int n=0; n<2000; ++n) {
+            int v = dist(engine);
+            heap4.push(v);
+            maxheap.push(v);
+            ref.push_back(v);
+        }
+        std::sort(ref.begin(), ref.end());
+        for (auto v: ref) {
+            CPPUNIT_ASSERT(heap4.top()==v);
+            CPPUNIT_ASSERT(heap4.pop()==v);
+        }
+        CPPUNIT_ASSERT(heap4.empty());
+        for (auto i=ref.rbegin(); i!=ref.rend(); ++i) {
+            CPPUNIT_ASSERT(maxheap.pop()==*i);
+        }
+    }
+
+    void testDeadline() {
+        using Queue = DeadlineQueue<std::string>;
+        const auto now = Queue::Clock::now();
+        const auto ms = std::chrono::milliseconds{1};
+        Queue queue;
+        queue.add("later", now + 30*ms);
+        queue.add("whenever");
+        queue.add("soon1", now + 10*ms);
+        queue.add("soon2", now + 10*ms);
+        queue.add("overdue", now - 10*ms);
+        CPPUNIT_ASSERT(queue.get()=="overdue");
+        CPPUNIT_ASSERT(queue.get()=="soon1");
+        CPPUNIT_ASSERT(queue.get()=="soon2");
+        CPPUNIT_ASSERT(queue.get()=="later");
+        CPPUNIT_ASSERT(queue.get()=="whenever");
+        CPPUNIT_ASSERT(queue.size()==0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PriorityQueueTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,132 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/profiledmutextest.cc Tests the ProfiledMutex of
+ *       src/cpp11/profiledmutex.h.
+ */
+
+#include "cpp11/profiledmutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// Holds \a mutex for \a ms milliseconds while the caller tries to lock
+// it, so that the caller's lock() is contended.
+void contend(ProfiledMutex &mutex, int ms)
+{
+    std::atomic<bool> locked { false };
+    std::thread holder { [&] {
+        std::unique_lock<ProfiledMutex> lock { mutex };
+        locked = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+    } };
+    while (!locked) {
+        std::this_thread::yield();
+    }
+    {
+        std::unique_lock<ProfiledMutex> lock { mutex };
+    }
+    holder.join();
+}
+
+} // namespace
+
+class ProfiledMutexTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ProfiledMutexTest);
+    CPPUNIT_TEST(testUncontended);
+    CPPUNIT_TEST(testContended);
+    CPPUNIT_TEST(testStdLock);
+    CPPUNIT_TEST(testSharedName);
+    CPPUNIT_TEST(testReport);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testUncontended() {
+        ProfiledMutex mutex { "test.uncontended" };
+        for (int n=0; n<100; ++n) {
+            std::lock_guard<ProfiledMutex> lock { mutex };
+        }
+        CPPUNIT_ASSERT(mutex.try_lock());
+        CPPUNIT_ASSERT(!mutex.try_lock());
+        mutex.unlock();
+        const LockProfile::Snapshot s = mutex.profile().snapshot();
+        CPPUNIT_ASSERT(s.name == "test.uncontended");
+        CPPUNIT_ASSERT(s.acquisitions() == 101);
+        CPPUNIT_ASSERT(s.contended() == 0);
+        CPPUNIT_ASSERT(s.contention() == 0.0);
+    }
+
+    void testContended() {
+        ProfiledMutex mutex { "test.contended" };
+        contend(mutex, 20);
+        const LockProfile::Snapshot s = mutex.profile().snapshot();
+        CPPUNIT_ASSERT(s.acquisitions() == 2);
+        CPPUNIT_ASSERT(s.contended() == 1);
+        CPPUNIT_ASSERT(s.contention() == 0.5);
+        // Waited for (most of) the 20ms the holder held the lock.
+        CPPUNIT_ASSERT(s.wait.max() >= 10000000);
+        CPPUNIT_ASSERT(s.hold.max() >= 20000000);
+    }
+
+    void testStdLock() {
+        ProfiledMutex m1 { "test.stdlock.1" };
+        ProfiledMutex m2 { "test.stdlock.2" };
+        {
+            std::unique_lock<ProfiledMutex> lock1 { m1, std::defer_lock };
+            std::unique_lock<ProfiledMutex> lock2 { m2, std::defer_lock };
+            std::lock(lock1, lock2);
+            CPPUNIT_ASSERT(lock1.owns_lock() && lock2.owns_lock());
+        }
+        CPPUNIT_ASSERT(m1.profile().snapshot().acquisitions() == 1);
+        CPPUNIT_ASSERT(m2.profile().snapshot().acquisitions() == 1);
+    }
+
+    void testSharedName() {
+        {
+            ProfiledMutex a { "test.shared" };
+            ProfiledMutex b { "test.shared" };
+            CPPUNIT_ASSERT(&a.profile() == &b.profile());
+            std::lock_guard<ProfiledMutex> la { a };
+            std::lock_guard<ProfiledMutex> lb { b };
+        }
+        // The profile outlives the mutexes.
+        CPPUNIT_ASSERT(LockProfile::get("test.shared")->snapshot()
+            .acquisitions() == 2);
+    }
+
+    void testReport() {
+        ProfiledMutex cold { "test.report.cold" };
+        ProfiledMutex hot { "test.report.hot" };
+        ProfiledMutex warm { "test.report.warm" };
+        for (int n=0; n<1000; ++n) {
+            std::lock_guard<ProfiledMutex> lock { cold };
+        }
+        contend(hot, 30);
+        contend(warm, 5);
+        std::vector<LockProfile::Snapshot> report = LockProfile::report();
+        size_t hot_rank = report.size(), warm_rank = report.size();
+        size_t cold_rank = report.size();
+        for (size_t i=0; i<report.size(); ++i) {
+            if (report[i].name == "test.report.hot") hot_rank = i;
+            if (report[i].name == "test.report.warm") warm_rank = i;
+            if (report[i].name == "test.report.cold") cold_rank = i;
+        }
+        CPPUNIT_ASSERT(hot_rank < warm_rank);
+        CPPUNIT_ASSERT(warm_rank < cold_rank);
+        CPPUNIT_ASSERT(cold_rank < report.size());
+        CPPUNIT_ASSERT(LockProfile::report(1).size() == 1);
+        CPPUNIT_ASSERT(LockProfile::report_text().find("test.report.hot")
+            != std::string::npos);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ProfiledMutexTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,79 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/queuestatstest.cc Tests the Queue instrumentation of
+ *       src/cpp11/queuestats.h.
+ */
+
+#include "cpp11/consumer.h"
+#include "cpp11/queuestats.h"
+
+#include <string>
+#include <thread>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class QueueStatsTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(QueueStatsTest);
+    CPPUNIT_TEST(testDisabled);
+    CPPUNIT_TEST(testEnabled);
+    CPPUNIT_TEST(testNoStats);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testDisabled() {
+        Queue<std::string> queue;
+        CPPUNIT_ASSERT(!queue.stats().enabled());
+        queue.add("a");
+        CPPUNIT_ASSERT(queue.get()=="a");
+        QueueStats::Snapshot s = queue.stats().snapshot();
+        CPPUNIT_ASSERT(s.latency.count()==0);
+        CPPUNIT_ASSERT(s.depth.count()==0);
+        CPPUNIT_ASSERT(s.wait.count()==0);
+    }
+
+    void testEnabled() {
+        Queue<std::string> queue;
+        queue.add("before");    // added while disabled: no latency
+        queue.stats().enable();
+        queue.add("a");
+        queue.add("b");
+        CPPUNIT_ASSERT(queue.get()=="before");
+        CPPUNIT_ASSERT(queue.get()=="a");
+        CPPUNIT_ASSERT(queue.get()=="b");
+        // A consumer waiting for a delayed producer records a wait.
+        std::thread producer { [&queue] {
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            queue.add("late");
+        } };
+        CPPUNIT_ASSERT(queue.get()=="late");
+        producer.join();
+
+        QueueStats::Snapshot s = queue.stats().snapshot();
+        CPPUNIT_ASSERT(s.latency.count()==3);
+        CPPUNIT_ASSERT(s.depth.count()==3);
+        CPPUNIT_ASSERT(s.depth.max()==3);
+        CPPUNIT_ASSERT(s.wait.count()==1);
+        CPPUNIT_ASSERT(s.wait.min() >= 10*1000*1000);
+        CPPUNIT_ASSERT(s.to_text().find("wait:    count=1 ")
+            !=std::string::npos);
+        CPPUNIT_ASSERT(s.to_json().find("{\"latency_ns\":{\"count\":3,")==0);
+    }
+
+    void testNoStats() {
+        // No space and no recording with the null policy.
+        static_assert(sizeof(NoQueueStats::Stamp)==1, "empty");
+        Queue<int, NoQueueStats> queue;
+        queue.add(1);
+        queue.add(2);
+        int m = 0;
+        CPPUNIT_ASSERT(queue.try_get(m) && m==1);
+        CPPUNIT_ASSERT(queue.get()==2);
+        CPPUNIT_ASSERT(!queue.try_get(m));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(QueueStatsTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
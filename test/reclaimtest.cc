@@ -0,0 +1,115 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/reclaimtest.cc Tests EpochDomain and HazardDomain of
+ *       src/cpp11/reclaim.h.
+ */
+
+#include "cpp11/reclaim.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+std::atomic<int> alive { 0 };
+
+struct Tracked {
+    int value;
+    explicit Tracked(int v) : value(v) { ++alive; }
+    ~Tracked() { value = -1; --alive; }
+};
+
+} // namespace
+
+class ReclaimTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ReclaimTest);
+    CPPUNIT_TEST(testEpochProtects);
+    CPPUNIT_TEST(testEpochBounded);
+    CPPUNIT_TEST(testHazardProtects);
+    CPPUNIT_TEST(testHazardBounded);
+    CPPUNIT_TEST(testDestructor);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    // An object retired while another thread's guard may still use it
+    // survives until that guard ends.
+    template<typename Domain>
+    void protects() {
+        Domain domain { 1 };
+        std::atomic<Tracked*> shared { new Tracked(42) };
+        std::atomic<bool> reading { false };
+        std::atomic<bool> retired { false };
+        std::thread reader { [&] {
+            typename Domain::Guard guard { domain };
+            Tracked *t = guard.protect(0, shared);
+            reading = true;
+            while (!retired) {
+                std::this_thread::yield();
+            }
+            CPPUNIT_ASSERT(t->value == 42);
+        } };
+        while (!reading) {
+            std::this_thread::yield();
+        }
+        {
+            typename Domain::Guard guard { domain };
+            Tracked *old = shared.exchange(new Tracked(43));
+            guard.retire(old);
+        }
+        domain.collect();
+        CPPUNIT_ASSERT(alive == 2);
+        CPPUNIT_ASSERT(domain.pending() == 1);
+        retired = true;
+        reader.join();
+        domain.collect();
+        CPPUNIT_ASSERT(domain.pending() == 0);
+        CPPUNIT_ASSERT(alive == 1);
+        delete shared.load();
+    }
+
+    // Retiring many objects keeps garbage bounded by the threshold.
+    template<typename Domain>
+    void bounded() {
+        Domain domain { 16 };
+        for (int n=0; n<10000; ++n) {
+            typename Domain::Guard guard { domain };
+            guard.retire(new Tracked(n));
+            CPPUNIT_ASSERT(domain.pending() <= 32);
+        }
+        domain.collect();
+        CPPUNIT_ASSERT(domain.pending() == 0);
+        CPPUNIT_ASSERT(alive == 0);
+    }
+
+    void testEpochProtects() { protects<EpochDomain>(); }
+    void testEpochBounded() { bounded<EpochDomain>(); }
+    void testHazardProtects() { protects<HazardDomain>(); }
+    void testHazardBounded() { bounded<HazardDomain>(); }
+
+    void testDestructor() {
+        {
+            EpochDomain epochs { 1000 };
+            HazardDomain hazards { 1000 };
+            std::thread other { [&] {
+                EpochDomain::Guard e { epochs };
+                HazardDomain::Guard h { hazards };
+                for (int n=0; n<10; ++n) {
+                    e.retire(new Tracked(n));
+                    h.retire(new Tracked(n));
+                }
+            } };
+            other.join();
+            CPPUNIT_ASSERT(alive == 20);
+        }
+        CPPUNIT_ASSERT(alive == 0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ReclaimTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,158 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/rwlocktest.cc Tests DistributedRWLock and SeqLock of
+ *       src/cpp11/rwlock.h.
+ */
+
+#include "cpp11/rwlock.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// Consistent only if all fields are equal.
+struct Snapshot {
+    uint64_t a, b, c;
+    uint32_t d;
+};
+
+} // namespace
+
+class RWLockTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(RWLockTest);
+    CPPUNIT_TEST(testExclusion);
+    CPPUNIT_TEST(testConcurrent);
+    CPPUNIT_TEST(testSeqLock);
+    CPPUNIT_TEST(testSeqLockConcurrent);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testExclusion() {
+        DistributedRWLock lock { 3 };
+        CPPUNIT_ASSERT(lock.slots() == 4);
+        lock.lock_shared();
+        CPPUNIT_ASSERT(lock.try_lock_shared());
+        CPPUNIT_ASSERT(!lock.try_lock());
+        lock.unlock_shared();
+        lock.unlock_shared();
+        CPPUNIT_ASSERT(lock.try_lock());
+        CPPUNIT_ASSERT(!lock.try_lock());
+        CPPUNIT_ASSERT(!lock.try_lock_shared());
+        // Readers of other threads (other slots) are excluded, too.
+        bool read = true;
+        std::thread other { [&] { read = lock.try_lock_shared(); } };
+        other.join();
+        CPPUNIT_ASSERT(!read);
+        lock.unlock();
+        {
+            ReadLock<DistributedRWLock> r1 { lock };
+            ReadLock<DistributedRWLock> r2 { lock };
+            CPPUNIT_ASSERT(!lock.try_lock());
+        }
+        std::unique_lock<DistributedRWLock> writing { lock };
+        CPPUNIT_ASSERT(!lock.try_lock_shared());
+    }
+
+    void testConcurrent() {
+        DistributedRWLock lock;
+        Snapshot data { 0, 0, 0, 0 };
+        std::atomic<bool> stop { false };
+        std::atomic<int> torn { 0 };
+        std::vector<std::thread> readers;
+        for (int t=0; t<4; ++t) {
+            readers.emplace_back([&] {
+                while (!stop) {
+                    ReadLock<DistributedRWLock> read { lock };
+                    if (data.a != data.b || data.b != data.c
+                            || data.c != data.d) {
+                        ++torn;
+                    }
+                }
+            });
+        }
+        for (uint32_t n=1; n<=2000; ++n) {
+            std::unique_lock<DistributedRWLock> write { lock };
+            data.a = n;
+            data.b = n;
+            data.c = n;
+            data.d = n;
+        }
+        stop = true;
+        for (auto &r: readers) {
+            r.join();
+        }
+        CPPUNIT_ASSERT(torn == 0);
+        CPPUNIT_ASSERT(data.d == 2000);
+    }
+
+    void testSeqLock() {
+        SeqLock<Snapshot> seq { Snapshot { 1, 2, 3, 4 } };
+        CPPUNIT_ASSERT(seq.version() == 0);
+        Snapshot s = seq.load();
+        CPPUNIT_ASSERT(s.a == 1 && s.b == 2 && s.c == 3 && s.d == 4);
+        seq.store(Snapshot { 5, 6, 7, 8 });
+        seq.update([](Snapshot v) { v.d += 1; return v; });
+        CPPUNIT_ASSERT(seq.version() == 2);
+        CPPUNIT_ASSERT(seq.try_load(s));
+        CPPUNIT_ASSERT(s.a == 5 && s.d == 9);
+        SeqLock<char> small;
+        CPPUNIT_ASSERT(small.load() == 0);
+        small.store('x');
+        CPPUNIT_ASSERT(small.load() == 'x');
+    }
+
+    void testSeqLockConcurrent() {
+        SeqLock<Snapshot> seq;
+        std::atomic<bool> stop { false };
+        std::atomic<int> torn { 0 };
+        std::atomic<long> loads { 0 };
+        std::vector<std::thread> readers;
+        for (int t=0; t<3; ++t) {
+            readers.emplace_back([&] {
+                uint64_t last = 0;
+                while (!stop) {
+                    const Snapshot s = seq.load();
+                    if (s.a != s.b || s.b != s.c || s.c != s.d
+                            || s.a < last) {
+                        ++torn;
+                    }
+                    last = s.a;
+                    ++loads;
+                }
+            });
+        }
+        // Two writers, each increments all fields.
+        std::vector<std::thread> writers;
+        for (int t=0; t<2; ++t) {
+            writers.emplace_back([&] {
+                for (int n=0; n<5000; ++n) {
+                    seq.update([](Snapshot v) {
+                        ++v.a; ++v.b; ++v.c; ++v.d;
+                        return v;
+                    });
+                }
+            });
+        }
+        for (auto &w: writers) {
+            w.join();
+        }
+        stop = true;
+        for (auto &r: readers) {
+            r.join();
+        }
+        CPPUNIT_ASSERT(torn == 0);
+        CPPUNIT_ASSERT(seq.load().d == 10000);
+        CPPUNIT_ASSERT(seq.version() == 10000);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RWLockTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
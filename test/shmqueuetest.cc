@@ -0,0 +1,229 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/shmqueuetest.cc Tests the shared memory queue of
+ *       src/cpp11/shmqueue.h, also between two processes.
+ */
+
+#include "cpp11/shmqueue.h"
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+struct Tick {
+    uint64_t seq;
+    double price;
+};
+
+// A segment name unique to this process and removed again at the end.
+struct ShmName {
+    std::string name;
+    explicit ShmName(const char *what)
+        : name(std::string("/cpp11-test-") + what + "-"
+            + std::to_string(::getpid())) {
+        ShmRing::unlink(name);
+    }
+    ~ShmName() { ShmRing::unlink(name); }
+};
+
+} // namespace
+
+class ShmQueueTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ShmQueueTest);
+    CPPUNIT_TEST(testRecords);
+    CPPUNIT_TEST(testFullAndWrap);
+    CPPUNIT_TEST(testClose);
+    CPPUNIT_TEST(testTwoProcesses);
+    CPPUNIT_TEST(testReopen);
+    CPPUNIT_TEST(testTakeOver);
+    CPPUNIT_TEST_EXCEPTION(testBadCapacity, std::invalid_argument);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testRecords() {
+        ShmName name("records");
+        ShmRing ring(name.name, 4096);
+        CPPUNIT_ASSERT(ring.capacity()==4096);
+        CPPUNIT_ASSERT(ring.used()==0);
+        ring.write("hello", 5);
+        ring.write("", 0);
+        CPPUNIT_ASSERT(ring.used()==16+8);
+        std::string record;
+        CPPUNIT_ASSERT(ring.try_read(record) && record=="hello");
+        CPPUNIT_ASSERT(ring.try_read(record) && record.empty());
+        CPPUNIT_ASSERT(!ring.try_read(record));
+
+        // A second mapping (as another process has) sees the records.
+        ShmRing other(name.name);
+        ring.write("x", 1);
+        const char *data;
+        size_t size;
+        CPPUNIT_ASSERT(other.try_peek(data, size));
+        CPPUNIT_ASSERT(size==1 && *data=='x');
+        other.consume();
+        CPPUNIT_ASSERT(!ring.try_read(record));
+    }
+
+    void testFullAndWrap() {
+        ShmName name("wrap");
+        ShmRing ring(name.name, 4096);
+        const std::string big(1000, 'b');
+        bool thrown = false;
+        try {
+            ring.try_write(big.data(), ring.max_record() + 1);
+        } catch (const std::length_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+        // Records of 1008 bytes: four fit, the fifth not.
+        for (int n=0; n<4; ++n) {
+            CPPUNIT_ASSERT(ring.try_write(big.data(), big.size()));
+        }
+        CPPUNIT_ASSERT(!ring.try_write(big.data(), big.size()));
+        // Many rounds through the ring with odd sizes and wrap padding,
+        // compared to a plain deque.
+        std::deque<std::string> model(4, big);
+        std::string record;
+        size_t size = 1;
+        for (int round=0; round<200; ++round) {
+            while (model.size() > 2) {
+                CPPUNIT_ASSERT(ring.try_read(record));
+                CPPUNIT_ASSERT(record==model.front());
+                model.pop_front();
+            }
+            for (;;) {
+                size = size * 7 % 1013;
+                const std::string next(size, char('a' + round % 26));
+                if (!ring.try_write(next.data(), next.size())) {
+                    break;
+                }
+                model.push_back(next);
+            }
+        }
+        while (ring.try_read(record)) {
+            CPPUNIT_ASSERT(record==model.front());
+            model.pop_front();
+        }
+        CPPUNIT_ASSERT(model.empty());
+        CPPUNIT_ASSERT(ring.recoveries()==0);
+    }
+
+    void testClose() {
+        ShmName name("close");
+        ShmQueue<Tick> queue(name.name, 4096);
+        queue.add(Tick { 1, 1.5 });
+        queue.close();
+        CPPUNIT_ASSERT(queue.closed());
+        bool thrown = false;
+        try {
+            queue.add(Tick { 2, 2.5 });
+        } catch (const std::logic_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+        Tick t;
+        CPPUNIT_ASSERT(queue.get(t) && t.seq==1 && t.price==1.5);
+        CPPUNIT_ASSERT(!queue.get(t));
+    }
+
+    void testTwoProcesses() {
+        ShmName name("fork");
+        const uint64_t count = 100000;
+        // Small, so that both sides have to wait for each other.
+        ShmQueue<Tick> queue(name.name, 4096);
+        const pid_t child = ::fork();
+        CPPUNIT_ASSERT(child >= 0);
+        if (child == 0) {
+            int status = 0;
+            try {
+                ShmQueue<Tick> producer(name.name);
+                for (uint64_t n=0; n<count; ++n) {
+                    producer.add(Tick { n, n * 0.5 });
+                }
+                producer.close();
+            } catch (...) {
+                status = 1;
+            }
+            ::_exit(status);
+        }
+        Tick t;
+        uint64_t expected = 0;
+        bool ordered = true;
+        while (queue.get(t)) {
+            ordered = ordered && t.seq==expected && t.price==expected*0.5;
+            ++expected;
+        }
+        int status = -1;
+        CPPUNIT_ASSERT(::waitpid(child, &status, 0)==child);
+        CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status)==0);
+        CPPUNIT_ASSERT(ordered);
+        CPPUNIT_ASSERT(expected==count);
+    }
+
+    void testReopen() {
+        ShmName name("reopen");
+        {
+            ShmRing ring(name.name, 8192);
+            ring.write("one", 3);
+            ring.write("two", 3);
+            // A reader that dies between peek and consume...
+            const char *data;
+            size_t size;
+            CPPUNIT_ASSERT(ring.try_peek(data, size) && size==3);
+        }
+        // ... leaves the record for the next one.
+        ShmRing ring(name.name, 8192);
+        CPPUNIT_ASSERT(ring.recoveries()==0);
+        std::string record;
+        CPPUNIT_ASSERT(ring.try_read(record) && record=="one");
+        CPPUNIT_ASSERT(ring.try_read(record) && record=="two");
+        bool thrown = false;
+        try {
+            ShmRing other(name.name, 4096);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+    }
+
+    void testTakeOver() {
+        ShmName name("takeover");
+        // A creator that died before initializing the segment.
+        const int fd = ::shm_open(name.name.c_str(),
+            O_RDWR | O_CREAT | O_EXCL, 0600);
+        CPPUNIT_ASSERT(fd >= 0);
+        CPPUNIT_ASSERT(::ftruncate(fd, 4096)==0);
+        ::close(fd);
+        bool thrown = false;
+        try {
+            ShmRing ring(name.name);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+        ShmRing ring(name.name, 4096);
+        ring.write("ok", 2);
+        std::string record;
+        CPPUNIT_ASSERT(ring.try_read(record) && record=="ok");
+    }
+
+    void testBadCapacity() {
+        ShmRing ring("/cpp11-test-bad", 5000);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ShmQueueTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
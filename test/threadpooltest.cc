@@ -0,0 +1,129 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/threadpooltest.cc Tests the ThreadPool of
+ *       src/cpp11/threadpool.h.
+ */
+
+#include "cpp11/threadpool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ThreadPoolTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(ThreadPoolTest);
+    CPPUNIT_TEST(testSubmit);
+    CPPUNIT_TEST(testParallelFor);
+    CPPUNIT_TEST(testParallelReduce);
+    CPPUNIT_TEST_EXCEPTION(testException, std::runtime_error);
+    CPPUNIT_TEST(testNested);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testSubmit() {
+        ThreadPool pool { 2 };
+        CPPUNIT_ASSERT(pool.size()==2);
+        std::future<int> answer = pool.submit([] { return 6*7; });
+        std::future<std::string> text =
+            pool.submit([] { return std::string("pool"); });
+        std::future<void> fails = pool.submit([] {
+            throw std::runtime_error("task failed");
+        });
+        CPPUNIT_ASSERT(pool.wait(answer)==42);
+        CPPUNIT_ASSERT(text.get()=="pool");
+        bool thrown = false;
+        try {
+            fails.get();
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CPPUNIT_ASSERT(thrown);
+    }
+
+    void testParallelFor() {
+        ThreadPool pool { 3 };
+        std::vector<int> v(100000);
+        pool.parallel_for(size_t{0}, v.size(),
+            [&v](size_t i) { v[i] = static_cast<int>(i) * 2; });
+        for (size_t i=0; i<v.size(); ++i) {
+            CPPUNIT_ASSERT(v[i]==static_cast<int>(i) * 2);
+        }
+        // Signed indices, an explicit grain not dividing the range.
+        std::atomic<int> sum { 0 };
+        std::atomic<int> calls { 0 };
+        pool.parallel_for(-50, 51, [&](int i) { sum += i; ++calls; }, 7);
+        CPPUNIT_ASSERT(sum==0 && calls==101);
+        pool.parallel_for(5, 5, [&](int) { ++calls; });
+        pool.parallel_for(5, 3, [&](int) { ++calls; });
+        CPPUNIT_ASSERT(calls==101);
+    }
+
+    void testParallelReduce() {
+        ThreadPool pool { 4 };
+        const uint64_t n = 1000000;
+        const uint64_t sum = pool.parallel_reduce(uint64_t{1}, n+1,
+            uint64_t{0},
+            [](uint64_t b, uint64_t e) {
+                uint64_t s = 0;
+                for (; b<e; ++b) s += b;
+                return s;
+            },
+            std::plus<uint64_t>());
+        CPPUNIT_ASSERT(sum==n*(n+1)/2);
+
+        // With a fixed grain, floating point sums are reproducible
+        // whatever the number of threads.
+        std::vector<double> values(100000);
+        for (size_t i=0; i<values.size(); ++i) {
+            values[i] = 1.0 / (i + 1);
+        }
+        auto partial = [&values](size_t b, size_t e) {
+            double s = 0.0;
+            for (; b<e; ++b) s += values[b];
+            return s;
+        };
+        ThreadPool single { 1 };
+        const double a = pool.parallel_reduce(size_t{0}, values.size(),
+            0.0, partial, std::plus<double>(), 1000);
+        const double b = single.parallel_reduce(size_t{0}, values.size(),
+            0.0, partial, std::plus<double>(), 1000);
+        CPPUNIT_ASSERT(a==b);
+        CPPUNIT_ASSERT(pool.parallel_reduce(3, 3, 17,
+            [](int, int) { return 1; }, std::plus<int>())==17);
+    }
+
+    void testException() {
+        ThreadPool pool { 2 };
+        pool.parallel_for(0, 1000, [](int i) {
+            if (i == 500) throw std::runtime_error("bad index");
+        });
+    }
+
+    void testNested() {
+        // Tasks waiting for nested loops on a single thread: only works
+        // because waiting threads run pending tasks.
+        ThreadPool pool { 1 };
+        std::atomic<int> count { 0 };
+        std::vector<std::future<void>> outer;
+        for (int t=0; t<4; ++t) {
+            outer.push_back(pool.submit([&pool, &count] {
+                pool.parallel_for(0, 100, [&count](int) { ++count; }, 10);
+            }));
+        }
+        for (auto &f: outer) {
+            pool.wait(f);
+        }
+        CPPUNIT_ASSERT(count==400);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ThreadPoolTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,157 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/timerwheeltest.cc Tests TimerWheel and TimerService of
+ *       src/cpp11/timerwheel.h.
+ */
+
+#include "cpp11/timerwheel.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// Advances \a wheel to \a now, calling the expired callbacks.
+void run(TimerWheel &wheel, uint64_t now)
+{
+    wheel.advance(now, [](TimerWheel::Callback &callback) {
+        callback();
+    });
+}
+
+} // namespace
+
+class TimerWheelTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(TimerWheelTest);
+    CPPUNIT_TEST(testFire);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST(testExactTicks);
+    CPPUNIT_TEST(testFarFuture);
+    CPPUNIT_TEST(testReentrant);
+    CPPUNIT_TEST(testService);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testFire() {
+        TimerWheel wheel { 100 };
+        std::vector<int> fired;
+        wheel.schedule(105, [&fired] { fired.push_back(5); });
+        wheel.schedule(102, [&fired] { fired.push_back(2); });
+        wheel.schedule(50, [&fired] { fired.push_back(0); });
+        CPPUNIT_ASSERT(wheel.size() == 3);
+        CPPUNIT_ASSERT(wheel.next_expiry() == 101);
+        run(wheel, 101);
+        CPPUNIT_ASSERT(fired == std::vector<int>({ 0 }));
+        run(wheel, 104);
+        CPPUNIT_ASSERT(fired == std::vector<int>({ 0, 2 }));
+        CPPUNIT_ASSERT(wheel.next_expiry() == 105);
+        run(wheel, 1000);
+        CPPUNIT_ASSERT(fired == std::vector<int>({ 0, 2, 5 }));
+        CPPUNIT_ASSERT(wheel.empty() && wheel.now() == 1000);
+        CPPUNIT_ASSERT(wheel.next_expiry() == UINT64_MAX);
+    }
+
+    void testCancel() {
+        TimerWheel wheel;
+        int fired = 0;
+        const TimerWheel::TimerId a = wheel.schedule(10, [&] { ++fired; });
+        const TimerWheel::TimerId b =
+            wheel.schedule(100000, [&] { ++fired; });
+        CPPUNIT_ASSERT(a != 0 && a != b);
+        CPPUNIT_ASSERT(wheel.cancel(b));
+        CPPUNIT_ASSERT(!wheel.cancel(b));
+        CPPUNIT_ASSERT(wheel.size() == 1);
+        // The node of b is reused, the old id must not cancel it.
+        const TimerWheel::TimerId c =
+            wheel.schedule(20, [&] { fired += 10; });
+        CPPUNIT_ASSERT(!wheel.cancel(b));
+        run(wheel, 100);
+        CPPUNIT_ASSERT(fired == 11);
+        CPPUNIT_ASSERT(!wheel.cancel(a) && !wheel.cancel(c));
+        CPPUNIT_ASSERT(!wheel.cancel(0));
+    }
+
+    // Random expiries over all levels fire exactly at their tick, also
+    // when advancing in uneven steps.
+    void testExactTicks() {
+        std::mt19937_64 random { 42 };
+        TimerWheel wheel { 12345 };
+        uint64_t late = 0;
+        size_t count = 0;
+        for (int n=0; n<20000; ++n) {
+            const unsigned bits = 1 + random() % 30;
+            const uint64_t expires = wheel.now() + 1
+                + random() % (uint64_t{1} << bits);
+            wheel.schedule(expires, [&, expires] {
+                if (wheel.now() != expires) {
+                    ++late;
+                }
+                ++count;
+            });
+        }
+        while (!wheel.empty()) {
+            run(wheel, wheel.now() + 1 + random() % 100000);
+        }
+        CPPUNIT_ASSERT(count == 20000);
+        CPPUNIT_ASSERT(late == 0);
+    }
+
+    void testFarFuture() {
+        TimerWheel wheel { 7 };
+        uint64_t fired_at = 0;
+        const uint64_t far = (uint64_t{3} << 32) + 99;
+        wheel.schedule(far, [&] { fired_at = wheel.now(); });
+        CPPUNIT_ASSERT(wheel.next_expiry() <= far);
+        run(wheel, far - 1);
+        CPPUNIT_ASSERT(fired_at == 0 && wheel.size() == 1);
+        run(wheel, far);
+        CPPUNIT_ASSERT(fired_at == far);
+    }
+
+    void testReentrant() {
+        TimerWheel wheel;
+        int fired = 0;
+        const TimerWheel::TimerId victim =
+            wheel.schedule(3, [&] { fired += 100; });
+        wheel.schedule(2, [&] {
+            ++fired;
+            wheel.cancel(victim);
+            wheel.schedule(wheel.now(), [&] { ++fired; });
+        });
+        run(wheel, 2);
+        CPPUNIT_ASSERT(fired == 1 && wheel.size() == 1);
+        run(wheel, 3);
+        CPPUNIT_ASSERT(fired == 2 && wheel.empty());
+    }
+
+    void testService() {
+        ThreadPool pool { 2 };
+        TimerService timers { pool };
+        using Clock = TimerService::Clock;
+        const Clock::time_point start = Clock::now();
+        auto done = std::make_shared<std::promise<Clock::time_point>>();
+        std::atomic<int> cancelled_fired { 0 };
+        timers.schedule_after(std::chrono::milliseconds{30},
+            [done] { done->set_value(Clock::now()); });
+        const TimerService::TimerId id = timers.schedule_after(
+            std::chrono::milliseconds{20}, [&] { ++cancelled_fired; });
+        CPPUNIT_ASSERT(timers.pending() == 2);
+        CPPUNIT_ASSERT(timers.cancel(id));
+        const Clock::time_point fired = done->get_future().get();
+        CPPUNIT_ASSERT(fired - start >= std::chrono::milliseconds{30});
+        CPPUNIT_ASSERT(cancelled_fired == 0);
+        CPPUNIT_ASSERT(timers.pending() == 0);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TimerWheelTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
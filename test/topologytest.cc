@@ -0,0 +1,201 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/topologytest.cc Tests CpuTopology, pinning and NodeBuffer
+ *       of src/cpp11/topology.h.
+ */
+
+#include "cpp11/topology.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// A sysfs lookalike in a temporary directory, removed again at the end.
+class FakeSysfs {
+  public:
+    FakeSysfs() {
+        char name[] = "/tmp/cpp11-sysfs-XXXXXX";
+        root_ = ::mkdtemp(name);
+    }
+    ~FakeSysfs() {
+        for (auto it=paths_.rbegin(); it!=paths_.rend(); ++it) {
+            std::remove(it->c_str());
+        }
+        std::remove(root_.c_str());
+    }
+    const std::string &root() const { return root_; }
+    // Writes \a path (below the root), creating its directories.
+    void write(const std::string &path, const std::string &text) {
+        size_t slash = 0;
+        while ((slash = path.find('/', slash + 1)) != std::string::npos) {
+            const std::string dir = root_ + "/" + path.substr(0, slash);
+            if (::mkdir(dir.c_str(), 0700) == 0) {
+                paths_.push_back(dir);
+            }
+        }
+        const std::string file = root_ + "/" + path;
+        std::ofstream { file } << text << "\n";
+        paths_.push_back(file);
+    }
+
+  private:
+    std::string root_;
+    std::vector<std::string> paths_;
+};
+
+// Two packages (and nodes) of two cores with two threads each, numbered
+// as Linux does: the second threads of all cores follow the first ones.
+void write_two_sockets(FakeSysfs &sysfs)
+{
+    sysfs.write("cpu/online", "0-7");
+    for (unsigned cpu=0; cpu<8; ++cpu) {
+        const std::string dir =
+            "cpu/cpu" + std::to_string(cpu) + "/topology/";
+        sysfs.write(dir + "core_id", std::to_string(cpu % 2));
+        sysfs.write(dir + "physical_package_id",
+            std::to_string(cpu % 4 / 2));
+    }
+    sysfs.write("node/online", "0-1");
+    sysfs.write("node/node0/cpulist", "0-1,4-5");
+    sysfs.write("node/node1/cpulist", "2-3,6-7");
+}
+
+} // namespace
+
+class TopologyTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(TopologyTest);
+    CPPUNIT_TEST(testParse);
+    CPPUNIT_TEST(testSysfs);
+    CPPUNIT_TEST(testAllowed);
+    CPPUNIT_TEST(testFlat);
+    CPPUNIT_TEST(testPin);
+    CPPUNIT_TEST(testNodeBuffer);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testParse() {
+        CPPUNIT_ASSERT(parse_cpu_list("0-3,8,10-11\n")
+            == CpuList({ 0, 1, 2, 3, 8, 10, 11 }));
+        CPPUNIT_ASSERT(parse_cpu_list("5,1,5") == CpuList({ 1, 5 }));
+        CPPUNIT_ASSERT(parse_cpu_list("").empty());
+        CPPUNIT_ASSERT(parse_cpu_list("\n").empty());
+        CPPUNIT_ASSERT_THROW(parse_cpu_list("3-1"), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(parse_cpu_list("1-"), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(parse_cpu_list("cpu0"),
+            std::invalid_argument);
+    }
+
+    void testSysfs() {
+        FakeSysfs sysfs;
+        write_two_sockets(sysfs);
+        const CpuTopology topology { CpuList(), sysfs.root() };
+        CPPUNIT_ASSERT(topology.cpus().size() == 8);
+        const CpuTopology::Cpu &cpu = topology.cpu(6);
+        CPPUNIT_ASSERT(cpu.id == 6 && cpu.core == 0 && cpu.package == 1
+            && cpu.node == 1);
+        CPPUNIT_ASSERT_THROW(topology.cpu(8), std::out_of_range);
+        CPPUNIT_ASSERT(topology.nodes() == CpuList({ 0, 1 }));
+        CPPUNIT_ASSERT(topology.node_cpus(1) == CpuList({ 2, 3, 6, 7 }));
+        CPPUNIT_ASSERT(topology.siblings(1) == CpuList({ 1, 5 }));
+        CPPUNIT_ASSERT(topology.nearest(0)
+            == CpuList({ 0, 4, 1, 5, 2, 3, 6, 7 }));
+        CPPUNIT_ASSERT(topology.close_pair() == std::make_pair(0u, 1u));
+    }
+
+    void testAllowed() {
+        FakeSysfs sysfs;
+        write_two_sockets(sysfs);
+        // Only siblings left: better than crossing packages.
+        const CpuTopology siblings { { 0, 4, 2 }, sysfs.root() };
+        CPPUNIT_ASSERT(siblings.cpus().size() == 3);
+        CPPUNIT_ASSERT(siblings.close_pair() == std::make_pair(0u, 4u));
+        const CpuTopology apart { { 3, 0 }, sysfs.root() };
+        CPPUNIT_ASSERT(apart.close_pair() == std::make_pair(0u, 3u));
+        const CpuTopology single { { 5 }, sysfs.root() };
+        CPPUNIT_ASSERT(single.close_pair() == std::make_pair(5u, 5u));
+    }
+
+    void testFlat() {
+        const CpuTopology topology { { 0, 1, 2 }, "/nonexistent" };
+        CPPUNIT_ASSERT(topology.cpus().size() == 3);
+        CPPUNIT_ASSERT(topology.nodes() == CpuList({ 0 }));
+        CPPUNIT_ASSERT(topology.siblings(2) == CpuList({ 2 }));
+        CPPUNIT_ASSERT(topology.close_pair() == std::make_pair(0u, 1u));
+        CPPUNIT_ASSERT(!CpuTopology::system().cpus().empty());
+    }
+
+    void testPin() {
+        const CpuList allowed = this_thread_cpus();
+        CPPUNIT_ASSERT(!allowed.empty());
+        const unsigned cpu = allowed.back();
+        CpuList seen;
+        int ran_on = -1;
+        pinned_thread({ cpu }, [&] {
+            seen = this_thread_cpus();
+            ran_on = ::sched_getcpu();
+        }).join();
+        CPPUNIT_ASSERT(seen == CpuList({ cpu }));
+        CPPUNIT_ASSERT(ran_on == static_cast<int>(cpu));
+        // The caller stays as it was.
+        CPPUNIT_ASSERT(this_thread_cpus() == allowed);
+
+        // The process' CPUs and the system topology do not depend on the
+        // asking thread, even if that one comes first.
+        const CpuList process = process_cpus();
+        CpuList from_pinned, system_ids;
+        pinned_thread({ cpu }, [&] {
+            from_pinned = process_cpus();
+            for (const CpuTopology::Cpu &c: CpuTopology::system().cpus()) {
+                system_ids.push_back(c.id);
+            }
+        }).join();
+        CPPUNIT_ASSERT(from_pinned == process);
+        CPPUNIT_ASSERT(system_ids == process);
+
+        bool ran = false;
+        CPPUNIT_ASSERT_THROW(pinned_thread(CpuList(), [&] { ran = true; }),
+            std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(
+            pinned_thread({ CPU_SETSIZE - 1 }, [&] { ran = true; }),
+            std::system_error);
+        CPPUNIT_ASSERT(!ran);
+    }
+
+    void testNodeBuffer() {
+        const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        NodeBuffer here { 10000 };
+        CPPUNIT_ASSERT(here.size() >= 10000 && here.size() % page == 0);
+        unsigned char *bytes = here.as<unsigned char>();
+        for (size_t n=0; n<here.size(); ++n) {
+            CPPUNIT_ASSERT(bytes[n] == 0);
+        }
+        bytes[here.size() - 1] = 42;
+
+        const CpuTopology &topology = CpuTopology::system();
+        const int node = static_cast<int>(topology.cpus().front().node);
+        NodeBuffer there { 1, node };
+        CPPUNIT_ASSERT(there.size() == page);
+        NodeBuffer moved { std::move(there) };
+        CPPUNIT_ASSERT(moved.size() == page && there.data() == nullptr);
+        CPPUNIT_ASSERT_THROW(NodeBuffer(1, 1 << 20),
+            std::invalid_argument);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TopologyTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,119 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/waitstrategytest.cc Tests src/cpp11/waitstrategy.h.
+ */
+
+#include "cpp11/waitstrategy.h"
+#include "cpp11/consumer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class WaitStrategyTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(WaitStrategyTest);
+    CPPUNIT_TEST(testEventCount);
+    CPPUNIT_TEST(testSpinThenPark);
+    CPPUNIT_TEST(testParkOnly);
+    CPPUNIT_TEST_SUITE_END();
+
+    // Several producers and consumers pass numbers; checks the sum.
+    template<typename Q>
+    void check_queue(Q &queue, int producers, int consumers, int each) {
+        std::atomic<long> sum { 0 };
+        std::vector<std::thread> threads;
+        for (int c=0; c<consumers; ++c) {
+            threads.emplace_back([&] {
+                for (;;) {
+                    int m = queue.get();
+                    if (m < 0) break;
+                    sum.fetch_add(m);
+                }
+            });
+        }
+        std::vector<std::thread> adders;
+        for (int p=0; p<producers; ++p) {
+            adders.emplace_back([&] {
+                for (int n=1; n<=each; ++n) {
+                    queue.add(n);
+                    if (n % 1000 == 0) {
+                        // Give consumers a reason to park.
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds{200});
+                    }
+                }
+            });
+        }
+        for (auto &t: adders) {
+            t.join();
+        }
+        for (int c=0; c<consumers; ++c) {
+            queue.add(-1);
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+        CPPUNIT_ASSERT(sum.load() == long(producers) * each * (each+1) / 2);
+    }
+
+  public:
+    void testEventCount() {
+        EventCount events;
+        // Notify without waiters is a no-op.
+        events.notify_one();
+        events.notify_all();
+        CPPUNIT_ASSERT(events.waiters()==0);
+
+        std::atomic<bool> flag { false };
+        std::thread waiter { [&] {
+            while (!flag.load()) {
+                EventCount::Key key = events.prepare_wait();
+                if (flag.load()) {
+                    events.cancel_wait();
+                    break;
+                }
+                events.wait(key);
+            }
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        flag.store(true);
+        events.notify_all();
+        waiter.join();
+        CPPUNIT_ASSERT(events.waiters()==0);
+
+        // A key from before a notify does not block.
+        EventCount::Key key = events.prepare_wait();
+        std::thread notifier { [&] { events.notify_one(); } };
+        notifier.join();
+        events.wait(key);
+        CPPUNIT_ASSERT(events.waiters()==0);
+    }
+
+    void testSpinThenPark() {
+        Queue<int, NoQueueStats, SpinThenParkWait> queue;
+        CPPUNIT_ASSERT(queue.wait_policy().strategy().spins
+            == WaitStrategy::spin_then_park().spins);
+        check_queue(queue, 2, 3, 5000);
+        CPPUNIT_ASSERT(queue.wait_policy().sleepers()==0);
+        CPPUNIT_ASSERT(queue.size()==0);
+    }
+
+    void testParkOnly() {
+        // No spinning at all: every wait goes through the EventCount.
+        Queue<int, QueueStats, SpinThenParkWait> queue;
+        queue.wait_policy().configure(WaitStrategy::park());
+        queue.stats().enable();
+        check_queue(queue, 1, 2, 3000);
+        CPPUNIT_ASSERT(queue.stats().snapshot().latency.count()==3002);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WaitStrategyTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
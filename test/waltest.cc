@@ -0,0 +1,319 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/waltest.cc Tests the write-ahead log of src/cpp11/wal.h.
+ */
+
+#include "cpp11/wal.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace {
+
+// A fresh directory below /tmp, removed with its files at the end.
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char name[] = "/tmp/cpp11-waltest-XXXXXX";
+        if (!::mkdtemp(name)) {
+            throw std::runtime_error("mkdtemp failed");
+        }
+        path = name;
+    }
+    ~TempDir() {
+        for (const std::string &file: files()) {
+            ::unlink((path + "/" + file).c_str());
+        }
+        ::rmdir(path.c_str());
+    }
+    std::vector<std::string> files() const {
+        std::vector<std::string> result;
+        DIR *dir = ::opendir(path.c_str());
+        while (const dirent *entry = ::readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                result.push_back(entry->d_name);
+            }
+        }
+        ::closedir(dir);
+        return result;
+    }
+    size_t segments() const {
+        size_t n = 0;
+        for (const std::string &file: files()) {
+            n += file.find(".wal") != std::string::npos;
+        }
+        return n;
+    }
+};
+
+typedef std::vector<std::pair<WriteAheadLog::Sequence, std::string>>
+    Records;
+
+Records replay(const WriteAheadLog &log)
+{
+    Records records;
+    log.replay([&records](WriteAheadLog::Sequence seq, const char *data,
+            size_t size) {
+        records.emplace_back(seq, std::string(data, size));
+    });
+    return records;
+}
+
+struct Order {
+    int id;
+    double amount;
+};
+
+} // namespace
+
+class WalTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(WalTest);
+    CPPUNIT_TEST(testCrc32);
+    CPPUNIT_TEST(testAppendReplay);
+    CPPUNIT_TEST(testGroupCommit);
+    CPPUNIT_TEST(testTornTail);
+    CPPUNIT_TEST_EXCEPTION(testDamaged, std::runtime_error);
+    CPPUNIT_TEST_EXCEPTION(testDamagedLast, std::runtime_error);
+    CPPUNIT_TEST(testCheckpoint);
+    CPPUNIT_TEST(testDurableQueue);
+    CPPUNIT_TEST(testDurableQueueProducers);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testCrc32() {
+        CPPUNIT_ASSERT(crc32("123456789", 9)==0xcbf43926u);
+        CPPUNIT_ASSERT(crc32("", 0)==0);
+        CPPUNIT_ASSERT(crc32("6789", 4, crc32("12345", 5))==0xcbf43926u);
+    }
+
+    void testAppendReplay() {
+        TempDir dir;
+        {
+            WalOptions options;
+            options.max_delay = std::chrono::microseconds{0};
+            WriteAheadLog log(dir.path, options);
+            CPPUNIT_ASSERT(replay(log).empty());
+            std::vector<std::thread> threads;
+            for (int t=0; t<4; ++t) {
+                threads.emplace_back([&log, t] {
+                    for (int n=0; n<25; ++n) {
+                        log.append(std::to_string(t*100 + n));
+                    }
+                });
+            }
+            for (auto &thread: threads) {
+                thread.join();
+            }
+            CPPUNIT_ASSERT(log.durable()==100);
+            const WalStats stats = log.stats();
+            CPPUNIT_ASSERT(stats.records==100);
+            CPPUNIT_ASSERT(stats.batch_records.sum()==100);
+        }
+        WriteAheadLog log(dir.path);
+        const Records records = replay(log);
+        CPPUNIT_ASSERT(records.size()==100);
+        std::vector<int> next(4, 0);
+        for (size_t i=0; i<records.size(); ++i) {
+            CPPUNIT_ASSERT(records[i].first==i+1);
+            // Each thread's records are in its order.
+            const int value = std::stoi(records[i].second);
+            CPPUNIT_ASSERT(value % 100==next[value / 100]++);
+        }
+        CPPUNIT_ASSERT(log.append("more")==101);
+    }
+
+    void testGroupCommit() {
+        TempDir dir;
+        WalOptions options;
+        options.max_delay = std::chrono::milliseconds{50};
+        WriteAheadLog log(dir.path, options);
+        std::vector<std::thread> threads;
+        for (int t=0; t<8; ++t) {
+            threads.emplace_back([&log] { log.append("x"); });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        // All waited for the same window, so fewer syncs than records.
+        const WalStats stats = log.stats();
+        CPPUNIT_ASSERT(stats.records==8);
+        CPPUNIT_ASSERT(stats.batch_records.count() < 8);
+        CPPUNIT_ASSERT(stats.batch_records.max() > 1);
+
+        // flush() does not wait for the window.
+        const WriteAheadLog::Sequence seq = log.append_async("y", 1);
+        log.flush();
+        log.wait_durable(seq);
+    }
+
+    void testTornTail() {
+        TempDir dir;
+        {
+            WriteAheadLog log(dir.path);
+            log.append("one");
+            log.append("two");
+            log.append("three");
+        }
+        {
+            // A crash in the middle of writing a record.
+            std::ofstream segment(dir.path + "/" + dir.files().front(),
+                std::ios::app | std::ios::binary);
+            segment.write("\x05\0\0\0\x12\x34", 6);
+        }
+        {
+            WriteAheadLog log(dir.path);
+            const Records records = replay(log);
+            CPPUNIT_ASSERT(records.size()==3);
+            CPPUNIT_ASSERT(records[2].second=="three");
+            CPPUNIT_ASSERT(log.append("four")==4);
+        }
+        WriteAheadLog log(dir.path);
+        CPPUNIT_ASSERT(replay(log).size()==4);
+    }
+
+    void testDamaged() {
+        TempDir dir;
+        WalOptions options;
+        options.segment_bytes = 1;      // a segment per batch
+        options.max_delay = std::chrono::microseconds{0};
+        {
+            WriteAheadLog log(dir.path, options);
+            log.append("first");
+            log.append("second");
+        }
+        CPPUNIT_ASSERT(dir.segments()==3);
+        {
+            // Flip a payload byte of the oldest segment.
+            std::fstream segment(dir.path + "/00000000000000000001.wal",
+                std::ios::in | std::ios::out | std::ios::binary);
+            segment.seekp(16);
+            segment.put('F');
+        }
+        WriteAheadLog log(dir.path, options);
+    }
+
+    void testDamagedLast() {
+        TempDir dir;
+        {
+            WriteAheadLog log(dir.path);
+            log.append("one");
+            log.append("two");
+            log.append("three");
+        }
+        CPPUNIT_ASSERT(dir.segments()==1);
+        {
+            // Flip a payload byte of the first record: the intact records
+            // behind it must not be cut off as a torn end.
+            std::fstream segment(dir.path + "/" + dir.files().front(),
+                std::ios::in | std::ios::out | std::ios::binary);
+            segment.seekp(16);
+            segment.put('O');
+        }
+        WriteAheadLog log(dir.path);
+    }
+
+    void testCheckpoint() {
+        TempDir dir;
+        WalOptions options;
+        options.segment_bytes = 1;
+        options.max_delay = std::chrono::microseconds{0};
+        {
+            WriteAheadLog log(dir.path, options);
+            for (int n=1; n<=10; ++n) {
+                log.append(std::to_string(n));
+            }
+            CPPUNIT_ASSERT(dir.segments()==11);
+            log.checkpoint(6);
+            CPPUNIT_ASSERT(log.checkpointed()==6);
+            CPPUNIT_ASSERT(dir.segments()==5);
+            bool thrown = false;
+            try {
+                log.checkpoint(11);
+            } catch (const std::logic_error &) {
+                thrown = true;
+            }
+            CPPUNIT_ASSERT(thrown);
+        }
+        WriteAheadLog log(dir.path, options);
+        const Records records = replay(log);
+        CPPUNIT_ASSERT(records.size()==4);
+        CPPUNIT_ASSERT(records.front().first==7);
+        CPPUNIT_ASSERT(records.front().second=="7");
+        CPPUNIT_ASSERT(log.append("11")==11);
+    }
+
+    void testDurableQueue() {
+        TempDir dir;
+        {
+            DurableQueue<Order> orders(dir.path);
+            orders.add(Order { 1, 10.0 });
+            orders.add(Order { 2, 20.0 });
+            orders.add(Order { 3, 30.0 });
+            WriteAheadLog::Sequence seq;
+            CPPUNIT_ASSERT(orders.get(seq).id==1);
+            orders.checkpoint(seq);
+            CPPUNIT_ASSERT(orders.get().id==2);   // not checkpointed
+        }
+        DurableQueue<Order> orders(dir.path);
+        CPPUNIT_ASSERT(orders.size()==2);
+        CPPUNIT_ASSERT(orders.get().id==2);
+        const Order o = orders.get();
+        CPPUNIT_ASSERT(o.id==3 && o.amount==30.0);
+    }
+    void testDurableQueueProducers() {
+        TempDir dir;
+        WalOptions options;
+        options.max_delay = std::chrono::microseconds{200};
+        const int producers = 4, each = 200;
+        std::vector<int> processed;
+        {
+            DurableQueue<Order> orders(dir.path, options);
+            std::vector<std::thread> threads;
+            for (int p=0; p<producers; ++p) {
+                threads.emplace_back([&orders, p, each] {
+                    for (int n=0; n<each; ++n) {
+                        orders.add(Order { p * each + n, 1.0 });
+                    }
+                });
+            }
+            // Messages come in sequence order, so checkpointing each
+            // one never covers a message not taken yet.
+            WriteAheadLog::Sequence last = 0, seq;
+            for (int n=0; n<producers * each / 2; ++n) {
+                processed.push_back(orders.get(seq).id);
+                CPPUNIT_ASSERT(seq == last + 1);
+                orders.checkpoint(seq);
+                last = seq;
+            }
+            for (auto &t: threads) {
+                t.join();
+            }
+            // A crash: the rest is never taken.
+        }
+        DurableQueue<Order> orders(dir.path, options);
+        CPPUNIT_ASSERT(orders.size() == producers * each / 2);
+        while (orders.size()) {
+            processed.push_back(orders.get().id);
+        }
+        std::sort(processed.begin(), processed.end());
+        for (int n=0; n<producers * each; ++n) {
+            CPPUNIT_ASSERT(processed[n] == n);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WalTest);
+
+/* vim: set ts=4 sw=4 tw=76: */
@@ -0,0 +1,178 @@
+/**
+ * Cpp11 - [c] Steffen Dettmer 2012, 2014 <Steffen.Dettmer@gmail.com>
+ *
+ * Examples in form of test code demonstrating C++ 2011.
+ *
+ * \file test/workstealingtest.cc Tests src/cpp11/workstealing.h.
+ */
+
+#include "cpp11/workstealing.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class WorkStealingTest : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE(WorkStealingTest);
+    CPPUNIT_TEST(testDeque);
+    CPPUNIT_TEST(testDequeSteal);
+    CPPUNIT_TEST(testPool);
+    CPPUNIT_TEST(testPoolSpawn);
+    CPPUNIT_TEST_EXCEPTION(testSubmitAfterShutdown, std::logic_error);
+    CPPUNIT_TEST(testShutdownWhileSubmitting);
+    CPPUNIT_TEST(testMessagePool);
+    CPPUNIT_TEST_SUITE_END();
+  public:
+    void testDeque() {
+        // Owner side is LIFO, thief side FIFO; grows beyond initial size.
+        ChaseLevDeque<intptr_t> deque { 2 };
+        for (intptr_t n=1; n<=10; ++n) {
+            deque.push(n);
+        }
+        CPPUNIT_ASSERT(deque.size()==10);
+        CPPUNIT_ASSERT(deque.take()==10);
+        CPPUNIT_ASSERT(deque.steal()==1);
+        CPPUNIT_ASSERT(deque.steal()==2);
+        CPPUNIT_ASSERT(deque.take()==9);
+        CPPUNIT_ASSERT(deque.size()==6);
+        while (deque.take()) { }
+        CPPUNIT_ASSERT(deque.size()==0);
+        CPPUNIT_ASSERT(deque.take()==0);
+        CPPUNIT_ASSERT(deque.steal()==0);
+    }
+
+    void testDequeSteal() {
+        // Every element must be taken exactly once, by owner or thieves.
+        const intptr_t count = 100000;
+        ChaseLevDeque<intptr_t> deque { 16 };
+        std::vector<std::atomic<int>> seen(count+1);
+        std::atomic<bool> done { false };
+        auto mark = [&] (intptr_t value) { seen[value].fetch_add(1); };
+
+        std::vector<std::thread> thieves;
+        for (int n=0; n<3; ++n) {
+            thieves.emplace_back([&] {
+                while (!done.load() || deque.size() > 0) {
+                    if (intptr_t value = deque.steal()) {
+                        mark(value);
+                    }
+                }
+            });
+        }
+        for (intptr_t n=1; n<=count; ++n) {
+            deque.push(n);
+            if (n%3 == 0) {
+                if (intptr_t value = deque.take()) {
+                    mark(value);
+                }
+            }
+        }
+        while (intptr_t value = deque.take()) {
+            mark(value);
+        }
+        done.store(true);
+        for (auto &t: thieves) {
+            t.join();
+        }
+        for (intptr_t n=1; n<=count; ++n) {
+            CPPUNIT_ASSERT(seen[n].load()==1);
+        }
+    }
+
+    void testPool() {
+        std::atomic<int> sum { 0 };
+        {
+            WorkStealingPool pool { 4 };
+            CPPUNIT_ASSERT(pool.size()==4);
+            for (int n=1; n<=1000; ++n) {
+                pool.submit([&sum, n] { sum.fetch_add(n); });
+            }
+            // Destructor shuts down gracefully, running everything.
+        }
+        CPPUNIT_ASSERT(sum.load()==1000*1001/2);
+    }
+
+    void testPoolSpawn() {
+        // A task tree: each node spawns two children from inside the pool,
+        // so most work travels through local deques and stealing.
+        std::atomic<int> leaves { 0 };
+        WorkStealingPool pool { 3 };
+        std::function<void(int)> node = [&] (int depth) {
+            if (depth == 0) {
+                leaves.fetch_add(1);
+                return;
+            }
+            pool.submit([&node, depth] { node(depth-1); });
+            pool.submit([&node, depth] { node(depth-1); });
+        };
+        pool.submit([&node] { node(12); });
+        pool.shutdown();
+        CPPUNIT_ASSERT(leaves.load()==4096);
+        CPPUNIT_ASSERT(pool.pending()==0);
+    }
+
+    void testSubmitAfterShutdown() {
+        WorkStealingPool pool { 1 };
+        pool.shutdown();
+        pool.submit([] { });
+    }
+
+    void testShutdownWhileSubmitting() {
+        // Every task that submit() accepted runs before shutdown()
+        // returns, also when outside threads submit meanwhile.
+        for (int round=0; round<20; ++round) {
+            std::atomic<int> accepted { 0 }, ran { 0 };
+            WorkStealingPool pool { 2 };
+            std::vector<std::thread> producers;
+            for (int p=0; p<3; ++p) {
+                producers.emplace_back([&] {
+                    try {
+                        for (;;) {
+                            pool.submit([&ran] { ran.fetch_add(1); });
+                            accepted.fetch_add(1);
+                        }
+                    } catch (const std::logic_error &) {
+                    }
+                });
+            }
+            while (accepted.load() < 100) {
+                std::this_thread::yield();
+            }
+            pool.shutdown();
+            for (auto &t: producers) {
+                t.join();
+            }
+            CPPUNIT_ASSERT(ran.load()==accepted.load());
+        }
+    }
+
+    void testMessagePool() {
+        std::atomic<int> stops { 0 };
+        std::atomic<int> consumed { 0 };
+        MessagePool<std::string> pool {
+            [&] (const std::string &m) {
+                if (m == "STOP") {
+                    stops.fetch_add(1);
+                } else {
+                    consumed.fetch_add(1);
+                }
+            },
+            2
+        };
+        for (int n=0; n<100; ++n) {
+            pool.add("MSG_" + std::to_string(n));
+        }
+        pool.add("STOP");
+        pool.shutdown();
+        CPPUNIT_ASSERT(consumed.load()==100);
+        CPPUNIT_ASSERT(stops.load()==1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WorkStealingTest);
+
+/* vim: set ts=4 sw=4 tw=76: */